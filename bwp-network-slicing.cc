@@ -16,6 +16,9 @@
 #include "ns3/point-to-point-helper.h"
 #include "ns3/point-to-point-module.h"
 
+#include "slicing-event-log.h"
+#include "slicing-trace-manager.h"
+
 #include <iostream>
 #include <chrono>
 #include <ctime>    
@@ -50,6 +53,8 @@ main(int argc, char* argv[])
     bool udpFullBuffer = false;
     uint32_t udpPacketSize [] = {1252, 1252, 1252};   // packet size in bytes
     uint32_t lambda [] = {1000, 1000, 1000};
+    uint32_t ulPacketSize [] = {100, 50, 1252};  // packet size in bytes
+    uint32_t ulLambda [] = {500, 125, 1000};
     /*
     uint32_t udpPacketSize [] = {(uint32_t)(45000000./8./60.),
                                  (uint32_t)(30000000./8./60.),
@@ -57,12 +62,18 @@ main(int argc, char* argv[])
     uint32_t lambda [] = {60, 60, 30};
     */
     bool logging = true;
+    bool textLogging = false;
 
     // commencing...
     auto start = std::chrono::system_clock::now();
     std::time_t start_time = std::chrono::system_clock::to_time_t(start);
-    std::string simTag = std::ctime(&start_time);
+    char startTag[32];
+    std::strftime(startTag, sizeof(startTag), "%Y%m%d-%H%M%S", std::localtime(&start_time));
+    std::string simTag = std::string("results-") + startTag + ".txt";
     std::string outputDir = "./";
+    // NR traces: binary records of the selected families, see SliceTraceManager
+    std::string traceFamilies = "rxPacket,dlSched,ulSched,slotStats";
+    bool legacyTraces = false;
 
     // unit: seconds
     double simTime = 1;          
@@ -74,6 +85,9 @@ main(int argc, char* argv[])
     cmd.AddValue("ueNumPergNb0", "The number of UE per gNb of type 1 in multiple-ue topology", ueNumPergNb[0]);
     cmd.AddValue("ueNumPergNb1", "The number of UE per gNb of type 2 in multiple-ue topology", ueNumPergNb[1]);
     cmd.AddValue("ueNumPergNb2", "The number of UE per gNb of type 3 in multiple-ue topology", ueNumPergNb[2]);
+    cmd.AddValue("numFlowsUe",
+                 "The number of DL flows per UE, carried by one bearer with a port-range filter",
+                 numFlowsUe);
     cmd.AddValue("centralFrequencyBand",
                  "The system frequency to be used in band 1",
                  centralFrequencyBand);
@@ -111,11 +125,23 @@ main(int argc, char* argv[])
                  "Whether to set the full buffer traffic; if this parameter is "
                  "set then the udpInterval parameter will be neglected.",
                  udpFullBuffer);
-    cmd.AddValue("logging", "Enable logging", logging);
+    cmd.AddValue("logging",
+                 "Enable the binary event log <simTag>.evlog, see log-decode-network-slicing",
+                 logging);
+    cmd.AddValue("textLogging",
+                 "Enable the INFO text logs of UdpClient, UdpServer and LtePdcp",
+                 textLogging);
     cmd.AddValue("simTag",
                  "tag to be appended to output filenames to distinguish simulation campaigns",
                  simTag);
     cmd.AddValue("outputDir", "directory where to store simulation results", outputDir);
+    cmd.AddValue("traceFamilies",
+                 "NR trace families written to <simTag>.nrtrace: rxPacket, dlSched, ulSched, "
+                 "slotStats, rlc, pdcp or all; empty disables the NR traces",
+                 traceFamilies);
+    cmd.AddValue("legacyTraces",
+                 "Enable every text trace of the nr module instead of the binary traces",
+                 legacyTraces);
 
     cmd.Parse(argc, argv);
 
@@ -125,7 +151,7 @@ main(int argc, char* argv[])
     // inputConfig.ConfigureDefaults ();
 
     // enable logging or not
-    if (logging)
+    if (textLogging)
     {
 //        LogComponentEnable("Nr3gppPropagationLossModel", LOG_LEVEL_ALL);
 //        LogComponentEnable("Nr3gppBuildingsPropagationLossModel", LOG_LEVEL_ALL);
@@ -134,6 +160,15 @@ main(int argc, char* argv[])
         LogComponentEnable("UdpServer", LOG_LEVEL_INFO);
         LogComponentEnable("LtePdcp", LOG_LEVEL_INFO);
     }
+    if (logging)
+    {
+        std::string eventLogFile = outputDir + "/" + simTag + ".evlog";
+        if (!SliceEventLog::Open(eventLogFile))
+        {
+            std::cerr << "Can't open file " << eventLogFile << std::endl;
+            return 1;
+        }
+    }
 
     Config::SetDefault("ns3::LteRlcUm::MaxTxBufferSize", UintegerValue(999999999));
 
@@ -374,35 +409,65 @@ main(int argc, char* argv[])
     // attach UEs to the closest eNB before creating the dedicated flows
     nrHelper->AttachToClosestEnb(ueNetDev, enbNetDev);
 
-    // install UDP applications
+    // install UDP applications; every port stays below the ephemeral ones of the TCP ACKs
+    uint32_t numUes = ueNumPergNb[0] + ueNumPergNb[1] + ueNumPergNb[2];
+    NS_ABORT_MSG_IF(numFlowsUe == 0, "numFlowsUe must be at least 1");
+    NS_ABORT_MSG_IF(1234 + numUes * (numFlowsUe + 1) + 1 >= 49152,
+                    "numFlowsUe " << numFlowsUe << " for " << numUes
+                                  << " UEs takes ports beyond the first ephemeral port 49152");
     uint16_t dlPort = 1234;
     uint16_t ulPort = dlPort + (ueNumPergNb[0]+ueNumPergNb[1]+ueNumPergNb[2]) * numFlowsUe + 1;
     ApplicationContainer clientVrApps, clientCgApps, clientAdApps;
+    ApplicationContainer clientUlApps;
     ApplicationContainer serverApps;
 
     for (uint32_t u = 0; u < ueNumPergNb[0]; ++u)
     {
         // DL ONLY
-        PacketSinkHelper dlPacketSinkHelper(
+        // the flows of a UE share its load
+        for (uint16_t f = 0; f < numFlowsUe; ++f)
+        {
+            PacketSinkHelper dlPacketSinkHelper(
+                "ns3::UdpSocketFactory",
+                InetSocketAddress(Ipv4Address::GetAny(), dlPort + f));
+            serverApps.Add(dlPacketSinkHelper.Install(ueNodes.Get(u)));
+
+            // VR: 
+            UdpClientHelper dlClient(ueIpIface.GetAddress(u), dlPort + f);
+            dlClient.SetAttribute("PacketSize", UintegerValue(udpPacketSize[0]));
+            dlClient.SetAttribute("Interval", TimeValue(Seconds(numFlowsUe / lambda[0])));
+            dlClient.SetAttribute("MaxPackets", UintegerValue(0xFFFFFFFF));
+            dlClient.SetAttribute("StartTime", TimeValue(Seconds(0.3+0.1*u)));
+            dlClient.SetAttribute("StopTime", TimeValue(Seconds(0.4+0.1*u)));
+            clientVrApps.Add(dlClient.Install(remoteHost));
+        }
+
+        // UL
+        PacketSinkHelper ulPacketSinkHelper(
             "ns3::UdpSocketFactory",
-            InetSocketAddress(Ipv4Address::GetAny(), dlPort));
-        serverApps.Add(dlPacketSinkHelper.Install(ueNodes.Get(u)));
-
-        // VR: 
-        UdpClientHelper dlClient(ueIpIface.GetAddress(u), dlPort);
-        dlClient.SetAttribute("PacketSize", UintegerValue(udpPacketSize[0]));
-        dlClient.SetAttribute("Interval", TimeValue(Seconds(1.0 / lambda[0])));
-        dlClient.SetAttribute("MaxPackets", UintegerValue(0xFFFFFFFF));
-        dlClient.SetAttribute("StartTime", TimeValue(Seconds(0.3+0.1*u)));
-        dlClient.SetAttribute("StopTime", TimeValue(Seconds(0.4+0.1*u)));
-        clientVrApps.Add(dlClient.Install(remoteHost));
+            InetSocketAddress(Ipv4Address::GetAny(), ulPort));
+        ApplicationContainer ulSink = ulPacketSinkHelper.Install(remoteHost);
+        SliceEventLog::ConnectApps(ulSink, 0);
+        serverApps.Add(ulSink);
+
+        UdpClientHelper ulClient(remoteHostAddr, ulPort);
+        ulClient.SetAttribute("PacketSize", UintegerValue(ulPacketSize[0]));
+        ulClient.SetAttribute("Interval", TimeValue(Seconds(1.0 / ulLambda[0])));
+        ulClient.SetAttribute("MaxPackets", UintegerValue(0xFFFFFFFF));
+        clientUlApps.Add(ulClient.Install(ueNodes.Get(u)));
 
         Ptr<EpcTft> tft = Create<EpcTft>();
         EpcTft::PacketFilter dlpf;
         dlpf.localPortStart = dlPort;
-        dlpf.localPortEnd = dlPort;
-        ++dlPort;
+        dlpf.localPortEnd = dlPort + numFlowsUe - 1;
+        dlPort += numFlowsUe;
         tft->Add(dlpf);
+        EpcTft::PacketFilter ulpf;
+        ulpf.remotePortStart = ulPort;
+        ulpf.remotePortEnd = ulPort;
+        ulpf.direction = EpcTft::UPLINK;
+        ++ulPort;
+        tft->Add(ulpf);
 
         EpsBearer bearer(EpsBearer::GBR_GAMING);
         nrHelper->ActivateDedicatedEpsBearer(ueNetDev.Get(u), bearer, tft);
@@ -410,24 +475,48 @@ main(int argc, char* argv[])
 
     for (uint32_t u = ueNumPergNb[0]; u < ueNumPergNb[0] + ueNumPergNb[1]; ++u)
     {
-        PacketSinkHelper dlPacketSinkHelper(
+        // the flows of a UE share its load
+        for (uint16_t f = 0; f < numFlowsUe; ++f)
+        {
+            PacketSinkHelper dlPacketSinkHelper(
+                "ns3::UdpSocketFactory",
+                InetSocketAddress(Ipv4Address::GetAny(), dlPort + f));
+            serverApps.Add(dlPacketSinkHelper.Install(ueNodes.Get(u)));
+
+            // Cloud Gaming: 
+            UdpClientHelper dlClient(ueIpIface.GetAddress(u), dlPort + f);
+            dlClient.SetAttribute("PacketSize", UintegerValue(udpPacketSize[1]));
+            dlClient.SetAttribute("Interval", TimeValue(Seconds(numFlowsUe / lambda[1])));
+            dlClient.SetAttribute("MaxPackets", UintegerValue(0xFFFFFFFF));
+            clientCgApps.Add(dlClient.Install(remoteHost));
+        }
+
+        // UL
+        PacketSinkHelper ulPacketSinkHelper(
             "ns3::UdpSocketFactory",
-            InetSocketAddress(Ipv4Address::GetAny(), dlPort));
-        serverApps.Add(dlPacketSinkHelper.Install(ueNodes.Get(u)));
+            InetSocketAddress(Ipv4Address::GetAny(), ulPort));
+        ApplicationContainer ulSink = ulPacketSinkHelper.Install(remoteHost);
+        SliceEventLog::ConnectApps(ulSink, 1);
+        serverApps.Add(ulSink);
 
-        // Cloud Gaming: 
-        UdpClientHelper dlClient(ueIpIface.GetAddress(u), dlPort);
-        dlClient.SetAttribute("PacketSize", UintegerValue(udpPacketSize[1]));
-        dlClient.SetAttribute("Interval", TimeValue(Seconds(1.0 / lambda[1])));
-        dlClient.SetAttribute("MaxPackets", UintegerValue(0xFFFFFFFF));
-        clientCgApps.Add(dlClient.Install(remoteHost));
+        UdpClientHelper ulClient(remoteHostAddr, ulPort);
+        ulClient.SetAttribute("PacketSize", UintegerValue(ulPacketSize[1]));
+        ulClient.SetAttribute("Interval", TimeValue(Seconds(1.0 / ulLambda[1])));
+        ulClient.SetAttribute("MaxPackets", UintegerValue(0xFFFFFFFF));
+        clientUlApps.Add(ulClient.Install(ueNodes.Get(u)));
 
         Ptr<EpcTft> tft = Create<EpcTft>();
         EpcTft::PacketFilter dlpf;
         dlpf.localPortStart = dlPort;
-        dlpf.localPortEnd = dlPort;
-        ++dlPort;
+        dlpf.localPortEnd = dlPort + numFlowsUe - 1;
+        dlPort += numFlowsUe;
         tft->Add(dlpf);
+        EpcTft::PacketFilter ulpf;
+        ulpf.remotePortStart = ulPort;
+        ulpf.remotePortEnd = ulPort;
+        ulpf.direction = EpcTft::UPLINK;
+        ++ulPort;
+        tft->Add(ulpf);
 
         EpsBearer bearer(EpsBearer::NGBR_VOICE_VIDEO_GAMING);
         nrHelper->ActivateDedicatedEpsBearer(ueNetDev.Get(u), bearer, tft);
@@ -436,23 +525,47 @@ main(int argc, char* argv[])
     for (uint32_t u = ueNumPergNb[0] + ueNumPergNb[1]; u < ueNodes.GetN(); ++u)
     {
         // DL ONLY
-        PacketSinkHelper dlPacketSinkHelper(
+        // the flows of a UE share its load
+        for (uint16_t f = 0; f < numFlowsUe; ++f)
+        {
+            PacketSinkHelper dlPacketSinkHelper(
+                "ns3::UdpSocketFactory",
+                InetSocketAddress(Ipv4Address::GetAny(), dlPort + f));
+            serverApps.Add(dlPacketSinkHelper.Install(ueNodes.Get(u)));
+
+            UdpClientHelper dlClient(ueIpIface.GetAddress(u), dlPort + f);
+            dlClient.SetAttribute("PacketSize", UintegerValue(udpPacketSize[2]));
+            dlClient.SetAttribute("Interval", TimeValue(Seconds(numFlowsUe / lambda[2])));
+            dlClient.SetAttribute("MaxPackets", UintegerValue(0xFFFFFFFF));
+            clientAdApps.Add(dlClient.Install(remoteHost));
+        }
+
+        // UL
+        PacketSinkHelper ulPacketSinkHelper(
             "ns3::UdpSocketFactory",
-            InetSocketAddress(Ipv4Address::GetAny(), dlPort));
-        serverApps.Add(dlPacketSinkHelper.Install(ueNodes.Get(u)));
+            InetSocketAddress(Ipv4Address::GetAny(), ulPort));
+        ApplicationContainer ulSink = ulPacketSinkHelper.Install(remoteHost);
+        SliceEventLog::ConnectApps(ulSink, 2);
+        serverApps.Add(ulSink);
 
-        UdpClientHelper dlClient(ueIpIface.GetAddress(u), dlPort);
-        dlClient.SetAttribute("PacketSize", UintegerValue(udpPacketSize[2]));
-        dlClient.SetAttribute("Interval", TimeValue(Seconds(1.0 / lambda[2])));
-        dlClient.SetAttribute("MaxPackets", UintegerValue(0xFFFFFFFF));
-        clientAdApps.Add(dlClient.Install(remoteHost));
+        UdpClientHelper ulClient(remoteHostAddr, ulPort);
+        ulClient.SetAttribute("PacketSize", UintegerValue(ulPacketSize[2]));
+        ulClient.SetAttribute("Interval", TimeValue(Seconds(1.0 / ulLambda[2])));
+        ulClient.SetAttribute("MaxPackets", UintegerValue(0xFFFFFFFF));
+        clientUlApps.Add(ulClient.Install(ueNodes.Get(u)));
 
         Ptr<EpcTft> tft = Create<EpcTft>();
         EpcTft::PacketFilter dlpf;
         dlpf.localPortStart = dlPort;
-        dlpf.localPortEnd = dlPort;
-        ++dlPort;
+        dlpf.localPortEnd = dlPort + numFlowsUe - 1;
+        dlPort += numFlowsUe;
         tft->Add(dlpf);
+        EpcTft::PacketFilter ulpf;
+        ulpf.remotePortStart = ulPort;
+        ulpf.remotePortEnd = ulPort;
+        ulpf.direction = EpcTft::UPLINK;
+        ++ulPort;
+        tft->Add(ulpf);
         
         EpsBearer bearer(EpsBearer::NGBR_VIDEO_TCP_DEFAULT);
         nrHelper->ActivateDedicatedEpsBearer(ueNetDev.Get(u), bearer, tft);
@@ -462,12 +575,46 @@ main(int argc, char* argv[])
     serverApps.Start(Seconds(udpAppStartTime));
     clientCgApps.Start(Seconds(udpAppStartTime));
     clientAdApps.Start(Seconds(udpAppStartTime));
+    clientUlApps.Start(Seconds(udpAppStartTime));
     serverApps.Stop(Seconds(simTime));
     clientCgApps.Stop(Seconds(simTime));
     clientAdApps.Stop(Seconds(simTime));
+    clientUlApps.Stop(Seconds(simTime));
+
+    // log the packets of the applications of each slice, and the PDCP PDUs once attached
+    SliceEventLog::ConnectApps(clientVrApps, 0);
+    SliceEventLog::ConnectApps(clientCgApps, 1);
+    SliceEventLog::ConnectApps(clientAdApps, 2);
+    for (uint32_t u = 0; u < ueNodes.GetN(); ++u)
+    {
+        uint8_t s = u < ueNumPergNb[0] ? 0 : (u < ueNumPergNb[0] + ueNumPergNb[1] ? 1 : 2);
+        SliceEventLog::ConnectNodes(NodeContainer(ueNodes.Get(u)), s);
+        SliceEventLog::AddUes(s, NetDeviceContainer(ueNetDev.Get(u)));
+    }
+    Simulator::Schedule(Seconds(udpAppStartTime), &SliceEventLog::ConnectPdcp);
 
     // enable the traces provided by the nr module
-    nrHelper->EnableTraces();
+    Ptr<SliceTraceManager> traceManager;
+    if (legacyTraces)
+    {
+        nrHelper->EnableTraces();
+    }
+    else if (!traceFamilies.empty())
+    {
+        traceManager = CreateObject<SliceTraceManager>();
+        traceManager->SetAttribute("Families", StringValue(traceFamilies));
+        std::string traceFile = outputDir + "/" + simTag + ".nrtrace";
+        if (!traceManager->Open(traceFile))
+        {
+            std::cerr << "Can't open file " << traceFile << std::endl;
+            return 1;
+        }
+        traceManager->ConnectGnbs(enbNetDev);
+        traceManager->ConnectUes(ueNetDev);
+        Simulator::Schedule(Seconds(udpAppStartTime),
+                            &SliceTraceManager::ConnectBearers,
+                            traceManager);
+    }
 
     FlowMonitorHelper flowmonHelper;
     NodeContainer endpointNodes;
@@ -482,6 +629,12 @@ main(int argc, char* argv[])
     Simulator::Stop(Seconds(simTime));
     Simulator::Run();
 
+    if (traceManager)
+    {
+        traceManager->Close();
+    }
+    SliceEventLog::Close();
+
     /*
      * To check what was installed in the memory, i.e., BWPs of eNb Device, and its configuration.
      * Example is: Node 1 -> Device 0 -> BandwidthPartMap -> {0,1} BWPs -> NrGnbPhy ->
@@ -502,6 +655,10 @@ main(int argc, char* argv[])
 
     double averageFlowThroughput = 0.0;
     double averageFlowDelay = 0.0;
+    // index 0: DL, from the remote host; index 1: UL, towards it
+    double averageDirThroughput [] = {0.0, 0.0};
+    double averageDirDelay [] = {0.0, 0.0};
+    uint32_t numDirFlows [] = {0, 0};
 
     std::ofstream outFile;
     std::string filename = outputDir + "/" + simTag;
@@ -529,9 +686,11 @@ main(int argc, char* argv[])
         {
             protoStream.str("UDP");
         }
+        uint8_t dir = t.sourceAddress == remoteHostAddr ? 0 : 1;
+        ++numDirFlows[dir];
         outFile << "Flow " << i->first << " (" << t.sourceAddress << ":" << t.sourcePort << " -> "
                 << t.destinationAddress << ":" << t.destinationPort << ") proto "
-                << protoStream.str() << "\n";
+                << protoStream.str() << (dir == 0 ? " DL" : " UL") << "\n";
         outFile << "  Tx Packets: " << i->second.txPackets << "\n";
         outFile << "  Tx Bytes:   " << i->second.txBytes << "\n";
         outFile << "  TxOffered:  "
@@ -547,6 +706,8 @@ main(int argc, char* argv[])
 
             averageFlowThroughput += i->second.rxBytes * 8.0 / rxDuration / 1000 / 1000;
             averageFlowDelay += 1000 * i->second.delaySum.GetSeconds() / i->second.rxPackets;
+            averageDirThroughput[dir] += i->second.rxBytes * 8.0 / rxDuration / 1000 / 1000;
+            averageDirDelay[dir] += 1000 * i->second.delaySum.GetSeconds() / i->second.rxPackets;
 
             outFile << "  Throughput: " << i->second.rxBytes * 8.0 / rxDuration / 1000 / 1000
                     << " Mbps\n";
@@ -568,6 +729,15 @@ main(int argc, char* argv[])
 
     outFile << "\n\n  Mean flow throughput: " << averageFlowThroughput / stats.size() << "\n";
     outFile << "  Mean flow delay: " << averageFlowDelay / stats.size() << "\n";
+    for (uint8_t dir = 0; dir < 2; ++dir)
+    {
+        std::string dirName = dir == 0 ? "DL" : "UL";
+        outFile << "  Mean " << dirName << " flow throughput: "
+                << (numDirFlows[dir] > 0 ? averageDirThroughput[dir] / numDirFlows[dir] : 0.)
+                << "\n";
+        outFile << "  Mean " << dirName << " flow delay: "
+                << (numDirFlows[dir] > 0 ? averageDirDelay[dir] / numDirFlows[dir] : 0.) << "\n";
+    }
 
     outFile.close();
 
@@ -0,0 +1,147 @@
+#include "ns3/core-module.h"
+
+#include "slicing-event-log.h"
+
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <vector>
+
+/**
+ * Decode a binary event log written by SliceEventLog, e.g. with
+ * sim-network-slicing --logging=true, into one text line per event:
+ * time in seconds, node, slice, level, event name and fields.
+ *
+ * The events can be filtered by name, slice and level. The records of a
+ * thread are in time order; a log written by several threads interleaves
+ * their buffers.
+ *
+ * Example:
+ * ./ns3 run "log-decode-network-slicing --logFile=results.evlog --event=PdcpDlRx --slice=2"
+ */
+
+using namespace ns3;
+
+NS_LOG_COMPONENT_DEFINE("SlicingLogDecode");
+
+static const char* g_levelNames[] = {"NONE", "ERROR", "WARN", "INFO", "DEBUG"};
+
+int
+main(int argc, char* argv[])
+{
+    std::string logFile = "";
+    std::string outputFile = "";
+    std::string event = "";
+    int32_t slice = -1;
+    uint32_t level = SLICING_EVENT_DEBUG;
+    uint32_t chunk = 1 << 16;
+
+    CommandLine cmd(__FILE__);
+
+    cmd.AddValue("logFile", "binary event log written by sim-network-slicing", logFile);
+    cmd.AddValue("outputFile", "text file to write, standard output if empty", outputFile);
+    cmd.AddValue("event", "if not empty, only the events with this name, e.g. AppRx", event);
+    cmd.AddValue("slice", "if not negative, only the events of this slice", slice);
+    cmd.AddValue("level", "highest level printed, 1 (ERROR) to 4 (DEBUG)", level);
+    cmd.AddValue("chunk", "number of records read at once", chunk);
+
+    cmd.Parse(argc, argv);
+
+    std::ifstream in(logFile.c_str(), std::ifstream::in | std::ifstream::binary);
+    if (!in.is_open())
+    {
+        std::cerr << "Can't open file " << logFile << std::endl;
+        return 1;
+    }
+    EventLogHeader header;
+    if (!in.read(reinterpret_cast<char*>(&header), sizeof(header)) ||
+        std::memcmp(header.magic, g_eventLogMagic, sizeof(header.magic)) != 0)
+    {
+        std::cerr << logFile << " is not an event log" << std::endl;
+        return 1;
+    }
+    if (header.version != 1 || header.recordSize != sizeof(EventRecord))
+    {
+        std::cerr << "Unsupported event log version " << header.version << std::endl;
+        return 1;
+    }
+
+    std::FILE* out = stdout;
+    if (!outputFile.empty())
+    {
+        out = std::fopen(outputFile.c_str(), "w");
+        if (!out)
+        {
+            std::cerr << "Can't open file " << outputFile << std::endl;
+            return 1;
+        }
+    }
+
+    std::vector<EventRecord> records(chunk);
+    uint64_t numRecords = 0;
+    uint64_t numPrinted = 0;
+    while (in)
+    {
+        in.read(reinterpret_cast<char*>(records.data()), chunk * sizeof(EventRecord));
+        std::size_t n = in.gcount() / sizeof(EventRecord);
+        numRecords += n;
+        for (std::size_t i = 0; i < n; ++i)
+        {
+            const EventRecord& r = records[i];
+            const char* name = SliceEventName(r.event);
+            if (r.level > level || (slice >= 0 && r.slice != slice) ||
+                (!event.empty() && event != name))
+            {
+                continue;
+            }
+            ++numPrinted;
+            std::fprintf(out,
+                         "%.9f node %u slice %d %s %s",
+                         r.timeNs / 1e9,
+                         r.node,
+                         r.slice == UINT8_MAX ? -1 : r.slice,
+                         r.level <= SLICING_EVENT_DEBUG ? g_levelNames[r.level] : "?",
+                         name);
+            switch (r.event)
+            {
+            case EVENT_APP_TX:
+            case EVENT_APP_RX:
+                std::fprintf(out,
+                             " uid %llu size %llu\n",
+                             static_cast<unsigned long long>(r.f0),
+                             static_cast<unsigned long long>(r.f1));
+                break;
+            case EVENT_PDCP_DL_TX:
+            case EVENT_PDCP_UL_TX:
+                std::fprintf(out,
+                             " rnti %u lcid %u size %llu\n",
+                             static_cast<unsigned>(r.f0 & 0xFFFF),
+                             static_cast<unsigned>(r.f0 >> 16),
+                             static_cast<unsigned long long>(r.f1));
+                break;
+            case EVENT_PDCP_DL_RX:
+            case EVENT_PDCP_UL_RX:
+                std::fprintf(out,
+                             " rnti %u lcid %u size %llu delay %.6f ms\n",
+                             static_cast<unsigned>(r.f0 & 0xFFFF),
+                             static_cast<unsigned>(r.f0 >> 16),
+                             static_cast<unsigned long long>(r.f1),
+                             r.f2);
+                break;
+            default:
+                std::fprintf(out,
+                             " %llu %llu %g\n",
+                             static_cast<unsigned long long>(r.f0),
+                             static_cast<unsigned long long>(r.f1),
+                             r.f2);
+            }
+        }
+    }
+    if (out != stdout)
+    {
+        std::fclose(out);
+    }
+    std::cerr << numPrinted << " of " << numRecords << " events printed" << std::endl;
+    return 0;
+}
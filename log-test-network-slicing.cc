@@ -7,11 +7,15 @@
 #include "ns3/flow-monitor-module.h"
 #include "ns3/stats-module.h"
 #include "ns3/wifi-helper.h"
+#include "ns3/wifi-net-device.h"
+#include "ns3/wifi-phy.h"
 #include "ns3/yans-wifi-channel.h"
 #include "ns3/yans-wifi-helper.h"
 #include "ns3/yans-wifi-phy.h"
 #include "ns3/ssid.h"
 
+#include "slicing-pcap-capture.h"
+
 #include <fstream>
 
 /**
@@ -160,16 +164,31 @@ RandomApp::ScheduleTx()
 }
 
 /**
- * Rx drop callback
+ * Rx drop callback of a WiFi PHY
  *
- * \param file The output PCAP file.
+ * \param capture The capture of the dropped packets.
  * \param p The dropped packet.
+ * \param reason The reason of the drop.
  */
 static void
-RxDrop(Ptr<PcapFileWrapper> file, Ptr<const Packet> p)
+WifiRxDrop(Ptr<AsyncPcapCapture> capture, Ptr<const Packet> p, WifiPhyRxfailureReason /* reason */)
 {
-    NS_LOG_UNCOND("RxDrop at " << Simulator::Now().GetSeconds());
-    file->Write(Simulator::Now(), p);
+    capture->Capture(p);
+}
+
+/**
+ * Print the counters of a capture.
+ *
+ * \param name The name of the capture.
+ * \param capture The capture.
+ */
+static void
+ReportCapture(const std::string& name, Ptr<AsyncPcapCapture> capture)
+{
+    std::cout << name << ": " << capture->GetNumSeen() << " drops, "
+              << capture->GetNumCaptured() << " captured, " << capture->GetNumRingDrops()
+              << " lost to a full ring, " << capture->GetNumOverBudget() << " over budget"
+              << std::endl;
 }
 
 /**
@@ -182,12 +201,20 @@ int main(int argc, char *argv[])
     int n_ue_slice = 2;
     double stop_time = 10.0;
     double cleanup_time = 0.0;
+    uint32_t snapLen = 96;
+    uint32_t captureRing = 4096;
+    uint64_t captureBudget = 0;
+    uint32_t captureSampling = 1;
 
     CommandLine cmd(__FILE__);
 //    cmd.AddValue("n_slice", "The Number of Slices", n_slice);
 //    cmd.AddValue("n_ue_slice", "The Number of UEs in Each Slice", n_ue_slice);
     cmd.AddValue("stop_time", "Application Runtime", stop_time);
     cmd.AddValue("cleanup_time", "Cleanup Time After Application Stops", stop_time);
+    cmd.AddValue("snapLen", "Bytes captured per dropped packet", snapLen);
+    cmd.AddValue("captureRing", "Dropped packets buffered for the PCAP writer thread", captureRing);
+    cmd.AddValue("captureBudget", "Maximum dropped packets captured, 0 for no limit", captureBudget);
+    cmd.AddValue("captureSampling", "Capture one of N dropped packets", captureSampling);
     cmd.Parse(argc, argv);
 
     // Create network topology: 
@@ -313,16 +340,36 @@ int main(int argc, char *argv[])
     apps2.Start(Seconds(0.0));
     apps2.Stop(Seconds(stop_time));
 
-    // Logger on
-    PcapHelper pcapHelper;
-    Ptr<PcapFileWrapper> file =
-        pcapHelper.CreateFile("rxdrop.pcap", std::ios::out, PcapHelper::DLT_PPP);
-    coreGnbDevices.Get(1)->TraceConnectWithoutContext("[gNB]PhyTxDrop", MakeBoundCallback(&RxDrop, file));
-    ueDevices1.Get(0)->TraceConnectWithoutContext("[UE]PhyRxDrop", MakeBoundCallback(&RxDrop, file));
+    // Logger on: the drops are captured asynchronously, one file per link type
+    Ptr<AsyncPcapCapture> captures [2];
+    const std::string captureFiles [] = {"txdrop-p2p.pcap", "rxdrop-wifi.pcap"};
+    const uint32_t captureLinkTypes [] = {PcapHelper::DLT_PPP, PcapHelper::DLT_IEEE802_11};
+    for (int k = 0; k < 2; ++k) {
+        captures[k] = CreateObject<AsyncPcapCapture>();
+        captures[k]->SetAttribute("SnapLen", UintegerValue(snapLen));
+        captures[k]->SetAttribute("RingSize", UintegerValue(captureRing));
+        captures[k]->SetAttribute("Budget", UintegerValue(captureBudget));
+        captures[k]->SetAttribute("SamplingPeriod", UintegerValue(captureSampling));
+        if (!captures[k]->Open(captureFiles[k], captureLinkTypes[k])) {
+            std::cerr << "Can't open file " << captureFiles[k] << std::endl;
+            return 1;
+        }
+    }
+    coreGnbDevices.Get(1)->TraceConnectWithoutContext(
+        "PhyTxDrop",
+        MakeCallback(&AsyncPcapCapture::Capture, captures[0]));
+    DynamicCast<WifiNetDevice>(ueDevices1.Get(0))->GetPhy()->TraceConnectWithoutContext(
+        "PhyRxDrop",
+        MakeBoundCallback(&WifiRxDrop, captures[1]));
 
     Simulator::Stop(Seconds(stop_time+cleanup_time));
     Simulator::Run();
 
+    for (int k = 0; k < 2; ++k) {
+        captures[k]->Close();
+        ReportCapture(captureFiles[k], captures[k]);
+    }
+
     flowMonitor->SerializeToXmlFile("NameOfFile.xml", true, true);
 
     Simulator::Destroy();
@@ -0,0 +1,493 @@
+#include "ns3/core-module.h"
+
+#include "slicing-batch-runner.h"
+#include "slicing-kpi.h"
+
+#include <algorithm>
+#include <filesystem>
+#include <iostream>
+#include <limits>
+#include <map>
+#include <random>
+#include <sstream>
+#include <thread>
+
+/**
+ * Genetic search of the TDD pattern and numerology of every CC of
+ * sim-network-slicing.cc.
+ *
+ * Each candidate is first screened with a short run. Candidates whose screening
+ * KPIs are clearly dominated by an already screened candidate are pruned; the
+ * others are evaluated with a longer run. Runs of a generation are executed in
+ * parallel as separate processes. The Pareto front of per-slice p99 latency
+ * against aggregate throughput is written to pareto-front.csv.
+ *
+ * Example:
+ * ./ns3 run "opt-network-slicing --simBinary=build/scratch/ns3.42-sim-network-slicing-default"
+ */
+
+using namespace ns3;
+
+NS_LOG_COMPONENT_DEFINE("SlicingTddOptimizer");
+
+static const uint8_t g_numCcs = 3;
+static const uint8_t g_numSlices = 3;
+static const std::string g_sliceNames[] = {"VR", "CG", "AD"};
+
+/// TDD pattern and numerology of each CC, as indexes into the search space.
+struct Candidate
+{
+    uint8_t pattern[g_numCcs];   //!< Index of the TDD pattern of each CC.
+    uint8_t numerology[g_numCcs]; //!< Index of the numerology of each CC.
+
+    /// \return A key identifying the candidate.
+    std::string Key() const
+    {
+        std::ostringstream key;
+        for (uint8_t n = 0; n < g_numCcs; ++n)
+        {
+            key << "p" << +pattern[n] << "n" << +numerology[n];
+        }
+        return key.str();
+    }
+};
+
+/// Outcome of the runs of one candidate.
+struct Evaluation
+{
+    Candidate candidate;                 //!< The evaluated candidate.
+    bool valid{false};                   //!< False if a run failed.
+    bool pruned{false};                  //!< True if the long run was skipped.
+    double screenP99Ms[g_numSlices]{};   //!< Per-slice p99 delay of the screening run.
+    double screenThroughputMbps{0};      //!< Aggregate throughput of the screening run.
+    double p99Ms[g_numSlices]{};         //!< Per-slice p99 delay, worst of DL and UL.
+    double dlP99Ms[g_numSlices]{};       //!< Per-slice DL p99 delay.
+    double ulP99Ms[g_numSlices]{};       //!< Per-slice UL p99 delay.
+    double throughputMbps{0};            //!< Aggregate throughput of all slices.
+    uint32_t rank{std::numeric_limits<uint32_t>::max()}; //!< Pareto rank, 0 for the front.
+};
+
+/**
+ * Check whether a point dominates another, with a relative margin.
+ *
+ * \param p99A The per-slice p99 delays of the first point.
+ * \param thrA The aggregate throughput of the first point.
+ * \param p99B The per-slice p99 delays of the second point.
+ * \param thrB The aggregate throughput of the second point.
+ * \param margin The relative margin by which the first point must be better.
+ * \return true if the first point dominates the second one.
+ */
+static bool
+Dominates(const double* p99A, double thrA, const double* p99B, double thrB, double margin)
+{
+    bool strict = thrA > thrB * (1 + margin);
+    for (uint8_t s = 0; s < g_numSlices; ++s)
+    {
+        if (p99A[s] * (1 + margin) > p99B[s])
+        {
+            return false;
+        }
+        strict = strict || p99A[s] * (1 + margin) < p99B[s];
+    }
+    return thrA >= thrB * (1 + margin) && strict;
+}
+
+/**
+ * Fill the objectives of an evaluation from the KPIs of a run.
+ *
+ * \param kpis The KPIs read from the run.
+ * \param p99Ms The per-slice p99 delay, worst of DL and UL.
+ * \param dlP99Ms The per-slice DL p99 delay, may be null.
+ * \param ulP99Ms The per-slice UL p99 delay, may be null.
+ * \param throughputMbps The aggregate throughput.
+ */
+static void
+ReduceKpis(const std::vector<SliceKpi>& kpis,
+           double* p99Ms,
+           double* dlP99Ms,
+           double* ulP99Ms,
+           double& throughputMbps)
+{
+    throughputMbps = 0;
+    for (uint8_t s = 0; s < g_numSlices; ++s)
+    {
+        p99Ms[s] = 0;
+    }
+    for (const auto& k : kpis)
+    {
+        throughputMbps += k.throughputMbps;
+        for (uint8_t s = 0; s < g_numSlices; ++s)
+        {
+            if (k.slice != g_sliceNames[s])
+            {
+                continue;
+            }
+            p99Ms[s] = std::max(p99Ms[s], k.p99DelayMs);
+            if (k.direction == "DL" && dlP99Ms)
+            {
+                dlP99Ms[s] = k.p99DelayMs;
+            }
+            if (k.direction == "UL" && ulP99Ms)
+            {
+                ulP99Ms[s] = k.p99DelayMs;
+            }
+        }
+    }
+}
+
+/**
+ * Assign the Pareto rank of every valid, non-pruned evaluation.
+ *
+ * \param evals The evaluations.
+ */
+static void
+RankEvaluations(std::vector<Evaluation*>& evals)
+{
+    std::vector<Evaluation*> remaining;
+    for (auto e : evals)
+    {
+        e->rank = std::numeric_limits<uint32_t>::max();
+        if (e->valid && !e->pruned)
+        {
+            remaining.push_back(e);
+        }
+    }
+    for (uint32_t rank = 0; !remaining.empty(); ++rank)
+    {
+        std::vector<Evaluation*> front;
+        std::vector<Evaluation*> rest;
+        for (auto a : remaining)
+        {
+            bool dominated = false;
+            for (auto b : remaining)
+            {
+                if (b != a && Dominates(b->p99Ms, b->throughputMbps, a->p99Ms, a->throughputMbps, 0))
+                {
+                    dominated = true;
+                    break;
+                }
+            }
+            (dominated ? rest : front).push_back(a);
+        }
+        for (auto e : front)
+        {
+            e->rank = rank;
+        }
+        remaining.swap(rest);
+    }
+}
+
+/**
+ * Split a string.
+ *
+ * \param s The string.
+ * \param sep The separator.
+ * \return The non-empty fields.
+ */
+static std::vector<std::string>
+Split(const std::string& s, char sep)
+{
+    std::vector<std::string> fields;
+    std::istringstream iss(s);
+    std::string field;
+    while (std::getline(iss, field, sep))
+    {
+        if (!field.empty())
+        {
+            fields.push_back(field);
+        }
+    }
+    return fields;
+}
+
+int
+main(int argc, char* argv[])
+{
+    std::string simBinary = "build/scratch/ns3.42-sim-network-slicing-default";
+    std::string patternList = "DL|DL|DL|DL|UL|DL|DL|DL|DL|UL|;"
+                              "DL|DL|DL|S|UL|DL|DL|DL|S|UL|;"
+                              "DL|S|UL|UL|DL|DL|S|UL|UL|DL|;"
+                              "DL|DL|DL|DL|DL|DL|DL|DL|S|UL|;"
+                              "F|F|F|F|F|F|F|F|F|F|";
+    std::string numerologyList = "2,3,4";
+    uint32_t populationSize = 12;
+    uint32_t generations = 5;
+    double crossoverRate = 0.9;
+    double mutationRate = 0.15;
+    uint32_t screenDuration = 500;
+    uint32_t evalDuration = 2000;
+    double pruneMargin = 0.1;
+    uint32_t jobs = std::max(1U, std::thread::hardware_concurrency());
+    uint32_t rngRun = 1;
+    uint32_t seed = 1;
+    std::string extraArgs = "";
+    std::string outputDir = "./opt-results";
+
+    CommandLine cmd(__FILE__);
+
+    cmd.AddValue("simBinary", "path of the built sim-network-slicing executable", simBinary);
+    cmd.AddValue("patterns", "candidate TDD patterns, separated by ';'", patternList);
+    cmd.AddValue("numerologies", "candidate numerologies, separated by ','", numerologyList);
+    cmd.AddValue("populationSize", "number of candidates per generation", populationSize);
+    cmd.AddValue("generations", "number of generations", generations);
+    cmd.AddValue("crossoverRate", "probability to recombine two parents", crossoverRate);
+    cmd.AddValue("mutationRate", "probability to mutate each gene", mutationRate);
+    cmd.AddValue("screenDuration", "appDuration of the screening runs in ms", screenDuration);
+    cmd.AddValue("evalDuration", "appDuration of the evaluation runs in ms", evalDuration);
+    cmd.AddValue("pruneMargin",
+                 "relative margin by which a screened candidate must be dominated to be pruned",
+                 pruneMargin);
+    cmd.AddValue("jobs", "number of simulations run in parallel", jobs);
+    cmd.AddValue("rngRun", "Rng run random number of the simulations", rngRun);
+    cmd.AddValue("seed", "seed of the genetic search", seed);
+    cmd.AddValue("extraArgs", "extra arguments passed to every simulation", extraArgs);
+    cmd.AddValue("outputDir", "directory where to store the runs and the Pareto front", outputDir);
+
+    cmd.Parse(argc, argv);
+
+    std::vector<std::string> patterns = Split(patternList, ';');
+    std::vector<uint16_t> numerologies;
+    for (const auto& n : Split(numerologyList, ','))
+    {
+        numerologies.push_back(static_cast<uint16_t>(std::stoul(n)));
+    }
+    NS_ABORT_MSG_IF(patterns.empty() || numerologies.empty(), "Empty search space");
+
+    std::filesystem::create_directories(outputDir);
+    std::string simPath = std::filesystem::absolute(simBinary).string();
+
+    std::mt19937 rng(seed);
+    std::uniform_real_distribution<double> uniform(0., 1.);
+    auto randomCandidate = [&]() {
+        Candidate c;
+        for (uint8_t n = 0; n < g_numCcs; ++n)
+        {
+            c.pattern[n] = rng() % patterns.size();
+            c.numerology[n] = rng() % numerologies.size();
+        }
+        return c;
+    };
+
+    // run directory of a candidate, so that traces of parallel runs do not clash
+    auto makeCommand = [&](const Candidate& c, uint32_t duration, const std::string& dir) {
+        std::filesystem::create_directories(dir);
+        std::ostringstream command;
+        command << "cd " << ShellQuote(dir) << " && " << ShellQuote(simPath)
+                << " --appDuration=" << duration << " --rngRun=" << rngRun;
+        for (uint8_t n = 0; n < g_numCcs; ++n)
+        {
+            command << " --tddPatternCc" << +n << "=" << ShellQuote(patterns[c.pattern[n]])
+                    << " --numerologyCc" << +n << "=" << numerologies[c.numerology[n]];
+        }
+        command << " --outputDir=. --simTag=results.txt --kpiFile=kpi.txt " << extraArgs
+                << " > sim.log 2>&1";
+        return command.str();
+    };
+
+    std::map<std::string, Evaluation> archive;
+
+    // screen, prune and evaluate the candidates not seen before
+    auto evaluate = [&](const std::vector<Candidate>& candidates) {
+        std::vector<Evaluation*> batch;
+        std::vector<std::string> commands;
+        for (const auto& c : candidates)
+        {
+            if (archive.count(c.Key()))
+            {
+                continue;
+            }
+            Evaluation& e = archive[c.Key()];
+            e.candidate = c;
+            batch.push_back(&e);
+            commands.push_back(makeCommand(c, screenDuration, outputDir + "/" + c.Key() + "/screen"));
+        }
+        RunParallel(commands, jobs);
+
+        std::vector<Evaluation*> survivors;
+        commands.clear();
+        for (auto e : batch)
+        {
+            std::vector<SliceKpi> kpis;
+            std::string dir = outputDir + "/" + e->candidate.Key();
+            if (!ReadKpiFile(dir + "/screen/kpi.txt", kpis))
+            {
+                std::cerr << "Screening run of " << e->candidate.Key() << " failed" << std::endl;
+                continue;
+            }
+            ReduceKpis(kpis, e->screenP99Ms, nullptr, nullptr, e->screenThroughputMbps);
+            e->valid = true;
+        }
+        for (auto e : batch)
+        {
+            if (!e->valid)
+            {
+                continue;
+            }
+            for (const auto& a : archive)
+            {
+                const Evaluation& other = a.second;
+                if (&other != e && other.valid &&
+                    Dominates(other.screenP99Ms,
+                              other.screenThroughputMbps,
+                              e->screenP99Ms,
+                              e->screenThroughputMbps,
+                              pruneMargin))
+                {
+                    e->pruned = true;
+                    break;
+                }
+            }
+            if (!e->pruned)
+            {
+                survivors.push_back(e);
+                commands.push_back(makeCommand(e->candidate,
+                                               evalDuration,
+                                               outputDir + "/" + e->candidate.Key() + "/eval"));
+            }
+        }
+        RunParallel(commands, jobs);
+
+        for (auto e : survivors)
+        {
+            std::vector<SliceKpi> kpis;
+            if (!ReadKpiFile(outputDir + "/" + e->candidate.Key() + "/eval/kpi.txt", kpis))
+            {
+                std::cerr << "Evaluation run of " << e->candidate.Key() << " failed" << std::endl;
+                e->valid = false;
+                continue;
+            }
+            ReduceKpis(kpis, e->p99Ms, e->dlP99Ms, e->ulP99Ms, e->throughputMbps);
+        }
+        std::cout << "Screened " << batch.size() << " candidates, pruned "
+                  << batch.size() - survivors.size() << std::endl;
+    };
+
+    std::vector<Candidate> population;
+    for (uint32_t i = 0; i < populationSize; ++i)
+    {
+        population.push_back(randomCandidate());
+    }
+    evaluate(population);
+
+    for (uint32_t g = 0; g < generations; ++g)
+    {
+        std::vector<Evaluation*> all;
+        for (auto& a : archive)
+        {
+            all.push_back(&a.second);
+        }
+        RankEvaluations(all);
+
+        // binary tournament on the Pareto rank
+        auto select = [&]() -> const Candidate& {
+            const Evaluation& a = archive.at(population[rng() % population.size()].Key());
+            const Evaluation& b = archive.at(population[rng() % population.size()].Key());
+            return a.rank <= b.rank ? a.candidate : b.candidate;
+        };
+
+        std::vector<Candidate> children;
+        while (children.size() < populationSize)
+        {
+            Candidate child = select();
+            const Candidate& other = select();
+            for (uint8_t n = 0; n < g_numCcs; ++n)
+            {
+                if (uniform(rng) < crossoverRate && uniform(rng) < 0.5)
+                {
+                    child.pattern[n] = other.pattern[n];
+                    child.numerology[n] = other.numerology[n];
+                }
+                if (uniform(rng) < mutationRate)
+                {
+                    child.pattern[n] = rng() % patterns.size();
+                }
+                if (uniform(rng) < mutationRate)
+                {
+                    child.numerology[n] = rng() % numerologies.size();
+                }
+            }
+            children.push_back(child);
+        }
+        evaluate(children);
+
+        // elitist replacement: keep the best ranked of parents and children
+        all.clear();
+        for (auto& a : archive)
+        {
+            all.push_back(&a.second);
+        }
+        RankEvaluations(all);
+        std::vector<Candidate> pool(population);
+        pool.insert(pool.end(), children.begin(), children.end());
+        std::stable_sort(pool.begin(), pool.end(), [&](const Candidate& a, const Candidate& b) {
+            const Evaluation& ea = archive.at(a.Key());
+            const Evaluation& eb = archive.at(b.Key());
+            if (ea.rank != eb.rank)
+            {
+                return ea.rank < eb.rank;
+            }
+            return ea.throughputMbps > eb.throughputMbps;
+        });
+        population.clear();
+        std::map<std::string, bool> seen;
+        for (const auto& c : pool)
+        {
+            if (population.size() < populationSize && !seen[c.Key()])
+            {
+                seen[c.Key()] = true;
+                population.push_back(c);
+            }
+        }
+        std::cout << "Generation " << g + 1 << " of " << generations << " done, "
+                  << archive.size() << " candidates evaluated" << std::endl;
+    }
+
+    std::vector<Evaluation*> all;
+    for (auto& a : archive)
+    {
+        all.push_back(&a.second);
+    }
+    RankEvaluations(all);
+
+    std::ofstream front(outputDir + "/pareto-front.csv");
+    std::ofstream evals(outputDir + "/evaluations.csv");
+    for (auto out : {&front, &evals})
+    {
+        *out << "patternCc0,patternCc1,patternCc2,numerologyCc0,numerologyCc1,numerologyCc2";
+        for (uint8_t s = 0; s < g_numSlices; ++s)
+        {
+            *out << ",p99Dl" << g_sliceNames[s] << "Ms,p99Ul" << g_sliceNames[s] << "Ms";
+        }
+        *out << ",throughputMbps,rank,pruned\n";
+    }
+    for (auto e : all)
+    {
+        if (!e->valid)
+        {
+            continue;
+        }
+        std::ostringstream row;
+        for (uint8_t n = 0; n < g_numCcs; ++n)
+        {
+            row << patterns[e->candidate.pattern[n]] << ",";
+        }
+        for (uint8_t n = 0; n < g_numCcs; ++n)
+        {
+            row << numerologies[e->candidate.numerology[n]] << ",";
+        }
+        for (uint8_t s = 0; s < g_numSlices; ++s)
+        {
+            row << e->dlP99Ms[s] << "," << e->ulP99Ms[s] << ",";
+        }
+        row << e->throughputMbps << ","
+            << (e->pruned ? -1 : static_cast<int64_t>(e->rank)) << "," << e->pruned << "\n";
+        evals << row.str();
+        if (e->rank == 0)
+        {
+            front << row.str();
+            std::cout << "Pareto: " << row.str();
+        }
+    }
+
+    return 0;
+}
@@ -0,0 +1,280 @@
+#include "ns3/core-module.h"
+
+#include "slicing-batch-runner.h"
+#include "slicing-kpi.h"
+#include "slicing-stats.h"
+
+#include <algorithm>
+#include <cmath>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <sstream>
+#include <thread>
+
+/**
+ * Sequential-stopping replication controller for sim-network-slicing.cc.
+ *
+ * Every configuration of the configuration file, one line of arguments each,
+ * is run with rngRun = 1, 2, ... until the confidence interval of the mean of
+ * every monitored KPI, the throughput and the p99 delay of each slice and
+ * direction, is narrower than the target relative half-width, or until the
+ * run budget is spent. After the initial replications, each round gives the
+ * parallel slots to the configurations that are furthest from their target,
+ * in proportion to the replications they are estimated to still need, so the
+ * noisy configurations get the CPU and the stable ones stop early.
+ *
+ * The means and confidence intervals are written to replications.csv.
+ *
+ * Example:
+ * ./ns3 run "rep-network-slicing --configs=configs.txt --targetHalfWidth=0.05"
+ */
+
+using namespace ns3;
+
+NS_LOG_COMPONENT_DEFINE("SlicingReplicationController");
+
+/// Replications of one configuration.
+struct Configuration
+{
+    std::string args;                           //!< Arguments of the configuration.
+    uint32_t runs{0};                           //!< Replications launched.
+    uint32_t failed{0};                         //!< Replications without KPIs.
+    uint32_t idle{0};                           //!< KPI records of a direction without traffic.
+    std::map<std::string, RunningStats> stats;  //!< Statistics of each KPI.
+};
+
+/**
+ * Estimate the replications a configuration still needs.
+ *
+ * The half-width shrinks as 1/sqrt(n), so n (h / target)^2 replications
+ * reach the target for the worst KPI, n being the samples of that KPI. A
+ * configuration without any KPI yet, e.g. whose replications all failed, is
+ * not converged.
+ *
+ * \param c The configuration.
+ * \param confidence The confidence level.
+ * \param target The target relative half-width.
+ * \param absTolerance The absolute half-width accepted for KPIs whose mean is close to zero.
+ * \return The number of additional replications, 0 if converged.
+ */
+static uint32_t
+RemainingRuns(const Configuration& c, double confidence, double target, double absTolerance)
+{
+    if (c.stats.empty())
+    {
+        return 1;
+    }
+    double worst = 0;
+    uint32_t n = 0;
+    for (const auto& [name, s] : c.stats)
+    {
+        double hw = s.GetHalfWidth(confidence);
+        double allowed = std::max(target * std::abs(s.GetMean()), absTolerance);
+        if (hw / allowed > worst)
+        {
+            worst = hw / allowed;
+            n = s.GetCount();
+        }
+    }
+    if (worst <= 1)
+    {
+        return 0;
+    }
+    if (std::isinf(worst) || n == 0)
+    {
+        return 1;
+    }
+    return std::max<uint32_t>(1, std::ceil(n * worst * worst) - n);
+}
+
+int
+main(int argc, char* argv[])
+{
+    std::string simBinary = "build/scratch/ns3.42-sim-network-slicing-default";
+    std::string configs = "";
+    double confidence = 0.95;
+    double targetHalfWidth = 0.05;
+    double absTolerance = 0.01;
+    uint32_t minRuns = 3;
+    uint32_t maxRunsPerConfig = 50;
+    uint32_t budget = 200;
+    uint32_t jobs = std::max(1U, std::thread::hardware_concurrency());
+    std::string extraArgs = "";
+    std::string outputDir = "./rep-results";
+
+    CommandLine cmd(__FILE__);
+
+    cmd.AddValue("simBinary", "path of the built sim-network-slicing executable", simBinary);
+    cmd.AddValue("configs",
+                 "file with one configuration per line, as arguments of the simulation; "
+                 "empty for a single configuration given by extraArgs",
+                 configs);
+    cmd.AddValue("confidence", "confidence level of the intervals", confidence);
+    cmd.AddValue("targetHalfWidth",
+                 "target half-width of the confidence intervals, relative to the mean",
+                 targetHalfWidth);
+    cmd.AddValue("absTolerance",
+                 "half-width accepted for KPIs whose mean is close to zero",
+                 absTolerance);
+    cmd.AddValue("minRuns", "number of replications before the first check", minRuns);
+    cmd.AddValue("maxRunsPerConfig", "maximum number of replications of a configuration", maxRunsPerConfig);
+    cmd.AddValue("budget", "maximum number of replications in total", budget);
+    cmd.AddValue("jobs", "number of simulations run in parallel", jobs);
+    cmd.AddValue("extraArgs", "extra arguments passed to every simulation", extraArgs);
+    cmd.AddValue("outputDir", "directory where to store the runs and the results", outputDir);
+
+    cmd.Parse(argc, argv);
+
+    NS_ABORT_MSG_IF(minRuns < 2, "At least two replications are needed for an interval");
+
+    std::vector<Configuration> configurations;
+    if (configs.empty())
+    {
+        configurations.emplace_back();
+    }
+    else
+    {
+        std::ifstream in(configs.c_str());
+        NS_ABORT_MSG_IF(!in.is_open(), "Can't open file " << configs);
+        std::string line;
+        while (std::getline(in, line))
+        {
+            if (!line.empty() && line[0] != '#')
+            {
+                configurations.emplace_back();
+                configurations.back().args = line;
+            }
+        }
+    }
+
+    std::filesystem::create_directories(outputDir);
+    std::string simPath = std::filesystem::absolute(simBinary).string();
+
+    // each replication has its own directory, so that traces of parallel runs do not clash
+    auto runDir = [&](std::size_t c, uint32_t run) {
+        return outputDir + "/config" + std::to_string(c) + "/run" + std::to_string(run);
+    };
+    auto makeCommand = [&](std::size_t c, uint32_t run) {
+        std::string dir = runDir(c, run);
+        std::filesystem::create_directories(dir);
+        std::ostringstream command;
+        command << "cd " << ShellQuote(dir) << " && " << ShellQuote(simPath) << " --rngRun=" << run
+                << " " << configurations[c].args << " " << extraArgs
+                << " --outputDir=. --simTag=results.txt --kpiFile=kpi.txt > sim.log 2>&1";
+        return command.str();
+    };
+
+    uint32_t spent = 0;
+    for (uint32_t round = 0; spent < budget; ++round)
+    {
+        // how many more replications each configuration asks for
+        std::vector<std::pair<std::size_t, uint32_t>> requests;
+        uint32_t totalRequested = 0;
+        for (std::size_t c = 0; c < configurations.size(); ++c)
+        {
+            Configuration& conf = configurations[c];
+            uint32_t want = conf.runs < minRuns
+                                ? minRuns - conf.runs
+                                : RemainingRuns(conf, confidence, targetHalfWidth, absTolerance);
+            want = std::min(want, maxRunsPerConfig - std::min(maxRunsPerConfig, conf.runs));
+            if (want > 0)
+            {
+                requests.emplace_back(c, want);
+                totalRequested += want;
+            }
+        }
+        if (requests.empty())
+        {
+            break;
+        }
+
+        // the initial replications are all granted; later rounds share the slots
+        // in proportion to the estimated need, at least one each
+        uint32_t slots = std::min(budget - spent, round == 0 ? totalRequested : jobs);
+        std::sort(requests.begin(), requests.end(), [](const auto& a, const auto& b) {
+            return a.second > b.second;
+        });
+        std::vector<std::pair<std::size_t, uint32_t>> launches;
+        for (const auto& [c, want] : requests)
+        {
+            if (slots == 0)
+            {
+                break;
+            }
+            uint32_t share = round == 0 ? want
+                                        : std::max<uint32_t>(1,
+                                                             static_cast<uint64_t>(jobs) * want /
+                                                                 totalRequested);
+            share = std::min({share, want, slots});
+            slots -= share;
+            for (uint32_t k = 0; k < share; ++k)
+            {
+                launches.emplace_back(c, ++configurations[c].runs);
+            }
+        }
+
+        std::vector<std::string> commands;
+        for (const auto& [c, run] : launches)
+        {
+            commands.push_back(makeCommand(c, run));
+        }
+        RunParallel(commands, jobs);
+        spent += launches.size();
+
+        for (const auto& [c, run] : launches)
+        {
+            Configuration& conf = configurations[c];
+            std::vector<SliceKpi> kpis;
+            if (!ReadKpiFile(runDir(c, run) + "/kpi.txt", kpis))
+            {
+                std::cerr << "Replication " << run << " of config " << c << " failed" << std::endl;
+                ++conf.failed;
+                continue;
+            }
+            for (const auto& k : kpis)
+            {
+                // a direction without traffic still counts, as a zero throughput
+                if (k.throughputMbps == 0 && k.p99DelayMs == 0)
+                {
+                    ++conf.idle;
+                }
+                std::string key = k.slice + "," + k.direction;
+                conf.stats[key + ",throughputMbps"].Add(k.throughputMbps);
+                conf.stats[key + ",p99DelayMs"].Add(k.p99DelayMs);
+            }
+        }
+        std::cout << "Round " << round + 1 << ": " << launches.size() << " replications, "
+                  << spent << " of " << budget << " spent" << std::endl;
+    }
+
+    std::ofstream out(outputDir + "/replications.csv");
+    out << "config,runs,failed,converged,slice,direction,kpi,mean,halfWidth,relativeHalfWidth\n";
+    for (std::size_t c = 0; c < configurations.size(); ++c)
+    {
+        const Configuration& conf = configurations[c];
+        bool converged =
+            conf.runs >= minRuns &&
+            RemainingRuns(conf, confidence, targetHalfWidth, absTolerance) == 0;
+        for (const auto& [name, s] : conf.stats)
+        {
+            double hw = s.GetHalfWidth(confidence);
+            out << c << "," << s.GetCount() << "," << conf.failed << "," << converged << ","
+                << name << "," << s.GetMean() << "," << hw << ","
+                << (s.GetMean() != 0 ? hw / std::abs(s.GetMean()) : 0.) << "\n";
+        }
+        if (conf.stats.empty())
+        {
+            // no KPI to report: a row still records the failures
+            out << c << ",0," << conf.failed << ",0,,,,,,\n";
+        }
+        std::cout << "Config " << c << " (" << conf.args << "): " << conf.runs << " replications, "
+                  << conf.failed << " failed, " << conf.idle << " idle KPI records, "
+                  << (conf.stats.empty()
+                          ? (conf.runs > 0 ? "no KPIs, all replications failed" : "no replications")
+                          : (converged ? "converged" : "not converged"))
+                  << std::endl;
+    }
+    return 0;
+}
@@ -0,0 +1,121 @@
+#include "ns3/core-module.h"
+
+#include "slicing-results-store.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <set>
+#include <tuple>
+
+/**
+ * Summarize the slices table of a results store written by
+ * sim-network-slicing.cc with --resultsStore.
+ *
+ * The slice rows are grouped by configuration hash, slice and direction, and
+ * the mean throughput, mean and worst p99 delay and mean lost packets over the
+ * runs of each group are printed as CSV, followed by the parameters of each
+ * configuration. The columns are memory-mapped and scanned once.
+ *
+ * Example:
+ * ./ns3 run "results-scan-network-slicing --store=results-store"
+ */
+
+using namespace ns3;
+
+NS_LOG_COMPONENT_DEFINE("SlicingResultsScan");
+
+static const std::string g_sliceNames[] = {"VR", "CG", "AD"};
+
+/// Sums over the runs of a group.
+struct GroupSums
+{
+    uint32_t runs{0};           //!< Number of runs.
+    double throughputMbps{0};   //!< Sum of the throughput.
+    double p99DelayMs{0};       //!< Sum of the p99 delay.
+    double maxP99DelayMs{0};    //!< Worst p99 delay.
+    double lostPackets{0};      //!< Sum of the lost packets.
+};
+
+int
+main(int argc, char* argv[])
+{
+    std::string store = "./results-store";
+    std::string configHash = "";
+
+    CommandLine cmd(__FILE__);
+
+    cmd.AddValue("store", "directory of the results store", store);
+    cmd.AddValue("configHash", "if not empty, only the configuration with this hex hash", configHash);
+
+    cmd.Parse(argc, argv);
+
+    ColumnReader slices;
+    if (!slices.Open(store, "slices", g_sliceColumns))
+    {
+        std::cerr << "Can't open the slices table of " << store << std::endl;
+        return 1;
+    }
+    uint64_t filter = configHash.empty() ? 0 : std::stoull(configHash, nullptr, 16);
+
+    const uint64_t* hash = slices.Get<uint64_t>("configHash");
+    const uint8_t* slice = slices.Get<uint8_t>("slice");
+    const uint8_t* direction = slices.Get<uint8_t>("direction");
+    const double* throughput = slices.Get<double>("throughputMbps");
+    const double* p99 = slices.Get<double>("p99DelayMs");
+    const uint64_t* lost = slices.Get<uint64_t>("lostPackets");
+
+    std::map<std::tuple<uint64_t, uint8_t, uint8_t>, GroupSums> groups;
+    std::set<uint64_t> hashes;
+    for (uint64_t r = 0; r < slices.GetNumRows(); ++r)
+    {
+        if (!configHash.empty() && hash[r] != filter)
+        {
+            continue;
+        }
+        GroupSums& g = groups[std::make_tuple(hash[r], slice[r], direction[r])];
+        hashes.insert(hash[r]);
+        ++g.runs;
+        g.throughputMbps += throughput[r];
+        g.p99DelayMs += p99[r];
+        g.maxP99DelayMs = std::max(g.maxP99DelayMs, p99[r]);
+        g.lostPackets += lost[r];
+    }
+
+    std::cout << "configHash,slice,direction,runs,throughputMbps,p99DelayMs,maxP99DelayMs,"
+                 "lostPackets\n";
+    for (const auto& [key, g] : groups)
+    {
+        char hex[17];
+        std::snprintf(hex, sizeof(hex), "%016llx", static_cast<unsigned long long>(std::get<0>(key)));
+        uint8_t s = std::get<1>(key);
+        std::cout << hex << "," << (s < 3 ? g_sliceNames[s] : std::to_string(s)) << ","
+                  << (std::get<2>(key) == 0 ? "DL" : "UL") << "," << g.runs << ","
+                  << g.throughputMbps / g.runs << "," << g.p99DelayMs / g.runs << ","
+                  << g.maxP99DelayMs << "," << g.lostPackets / g.runs << "\n";
+    }
+
+    // the parameters of the configurations listed above
+    std::ifstream configs(store + "/configs.txt");
+    std::map<std::string, std::string> params;
+    std::string line;
+    while (std::getline(configs, line))
+    {
+        std::size_t space = line.find(' ');
+        if (space != std::string::npos)
+        {
+            params.emplace(line.substr(0, space), line.substr(space + 1));
+        }
+    }
+    std::cout << "\n";
+    for (const auto& [hexHash, canonical] : params)
+    {
+        if (hashes.count(std::stoull(hexHash, nullptr, 16)) > 0)
+        {
+            std::cout << "# " << hexHash << " " << canonical << "\n";
+        }
+    }
+    return 0;
+}
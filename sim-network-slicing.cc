@@ -16,7 +16,37 @@
 #include "ns3/point-to-point-helper.h"
 #include "ns3/point-to-point-module.h"
 
+#include "slicing-admission-control.h"
+#include "slicing-batch-runner.h"
+#include "slicing-buffer-status.h"
+#include "slicing-ca-split-app.h"
+#include "slicing-core-topology.h"
+#include "slicing-drop-counters.h"
+#include "slicing-duplication-app.h"
+#include "slicing-edge-offload.h"
+#include "slicing-event-log.h"
+#include "slicing-flow-plan.h"
+#include "slicing-harq-stats.h"
+#include "slicing-kpi.h"
+#include "slicing-kpi-sampler.h"
+#include "slicing-memory-accounting.h"
+#include "slicing-metrics-endpoint.h"
+#include "slicing-minislot-scheduler.h"
+#include "slicing-power-allocator.h"
+#include "slicing-priority-cost.h"
+#include "slicing-results-store.h"
+#include "slicing-run-config.h"
+#include "slicing-sched-timeline.h"
+#include "slicing-steady-state.h"
+#include "slicing-stream-registry.h"
+#include "slicing-trace-manager.h"
+#include "slicing-ue-registry.h"
+
+#include <algorithm>
+#include <functional>
 #include <iostream>
+#include <map>
+#include <tuple>
 #include <chrono>
 #include <ctime>    
 
@@ -24,6 +54,23 @@ using namespace ns3;
 
 NS_LOG_COMPONENT_DEFINE("PreliminaryNetworkSlicingSimulation");
 
+/**
+ * Install an XR source on the remote host and its sinks on a UE.
+ *
+ * The bearers carrying the flow are activated by the caller, see FlowPortPlan.
+ *
+ * \param ueContainer The UEs of the slice.
+ * \param i The index of the UE in the slice.
+ * \param ueIpIface The IP interfaces of the UEs of the slice.
+ * \param config The XR configuration; its streams use consecutive ports from port.
+ * \param appDataRate The data rate in Mbps.
+ * \param appFps The frame rate.
+ * \param port The first port of the flow.
+ * \param transportProtocol The socket factory.
+ * \param remoteHostContainer The application server of the slice.
+ * \param serverApps The container the sinks are added to.
+ * \param clientApps The container the source is added to.
+ */
 void
 ConfigureXrApp(NodeContainer& ueContainer,
                uint32_t i,
@@ -34,15 +81,8 @@ ConfigureXrApp(NodeContainer& ueContainer,
                uint16_t port,
                std::string transportProtocol,
                NodeContainer& remoteHostContainer,
-               NetDeviceContainer& ueNetDev,
-               Ptr<NrHelper> nrHelper,
-               EpsBearer& bearer,
-               Ptr<EpcTft> tft,
-               bool isMx1,
-               std::vector<Ptr<EpcTft>>& tfts,
                ApplicationContainer& serverApps,
-               ApplicationContainer& clientApps,
-               ApplicationContainer& pingApps)
+               ApplicationContainer& clientApps)
 {
     XrTrafficMixerHelper trafficMixerHelper;
     Ipv4Address ipAddress = ueIpIface.GetAddress(i, 0);
@@ -62,28 +102,6 @@ ConfigureXrApp(NodeContainer& ueContainer,
     currentUeClientApps.Add(
         trafficMixerHelper.Install(transportProtocol, addresses, remoteHostContainer.Get(0)));
 
-    // Seed the ARP cache by pinging early in the simulation
-    // This is a workaround until a static ARP capability is provided
-    PingHelper ping(ipAddress);
-    pingApps.Add(ping.Install(remoteHostContainer));
-
-    Ptr<NetDevice> ueDevice = ueNetDev.Get(i);
-    // Activate a dedicated bearer for the traffic type per node
-    nrHelper->ActivateDedicatedEpsBearer(ueDevice, bearer, tft);
-    // Activate a dedicated bearer for the traffic type per node
-    if (isMx1)
-    {
-        nrHelper->ActivateDedicatedEpsBearer(ueDevice, bearer, tft);
-    }
-    else
-    {
-        NS_ASSERT(tfts.size() >= currentUeClientApps.GetN());
-        for (uint32_t j = 0; j < currentUeClientApps.GetN(); j++)
-        {
-            nrHelper->ActivateDedicatedEpsBearer(ueDevice, bearer, tfts[j]);
-        }
-    }
-
     for (uint32_t j = 0; j < currentUeClientApps.GetN(); j++)
     {
         PacketSinkHelper dlPacketSinkHelper(transportProtocol, localAddresses.at(j));
@@ -100,13 +118,265 @@ ConfigureXrApp(NodeContainer& ueContainer,
     clientApps.Add(currentUeClientApps);
 }
 
+/**
+ * Configure a frame-based source split over bearers on several CCs.
+ *
+ * Leg k of the source targets port + k of the UE, which is matched by the TFT
+ * of the k-th bearer of the slice; the QCI of each bearer maps to a different
+ * BWP. The bearers are activated by the caller, see FlowPortPlan.
+ *
+ * \param ueContainer The UEs of the slice.
+ * \param i The index of the UE in the slice.
+ * \param ueIpIface The IP interfaces of the UEs of the slice.
+ * \param appDataRate The data rate of the source in Mbps.
+ * \param appFps The frame rate of the source.
+ * \param port The port of the primary leg.
+ * \param transportProtocol The socket factory.
+ * \param remoteHostContainer The application server of the slice.
+ * \param weights The split weight of each leg, the primary CC first.
+ * \param policy The split policy.
+ * \param serverApps The container the sinks are added to.
+ * \param clientApps The container the source is added to.
+ * \return The source.
+ */
+Ptr<CaSplitApp>
+ConfigureCaApp(NodeContainer& ueContainer,
+               uint32_t i,
+               Ipv4InterfaceContainer& ueIpIface,
+               double appDataRate,
+               uint16_t appFps,
+               uint16_t port,
+               std::string transportProtocol,
+               NodeContainer& remoteHostContainer,
+               const std::vector<double>& weights,
+               std::string policy,
+               ApplicationContainer& serverApps,
+               ApplicationContainer& clientApps)
+{
+    Ipv4Address ipAddress = ueIpIface.GetAddress(i, 0);
+
+    std::vector<Address> legs;
+    for (uint32_t k = 0; k < weights.size(); ++k)
+    {
+        legs.emplace_back(InetSocketAddress(ipAddress, port + k));
+        PacketSinkHelper dlPacketSinkHelper(transportProtocol,
+                                            InetSocketAddress(Ipv4Address::GetAny(), port + k));
+        serverApps.Add(dlPacketSinkHelper.Install(ueContainer.Get(i)));
+    }
+
+    Ptr<CaSplitApp> app = CreateObject<CaSplitApp>();
+    app->Setup(transportProtocol, legs, weights, policy, appDataRate, appFps);
+    remoteHostContainer.Get(0)->AddApplication(app);
+    clientApps.Add(app);
+    return app;
+}
+
+/**
+ * Configure a frame-based UDP source duplicated over bearers on several CCs.
+ *
+ * As for ConfigureCaApp, leg k targets port + k of the UE, matched by the TFT
+ * of the k-th bearer of the slice, but every packet goes over all the legs
+ * and the sink on the UE keeps the first copy.
+ *
+ * \param ueContainer The UEs of the slice.
+ * \param i The index of the UE in the slice.
+ * \param ueIpIface The IP interfaces of the UEs of the slice.
+ * \param appDataRate The data rate of the source in Mbps, without the copies.
+ * \param appFps The frame rate of the source.
+ * \param port The port of the primary leg.
+ * \param deadline The delay budget of a packet.
+ * \param remoteHostContainer The application server of the slice.
+ * \param numLegs The number of legs.
+ * \param serverApps The container the sink is added to.
+ * \param clientApps The container the source is added to.
+ */
+void
+ConfigureDuplicationApp(NodeContainer& ueContainer,
+                        uint32_t i,
+                        Ipv4InterfaceContainer& ueIpIface,
+                        double appDataRate,
+                        uint16_t appFps,
+                        uint16_t port,
+                        Time deadline,
+                        NodeContainer& remoteHostContainer,
+                        uint32_t numLegs,
+                        ApplicationContainer& serverApps,
+                        ApplicationContainer& clientApps)
+{
+    Ipv4Address ipAddress = ueIpIface.GetAddress(i, 0);
+
+    std::vector<Address> legs;
+    std::vector<uint16_t> ports;
+    for (uint32_t k = 0; k < numLegs; ++k)
+    {
+        legs.emplace_back(InetSocketAddress(ipAddress, port + k));
+        ports.push_back(port + k);
+    }
+
+    Ptr<DuplicateDiscardSink> sink = CreateObject<DuplicateDiscardSink>();
+    sink->SetAttribute("Deadline", TimeValue(deadline));
+    sink->Setup(ports);
+    ueContainer.Get(i)->AddApplication(sink);
+    serverApps.Add(sink);
+
+    Ptr<DuplicatingSource> source = CreateObject<DuplicatingSource>();
+    source->Setup(legs, appDataRate, appFps);
+    remoteHostContainer.Get(0)->AddApplication(source);
+    clientApps.Add(source);
+}
+
+/**
+ * Install an uplink constant bit rate generator on a UE.
+ *
+ * \param ueNode The UE node that sends the traffic.
+ * \param remoteAddress The address of the remote host that receives it.
+ * \param port The destination port, matched by the UL packet filter of the slice.
+ * \param dataRate The data rate in Mbps.
+ * \param packetSize The packet size in bytes.
+ * \param clientApps The container the generator is added to.
+ */
+void
+ConfigureUlApp(Ptr<Node> ueNode,
+               Ipv4Address remoteAddress,
+               uint16_t port,
+               double dataRate,
+               uint32_t packetSize,
+               ApplicationContainer& clientApps)
+{
+    UdpClientHelper ulClient(remoteAddress, port);
+    ulClient.SetAttribute("PacketSize", UintegerValue(packetSize));
+    ulClient.SetAttribute("Interval", TimeValue(Seconds(packetSize * 8.0 / (dataRate * 1e6))));
+    ulClient.SetAttribute("MaxPackets", UintegerValue(0xFFFFFFFF));
+    clientApps.Add(ulClient.Install(ueNode));
+}
+
+/**
+ * Map a flow to its slice and direction from the port plan of the scenario.
+ *
+ * \param t The five-tuple of the flow.
+ * \param dlPlan The port plan of the DL flows.
+ * \param ulPorts The UL port of each slice.
+ * \param numSlices The number of slices.
+ * \param slice The slice index, set when the flow belongs to a slice.
+ * \param isDl Set to true for a downlink data flow, false for an uplink one.
+ * \return false for flows outside the port plan, e.g. the ACKs of TCP flows.
+ */
+bool
+ClassifyFlow(const Ipv4FlowClassifier::FiveTuple& t,
+             const FlowPortPlan& dlPlan,
+             const uint16_t* ulPorts,
+             uint8_t numSlices,
+             uint8_t& slice,
+             bool& isDl)
+{
+    uint16_t flow;
+    if (dlPlan.Lookup(t.destinationPort, slice, flow))
+    {
+        isDl = true;
+        return true;
+    }
+    for (uint8_t s = 0; s < numSlices; ++s)
+    {
+        if (t.destinationPort == ulPorts[s])
+        {
+            slice = s;
+            isDl = false;
+            return true;
+        }
+    }
+    return false;
+}
+
+/**
+ * Sum the flow monitor statistics of the data flows of each slice.
+ *
+ * \param monitor The flow monitor.
+ * \param classifier The classifier of the flow monitor.
+ * \param dlPlan The port plan of the DL flows.
+ * \param ulPorts The UL port of each slice.
+ * \param numSlices The number of slices.
+ * \param withDelayBins False to leave the delay histograms out, e.g. for the live metrics.
+ * \return The counters of each direction and slice, at index dir * numSlices + slice.
+ */
+std::vector<SliceCounters>
+CollectSliceCounters(Ptr<FlowMonitor> monitor,
+                     Ptr<Ipv4FlowClassifier> classifier,
+                     const FlowPortPlan& dlPlan,
+                     const uint16_t* ulPorts,
+                     uint8_t numSlices,
+                     bool withDelayBins = true)
+{
+    std::vector<SliceCounters> counters(2 * numSlices);
+    for (const auto& [flowId, fs] : monitor->GetFlowStats())
+    {
+        uint8_t slice;
+        bool isDl;
+        if (!ClassifyFlow(classifier->FindFlow(flowId), dlPlan, ulPorts, numSlices, slice, isDl))
+        {
+            continue;
+        }
+        SliceCounters& c = counters[(isDl ? 0 : 1) * numSlices + slice];
+        c.rxBytes += fs.rxBytes;
+        c.rxPackets += fs.rxPackets;
+        c.lostPackets += fs.lostPackets;
+        c.delaySum += fs.delaySum.GetSeconds();
+        if (!withDelayBins)
+        {
+            continue;
+        }
+        const Histogram& h = fs.delayHistogram;
+        if (c.delayBins.size() < h.GetNBins())
+        {
+            c.delayBins.resize(h.GetNBins(), 0);
+        }
+        for (uint32_t b = 0; b < h.GetNBins(); ++b)
+        {
+            c.delayBins[b] += h.GetBinCount(b);
+        }
+    }
+    return counters;
+}
+
+/**
+ * Take the counters of each flow from the flow monitor statistics.
+ *
+ * \param monitor The flow monitor.
+ * \return The counters of each flow.
+ */
+std::map<FlowId, FlowCounters>
+CollectFlowCounters(Ptr<FlowMonitor> monitor)
+{
+    std::map<FlowId, FlowCounters> counters;
+    for (const auto& [flowId, fs] : monitor->GetFlowStats())
+    {
+        FlowCounters& c = counters[flowId];
+        c.txBytes = fs.txBytes;
+        c.txPackets = fs.txPackets;
+        c.rxBytes = fs.rxBytes;
+        c.rxPackets = fs.rxPackets;
+        c.lostPackets = fs.lostPackets;
+        c.delaySum = fs.delaySum.GetSeconds();
+        c.jitterSum = fs.jitterSum.GetSeconds();
+    }
+    return counters;
+}
+
+/**
+ * Run one scenario.
+ *
+ * \param argc The number of arguments.
+ * \param argv The command-line arguments of the scenario.
+ * \return The exit status of the scenario.
+ */
 int
-main(int argc, char* argv[])
+RunScenario(int argc, char* argv[])
 {
     uint32_t appDuration = 10000;
     uint32_t appStartTimeMs = 400;
 
-    const uint8_t numCcs = 3;
+    uint8_t numCcs = 3;                         // 2 when the AD slice shares the VR BWP
+    const uint8_t numSlices = 3;
+    const std::string sliceNames [] = {"VR", "CG", "AD"};
 
     uint16_t ueNumPerSlice [] = {1, 2, 3};
     uint16_t numFlowsUe = 1;
@@ -127,76 +397,338 @@ main(int argc, char* argv[])
 
     std::string pattern =
         "DL|DL|DL|DL|UL|DL|DL|DL|DL|UL|"; // Pattern can be e.g. "DL|S|UL|UL|DL|DL|S|UL|UL|DL|" "F|F|F|F|F|F|F|F|F|F|"
+    std::string patternCc [] = {"", "", ""};    // per-CC override of pattern, empty to inherit
     double totalTxPower = 41;
+    std::string powerAllocation = "bandwidth";
+    double powerSlaWeight [] = {1., 1., 2.};
+    uint32_t powerUpdatePeriod = 100;
     bool cellScan = false;
     double beamSearchAngleStep = 10.0;
 
     bool useUdp = false;
     double dataRate [] = {45., 30., 10.};   // data rate in Mbps
     uint16_t fps [] = {60, 60, 30};
+    bool vrCarrierAggregation = false;
+    std::string caSplitPolicy = "bandwidth";
+    // UL: VR pose updates, CG input, AD sensor uploads
+    double ulDataRate [] = {0.5, 0.1, 20.};     // data rate in Mbps, 0 disables the UL flow
+    uint32_t ulPacketSize [] = {100, 50, 1200}; // packet size in bytes
+    double deadlineMs [] = {10., 10., 5.};      // PDCP delay budget, 0 disables
+    // mini-slots on the AD BWP, see NrMacSchedulerTdmaMiniSlot
+    uint32_t miniSlotSymbols = 0;               // 2, 4 or 7; 0 keeps slot-based scheduling
+    bool sharedBwp = false;                     // AD on the VR BWP instead of its own
+    bool adPriority = false;                    // AD UEs before all the others
+    // duplication of the AD traffic over two CCs, see DuplicatingSource
+    uint32_t adDuplicationLegs = 0;             // 0 keeps the AD video flows
+    uint32_t adDuplicationCc = 1;               // CC of the second leg
+    // admission control, see SliceAdmissionController
+    bool admissionControl = false;
+    double admissionArrivalMs = 200.;   // mean time between the arrivals of the UEs of a slice
+    double admissionMaxLoad = 0.9;
+    double admissionDowngrade = 0.5;
+    // edge compute offload, see EdgeComputeServer and OffloadClient
+    double offloadPeriodMs [] = {0., 0., 100.};             // 0 disables
+    uint32_t offloadTaskSize [] = {100000, 10000, 60000};   // UL bytes per task
+    uint32_t offloadResultSize [] = {1000, 200, 200};       // DL bytes per result
+    double offloadDeadlineMs [] = {100., 50., 100.};
+    uint16_t offloadPriority [] = {2, 1, 0};                // 0 is served first
+    uint32_t offloadWorkers = 4;
+    std::string offloadServiceTime = "ns3::ExponentialRandomVariable[Mean=0.01]";
+    // core network, see SliceCoreTopology
+    bool flatCore = false;
+    std::string anchor [] = {"central", "edge", "edge"};
+    double s1uDelayMs = 1.;
+    double n9DelayMs = 10.;
+    double n9DataRate = 10.;                    // Gbps
+    double edgeN6DelayMs = 0.5;
+    double centralN6DelayMs = 1.;
+    // warm-up truncation and early stop, see SteadyStateDetector
+    bool steadyState = false;
+    uint32_t steadyStatePeriod = 100;
+    double steadyStateTolerance = 0.05;
+    bool steadyStateStop = false;
     bool logging = false;
+    bool textLogging = false;
 
     // commencing...
     auto start = std::chrono::system_clock::now();
     std::time_t start_time = std::chrono::system_clock::to_time_t(start);
-    std::string simTag = std::ctime(&start_time);
+    char startTag[32];
+    std::strftime(startTag, sizeof(startTag), "%Y%m%d-%H%M%S", std::localtime(&start_time));
+    std::string simTag = std::string("results-") + startTag + ".txt";
     std::string outputDir = "./";
+    std::string kpiFile = "";
+    std::string resultsStore = "";
+    // NR traces: binary records of the selected families, see SliceTraceManager
+    std::string traceFamilies = "rxPacket,dlSched,ulSched,slotStats";
+    uint32_t traceSampling = 1;
+    bool traceAggregate = false;
+    bool legacyTraces = false;
+    // per-slice KPI time series, see SliceKpiSampler
+    uint32_t kpiSamplingPeriod = 0;
+    uint32_t kpiSamplingCapacity = 4096;
+    bool kpiSamplingIncremental = true;
+    bool harqStatsPerUe = false;
+    // scheduler decisions as Chrome trace events, see SchedulerTimeline
+    uint32_t schedTimelineStartMs = 0;
+    uint32_t schedTimelineDurationMs = 0;
+    uint32_t schedTimelineCapacity = 1 << 20;
+    // live Prometheus metrics, see MetricsEndpoint
+    uint32_t metricsPort = 0;
+    std::string metricsSocket = "";
+    uint32_t metricsPeriodMs = 1000;
+    // memory census, see MemoryCensus; build with -DSLICING_MEMORY_ACCOUNTING for the heap
+    uint32_t memoryCensusPeriod = 0;
 
     // random seed
     uint32_t rngRun = 1;
+    bool legacyStreams = false;
 
     CommandLine cmd(__FILE__);
-
-    cmd.AddValue("appDuration", "Duration of the application in milliseconds.", appDuration);
-    cmd.AddValue("ueNumPerSlice0", "The number of UE of VR in multiple-ue topology", ueNumPerSlice[0]);
-    cmd.AddValue("ueNumPerSlice1", "The number of UE of CG in multiple-ue topology", ueNumPerSlice[1]);
-    cmd.AddValue("ueNumPerSlice2", "The number of UE of AD in multiple-ue topology", ueNumPerSlice[2]);
-    cmd.AddValue("centralFrequencyBand",
-                 "The system frequency to be used in band 1",
-                 centralFrequencyBand);
-    cmd.AddValue("bandwidthBand", "The system bandwidth to be used in band 1", bandwidthBand);
-    cmd.AddValue("centralFrequencyCc0",
-                 "The system frequency to be used in CC 0",
-                 centralFrequencyCc[0]);
-    cmd.AddValue("bandwidthCc0", "The system bandwidth to be used in CC 0", bandwidthCc[0]);
-    cmd.AddValue("centralFrequencyCc1",
-                 "The system frequency to be used in CC 1",
-                 centralFrequencyCc[1]);
-    cmd.AddValue("bandwidthCc1", "The system bandwidth to be used in CC 1", bandwidthCc[1]);
-    cmd.AddValue("centralFrequencyCc2",
-                 "The system frequency to be used in CC 1",
-                 centralFrequencyCc[2]);
-    cmd.AddValue("bandwidthCc2", "The system bandwidth to be used in CC 2", bandwidthCc[2]);
-    cmd.AddValue("numerologyCc0", "Numerlogy to be used in CC 0, BWP 0", numerologyCc[0]);
-    cmd.AddValue("numerologyCc1", "Numerlogy to be used in CC 0, BWP 1", numerologyCc[1]);
-    cmd.AddValue("numerologyCc2", "Numerlogy to be used in CC 1, BWP 0", numerologyCc[2]);
-    cmd.AddValue("tddPattern",
-                 "LTE TDD pattern to use (e.g. --tddPattern=DL|S|UL|UL|UL|DL|S|UL|UL|UL|)",
-                 pattern);
-    cmd.AddValue("totalTxPower",
-                 "total tx power that will be proportionally assigned to"
-                 " bandwidth parts depending on each BWP bandwidth ",
-                 totalTxPower);
-    cmd.AddValue("cellScan",
-                 "Use beam search method to determine beamforming vector,"
-                 "true to use cell scanning method",
-                 cellScan);
-    cmd.AddValue("beamSearchAngleStep",
-                 "Beam search angle step for beam search method",
-                 beamSearchAngleStep);
-    cmd.AddValue("useUdp",
-                 "if true, the NGMN applications will run over UDP connection, otherwise a TCP "
-                 "connection will be used.",
-                 useUdp);
+    // the scenario parameters, hashed into the key of the results store
+    RunConfig config(cmd);
+
+    config.AddValue("appDuration", "Duration of the application in milliseconds.", appDuration);
+    config.AddValue("ueNumPerSlice0", "The number of UE of VR in multiple-ue topology", ueNumPerSlice[0]);
+    config.AddValue("ueNumPerSlice1", "The number of UE of CG in multiple-ue topology", ueNumPerSlice[1]);
+    config.AddValue("ueNumPerSlice2", "The number of UE of AD in multiple-ue topology", ueNumPerSlice[2]);
+    config.AddValue("numFlowsUe",
+                    "The number of DL flows per UE; they share the slice data rate and use the "
+                    "QCIs of the slice in turn",
+                    numFlowsUe);
+    config.AddValue("centralFrequencyBand",
+                    "The system frequency to be used in band 1",
+                    centralFrequencyBand);
+    config.AddValue("bandwidthBand", "The system bandwidth to be used in band 1", bandwidthBand);
+    config.AddValue("centralFrequencyCc0",
+                    "The system frequency to be used in CC 0",
+                    centralFrequencyCc[0]);
+    config.AddValue("bandwidthCc0", "The system bandwidth to be used in CC 0", bandwidthCc[0]);
+    config.AddValue("centralFrequencyCc1",
+                    "The system frequency to be used in CC 1",
+                    centralFrequencyCc[1]);
+    config.AddValue("bandwidthCc1", "The system bandwidth to be used in CC 1", bandwidthCc[1]);
+    config.AddValue("centralFrequencyCc2",
+                    "The system frequency to be used in CC 1",
+                    centralFrequencyCc[2]);
+    config.AddValue("bandwidthCc2", "The system bandwidth to be used in CC 2", bandwidthCc[2]);
+    config.AddValue("numerologyCc0", "Numerlogy to be used in CC 0, BWP 0", numerologyCc[0]);
+    config.AddValue("numerologyCc1", "Numerlogy to be used in CC 0, BWP 1", numerologyCc[1]);
+    config.AddValue("numerologyCc2", "Numerlogy to be used in CC 1, BWP 0", numerologyCc[2]);
+    config.AddValue("tddPattern",
+                    "LTE TDD pattern to use (e.g. --tddPattern=DL|S|UL|UL|UL|DL|S|UL|UL|UL|)",
+                    pattern);
+    config.AddValue("tddPatternCc0", "TDD pattern of CC 0, overrides tddPattern", patternCc[0]);
+    config.AddValue("tddPatternCc1", "TDD pattern of CC 1, overrides tddPattern", patternCc[1]);
+    config.AddValue("tddPatternCc2", "TDD pattern of CC 2, overrides tddPattern", patternCc[2]);
+    config.AddValue("totalTxPower",
+                    "total tx power that will be proportionally assigned to"
+                    " bandwidth parts depending on each BWP bandwidth ",
+                    totalTxPower);
+    config.AddValue("powerAllocation",
+                    "split of totalTxPower across BWPs: bandwidth (proportional to the BWP "
+                    "bandwidth) or sla (re-optimized from the SLA weights and the measured demand)",
+                    powerAllocation);
+    config.AddValue("powerSlaWeight0", "SLA weight of VR in the power allocation", powerSlaWeight[0]);
+    config.AddValue("powerSlaWeight1", "SLA weight of CG in the power allocation", powerSlaWeight[1]);
+    config.AddValue("powerSlaWeight2", "SLA weight of AD in the power allocation", powerSlaWeight[2]);
+    config.AddValue("powerUpdatePeriod",
+                    "period of the power re-optimization in milliseconds",
+                    powerUpdatePeriod);
+    config.AddValue("cellScan",
+                    "Use beam search method to determine beamforming vector,"
+                    "true to use cell scanning method",
+                    cellScan);
+    config.AddValue("beamSearchAngleStep",
+                    "Beam search angle step for beam search method",
+                    beamSearchAngleStep);
+    config.AddValue("useUdp",
+                    "if true, the NGMN applications will run over UDP connection, otherwise a TCP "
+                    "connection will be used.",
+                    useUdp);
+    config.AddValue("dataRate0", "DL data rate of VR in Mbps", dataRate[0]);
+    config.AddValue("dataRate1", "DL data rate of CG in Mbps", dataRate[1]);
+    config.AddValue("dataRate2", "DL data rate of AD in Mbps", dataRate[2]);
+    config.AddValue("vrCarrierAggregation",
+                    "split the VR traffic over bearers on all CCs instead of CC 0 only",
+                    vrCarrierAggregation);
+    config.AddValue("caSplitPolicy",
+                    "split policy of the VR carrier aggregation: bandwidth, equal or backlog",
+                    caSplitPolicy);
+    config.AddValue("ulDataRate0", "UL data rate of the VR pose updates in Mbps", ulDataRate[0]);
+    config.AddValue("ulDataRate1", "UL data rate of the CG input in Mbps", ulDataRate[1]);
+    config.AddValue("ulDataRate2", "UL data rate of the AD sensor uploads in Mbps", ulDataRate[2]);
+    config.AddValue("ulPacketSize0", "UL packet size of the VR pose updates in bytes", ulPacketSize[0]);
+    config.AddValue("ulPacketSize1", "UL packet size of the CG input in bytes", ulPacketSize[1]);
+    config.AddValue("ulPacketSize2", "UL packet size of the AD sensor uploads in bytes", ulPacketSize[2]);
+    config.AddValue("deadlineMs0", "delay budget of the VR PDCP PDUs in ms, 0 disables", deadlineMs[0]);
+    config.AddValue("deadlineMs1", "delay budget of the CG PDCP PDUs in ms, 0 disables", deadlineMs[1]);
+    config.AddValue("deadlineMs2", "delay budget of the AD PDCP PDUs in ms, 0 disables", deadlineMs[2]);
+    config.AddValue("miniSlotSymbols",
+                    "schedule the AD BWP in mini-slots of 2, 4 or 7 symbols, with the shortest "
+                    "processing delays; 0 keeps slot-based scheduling",
+                    miniSlotSymbols);
+    config.AddValue("sharedBwp",
+                    "carry the AD slice on the VR BWP (CC 0) instead of its own CC; CC 2 is "
+                    "dropped and its bandwidth added to CC 0, to compare at the same spectrum",
+                    sharedBwp);
+    config.AddValue("adPriority",
+                    "schedule the AD UEs before the UEs of the other slices on every BWP, so "
+                    "that AD data takes the symbols it needs ahead of VR on a shared BWP",
+                    adPriority);
+    config.AddValue("adDuplicationLegs",
+                    "replace the AD DL flows by a UDP source whose packets go over 1 leg (the AD "
+                    "BWP) or 2 legs (also adDuplicationCc), with first-copy delivery at the UE; "
+                    "0 keeps the video flows",
+                    adDuplicationLegs);
+    config.AddValue("adDuplicationCc", "CC of the second leg of the AD duplication", adDuplicationCc);
+    config.AddValue("admissionControl",
+                    "start the UEs of each slice one by one, as admitted by the admission "
+                    "control; a rejected UE gets no DL traffic",
+                    admissionControl);
+    config.AddValue("admissionArrivalMs",
+                    "mean time between the arrivals of the UEs of a slice in ms",
+                    admissionArrivalMs);
+    config.AddValue("admissionMaxLoad",
+                    "share of the estimated slice capacity the admitted UEs may use",
+                    admissionMaxLoad);
+    config.AddValue("admissionDowngrade",
+                    "share of the slice rate a downgraded UE gets, 0 to reject instead",
+                    admissionDowngrade);
+    config.AddValue("offloadPeriodMs0", "period of the VR offload tasks in ms, 0 disables", offloadPeriodMs[0]);
+    config.AddValue("offloadPeriodMs1", "period of the CG offload tasks in ms, 0 disables", offloadPeriodMs[1]);
+    config.AddValue("offloadPeriodMs2", "period of the AD offload tasks in ms, 0 disables", offloadPeriodMs[2]);
+    config.AddValue("offloadTaskSize0", "UL bytes of a VR offload task", offloadTaskSize[0]);
+    config.AddValue("offloadTaskSize1", "UL bytes of a CG offload task", offloadTaskSize[1]);
+    config.AddValue("offloadTaskSize2", "UL bytes of an AD offload task", offloadTaskSize[2]);
+    config.AddValue("offloadResultSize0", "DL bytes of the result of a VR task", offloadResultSize[0]);
+    config.AddValue("offloadResultSize1", "DL bytes of the result of a CG task", offloadResultSize[1]);
+    config.AddValue("offloadResultSize2", "DL bytes of the result of an AD task", offloadResultSize[2]);
+    config.AddValue("offloadDeadlineMs0", "round-trip deadline of a VR task in ms", offloadDeadlineMs[0]);
+    config.AddValue("offloadDeadlineMs1", "round-trip deadline of a CG task in ms", offloadDeadlineMs[1]);
+    config.AddValue("offloadDeadlineMs2", "round-trip deadline of an AD task in ms", offloadDeadlineMs[2]);
+    config.AddValue("offloadPriority0", "priority of the VR tasks at the edge server, 0 first", offloadPriority[0]);
+    config.AddValue("offloadPriority1", "priority of the CG tasks at the edge server, 0 first", offloadPriority[1]);
+    config.AddValue("offloadPriority2", "priority of the AD tasks at the edge server, 0 first", offloadPriority[2]);
+    config.AddValue("offloadWorkers", "number of tasks the edge server serves in parallel", offloadWorkers);
+    config.AddValue("offloadServiceTime",
+                    "service time of a task in seconds, as a random variable",
+                    offloadServiceTime);
+    config.AddValue("flatCore",
+                    "connect a single remote host to the PGW with no delay, as before the "
+                    "core topology; with s1uDelayMs=0 it reproduces the former runs",
+                    flatCore);
+    config.AddValue("anchor0", "UPF anchor of VR: edge or central", anchor[0]);
+    config.AddValue("anchor1", "UPF anchor of CG: edge or central", anchor[1]);
+    config.AddValue("anchor2", "UPF anchor of AD: edge or central", anchor[2]);
+    config.AddValue("s1uDelayMs", "delay of the gNB-PGW backhaul (S1-U) in ms", s1uDelayMs);
+    config.AddValue("n9DelayMs", "delay of the N9 link between the edge and the central UPF in ms", n9DelayMs);
+    config.AddValue("n9DataRate", "data rate of the N9 link in Gbps", n9DataRate);
+    config.AddValue("edgeN6DelayMs", "delay between the edge UPF and an edge server in ms", edgeN6DelayMs);
+    config.AddValue("centralN6DelayMs",
+                    "delay between the central UPF and a central server in ms",
+                    centralN6DelayMs);
+    config.AddValue("steadyState",
+                    "detect the end of the warm-up of the per-slice throughput and delay (MSER-5) "
+                    "and leave it out of the per-slice results",
+                    steadyState);
+    config.AddValue("steadyStatePeriod",
+                    "sampling period of the steady-state detection in milliseconds",
+                    steadyStatePeriod);
+    config.AddValue("steadyStateTolerance",
+                    "relative half-width of the batch-means interval at which the per-slice "
+                    "metrics have converged",
+                    steadyStateTolerance);
+    config.AddValue("steadyStateStop",
+                    "stop the simulation as soon as the per-slice metrics have converged, "
+                    "without draining the packets in flight",
+                    steadyStateStop);
     cmd.AddValue("rngRun", "Rng run random number.", rngRun);
-    cmd.AddValue("logging", "Enable logging", logging);
+    config.AddValue("legacyStreams",
+                    "assign the RNG streams with a running counter, as before the stream "
+                    "registry; adding a UE then changes the streams of all the later ones",
+                    legacyStreams);
+    cmd.AddValue("logging",
+                 "Enable the binary event log <simTag>.evlog, see log-decode-network-slicing",
+                 logging);
+    cmd.AddValue("textLogging",
+                 "Enable the INFO text logs of UdpClient, UdpServer and LtePdcp",
+                 textLogging);
     cmd.AddValue("simTag",
                  "tag to be appended to output filenames to distinguish simulation campaigns",
                  simTag);
     cmd.AddValue("outputDir", "directory where to store simulation results", outputDir);
+    cmd.AddValue("kpiFile",
+                 "if not empty, file where to write the per-slice KPIs in machine-readable form",
+                 kpiFile);
+    cmd.AddValue("resultsStore",
+                 "if not empty, directory of the columnar store the run, slice and flow "
+                 "results are appended to",
+                 resultsStore);
+    cmd.AddValue("traceFamilies",
+                 "NR trace families written to <simTag>.nrtrace: rxPacket, dlSched, ulSched, "
+                 "slotStats, rlc, pdcp or all; empty disables the NR traces",
+                 traceFamilies);
+    cmd.AddValue("traceSampling", "Keep one of N trace records of each type", traceSampling);
+    cmd.AddValue("traceAggregate",
+                 "Merge the PHY and MAC trace records of the same UE and slot",
+                 traceAggregate);
+    cmd.AddValue("legacyTraces",
+                 "Enable every text trace of the nr module instead of the binary traces",
+                 legacyTraces);
+    cmd.AddValue("kpiSamplingPeriod",
+                 "period in milliseconds of the per-slice KPI samples written to "
+                 "<simTag>.samples.csv; 0 disables the sampling",
+                 kpiSamplingPeriod);
+    cmd.AddValue("kpiSamplingCapacity", "number of KPI samples buffered in memory", kpiSamplingCapacity);
+    cmd.AddValue("kpiSamplingIncremental",
+                 "write the KPI samples whenever the buffer is full, otherwise keep only the "
+                 "latest ones",
+                 kpiSamplingIncremental);
+    cmd.AddValue("harqStatsPerUe",
+                 "report the HARQ and MCS statistics of every UE, not only of every slice",
+                 harqStatsPerUe);
+    cmd.AddValue("schedTimelineStartMs",
+                 "start of the window of scheduler decisions written as Chrome trace events",
+                 schedTimelineStartMs);
+    cmd.AddValue("schedTimelineDurationMs",
+                 "length of the window of scheduler decisions in ms, 0 disables the timeline",
+                 schedTimelineDurationMs);
+    cmd.AddValue("schedTimelineCapacity",
+                 "number of scheduler decisions the timeline buffer holds",
+                 schedTimelineCapacity);
+    cmd.AddValue("metricsPort",
+                 "if not 0, serve live metrics in the Prometheus text format on this port "
+                 "of 127.0.0.1",
+                 metricsPort);
+    cmd.AddValue("metricsSocket",
+                 "if not empty, serve the live metrics on this Unix socket instead",
+                 metricsSocket);
+    cmd.AddValue("metricsPeriodMs",
+                 "simulated time between two snapshots of the live metrics in ms",
+                 metricsPeriodMs);
+    cmd.AddValue("memoryCensusPeriod",
+                 "if not 0, sample the memory of each category of objects and slice every "
+                 "this many ms",
+                 memoryCensusPeriod);
 
     cmd.Parse(argc, argv);
 
+    NS_ABORT_MSG_IF(powerAllocation != "bandwidth" && powerAllocation != "sla",
+                    "Unknown power allocation " << powerAllocation);
+    NS_ABORT_MSG_IF(steadyStateStop && !steadyState, "steadyStateStop needs steadyState");
+    NS_ABORT_MSG_IF(steadyState && steadyStatePeriod == 0, "steadyStatePeriod must be positive");
+    NS_ABORT_MSG_IF(sharedBwp && vrCarrierAggregation,
+                    "sharedBwp leaves no CC 2 for the carrier aggregation of VR");
+    if (sharedBwp)
+    {
+        // CC 0 takes the spectrum of CC 2 from its upper edge, so that the AD slice shares the
+        // same total bandwidth with VR and no BWP is left idle
+        centralFrequencyCc[0] += bandwidthCc[2] / 2.;
+        bandwidthCc[0] += bandwidthCc[2];
+        numCcs = 2;
+    }
+
 //    NS_ABORT_MSG_IF(true, "Abort anyways");
 
     // ConfigStore inputConfig;
@@ -206,7 +738,7 @@ main(int argc, char* argv[])
     SeedManager::SetRun(rngRun);
 
     // enable logging or not
-    if (logging)
+    if (textLogging)
     {
 //        LogComponentEnable("Nr3gppPropagationLossModel", LOG_LEVEL_ALL);
 //        LogComponentEnable("Nr3gppBuildingsPropagationLossModel", LOG_LEVEL_ALL);
@@ -215,9 +747,20 @@ main(int argc, char* argv[])
         LogComponentEnable("UdpServer", LOG_LEVEL_INFO);
         LogComponentEnable("LtePdcp", LOG_LEVEL_INFO);
     }
+    if (logging)
+    {
+        std::string eventLogFile = outputDir + "/" + simTag + ".evlog";
+        if (!SliceEventLog::Open(eventLogFile))
+        {
+            std::cerr << "Can't open file " << eventLogFile << std::endl;
+            return 1;
+        }
+    }
 
     Config::SetDefault("ns3::LteRlcUm::MaxTxBufferSize", UintegerValue(999999999));
 
+    MemoryAccounting::SetPhase(MEMORY_PHASE_TOPOLOGY);
+
     // create base stations and mobile terminals
     NodeContainer gNbNodes;
     NodeContainer ueNodes;
@@ -234,15 +777,38 @@ main(int argc, char* argv[])
     mobility.SetPositionAllocator(bsPositionAlloc);
     mobility.Install(gNbNodes);
 
-    Ptr<RandomDiscPositionAllocator> ueDiscPositionAlloc =
-        CreateObject<RandomDiscPositionAllocator>();
-    ueDiscPositionAlloc->SetX(0.0);
-    ueDiscPositionAlloc->SetY(0.0);
-    ueDiscPositionAlloc->SetZ(ueHeight);
-    mobility.SetPositionAllocator(ueDiscPositionAlloc);
-    for (uint32_t i = 0; i < ueNodes.GetN(); i++)
+    // the RNG streams of each entity derive from its slice and index, see RngStreamRegistry
+    Ptr<RngStreamRegistry> streamRegistry = CreateObject<RngStreamRegistry>();
+
+    // one allocator per slice, so that the position of a UE does not depend on the
+    // number of UEs of the other slices
+    Ptr<RandomDiscPositionAllocator> ueDiscPositionAlloc;
+    uint32_t firstUe = 0;
+    for (uint8_t s = 0; s < numSlices; ++s)
     {
-        mobility.Install(ueNodes.Get(i));
+        if (!ueDiscPositionAlloc || !legacyStreams)
+        {
+            ueDiscPositionAlloc = CreateObject<RandomDiscPositionAllocator>();
+            ueDiscPositionAlloc->SetX(0.0);
+            ueDiscPositionAlloc->SetY(0.0);
+            ueDiscPositionAlloc->SetZ(ueHeight);
+        }
+        if (!legacyStreams)
+        {
+            streamRegistry->Assign(RNG_ENTITY_UE,
+                                   s,
+                                   0,
+                                   RNG_PURPOSE_POSITION,
+                                   [&](int64_t stream) {
+                                       return ueDiscPositionAlloc->AssignStreams(stream);
+                                   });
+        }
+        mobility.SetPositionAllocator(ueDiscPositionAlloc);
+        for (uint32_t i = firstUe; i < firstUe + ueNumPerSlice[s]; i++)
+        {
+            mobility.Install(ueNodes.Get(i));
+        }
+        firstUe += ueNumPerSlice[s];
     }
 
     /** 
@@ -298,8 +864,24 @@ main(int argc, char* argv[])
      * Beamforming Model Setup;
      */
     nrHelper->SetPathlossAttribute("ShadowingEnabled", BooleanValue(false));
-    epcHelper->SetAttribute("S1uLinkDelay", TimeValue(MilliSeconds(0)));
-    nrHelper->SetSchedulerTypeId(TypeId::LookupByName("ns3::NrMacSchedulerTdmaRR"));
+    epcHelper->SetAttribute("S1uLinkDelay", TimeValue(MicroSeconds(s1uDelayMs * 1000)));
+    NS_ABORT_MSG_IF(miniSlotSymbols != 0 && miniSlotSymbols != 2 && miniSlotSymbols != 4 &&
+                        miniSlotSymbols != 7,
+                    "miniSlotSymbols must be 0, 2, 4 or 7");
+    // the slice of each UE, filled in once the UEs are installed
+    Ptr<SliceUeRegistry> ueRegistry = CreateObject<SliceUeRegistry>();
+    // the RLC queues of each slice, from the buffer status reports of the schedulers
+    Ptr<SliceBufferStatus> bufferStatus = CreateObject<SliceBufferStatus>();
+    bufferStatus->SetRegistry(ueRegistry);
+    // round robin as NrMacSchedulerTdmaRR without mini-slots and priority slice
+    nrHelper->SetSchedulerTypeId(NrMacSchedulerTdmaMiniSlot::GetTypeId());
+    nrHelper->SetSchedulerAttribute("MiniSlotSymbols", UintegerValue(miniSlotSymbols));
+    nrHelper->SetSchedulerAttribute("BufferStatus", PointerValue(bufferStatus));
+    if (adPriority)
+    {
+        nrHelper->SetSchedulerAttribute("PrioritySlice", UintegerValue(2));
+        nrHelper->SetSchedulerAttribute("Registry", PointerValue(ueRegistry));
+    }
     // Beamforming method
     if (cellScan)
     {
@@ -343,13 +925,40 @@ main(int argc, char* argv[])
     // VR, Cloud Gaming [CG], Autonomous Driving [AD]
     uint32_t bwpIdForVR = 0;
     uint32_t bwpIdForCG = 1;
-    uint32_t bwpIdForAD = 2;
+    // the AD slice has its own BWP, or the VR one when shared
+    uint32_t bwpIdForAD = sharedBwp ? bwpIdForVR : 2;
+    if (miniSlotSymbols > 0)
+    {
+        nrHelper->SetSchedulerAttribute("MiniSlotBwp", UintegerValue(bwpIdForAD));
+    }
 
-    nrHelper->SetGnbBwpManagerAlgorithmAttribute("NGBR_VIDEO_TCP_DEFAULT",
-                                                 UintegerValue(bwpIdForVR));
-    nrHelper->SetGnbBwpManagerAlgorithmAttribute("NGBR_VOICE_VIDEO_GAMING", UintegerValue(bwpIdForCG));
-    nrHelper->SetGnbBwpManagerAlgorithmAttribute("NGBR_V2X",
-                                                 UintegerValue(bwpIdForAD));
+    // QCIs of the flows of each slice, see FlowPortPlan
+    std::vector<EpsBearer::Qci> sliceQcis [] = {
+        {EpsBearer::NGBR_VIDEO_TCP_DEFAULT, EpsBearer::NGBR_IMS},
+        {EpsBearer::NGBR_VOICE_VIDEO_GAMING, EpsBearer::NGBR_LOW_LAT_EMBB},
+        {EpsBearer::NGBR_V2X, EpsBearer::NGBR_MC_DELAY_SIGNAL}};
+    // secondary legs of the VR slice in carrier-aggregation mode
+    std::vector<EpsBearer::Qci> vrCaQcis = {EpsBearer::NGBR_VIDEO_TCP_DEFAULT,
+                                            EpsBearer::NGBR_VIDEO_TCP_OPERATOR,
+                                            EpsBearer::NGBR_VIDEO_TCP_PREMIUM};
+
+    // the UE side maps the UL of each bearer the same way as the gNB
+    std::vector<std::tuple<EpsBearer::Qci, std::string, uint32_t>> qciToBwp = {
+        {EpsBearer::NGBR_VIDEO_TCP_DEFAULT, "NGBR_VIDEO_TCP_DEFAULT", bwpIdForVR},
+        {EpsBearer::NGBR_IMS, "NGBR_IMS", bwpIdForVR},
+        {EpsBearer::NGBR_VOICE_VIDEO_GAMING, "NGBR_VOICE_VIDEO_GAMING", bwpIdForCG},
+        {EpsBearer::NGBR_LOW_LAT_EMBB, "NGBR_LOW_LAT_EMBB", bwpIdForCG},
+        {EpsBearer::NGBR_V2X, "NGBR_V2X", bwpIdForAD},
+        {EpsBearer::NGBR_MC_DELAY_SIGNAL, "NGBR_MC_DELAY_SIGNAL", bwpIdForAD},
+        {EpsBearer::NGBR_VIDEO_TCP_OPERATOR, "NGBR_VIDEO_TCP_OPERATOR", bwpIdForCG},
+        {EpsBearer::NGBR_VIDEO_TCP_PREMIUM, "NGBR_VIDEO_TCP_PREMIUM", bwpIdForAD}};
+    std::map<EpsBearer::Qci, uint32_t> bwpOfQci;
+    for (const auto& [qci, name, bwpId] : qciToBwp)
+    {
+        nrHelper->SetGnbBwpManagerAlgorithmAttribute(name, UintegerValue(bwpId));
+        nrHelper->SetUeBwpManagerAlgorithmAttribute(name, UintegerValue(bwpId));
+        bwpOfQci[qci] = bwpId;
+    }
 
     // Install and get the pointers to the NetDevices
     NodeContainer ueVrNodes, ueCgNodes, ueAdNodes; 
@@ -374,11 +983,55 @@ main(int argc, char* argv[])
     NetDeviceContainer ueCgNetDev = nrHelper->InstallUeDevice(ueCgNodes, allBwps);
     NetDeviceContainer ueAdNetDev = nrHelper->InstallUeDevice(ueAdNodes, allBwps);
 
-    int64_t randomStream = 1;
-    randomStream += nrHelper->AssignStreams(gNbNetDev, randomStream);
-    randomStream += nrHelper->AssignStreams(ueVrNetDev, randomStream);
-    randomStream += nrHelper->AssignStreams(ueCgNetDev, randomStream);
-    randomStream += nrHelper->AssignStreams(ueAdNetDev, randomStream);
+    if (legacyStreams)
+    {
+        int64_t randomStream = 1;
+        randomStream += nrHelper->AssignStreams(gNbNetDev, randomStream);
+        randomStream += nrHelper->AssignStreams(ueVrNetDev, randomStream);
+        randomStream += nrHelper->AssignStreams(ueCgNetDev, randomStream);
+        randomStream += nrHelper->AssignStreams(ueAdNetDev, randomStream);
+    }
+    else
+    {
+        for (uint32_t i = 0; i < gNbNetDev.GetN(); ++i)
+        {
+            streamRegistry->Assign(RNG_ENTITY_GNB,
+                                   0,
+                                   i,
+                                   RNG_PURPOSE_DEVICE,
+                                   [&](int64_t stream) {
+                                       return nrHelper->AssignStreams(
+                                           NetDeviceContainer(gNbNetDev.Get(i)),
+                                           stream);
+                                   });
+        }
+        NetDeviceContainer* ueNetDevs [] = {&ueVrNetDev, &ueCgNetDev, &ueAdNetDev};
+        for (uint8_t s = 0; s < numSlices; ++s)
+        {
+            for (uint32_t i = 0; i < ueNetDevs[s]->GetN(); ++i)
+            {
+                streamRegistry->Assign(RNG_ENTITY_UE,
+                                       s,
+                                       i,
+                                       RNG_PURPOSE_DEVICE,
+                                       [&](int64_t stream) {
+                                           return nrHelper->AssignStreams(
+                                               NetDeviceContainer(ueNetDevs[s]->Get(i)),
+                                               stream);
+                                       });
+            }
+        }
+    }
+
+    if (miniSlotSymbols > 0)
+    {
+        // data in the slot of its DCI, HARQ feedback and UL grants one slot later; before
+        // the pattern, which builds the K1/K2 and HARQ feedback tables from these delays
+        Ptr<NrGnbPhy> adPhy = nrHelper->GetGnbPhy(gNbNetDev.Get(0), bwpIdForAD);
+        adPhy->SetAttribute("N0Delay", UintegerValue(0));
+        adPhy->SetAttribute("N1Delay", UintegerValue(1));
+        adPhy->SetAttribute("N2Delay", UintegerValue(1));
+    }
 
     // Set the attribute of the netdevice (gNbNetDev.Get (0)) and bandwidth part (0), (1), ...
     double x = pow(10, totalTxPower / 10);
@@ -390,7 +1043,9 @@ main(int argc, char* argv[])
                     "TxPower",
                     DoubleValue(10 *
                                 log10((band.GetBwpAt(n, 0)->m_channelBandwidth / bandwidthBand) * x)));
-        nrHelper->GetGnbPhy(gNbNetDev.Get(0), n)->SetAttribute("Pattern", StringValue(pattern));
+        nrHelper->GetGnbPhy(gNbNetDev.Get(0), n)
+                ->SetAttribute("Pattern",
+                               StringValue(patternCc[n].empty() ? pattern : patternCc[n]));
     }
 
     for (auto it = gNbNetDev.Begin(); it != gNbNetDev.End(); ++it)
@@ -414,27 +1069,58 @@ main(int argc, char* argv[])
     }
 
     // create the internet and install the IP stack on the UEs
-    // get SGW/PGW and create a single RemoteHost
+    // get SGW/PGW and create the application server of each slice
     Ptr<Node> pgw = epcHelper->GetPgwNode();
-    NodeContainer remoteHostContainer;
-    remoteHostContainer.Create(1);
-    Ptr<Node> remoteHost = remoteHostContainer.Get(0);
     InternetStackHelper internet;
-    internet.Install(remoteHostContainer);
-
-    // connect a remoteHost to pgw. Setup routing too
-    PointToPointHelper p2ph;
-    p2ph.SetDeviceAttribute("DataRate", DataRateValue(DataRate("100Gb/s")));
-    p2ph.SetDeviceAttribute("Mtu", UintegerValue(2500));
-    p2ph.SetChannelAttribute("Delay", TimeValue(Seconds(0.000)));
-    NetDeviceContainer internetDevices = p2ph.Install(pgw, remoteHost);
-    Ipv4AddressHelper ipv4h;
     Ipv4StaticRoutingHelper ipv4RoutingHelper;
-    ipv4h.SetBase("1.0.0.0", "255.0.0.0");
-    Ipv4InterfaceContainer internetIpIfaces = ipv4h.Assign(internetDevices);
-    Ptr<Ipv4StaticRouting> remoteHostStaticRouting =
-        ipv4RoutingHelper.GetStaticRouting(remoteHost->GetObject<Ipv4>());
-    remoteHostStaticRouting->AddNetworkRouteTo(Ipv4Address("7.0.0.0"), Ipv4Mask("255.0.0.0"), 1);
+    NodeContainer remoteHosts;
+    NodeContainer sliceRemoteHost [numSlices];
+    Ipv4Address sliceRemoteHostAddr [numSlices];
+    Ptr<SliceCoreTopology> coreTopology;
+    if (flatCore)
+    {
+        // connect a single remoteHost to pgw. Setup routing too
+        remoteHosts.Create(1);
+        Ptr<Node> remoteHost = remoteHosts.Get(0);
+        internet.Install(remoteHosts);
+        PointToPointHelper p2ph;
+        p2ph.SetDeviceAttribute("DataRate", DataRateValue(DataRate("100Gb/s")));
+        p2ph.SetDeviceAttribute("Mtu", UintegerValue(2500));
+        p2ph.SetChannelAttribute("Delay", TimeValue(Seconds(0.000)));
+        NetDeviceContainer internetDevices = p2ph.Install(pgw, remoteHost);
+        Ipv4AddressHelper ipv4h;
+        ipv4h.SetBase("1.0.0.0", "255.0.0.0");
+        Ipv4InterfaceContainer internetIpIfaces = ipv4h.Assign(internetDevices);
+        Ptr<Ipv4StaticRouting> remoteHostStaticRouting =
+            ipv4RoutingHelper.GetStaticRouting(remoteHost->GetObject<Ipv4>());
+        remoteHostStaticRouting->AddNetworkRouteTo(Ipv4Address("7.0.0.0"), Ipv4Mask("255.0.0.0"), 1);
+        for (uint8_t s = 0; s < numSlices; ++s)
+        {
+            sliceRemoteHost[s].Add(remoteHost);
+            sliceRemoteHostAddr[s] = internetIpIfaces.GetAddress(1);
+        }
+    }
+    else
+    {
+        // edge servers next to the PGW, central ones behind the N9 link
+        coreTopology = CreateObject<SliceCoreTopology>();
+        coreTopology->SetAttribute("N9Delay", TimeValue(MicroSeconds(n9DelayMs * 1000)));
+        coreTopology->SetAttribute("N9DataRate", DataRateValue(DataRate(n9DataRate * 1e9)));
+        coreTopology->SetAttribute("EdgeN6Delay", TimeValue(MicroSeconds(edgeN6DelayMs * 1000)));
+        coreTopology->SetAttribute("CentralN6Delay",
+                                   TimeValue(MicroSeconds(centralN6DelayMs * 1000)));
+        for (uint8_t s = 0; s < numSlices; ++s)
+        {
+            coreTopology->SetAnchor(s, SliceCoreTopology::ParseAnchor(anchor[s]));
+        }
+        coreTopology->Install(pgw, numSlices, Ipv4Address("7.0.0.0"), Ipv4Mask("255.0.0.0"));
+        remoteHosts = coreTopology->GetServers();
+        for (uint8_t s = 0; s < numSlices; ++s)
+        {
+            sliceRemoteHost[s].Add(coreTopology->GetServer(s));
+            sliceRemoteHostAddr[s] = coreTopology->GetServerAddress(s);
+        }
+    }
     internet.Install(ueNodes);
 
     Ipv4InterfaceContainer ueVrIpIface, ueCgIpIface, ueAdIpIface;
@@ -455,107 +1141,433 @@ main(int argc, char* argv[])
     nrHelper->AttachToClosestEnb(ueCgNetDev, gNbNetDev);
     nrHelper->AttachToClosestEnb(ueAdNetDev, gNbNetDev);
 
+    MemoryAccounting::SetPhase(MEMORY_PHASE_APPLICATIONS);
+
     // install generic 3GPP video applications
     std::string transportProtocol = useUdp ?
         "ns3::UdpSocketFactory" : "ns3::TcpSocketFactory";
+    // a slice reserves portStride ports for the M flows of its UEs, as many as the largest
+    // span of FlowPortPlan; the UL ports of the last slice are the highest of the plan
+    NS_ABORT_MSG_IF(numFlowsUe == 0, "numFlowsUe must be at least 1");
+    uint32_t portSpan = std::max({FlowPortPlan::GetSpan(numFlowsUe, sliceQcis[0].size()),
+                                  FlowPortPlan::GetSpan(numFlowsUe, sliceQcis[1].size()),
+                                  FlowPortPlan::GetSpan(numFlowsUe, sliceQcis[2].size()),
+                                  static_cast<uint32_t>(vrCaQcis.size())});
+    uint32_t stride = std::max<uint32_t>(100, portSpan);
+    NS_ABORT_MSG_IF(1001 + 12 * stride >= FIRST_EPHEMERAL_PORT,
+                    "numFlowsUe " << numFlowsUe << " takes the ports up to " << 1001 + 12 * stride
+                                  << ", beyond the first ephemeral port " << FIRST_EPHEMERAL_PORT);
+    uint16_t portStride = stride;
     uint16_t dlVrPort = 1001;
-    uint16_t dlCgPort = 1101;
-    uint16_t dlAdPort = 1201;
+    uint16_t dlCgPort = dlVrPort + portStride;
+    uint16_t dlAdPort = dlVrPort + 2 * portStride;
+    uint16_t ulVrPort = dlVrPort + 10 * portStride;
+    uint16_t ulCgPort = ulVrPort + portStride;
+    uint16_t ulAdPort = ulVrPort + 2 * portStride;
+    uint16_t ulPorts [] = {ulVrPort, ulCgPort, ulAdPort};
+    uint16_t offloadPort = dlVrPort + 3 * portStride;
     ApplicationContainer clientVrApps, clientCgApps, clientAdApps;
+    ApplicationContainer clientUlApps;
     ApplicationContainer serverApps, pingApps;
 
-    EpsBearer vrBearer(EpsBearer::NGBR_VIDEO_TCP_DEFAULT);
-    Ptr<EpcTft> vrTft = Create<EpcTft>();
-    EpcTft::PacketFilter dlpfVr;
-    dlpfVr.localPortStart = dlVrPort;
-    dlpfVr.localPortEnd = dlVrPort;
-    vrTft->Add(dlpfVr);
-
-    EpsBearer cgBearer(EpsBearer::NGBR_VOICE_VIDEO_GAMING);
-    Ptr<EpcTft> cgTft = Create<EpcTft>();
-    EpcTft::PacketFilter dlpfCg;
-    dlpfCg.localPortStart = dlCgPort;
-    dlpfCg.localPortEnd = dlCgPort;
-    cgTft->Add(dlpfCg);
-
-    EpsBearer adBearer(EpsBearer::NGBR_V2X);
-    Ptr<EpcTft> adTft = Create<EpcTft>();
-    EpcTft::PacketFilter dlpfAd;
-    dlpfAd.localPortStart = dlAdPort;
-    dlpfAd.localPortEnd = dlAdPort;
-    adTft->Add(dlpfAd);
-
-    std::vector<Ptr<EpcTft>> arTfts;    // unused;
-
-    for (uint32_t u = 0; u < ueNumPerSlice[0]; ++u)
-    {
-        ConfigureXrApp(
-            ueVrNodes,
-            u,
-            ueVrIpIface,
-            VR_DL1,//AR_M3,
-            dataRate[0],
-            fps[0],
-            dlVrPort,
-            transportProtocol,
-            remoteHostContainer,
-            ueVrNetDev,
-            nrHelper,
-            vrBearer,
-            vrTft,
-            true,
-            arTfts,
-            serverApps,
-            clientVrApps,
-            pingApps);
-    }
-
-    for (uint32_t u = ueNumPerSlice[0]; u < ueNumPerSlice[0] + ueNumPerSlice[1]; ++u)
-    {        
-        ConfigureXrApp(
-            ueCgNodes,
-            u - ueNumPerSlice[0],
-            ueCgIpIface,
-            VR_DL1,//AR_M3,
-            dataRate[1],
-            fps[1],
-            dlCgPort,
-            transportProtocol,
-            remoteHostContainer,
-            ueCgNetDev,
-            nrHelper,
-            cgBearer,
-            cgTft,
-            true,
-            arTfts,
-            serverApps,
-            clientCgApps,
-            pingApps
-        );
-    }
-
-    for (uint32_t u = ueNumPerSlice[0] + ueNumPerSlice[1]; u < ueNodes.GetN(); ++u)
-    {
-        ConfigureXrApp(
-            ueAdNodes,
-            u - ueNumPerSlice[0] - ueNumPerSlice[1],
-            ueAdIpIface,
-            VR_DL1,//AR_M3,
-            dataRate[2],
-            fps[2],
-            dlAdPort,
-            transportProtocol,
-            remoteHostContainer,
-            ueAdNetDev,
-            nrHelper,
-            adBearer,
-            adTft,
-            true,
-            arTfts,
-            serverApps,
-            clientAdApps,
-            pingApps
-        );
+    // the second leg of the AD duplication uses the VR carrier-aggregation QCI of its CC
+    NS_ABORT_MSG_IF(adDuplicationLegs > 2, "adDuplicationLegs must be 0, 1 or 2");
+    NS_ABORT_MSG_IF(adDuplicationLegs == 2 &&
+                        (adDuplicationCc >= numCcs || adDuplicationCc == bwpIdForAD),
+                    "adDuplicationCc must be another CC than the one of the AD flows");
+    NS_ABORT_MSG_IF(adDuplicationLegs > 0 && deadlineMs[2] <= 0.,
+                    "the AD duplication needs the deadline deadlineMs2");
+    std::vector<EpsBearer::Qci> adDuplicationQcis = {sliceQcis[2][0]};
+    if (adDuplicationLegs == 2)
+    {
+        auto leg = std::find_if(vrCaQcis.begin(), vrCaQcis.end(), [&](EpsBearer::Qci qci) {
+            return bwpOfQci.at(qci) == adDuplicationCc;
+        });
+        if (leg == vrCaQcis.end())
+        {
+            NS_ABORT_MSG("No carrier-aggregation QCI maps to adDuplicationCc " << adDuplicationCc);
+        }
+        adDuplicationQcis.push_back(*leg);
+    }
+
+    // in carrier-aggregation and duplication modes, the flows are the legs, one per CC
+    FlowPortPlan dlPlan;
+    dlPlan.AddSlice(dlVrPort,
+                    vrCarrierAggregation ? vrCaQcis.size() : numFlowsUe,
+                    vrCarrierAggregation ? vrCaQcis : sliceQcis[0]);
+    dlPlan.AddSlice(dlCgPort, numFlowsUe, sliceQcis[1]);
+    dlPlan.AddSlice(dlAdPort,
+                    adDuplicationLegs > 0 ? adDuplicationLegs : numFlowsUe,
+                    adDuplicationLegs > 0 ? adDuplicationQcis : sliceQcis[2]);
+
+    // the slices carried by each BWP, from the QCIs of their bearers: a BWP may carry
+    // several slices, e.g. a VR leg in carrier-aggregation mode, and a slice several BWPs
+    std::vector<std::vector<uint8_t>> bwpSlices(numCcs);
+    for (uint8_t s = 0; s < numSlices; ++s)
+    {
+        for (uint8_t q = 0; q < dlPlan.GetNumQcis(s); ++q)
+        {
+            std::vector<uint8_t>& slices = bwpSlices.at(bwpOfQci.at(dlPlan.GetQci(s, q)));
+            if (std::find(slices.begin(), slices.end(), s) == slices.end())
+            {
+                slices.push_back(s);
+            }
+        }
+    }
+
+    // one TFT per bearer; the first bearer of a slice also carries its UL flow
+    std::vector<Ptr<EpcTft>> sliceTfts [numSlices];
+    std::vector<EpsBearer> sliceBearers [numSlices];
+    for (uint8_t s = 0; s < numSlices; ++s)
+    {
+        sliceTfts[s] = dlPlan.CreateTfts(s);
+        for (uint8_t q = 0; q < dlPlan.GetNumQcis(s); ++q)
+        {
+            sliceBearers[s].emplace_back(dlPlan.GetQci(s, q));
+        }
+        EpcTft::PacketFilter ulpf;
+        ulpf.remotePortStart = ulPorts[s];
+        ulpf.remotePortEnd = ulPorts[s];
+        ulpf.direction = EpcTft::UPLINK;
+        sliceTfts[s][0]->Add(ulpf);
+        if (offloadPeriodMs[s] > 0.)
+        {
+            // the tasks and their results ride the first bearer of the slice
+            EpcTft::PacketFilter taskpf;
+            taskpf.remotePortStart = offloadPort;
+            taskpf.remotePortEnd = offloadPort;
+            taskpf.direction = EpcTft::UPLINK;
+            sliceTfts[s][0]->Add(taskpf);
+            EpcTft::PacketFilter resultpf;
+            resultpf.localPortStart = offloadPort;
+            resultpf.localPortEnd = offloadPort;
+            resultpf.direction = EpcTft::DOWNLINK;
+            sliceTfts[s][0]->Add(resultpf);
+        }
+    }
+
+    std::vector<double> vrCaWeights = {bandwidthCc[bwpIdForVR],
+                                       bandwidthCc[bwpIdForCG],
+                                       bandwidthCc[bwpIdForAD]};
+    std::vector<Ptr<CaSplitApp>> vrCaApps;
+    ApplicationContainer adDuplicationSources, adDuplicationSinks;
+
+    NodeContainer* sliceUeNodes [] = {&ueVrNodes, &ueCgNodes, &ueAdNodes};
+    NetDeviceContainer* sliceUeNetDev [] = {&ueVrNetDev, &ueCgNetDev, &ueAdNetDev};
+    Ipv4InterfaceContainer* sliceUeIpIface [] = {&ueVrIpIface, &ueCgIpIface, &ueAdIpIface};
+    ApplicationContainer* sliceClientApps [] = {&clientVrApps, &clientCgApps, &clientAdApps};
+
+    // losses of each slice by cause, set up once the UEs are registered; the TCP sockets of
+    // an admitted UE are connected when its applications are installed
+    Ptr<SliceDropCounters> dropCounters = CreateObject<SliceDropCounters>();
+
+    // the bearers cannot be set up after the attachment, so the admission control gates the
+    // DL applications of a UE instead: they are installed when it arrives, if admitted
+    Ptr<SliceAdmissionController> admission;
+    Time sliceArrival [numSlices];
+    if (admissionControl)
+    {
+        admission = CreateObject<SliceAdmissionController>();
+        admission->SetAttribute("MaxLoad", DoubleValue(admissionMaxLoad));
+        admission->SetAttribute("DowngradeFactor", DoubleValue(admissionDowngrade));
+        admission->SetSlices(std::vector<std::string>(sliceNames, sliceNames + numSlices));
+        admission->SetRegistry(ueRegistry);
+        for (int n = 0; n < numCcs; ++n)
+        {
+            admission->ConnectBwp(nrHelper->GetGnbPhy(gNbNetDev.Get(0), n),
+                                  nrHelper->GetGnbMac(gNbNetDev.Get(0), n),
+                                  bwpSlices[n]);
+        }
+        for (uint8_t s = 0; s < numSlices; ++s)
+        {
+            sliceArrival[s] = MilliSeconds(appStartTimeMs);
+        }
+        Simulator::Schedule(MilliSeconds(appStartTimeMs),
+                            &SliceAdmissionController::Start,
+                            admission);
+    }
+    // install the DL applications of UE u of slice s at a rate; the RNG streams of a
+    // traffic generator derive from its slice, UE and flow, whatever the other UEs do
+    auto installDlApps = [&](uint8_t s,
+                             uint32_t u,
+                             double rate,
+                             ApplicationContainer& sinks,
+                             ApplicationContainer& sources) {
+        if (s == 0 && vrCarrierAggregation)
+        {
+            vrCaApps.push_back(ConfigureCaApp(*sliceUeNodes[s],
+                                              u,
+                                              *sliceUeIpIface[s],
+                                              rate,
+                                              fps[s],
+                                              dlVrPort,
+                                              transportProtocol,
+                                              sliceRemoteHost[s],
+                                              vrCaWeights,
+                                              caSplitPolicy,
+                                              sinks,
+                                              sources));
+            return;
+        }
+        if (s == 2 && adDuplicationLegs > 0)
+        {
+            ConfigureDuplicationApp(*sliceUeNodes[s],
+                                    u,
+                                    *sliceUeIpIface[s],
+                                    rate,
+                                    fps[s],
+                                    dlAdPort,
+                                    MilliSeconds(deadlineMs[s]),
+                                    sliceRemoteHost[s],
+                                    adDuplicationLegs,
+                                    sinks,
+                                    sources);
+            adDuplicationSinks.Add(sinks.Get(sinks.GetN() - 1));
+            adDuplicationSources.Add(sources.Get(sources.GetN() - 1));
+            return;
+        }
+        uint16_t numFlows = dlPlan.GetNumFlows(s);
+        for (uint16_t f = 0; f < numFlows; ++f)
+        {
+            ApplicationContainer flowSources;
+            ConfigureXrApp(*sliceUeNodes[s],
+                           u,
+                           *sliceUeIpIface[s],
+                           VR_DL1, // AR_M3,
+                           rate / numFlows,
+                           fps[s],
+                           dlPlan.GetPort(s, f),
+                           transportProtocol,
+                           sliceRemoteHost[s],
+                           sinks,
+                           flowSources);
+            if (!legacyStreams)
+            {
+                streamRegistry->Assign(RNG_ENTITY_APP,
+                                       s,
+                                       u * numFlows + f,
+                                       RNG_PURPOSE_TRAFFIC,
+                                       [&](int64_t stream) {
+                                           int64_t used = 0;
+                                           for (uint32_t i = 0; i < flowSources.GetN(); ++i)
+                                           {
+                                               Ptr<TrafficGenerator> generator =
+                                                   DynamicCast<TrafficGenerator>(flowSources.Get(i));
+                                               if (generator)
+                                               {
+                                                   used += generator->AssignStreams(stream + used);
+                                               }
+                                           }
+                                           return used;
+                                       });
+            }
+            sources.Add(flowSources);
+        }
+    };
+
+    auto admitUe = [&](uint8_t s, uint32_t u) {
+        Time appStop = MilliSeconds(appStartTimeMs + appDuration);
+        if (Simulator::Now() >= appStop)
+        {
+            return;
+        }
+        AdmissionDecision decision = admission->Decide(s, dataRate[s]);
+        if (decision == ADMISSION_REJECT)
+        {
+            return;
+        }
+        double rate = dataRate[s] * (decision == ADMISSION_DOWNGRADE ? admissionDowngrade : 1.);
+        ApplicationContainer sinks;
+        ApplicationContainer sources;
+        installDlApps(s, u, rate, sinks, sources);
+        SliceEventLog::ConnectApps(sinks, s);
+        SliceEventLog::ConnectApps(sources, s);
+        // the start and stop times of an application added now count from now
+        sinks.Start(Seconds(0));
+        sources.Start(Seconds(0));
+        sinks.Stop(MilliSeconds(appStartTimeMs + appDuration + 2000) - Simulator::Now());
+        sources.Stop(appStop - Simulator::Now());
+        serverApps.Add(sinks);
+        sliceClientApps[s]->Add(sources);
+        // the TCP sockets of the new sources exist once they start
+        Simulator::Schedule(MilliSeconds(1), &SliceDropCounters::ConnectTcp, dropCounters);
+    };
+
+    for (uint8_t s = 0; s < numSlices; ++s)
+    {
+        for (uint32_t u = 0; u < ueNumPerSlice[s]; ++u)
+        {
+            // Activate one dedicated bearer per QCI of the slice, one per leg in the
+            // carrier-aggregation and duplication modes
+            for (uint8_t q = 0; q < dlPlan.GetNumQcis(s); ++q)
+            {
+                nrHelper->ActivateDedicatedEpsBearer(sliceUeNetDev[s]->Get(u),
+                                                     sliceBearers[s][q],
+                                                     sliceTfts[s][q]);
+            }
+
+            // Seed the ARP cache by pinging early in the simulation
+            // This is a workaround until a static ARP capability is provided
+            PingHelper ping(sliceUeIpIface[s]->GetAddress(u, 0));
+            pingApps.Add(ping.Install(sliceRemoteHost[s]));
+
+            if (admission)
+            {
+                // the UEs of a slice arrive one after the other as a Poisson process
+                Ptr<ExponentialRandomVariable> interArrival =
+                    CreateObject<ExponentialRandomVariable>();
+                interArrival->SetAttribute("Mean", DoubleValue(admissionArrivalMs));
+                if (!legacyStreams)
+                {
+                    streamRegistry->Assign(RNG_ENTITY_UE,
+                                           s,
+                                           u,
+                                           RNG_PURPOSE_TRAFFIC,
+                                           [&](int64_t stream) {
+                                               interArrival->SetStream(stream);
+                                               return int64_t(1);
+                                           });
+                }
+                sliceArrival[s] += MicroSeconds(interArrival->GetValue() * 1000);
+                Simulator::Schedule(sliceArrival[s], admitUe, s, u);
+                continue;
+            }
+
+            installDlApps(s, u, dataRate[s], serverApps, *sliceClientApps[s]);
+        }
+    }
+
+    // install the UL generators and their sinks on the servers of the slices
+    for (uint8_t s = 0; s < numSlices; ++s)
+    {
+        if (ulDataRate[s] <= 0.)
+        {
+            continue;
+        }
+        PacketSinkHelper ulPacketSinkHelper("ns3::UdpSocketFactory",
+                                            InetSocketAddress(Ipv4Address::GetAny(), ulPorts[s]));
+        ApplicationContainer ulSink = ulPacketSinkHelper.Install(sliceRemoteHost[s]);
+        SliceEventLog::ConnectApps(ulSink, s);
+        serverApps.Add(ulSink);
+    }
+    for (uint32_t u = 0; u < ueNodes.GetN(); ++u)
+    {
+        uint8_t s = u < ueNumPerSlice[0] ? 0 : (u < ueNumPerSlice[0] + ueNumPerSlice[1] ? 1 : 2);
+        if (ulDataRate[s] > 0.)
+        {
+            ConfigureUlApp(ueNodes.Get(u),
+                           sliceRemoteHostAddr[s],
+                           ulPorts[s],
+                           ulDataRate[s],
+                           ulPacketSize[s],
+                           clientUlApps);
+        }
+    }
+
+    // one edge server shared by the offloading slices, on the server of the first in priority
+    int serverSlice = -1;
+    for (uint8_t s = 0; s < numSlices; ++s)
+    {
+        if (offloadPeriodMs[s] > 0. &&
+            (serverSlice < 0 || offloadPriority[s] < offloadPriority[serverSlice]))
+        {
+            serverSlice = s;
+        }
+    }
+    Ptr<EdgeComputeServer> computeServer;
+    ApplicationContainer offloadClientApps [numSlices];
+    if (serverSlice >= 0)
+    {
+        computeServer = CreateObject<EdgeComputeServer>();
+        computeServer->SetAttribute("Port", UintegerValue(offloadPort));
+        computeServer->SetAttribute("Workers", UintegerValue(offloadWorkers));
+        computeServer->SetAttribute("ServiceTime", StringValue(offloadServiceTime));
+        sliceRemoteHost[serverSlice].Get(0)->AddApplication(computeServer);
+        serverApps.Add(computeServer);
+        if (!legacyStreams)
+        {
+            streamRegistry->Assign(RNG_ENTITY_SERVER,
+                                   serverSlice,
+                                   0,
+                                   RNG_PURPOSE_SERVICE,
+                                   [&](int64_t stream) {
+                                       return computeServer->AssignStreams(stream);
+                                   });
+        }
+    }
+    for (uint8_t s = 0; s < numSlices; ++s)
+    {
+        if (offloadPeriodMs[s] <= 0.)
+        {
+            continue;
+        }
+        computeServer->SetPriority(s, offloadPriority[s]);
+        Address serverAddress = InetSocketAddress(sliceRemoteHostAddr[serverSlice], offloadPort);
+        for (uint32_t u = 0; u < ueNumPerSlice[s]; ++u)
+        {
+            Ptr<OffloadClient> client = CreateObject<OffloadClient>();
+            client->SetAttribute("Port", UintegerValue(offloadPort));
+            client->SetAttribute("Period", TimeValue(MicroSeconds(offloadPeriodMs[s] * 1000)));
+            client->SetAttribute("TaskSize", UintegerValue(offloadTaskSize[s]));
+            client->SetAttribute("ResultSize", UintegerValue(offloadResultSize[s]));
+            client->SetAttribute("Deadline",
+                                 TimeValue(MicroSeconds(offloadDeadlineMs[s] * 1000)));
+            client->Setup(serverAddress, s);
+            sliceUeNodes[s]->Get(u)->AddApplication(client);
+            offloadClientApps[s].Add(client);
+        }
+        clientUlApps.Add(offloadClientApps[s]);
+    }
+
+    MemoryAccounting::SetPhase(MEMORY_PHASE_MONITORING);
+
+    // log the packets of the applications of each slice, and the PDCP PDUs once attached
+    for (uint8_t s = 0; s < numSlices; ++s)
+    {
+        SliceEventLog::ConnectApps(*sliceClientApps[s], s);
+        SliceEventLog::ConnectNodes(*sliceUeNodes[s], s);
+        SliceEventLog::AddUes(s, *sliceUeNetDev[s]);
+    }
+    Simulator::Schedule(MilliSeconds(appStartTimeMs), &SliceEventLog::ConnectPdcp);
+
+    // count the losses of each slice by cause
+    for (uint8_t s = 0; s < numSlices; ++s)
+    {
+        ueRegistry->AddUes(s, *sliceUeNetDev[s], *sliceUeIpIface[s]);
+    }
+    dropCounters->SetRegistry(ueRegistry);
+    for (uint8_t s = 0; s < numSlices; ++s)
+    {
+        dropCounters->SetDeadline(s, MicroSeconds(deadlineMs[s] * 1000));
+    }
+    Simulator::Schedule(MilliSeconds(appStartTimeMs), &SliceDropCounters::Connect, dropCounters);
+    // the TCP sockets are created when the applications start; those of the UEs admitted
+    // later are connected by admitUe
+    Simulator::Schedule(MilliSeconds(appStartTimeMs + 1),
+                        &SliceDropCounters::ConnectTcp,
+                        dropCounters);
+
+    // HARQ and link adaptation statistics of each slice and UE
+    Ptr<SliceHarqStats> harqStats = CreateObject<SliceHarqStats>();
+    harqStats->SetRegistry(ueRegistry);
+    Simulator::Schedule(MilliSeconds(appStartTimeMs), &SliceHarqStats::Connect, harqStats);
+
+    // spectrum the duplicated AD legs take on their BWPs
+    Ptr<DuplicationAirUsage> adDuplicationAir;
+    if (adDuplicationLegs > 0)
+    {
+        adDuplicationAir = CreateObject<DuplicationAirUsage>();
+        adDuplicationAir->SetRegistry(ueRegistry, 2);
+        adDuplicationAir->ConnectLeg(nrHelper->GetGnbPhy(gNbNetDev.Get(0), bwpIdForAD),
+                                     nrHelper->GetGnbMac(gNbNetDev.Get(0), bwpIdForAD));
+        if (adDuplicationLegs == 2)
+        {
+            adDuplicationAir->ConnectLeg(nrHelper->GetGnbPhy(gNbNetDev.Get(0), adDuplicationCc),
+                                         nrHelper->GetGnbMac(gNbNetDev.Get(0), adDuplicationCc));
+        }
+        Simulator::Schedule(MilliSeconds(appStartTimeMs),
+                            &DuplicationAirUsage::Start,
+                            adDuplicationAir);
     }
 
     // start UDP server and client apps
@@ -569,26 +1581,346 @@ main(int argc, char* argv[])
     clientVrApps.Start(MilliSeconds(appStartTimeMs));
     clientCgApps.Start(MilliSeconds(appStartTimeMs));
     clientAdApps.Start(MilliSeconds(appStartTimeMs));
+    clientUlApps.Start(MilliSeconds(appStartTimeMs));
     serverApps.Stop(MilliSeconds(simTimeMs));
     clientVrApps.Stop(MilliSeconds(appStartTimeMs + appDuration));
     clientCgApps.Stop(MilliSeconds(appStartTimeMs + appDuration));
     clientAdApps.Stop(MilliSeconds(appStartTimeMs + appDuration));
+    clientUlApps.Stop(MilliSeconds(appStartTimeMs + appDuration));
+
+    // measure the power efficiency of each BWP, and re-optimize the split in sla mode
+    Ptr<SlicePowerAllocator> powerAllocator = CreateObject<SlicePowerAllocator>();
+    powerAllocator->SetAttribute("TotalTxPower", DoubleValue(totalTxPower));
+    powerAllocator->SetAttribute("UpdatePeriod", TimeValue(MilliSeconds(powerUpdatePeriod)));
+    powerAllocator->SetAttribute("Adaptive", BooleanValue(powerAllocation == "sla"));
+    powerAllocator->SetSlices(std::vector<std::string>(sliceNames, sliceNames + numSlices));
+    powerAllocator->SetRegistry(ueRegistry);
+    // a BWP weighs as the strictest SLA of the slices it carries, e.g. AD and the VR leg
+    for (int n = 0; n < numCcs; ++n)
+    {
+        std::string names;
+        double slaWeight = 0;
+        for (uint8_t s : bwpSlices[n])
+        {
+            names += (names.empty() ? "" : "+") + sliceNames[s];
+            slaWeight = std::max(slaWeight, powerSlaWeight[s]);
+        }
+        powerAllocator->AddBwp(names.empty() ? "none" : names,
+                               nrHelper->GetGnbPhy(gNbNetDev.Get(0), n),
+                               nrHelper->GetGnbMac(gNbNetDev.Get(0), n),
+                               band.GetBwpAt(n, 0)->m_channelBandwidth,
+                               bwpSlices[n].empty() ? 1. : slaWeight);
+    }
+    Simulator::Schedule(MilliSeconds(appStartTimeMs), &SlicePowerAllocator::Start, powerAllocator);
+    Simulator::Schedule(MilliSeconds(appStartTimeMs + appDuration),
+                        &SlicePowerAllocator::Stop,
+                        powerAllocator);
+
+    // what the AD slice served first on the shared BWP costs the VR and CG slices
+    Ptr<SlicePriorityCost> priorityCost;
+    if (sharedBwp && adPriority)
+    {
+        priorityCost = CreateObject<SlicePriorityCost>();
+        priorityCost->SetSlices(std::vector<std::string>(sliceNames, sliceNames + numSlices), 2);
+        priorityCost->SetRegistry(ueRegistry);
+        priorityCost->SetBufferStatus(bufferStatus);
+        priorityCost->ConnectBwp(nrHelper->GetGnbPhy(gNbNetDev.Get(0), bwpIdForAD),
+                                 nrHelper->GetGnbMac(gNbNetDev.Get(0), bwpIdForAD));
+        Simulator::Schedule(MilliSeconds(appStartTimeMs), &SlicePriorityCost::Start, priorityCost);
+        Simulator::Schedule(MilliSeconds(appStartTimeMs + appDuration),
+                            &SlicePriorityCost::Stop,
+                            priorityCost);
+    }
 
     // enable the traces provided by the nr module
-    nrHelper->EnableTraces();
+    Ptr<SliceTraceManager> traceManager;
+    if (legacyTraces)
+    {
+        nrHelper->EnableTraces();
+    }
+    else if (!traceFamilies.empty())
+    {
+        traceManager = CreateObject<SliceTraceManager>();
+        traceManager->SetAttribute("Families", StringValue(traceFamilies));
+        traceManager->SetAttribute("SamplingPeriod", UintegerValue(traceSampling));
+        traceManager->SetAttribute("AggregatePerSlot", BooleanValue(traceAggregate));
+        std::string traceFile = outputDir + "/" + simTag + ".nrtrace";
+        if (!traceManager->Open(traceFile))
+        {
+            std::cerr << "Can't open file " << traceFile << std::endl;
+            return 1;
+        }
+        traceManager->ConnectGnbs(gNbNetDev);
+        traceManager->ConnectUes(ueVrNetDev);
+        traceManager->ConnectUes(ueCgNetDev);
+        traceManager->ConnectUes(ueAdNetDev);
+        // the bearers are set up by the time the ARP pings are done
+        Simulator::Schedule(MilliSeconds(appStartTimeMs),
+                            &SliceTraceManager::ConnectBearers,
+                            traceManager);
+    }
+
+    // sample the per-slice KPIs from the PDCP and PHY traces
+    Ptr<SliceKpiSampler> kpiSampler;
+    if (kpiSamplingPeriod > 0)
+    {
+        kpiSampler = CreateObject<SliceKpiSampler>();
+        kpiSampler->SetAttribute("Interval", TimeValue(MilliSeconds(kpiSamplingPeriod)));
+        kpiSampler->SetAttribute("Capacity", UintegerValue(kpiSamplingCapacity));
+        kpiSampler->SetAttribute("Incremental", BooleanValue(kpiSamplingIncremental));
+        std::string samplesFile = outputDir + "/" + simTag + ".samples.csv";
+        std::vector<std::string> names(sliceNames, sliceNames + numSlices);
+        if (!kpiSampler->Open(samplesFile, names))
+        {
+            std::cerr << "Can't open file " << samplesFile << std::endl;
+            return 1;
+        }
+        kpiSampler->AddUes(0, ueVrNetDev);
+        kpiSampler->AddUes(1, ueCgNetDev);
+        kpiSampler->AddUes(2, ueAdNetDev);
+        kpiSampler->SetBufferStatus(bufferStatus);
+        for (int n = 0; n < numCcs; ++n)
+        {
+            kpiSampler->ConnectBwp(nrHelper->GetGnbPhy(gNbNetDev.Get(0), n),
+                                   nrHelper->GetGnbMac(gNbNetDev.Get(0), n),
+                                   bwpSlices[n]);
+        }
+        Simulator::Schedule(MilliSeconds(appStartTimeMs), &SliceKpiSampler::Start, kpiSampler);
+    }
+
+    // scheduler decisions of a time window, for chrome://tracing or Perfetto
+    Ptr<SchedulerTimeline> schedTimeline;
+    if (schedTimelineDurationMs > 0)
+    {
+        schedTimeline = CreateObject<SchedulerTimeline>();
+        schedTimeline->SetAttribute("Start", TimeValue(MilliSeconds(schedTimelineStartMs)));
+        schedTimeline->SetAttribute(
+            "Stop",
+            TimeValue(MilliSeconds(schedTimelineStartMs + schedTimelineDurationMs)));
+        schedTimeline->SetAttribute("Capacity", UintegerValue(schedTimelineCapacity));
+        schedTimeline->SetRegistry(ueRegistry,
+                                   std::vector<std::string>(sliceNames, sliceNames + numSlices));
+        schedTimeline->ConnectGnbs(gNbNetDev);
+    }
 
     FlowMonitorHelper flowmonHelper;
     NodeContainer endpointNodes;
-    endpointNodes.Add(remoteHost);
+    endpointNodes.Add(remoteHosts);
     endpointNodes.Add(ueNodes);
 
     Ptr<ns3::FlowMonitor> monitor = flowmonHelper.Install(endpointNodes);
-    monitor->SetAttribute("DelayBinWidth", DoubleValue(0.001));
+    // fine enough for the percentiles of sub-millisecond slices
+    double delayBinWidth = 0.0001;
+    monitor->SetAttribute("DelayBinWidth", DoubleValue(delayBinWidth));
     monitor->SetAttribute("JitterBinWidth", DoubleValue(0.001));
     monitor->SetAttribute("PacketSizeBinWidth", DoubleValue(20));
+    Ptr<Ipv4FlowClassifier> classifier =
+        DynamicCast<Ipv4FlowClassifier>(flowmonHelper.GetClassifier());
+
+    // sample the per-slice throughput and delay of each period for the steady-state
+    // detection; the cumulative counters of each sample, per slice, per flow and of the
+    // drops, give the warm-up to subtract
+    Time measureStart = MilliSeconds(appStartTimeMs);
+    Time measureEnd = MilliSeconds(appStartTimeMs + appDuration);
+    bool stoppedEarly = false;
+    Ptr<SteadyStateDetector> detector;
+    std::vector<Time> snapshotTimes;
+    std::vector<std::vector<SliceCounters>> snapshots;
+    std::vector<std::map<FlowId, FlowCounters>> flowSnapshots;
+    std::function<void()> sampleSlices;
+    if (steadyState)
+    {
+        detector = CreateObject<SteadyStateDetector>();
+        detector->SetAttribute("Tolerance", DoubleValue(steadyStateTolerance));
+        for (uint8_t dir = 0; dir < 2; ++dir)
+        {
+            for (uint8_t s = 0; s < numSlices; ++s)
+            {
+                std::string name = sliceNames[s] + (dir == 0 ? " DL" : " UL");
+                detector->AddSeries(name + " throughput");
+                detector->AddSeries(name + " delay");
+            }
+        }
+        Time period = MilliSeconds(steadyStatePeriod);
+        snapshotTimes.push_back(measureStart);
+        snapshots.emplace_back(2 * numSlices);
+        flowSnapshots.emplace_back();
+        dropCounters->Mark();
+        sampleSlices = [&, period]() {
+            std::vector<SliceCounters> now =
+                CollectSliceCounters(monitor, classifier, dlPlan, ulPorts, numSlices);
+            for (uint32_t c = 0; c < now.size(); ++c)
+            {
+                SliceCounters d = now[c].Since(snapshots.back()[c]);
+                detector->AddSample(2 * c,
+                                    Simulator::Now(),
+                                    d.rxBytes * 8.0 / period.GetSeconds() / 1000 / 1000);
+                // an interval without packets has no delay sample
+                if (d.rxPackets > 0)
+                {
+                    detector->AddSample(2 * c + 1,
+                                        Simulator::Now(),
+                                        1000 * d.delaySum / d.rxPackets);
+                }
+            }
+            snapshotTimes.push_back(Simulator::Now());
+            snapshots.push_back(std::move(now));
+            flowSnapshots.push_back(CollectFlowCounters(monitor));
+            dropCounters->Mark();
+            if (steadyStateStop && detector->IsConverged())
+            {
+                measureEnd = Simulator::Now();
+                stoppedEarly = true;
+                Simulator::Stop();
+            }
+            else if (Simulator::Now() + period <= measureEnd)
+            {
+                Simulator::Schedule(period, sampleSlices);
+            }
+        };
+        Simulator::Schedule(measureStart + period, sampleSlices);
+    }
+
+    // live metrics; the snapshots only read the simulation state and its scalar counters
+    Ptr<MetricsEndpoint> metricsEndpoint;
+    if (metricsPort > 0 || !metricsSocket.empty())
+    {
+        metricsEndpoint = CreateObject<MetricsEndpoint>();
+        if (metricsPort > 0)
+        {
+            metricsEndpoint->SetAttribute("Port", UintegerValue(metricsPort));
+        }
+        metricsEndpoint->SetAttribute("SocketPath", StringValue(metricsSocket));
+        metricsEndpoint->SetAttribute("Period", TimeValue(MilliSeconds(metricsPeriodMs)));
+        std::vector<std::pair<std::string, std::string>> labels;
+        for (uint8_t dir = 0; dir < 2; ++dir)
+        {
+            for (uint8_t s = 0; s < numSlices; ++s)
+            {
+                labels.emplace_back(sliceNames[s], dir == 0 ? "DL" : "UL");
+            }
+        }
+        metricsEndpoint->SetSliceSource(labels, [&]() {
+            return CollectSliceCounters(monitor, classifier, dlPlan, ulPorts, numSlices, false);
+        });
+        if (!metricsEndpoint->Start())
+        {
+            std::cerr << "Can't open the metrics endpoint "
+                      << (metricsSocket.empty() ? std::to_string(metricsPort) : metricsSocket)
+                      << std::endl;
+            return 1;
+        }
+    }
 
+    // memory held by each category of objects, per slice where it is known
+    Ptr<MemoryCensus> memoryCensus;
+    if (memoryCensusPeriod > 0)
+    {
+        memoryCensus = CreateObject<MemoryCensus>();
+        memoryCensus->SetAttribute("Interval", TimeValue(MilliSeconds(memoryCensusPeriod)));
+        std::string memoryFile = outputDir + "/" + simTag + ".memory.csv";
+        if (!memoryCensus->Open(memoryFile,
+                                std::vector<std::string>(sliceNames, sliceNames + numSlices)))
+        {
+            std::cerr << "Can't open file " << memoryFile << std::endl;
+            return 1;
+        }
+        // the RLC transmission and retransmission buffers, from the buffer status reports:
+        // the queues holding data and their bytes, the UL ones held by the UEs
+        memoryCensus->AddProbe("RlcBuffer", [&]() {
+            std::vector<MemoryUsage> usage(numSlices);
+            for (uint8_t s = 0; s < numSlices; ++s)
+            {
+                for (uint8_t dir = 0; dir < 2; ++dir)
+                {
+                    usage[s].count += bufferStatus->GetQueues(dir, s);
+                    usage[s].bytes += bufferStatus->GetBytes(dir, s);
+                }
+            }
+            return usage;
+        });
+        memoryCensus->AddProbe("FlowMonitor", [&]() {
+            std::vector<MemoryUsage> usage(numSlices);
+            for (const auto& [flowId, fs] : monitor->GetFlowStats())
+            {
+                uint8_t slice;
+                bool isDl;
+                if (ClassifyFlow(classifier->FindFlow(flowId),
+                                 dlPlan,
+                                 ulPorts,
+                                 numSlices,
+                                 slice,
+                                 isDl))
+                {
+                    uint32_t bins = fs.delayHistogram.GetNBins() + fs.jitterHistogram.GetNBins() +
+                                    fs.packetSizeHistogram.GetNBins() +
+                                    fs.flowInterruptionsHistogram.GetNBins();
+                    ++usage[slice].count;
+                    usage[slice].bytes += sizeof(FlowMonitor::FlowStats) + bins * sizeof(uint32_t);
+                }
+            }
+            return usage;
+        });
+        memoryCensus->AddProbe("TraceBuffer", [&]() {
+            MemoryUsage usage;
+            if (traceManager)
+            {
+                ++usage.count;
+                usage.bytes += traceManager->GetBufferBytes();
+            }
+            if (schedTimeline)
+            {
+                ++usage.count;
+                usage.bytes += schedTimeline->GetBufferBytes();
+            }
+            return std::vector<MemoryUsage>{usage};
+        });
+        memoryCensus->Start();
+    }
+
+    MemoryAccounting::SetPhase(MEMORY_PHASE_RUN);
     Simulator::Stop(MilliSeconds(simTimeMs));
     Simulator::Run();
+    MemoryAccounting::SetPhase(MEMORY_PHASE_OTHER);
+
+    if (metricsEndpoint)
+    {
+        metricsEndpoint->Stop();
+    }
+    if (memoryCensus)
+    {
+        memoryCensus->Stop();
+    }
+
+    if (traceManager)
+    {
+        traceManager->Close();
+    }
+    if (kpiSampler)
+    {
+        kpiSampler->Stop();
+    }
+    SliceEventLog::Close();
+    harqStats->Finish();
+    if (schedTimeline)
+    {
+        std::string timelineFile = outputDir + "/" + simTag + ".sched.json";
+        if (!schedTimeline->Write(timelineFile))
+        {
+            std::cerr << "Can't open file " << timelineFile << std::endl;
+            return 1;
+        }
+        if (schedTimeline->GetNumDropped() > 0)
+        {
+            std::cerr << "Scheduler timeline full: " << schedTimeline->GetNumDropped()
+                      << " decisions not recorded, raise --schedTimelineCapacity" << std::endl;
+        }
+    }
+    if (stoppedEarly)
+    {
+        // the stop events of the applications did not run
+        powerAllocator->Stop();
+    }
 
     /*
      * To check what was installed in the memory, i.e., BWPs of eNb Device, and its configuration.
@@ -604,13 +1936,41 @@ main(int argc, char* argv[])
 
     // Print per-flow statistics
     monitor->CheckForLostPackets();
-    Ptr<Ipv4FlowClassifier> classifier =
-        DynamicCast<Ipv4FlowClassifier>(flowmonHelper.GetClassifier());
     FlowMonitor::FlowStatsContainer stats = monitor->GetFlowStats();
 
     double averageFlowThroughput = 0.0;
     double averageFlowDelay = 0.0;
 
+    // per-slice aggregates, DL and UL reported separately, the flows and the drops, all
+    // without the warm-up if detected
+    std::vector<SliceCounters> sliceCounters =
+        CollectSliceCounters(monitor, classifier, dlPlan, ulPorts, numSlices);
+    std::map<FlowId, FlowCounters> flowCounters = CollectFlowCounters(monitor);
+    if (detector)
+    {
+        Time warmupEnd = detector->GetWarmupEnd();
+        for (std::size_t k = 0; k < snapshotTimes.size(); ++k)
+        {
+            if (snapshotTimes[k] == warmupEnd)
+            {
+                for (uint32_t c = 0; c < sliceCounters.size(); ++c)
+                {
+                    sliceCounters[c] = sliceCounters[c].Since(snapshots[k][c]);
+                }
+                for (auto& [flowId, c] : flowCounters)
+                {
+                    auto warmup = flowSnapshots[k].find(flowId);
+                    if (warmup != flowSnapshots[k].end())
+                    {
+                        c = c.Since(warmup->second);
+                    }
+                }
+                dropCounters->Truncate(k);
+                measureStart = warmupEnd;
+            }
+        }
+    }
+
     std::ofstream outFile;
     std::string filename = outputDir + "/" + simTag;
     outFile.open(filename.c_str(), std::ofstream::out | std::ofstream::trunc);
@@ -622,12 +1982,24 @@ main(int argc, char* argv[])
 
     outFile.setf(std::ios_base::fixed);
 
+    uint64_t configHash = config.GetHash();
+    ColumnBlock runRows(g_runColumns);
+    ColumnBlock sliceRows(g_sliceColumns);
+    ColumnBlock flowRows(g_flowColumns);
+
     for (std::map<FlowId, FlowMonitor::FlowStats>::const_iterator i = stats.begin();
          i != stats.end();
          ++i)
     {
         Ipv4FlowClassifier::FiveTuple t = classifier->FindFlow(i->first);
-        double txDuration = MilliSeconds(appDuration).GetSeconds();
+        double txDuration = (measureEnd - measureStart).GetSeconds();
+        const FlowCounters& f = flowCounters[i->first];
+        // a flow is measured from the end of the warm-up at the earliest
+        Time firstTx = i->second.timeFirstTxPacket;
+        if (detector)
+        {
+            firstTx = std::max(firstTx, measureStart);
+        }
         std::stringstream protoStream;
         protoStream << (uint16_t)t.protocol;
         if (t.protocol == 6)
@@ -641,30 +2013,29 @@ main(int argc, char* argv[])
         outFile << "Flow " << i->first << " (" << t.sourceAddress << ":" << t.sourcePort << " -> "
                 << t.destinationAddress << ":" << t.destinationPort << ") proto "
                 << protoStream.str() << "\n";
-        outFile << "  Tx Packets: " << i->second.txPackets << "\n";
-        outFile << "  Tx Bytes:   " << i->second.txBytes << "\n";
+        outFile << "  Tx Packets: " << f.txPackets << "\n";
+        outFile << "  Tx Bytes:   " << f.txBytes << "\n";
         outFile << "  TxOffered:  "
-                << i->second.txBytes * 8.0 / txDuration / 1000 / 1000 << " Mbps\n";
-        outFile << "  Rx Bytes:   " << i->second.rxBytes << "\n";
-        if (i->second.rxPackets > 0)
+                << f.txBytes * 8.0 / txDuration / 1000 / 1000 << " Mbps\n";
+        outFile << "  Rx Bytes:   " << f.rxBytes << "\n";
+        if (f.rxPackets > 0)
         {
             // Measure the duration of the flow from receiver's perspective
             // double rxDuration = i->second.timeLastRxPacket.GetSeconds () -
             // i->second.timeFirstTxPacket.GetSeconds ();
-            double rxDuration = i->second.timeLastRxPacket.GetSeconds () -
-                i->second.timeFirstTxPacket.GetSeconds ();
+            double rxDuration = (i->second.timeLastRxPacket - firstTx).GetSeconds();
 
-            averageFlowThroughput += i->second.rxBytes * 8.0 / rxDuration / 1000 / 1000;
-            averageFlowDelay += 1000 * i->second.delaySum.GetSeconds() / i->second.rxPackets;
+            averageFlowThroughput += f.rxBytes * 8.0 / rxDuration / 1000 / 1000;
+            averageFlowDelay += 1000 * f.delaySum / f.rxPackets;
 
-            outFile << "  Throughput: " << i->second.rxBytes * 8.0 / rxDuration / 1000 / 1000
+            outFile << "  Throughput: " << f.rxBytes * 8.0 / rxDuration / 1000 / 1000
                     << " Mbps\n";
             outFile << "  Mean delay:  "
-                    << 1000 * i->second.delaySum.GetSeconds() / i->second.rxPackets << " ms\n";
+                    << 1000 * f.delaySum / f.rxPackets << " ms\n";
             // outFile << "  Mean upt:  " << i->second.uptSum / i->second.rxPackets / 1000/1000 << "
             // Mbps \n";
             outFile << "  Mean jitter:  "
-                    << 1000 * i->second.jitterSum.GetSeconds() / i->second.rxPackets << " ms\n";
+                    << 1000 * f.jitterSum / f.rxPackets << " ms\n";
         }
         else
         {
@@ -672,12 +2043,226 @@ main(int argc, char* argv[])
             outFile << "  Mean delay:  0 ms\n";
             outFile << "  Mean jitter: 0 ms\n";
         }
-        outFile << "  Rx Packets: " << i->second.rxPackets << "\n";
+        outFile << "  Rx Packets: " << f.rxPackets << "\n";
+
+        uint8_t slice = UINT8_MAX;
+        bool isDl = false;
+        bool inSlice = ClassifyFlow(t, dlPlan, ulPorts, numSlices, slice, isDl);
+        double rxDuration = (i->second.timeLastRxPacket - firstTx).GetSeconds();
+        uint64_t rxPackets = f.rxPackets;
+        flowRows.Put("configHash", configHash);
+        flowRows.Put("rngRun", rngRun);
+        flowRows.Put("flowId", i->first);
+        flowRows.Put("slice", inSlice ? slice : UINT8_MAX);
+        // a flow of no slice, e.g. a ping or a core flow, has no direction either
+        flowRows.Put("direction", inSlice ? (isDl ? 0 : 1) : UINT8_MAX);
+        flowRows.Put("protocol", t.protocol);
+        flowRows.Put("sourcePort", t.sourcePort);
+        flowRows.Put("destinationPort", t.destinationPort);
+        flowRows.Put("txPackets", f.txPackets);
+        flowRows.Put("rxPackets", rxPackets);
+        flowRows.Put("txBytes", f.txBytes);
+        flowRows.Put("rxBytes", f.rxBytes);
+        flowRows.Put("lostPackets", f.lostPackets);
+        flowRows.Put("throughputMbps",
+                     rxPackets > 0 ? f.rxBytes * 8.0 / rxDuration / 1000 / 1000 : 0.);
+        flowRows.Put("meanDelayMs",
+                     rxPackets > 0 ? 1000 * f.delaySum / rxPackets : 0.);
+        flowRows.Put("meanJitterMs",
+                     rxPackets > 0 ? 1000 * f.jitterSum / rxPackets : 0.);
     }
 
     outFile << "\n\n  Mean flow throughput: " << averageFlowThroughput / stats.size() << "\n";
     outFile << "  Mean flow delay: " << averageFlowDelay / stats.size() << "\n";
 
+    outFile << "\n\n  Per-slice results:\n";
+    std::vector<SliceKpi> kpis;
+    for (uint8_t s = 0; s < numSlices; ++s)
+    {
+        for (uint8_t dir = 0; dir < 2; ++dir)
+        {
+            double txDuration = (measureEnd - measureStart).GetSeconds();
+            const SliceCounters& c = sliceCounters[dir * numSlices + s];
+            SliceKpi kpi;
+            kpi.slice = sliceNames[s];
+            kpi.direction = dir == 0 ? "DL" : "UL";
+            kpi.throughputMbps = c.rxBytes * 8.0 / txDuration / 1000 / 1000;
+            kpi.meanDelayMs = c.rxPackets > 0 ? 1000 * c.delaySum / c.rxPackets : 0.;
+            kpi.p99DelayMs = 1000 * HistogramPercentile(c.delayBins, delayBinWidth, 0.99);
+            kpi.lostPackets = c.lostPackets;
+            kpis.push_back(kpi);
+
+            sliceRows.Put("configHash", configHash);
+            sliceRows.Put("rngRun", rngRun);
+            sliceRows.Put("slice", s);
+            sliceRows.Put("direction", dir);
+            sliceRows.Put("throughputMbps", kpi.throughputMbps);
+            sliceRows.Put("meanDelayMs", kpi.meanDelayMs);
+            sliceRows.Put("p99DelayMs", kpi.p99DelayMs);
+            sliceRows.Put("rxPackets", c.rxPackets);
+            sliceRows.Put("lostPackets", kpi.lostPackets);
+
+            outFile << "  Slice " << kpi.slice << " " << kpi.direction << ":";
+            outFile << " Throughput " << kpi.throughputMbps << " Mbps,";
+            outFile << " Mean delay " << kpi.meanDelayMs << " ms,";
+            outFile << " p99 delay " << kpi.p99DelayMs << " ms,";
+            outFile << " Lost packets " << kpi.lostPackets << "\n";
+            outFile << "    Drops: ";
+            dropCounters->Print(outFile, dir, s);
+            outFile << "\n    Air interface (PDCP to PDCP): ";
+            dropCounters->PrintLatency(outFile, dir, s);
+            outFile << "\n";
+        }
+    }
+
+    outFile << "\n  HARQ and link adaptation per slice:\n";
+    const auto& registeredUes = ueRegistry->GetUes();
+    for (uint8_t dir = 0; dir < 2; ++dir)
+    {
+        for (uint8_t s = 0; s < numSlices; ++s)
+        {
+            outFile << "  Slice " << sliceNames[s] << (dir == 0 ? " DL: " : " UL: ");
+            SliceHarqStats::Print(outFile, harqStats->GetSlice(dir, s));
+            outFile << "\n";
+            for (uint32_t i = 0; harqStatsPerUe && i < registeredUes.size(); ++i)
+            {
+                if (registeredUes[i].slice == s)
+                {
+                    outFile << "    UE " << registeredUes[i].rnti << ": ";
+                    SliceHarqStats::Print(outFile, harqStats->GetUe(dir, i));
+                    outFile << "\n";
+                }
+            }
+        }
+    }
+
+    if (computeServer)
+    {
+        double capacity = offloadWorkers * MilliSeconds(appDuration).GetSeconds();
+        outFile << "\n  Edge compute offload (" << offloadWorkers << " workers on the "
+                << sliceNames[serverSlice] << " server, utilization "
+                << 100. * computeServer->GetBusyTime().GetSeconds() / capacity << " %):\n";
+        for (uint8_t s = 0; s < numSlices; ++s)
+        {
+            if (offloadPeriodMs[s] > 0.)
+            {
+                outFile << "  Slice " << sliceNames[s] << ": ";
+                PrintOffloadStats(outFile, offloadClientApps[s], computeServer->GetSliceStats(s));
+            }
+        }
+    }
+
+    if (admission)
+    {
+        outFile << "\n  Admission control (a UE every " << admissionArrivalMs
+                << " ms on average per slice, max load " << admissionMaxLoad << "):\n";
+        admission->Print(outFile);
+    }
+
+    if (detector)
+    {
+        outFile << "\n  Steady state (MSER-5, " << steadyStatePeriod << " ms samples): per-slice "
+                << "results measured from " << measureStart.GetMilliSeconds() << " ms to "
+                << measureEnd.GetMilliSeconds() << " ms"
+                << (stoppedEarly ? ", stopped early after convergence, packets in flight not drained"
+                                : "")
+                << "\n";
+        detector->Report(outFile);
+    }
+
+    if (vrCarrierAggregation)
+    {
+        double txDuration = MilliSeconds(appDuration).GetSeconds();
+        outFile << "\n  VR carrier aggregation (" << caSplitPolicy << " split):\n";
+        uint64_t droppedBytes = 0;
+        for (uint32_t k = 0; k < vrCaQcis.size(); ++k)
+        {
+            uint64_t txBytes = 0;
+            for (const auto& app : vrCaApps)
+            {
+                txBytes += app->GetTxBytes(k);
+                droppedBytes += k == 0 ? app->GetDroppedBytes() : 0;
+            }
+            outFile << "  Leg " << k << " (CC " << k << "): Offered "
+                    << txBytes * 8.0 / txDuration / 1000 / 1000 << " Mbps\n";
+        }
+        outFile << "  Not accepted by any leg: " << droppedBytes * 8.0 / txDuration / 1000 / 1000
+                << " Mbps\n";
+    }
+
+    if (adDuplicationLegs > 0)
+    {
+        outFile << "\n  AD duplication (" << adDuplicationLegs << " legs, CC " << bwpIdForAD;
+        if (adDuplicationLegs == 2)
+        {
+            outFile << " and CC " << adDuplicationCc;
+        }
+        outFile << "): ";
+        PrintDuplicationStats(outFile,
+                              adDuplicationSources,
+                              adDuplicationSinks,
+                              adDuplicationLegs,
+                              MilliSeconds(deadlineMs[2]));
+        adDuplicationAir->Print(outFile);
+    }
+
+    if (memoryCensus)
+    {
+        outFile << "\n  Memory (" << (MemoryAccounting::IsHooked() ? "heap and RSS" : "RSS only")
+                << "):\n";
+        memoryCensus->Report(outFile);
+    }
+
+    if (coreTopology)
+    {
+        outFile << "\n  Core network (S1-U " << s1uDelayMs << " ms):\n";
+        coreTopology->Print(outFile, std::vector<std::string>(sliceNames, sliceNames + numSlices));
+    }
+
+    if (!legacyStreams)
+    {
+        outFile << "\n  RNG streams (per entity, slice and index):\n";
+        streamRegistry->Print(outFile);
+    }
+
+    outFile << "\n  Per-slice DL power (" << powerAllocation << " allocation):\n";
+    powerAllocator->Report(outFile);
+
+    if (priorityCost)
+    {
+        outFile << "\n  AD priority on the shared BWP " << bwpIdForAD
+                << " (DL RB x symbols granted to AD, and those each slice waited for):\n";
+        priorityCost->Print(outFile);
+    }
+
+    if (!kpiFile.empty() && !WriteKpiFile(kpiFile, kpis))
+    {
+        std::cerr << "Can't open file " << kpiFile << std::endl;
+        return 1;
+    }
+
+    // the run row goes last, so a run listed in the runs table has all its rows
+    if (!resultsStore.empty())
+    {
+        runRows.Put("configHash", configHash);
+        runRows.Put("rngRun", rngRun);
+        runRows.Put("appDurationMs", appDuration);
+        runRows.Put("numUes", ueNodes.GetN());
+        runRows.Put("numFlows", stats.size());
+        runRows.Put("wallClockS", elapsed_seconds.count());
+        runRows.Put("meanFlowThroughputMbps", averageFlowThroughput / stats.size());
+        runRows.Put("meanFlowDelayMs", averageFlowDelay / stats.size());
+        if (!AppendConfig(resultsStore, configHash, config.GetCanonical()) ||
+            !flowRows.AppendTo(resultsStore, "flows") ||
+            !sliceRows.AppendTo(resultsStore, "slices") || !runRows.AppendTo(resultsStore, "runs"))
+        {
+            std::cerr << "Can't append to the results store " << resultsStore << std::endl;
+            return 1;
+        }
+        outFile << "\n  Config hash " << std::hex << configHash << std::dec << ", run " << rngRun
+                << " appended to " << resultsStore << "\n";
+    }
+
     outFile.close();
 
     std::ifstream f(filename.c_str());
@@ -690,3 +2275,91 @@ main(int argc, char* argv[])
     Simulator::Destroy();
     return 0;
 }
+
+/**
+ * Reset the process-wide state a scenario leaves behind, so that the next
+ * scenario of a batch runs exactly as it would in a fresh process.
+ */
+void
+ResetScenarioState()
+{
+    // nodes, channels and pending events
+    Simulator::Destroy();
+    // attribute defaults and globals, including the RNG seed and run
+    Config::Reset();
+    RngSeedManager::ResetNextStreamIndex();
+    Ipv4AddressGenerator::Reset();
+    Ipv6AddressGenerator::Reset();
+    Mac48Address::ResetAllocationIndex();
+    Mac64Address::ResetAllocationIndex();
+    LogComponentDisableAll(LOG_LEVEL_ALL);
+    // a scenario that failed before the end leaves its event log open
+    SliceEventLog::Reset();
+    // the heap of the next scenario is counted from zero
+    MemoryAccounting::Reset();
+}
+
+int
+main(int argc, char* argv[])
+{
+    // --batchFile=<file> runs every scenario of the file in this process; the
+    // other arguments apply to all of them, before the arguments of the line
+    std::string batchFile;
+    std::vector<std::string> common;
+    for (int i = 1; i < argc; ++i)
+    {
+        std::string arg = argv[i];
+        if (arg.rfind("--batchFile=", 0) == 0)
+        {
+            batchFile = arg.substr(std::string("--batchFile=").size());
+        }
+        else
+        {
+            common.push_back(arg);
+        }
+    }
+    if (batchFile.empty())
+    {
+        return RunScenario(argc, argv);
+    }
+
+    std::vector<std::vector<std::string>> scenarios;
+    if (!ReadBatchFile(batchFile, scenarios))
+    {
+        std::cerr << "Can't open file " << batchFile << std::endl;
+        return 1;
+    }
+
+    int status = 0;
+    for (std::size_t n = 0; n < scenarios.size(); ++n)
+    {
+        std::vector<std::string> args = {argv[0]};
+        args.insert(args.end(), common.begin(), common.end());
+        args.insert(args.end(), scenarios[n].begin(), scenarios[n].end());
+        // the default simTag only has a one-second resolution
+        bool hasTag = std::any_of(args.begin(), args.end(), [](const std::string& a) {
+            return a.rfind("--simTag=", 0) == 0;
+        });
+        if (!hasTag)
+        {
+            args.push_back("--simTag=batch-" + std::to_string(n) + ".txt");
+        }
+        std::vector<char*> scenarioArgv;
+        for (auto& a : args)
+        {
+            scenarioArgv.push_back(&a[0]);
+        }
+        scenarioArgv.push_back(nullptr);
+
+        std::cout << "Batch scenario " << n + 1 << "/" << scenarios.size() << std::endl;
+        int result = RunScenario(static_cast<int>(args.size()), scenarioArgv.data());
+        if (result != 0)
+        {
+            std::cerr << "Batch scenario " << n + 1 << " failed with status " << result
+                      << std::endl;
+            status = result;
+        }
+        ResetScenarioState();
+    }
+    return status;
+}
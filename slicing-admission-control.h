@@ -0,0 +1,394 @@
+#ifndef SLICING_ADMISSION_CONTROL_H
+#define SLICING_ADMISSION_CONTROL_H
+
+#include "ns3/core-module.h"
+#include "ns3/nr-module.h"
+
+#include "slicing-ue-registry.h"
+
+#include <algorithm>
+#include <ostream>
+#include <string>
+#include <vector>
+
+namespace ns3
+{
+
+/// Decision on a new UE of a slice.
+enum AdmissionDecision : uint8_t
+{
+    ADMISSION_ACCEPT = 0, //!< Admitted at the requested rate.
+    ADMISSION_DOWNGRADE,  //!< Admitted at a lower rate.
+    ADMISSION_REJECT      //!< Blocked.
+};
+
+/**
+ * Admission control of the UEs of each slice from an estimate of its capacity.
+ *
+ * Every Period, the DL bits a slice carried in new transmissions on its BWPs
+ * are divided by the share its grants used of the RB x symbols left to it:
+ * those of its BWPs less the ones the other slices of each BWP used. This is
+ * the rate the slice would get with all it can have of its BWPs, so the
+ * slices sharing a BWP do not each count on the whole of it. The grants are
+ * attributed to the slices by RNTI, and a grant spans all the RBs of its
+ * symbols, as with the TDMA schedulers. The
+ * estimate already reflects the channel quality of the UEs, through the MCS
+ * their CQI reports lead to.
+ * The estimate is smoothed with an EWMA of weight Alpha, and the mean MCS is
+ * kept alongside it for the report. Windows with too few used RBs
+ * (MinUtilization) say nothing about the capacity and are skipped.
+ *
+ * A new UE asks for the SLA rate of its slice. It is accepted if the load
+ * of the slice with it stays within MaxLoad of the capacity. The load is the
+ * larger of the rate committed to the admitted UEs and the rate measured.
+ * Otherwise it is downgraded to DowngradeFactor of the rate if that fits, and
+ * rejected if not. Before the first estimate every UE is accepted.
+ */
+class SliceAdmissionController : public Object
+{
+  public:
+    SliceAdmissionController();
+    ~SliceAdmissionController() override;
+
+    /**
+     * Register this type.
+     * \return The TypeId.
+     */
+    static TypeId GetTypeId();
+
+    /**
+     * Set the slices.
+     * \param sliceNames The names of the slices.
+     */
+    void SetSlices(const std::vector<std::string>& sliceNames);
+
+    /**
+     * Set the slice of each UE, for the grants.
+     * \param registry The UEs and their slices.
+     */
+    void SetRegistry(Ptr<SliceUeRegistry> registry);
+
+    /**
+     * Estimate the capacity of the slices a BWP carries.
+     * \param phy The PHY of the BWP.
+     * \param mac The MAC of the BWP.
+     * \param slices The slices whose bearers map to the BWP.
+     */
+    void ConnectBwp(Ptr<NrGnbPhy> phy, Ptr<NrGnbMac> mac, const std::vector<uint8_t>& slices);
+
+    /// Start the periodic estimates.
+    void Start();
+
+    /**
+     * Decide on a new UE; an admitted UE commits its rate to the slice.
+     * \param slice The slice of the UE.
+     * \param rate The rate the UE asks for, in Mbps.
+     * \return The decision.
+     */
+    AdmissionDecision Decide(uint8_t slice, double rate);
+
+    /**
+     * \param slice The slice index.
+     * \return The rejected share of the UEs of the slice.
+     */
+    double GetBlockingProbability(uint8_t slice) const;
+
+    /**
+     * Print the decisions and the estimates of each slice.
+     * \param os The output stream.
+     */
+    void Print(std::ostream& os) const;
+
+  private:
+    /// Estimate and decisions of a slice.
+    struct Slice
+    {
+        std::string name;                  //!< Name of the slice.
+        uint64_t bits = 0;                 //!< DL bits of new transmissions in the window.
+        uint64_t mcsSum = 0;               //!< Sum of the MCS of the new transmissions.
+        uint64_t tbs = 0;                  //!< New transmissions in the window.
+        bool estimated = false;            //!< True once a window gave an estimate.
+        double capacity = 0;               //!< Capacity estimate in Mbps.
+        double measured = 0;               //!< Carried rate in Mbps.
+        double mcs = 0;                    //!< Mean MCS.
+        double committed = 0;              //!< Rate committed to the admitted UEs in Mbps.
+        uint32_t decisions[3] = {0, 0, 0}; //!< UEs per decision.
+    };
+
+    /// A BWP and its RB x symbols in the window.
+    struct Bwp
+    {
+        Ptr<NrGnbPhy> phy;            //!< PHY of the BWP.
+        std::vector<uint8_t> slices;  //!< Slices whose bearers map to the BWP.
+        std::vector<uint64_t> usedReg; //!< RB x symbols of the grants of each slice.
+        uint64_t availableReg = 0;    //!< Available RB x symbols.
+    };
+
+    /// Fold the window of every slice into its estimate.
+    void Update();
+
+    /**
+     * DlScheduling trace sink.
+     * \param bwp The index of the BWP in m_bwps.
+     * \param info The grant.
+     */
+    void DlScheduling(uint32_t bwp, NrSchedulingCallbackInfo info);
+
+    /**
+     * SlotDataStats trace sink.
+     * \param bwp The index of the BWP in m_bwps.
+     * \param sfnSf The slot.
+     * \param scheduledUe The number of scheduled UEs.
+     * \param usedReg The used RB x symbols.
+     * \param usedSym The used symbols.
+     * \param availableRb The available RBs.
+     * \param availableSym The available symbols.
+     * \param bwpId The BWP id.
+     * \param cellId The cell id.
+     */
+    void SlotDataStats(uint32_t bwp,
+                       const SfnSf& sfnSf,
+                       uint32_t scheduledUe,
+                       uint32_t usedReg,
+                       uint32_t usedSym,
+                       uint32_t availableRb,
+                       uint32_t availableSym,
+                       uint16_t bwpId,
+                       uint16_t cellId);
+
+    Time m_period;            //!< Estimation window.
+    double m_alpha;           //!< EWMA weight of the last window.
+    double m_maxLoad;         //!< Share of the capacity the admitted load may use.
+    double m_downgradeFactor; //!< Share of the rate a downgraded UE gets.
+    double m_minUtilization;  //!< Utilization below which a window is skipped.
+
+    std::vector<Slice> m_slices;                                       //!< Slices.
+    std::vector<Bwp> m_bwps;                                           //!< BWPs and their slices.
+    Ptr<SliceUeRegistry> m_registry;                                   //!< Slice of each UE.
+    EventId m_updateEvent;                                             //!< Next estimate.
+};
+
+inline SliceAdmissionController::SliceAdmissionController()
+    : m_alpha(0.3),
+      m_maxLoad(0.9),
+      m_downgradeFactor(0.5),
+      m_minUtilization(0.05)
+{
+}
+
+inline SliceAdmissionController::~SliceAdmissionController()
+{
+}
+
+/* static */
+inline TypeId
+SliceAdmissionController::GetTypeId()
+{
+    static TypeId tid =
+        TypeId("SliceAdmissionController")
+            .SetParent<Object>()
+            .SetGroupName("Tutorial")
+            .AddConstructor<SliceAdmissionController>()
+            .AddAttribute("Period",
+                          "Window of the capacity estimates",
+                          TimeValue(MilliSeconds(100)),
+                          MakeTimeAccessor(&SliceAdmissionController::m_period),
+                          MakeTimeChecker())
+            .AddAttribute("Alpha",
+                          "EWMA weight of the last window",
+                          DoubleValue(0.3),
+                          MakeDoubleAccessor(&SliceAdmissionController::m_alpha),
+                          MakeDoubleChecker<double>(0, 1))
+            .AddAttribute("MaxLoad",
+                          "Share of the capacity the admitted load may use",
+                          DoubleValue(0.9),
+                          MakeDoubleAccessor(&SliceAdmissionController::m_maxLoad),
+                          MakeDoubleChecker<double>(0))
+            .AddAttribute("DowngradeFactor",
+                          "Share of the requested rate a downgraded UE gets, 0 disables",
+                          DoubleValue(0.5),
+                          MakeDoubleAccessor(&SliceAdmissionController::m_downgradeFactor),
+                          MakeDoubleChecker<double>(0, 1))
+            .AddAttribute("MinUtilization",
+                          "Utilization below which a window gives no estimate",
+                          DoubleValue(0.05),
+                          MakeDoubleAccessor(&SliceAdmissionController::m_minUtilization),
+                          MakeDoubleChecker<double>(0, 1));
+    return tid;
+}
+
+inline void
+SliceAdmissionController::SetSlices(const std::vector<std::string>& sliceNames)
+{
+    m_slices.assign(sliceNames.size(), Slice());
+    for (uint32_t s = 0; s < sliceNames.size(); ++s)
+    {
+        m_slices[s].name = sliceNames[s];
+    }
+}
+
+inline void
+SliceAdmissionController::SetRegistry(Ptr<SliceUeRegistry> registry)
+{
+    m_registry = registry;
+}
+
+inline void
+SliceAdmissionController::ConnectBwp(Ptr<NrGnbPhy> phy,
+                                     Ptr<NrGnbMac> mac,
+                                     const std::vector<uint8_t>& slices)
+{
+    for (uint8_t slice : slices)
+    {
+        NS_ABORT_MSG_IF(slice >= m_slices.size(), "Unknown slice " << +slice);
+    }
+    uint32_t bwp = m_bwps.size();
+    m_bwps.push_back({phy, slices, std::vector<uint64_t>(m_slices.size(), 0)});
+    phy->TraceConnectWithoutContext(
+        "SlotDataStats",
+        MakeCallback(&SliceAdmissionController::SlotDataStats, this).Bind(bwp));
+    mac->TraceConnectWithoutContext(
+        "DlScheduling",
+        MakeCallback(&SliceAdmissionController::DlScheduling, this).Bind(bwp));
+}
+
+inline void
+SliceAdmissionController::Start()
+{
+    for (auto& s : m_slices)
+    {
+        s.bits = s.mcsSum = s.tbs = 0;
+    }
+    for (auto& bwp : m_bwps)
+    {
+        std::fill(bwp.usedReg.begin(), bwp.usedReg.end(), 0);
+        bwp.availableReg = 0;
+    }
+    m_updateEvent = Simulator::Schedule(m_period, &SliceAdmissionController::Update, this);
+}
+
+inline void
+SliceAdmissionController::DlScheduling(uint32_t bwp, NrSchedulingCallbackInfo info)
+{
+    NS_ABORT_MSG_IF(!m_registry, "No UE registry");
+    uint8_t slice = m_registry->GetSliceOfRnti(info.m_rnti);
+    if (slice >= m_slices.size())
+    {
+        return;
+    }
+    Slice& s = m_slices[slice];
+    m_bwps[bwp].usedReg[slice] += static_cast<uint64_t>(info.m_numSym) * m_bwps[bwp].phy->GetRbNum();
+    if (info.m_rv == 0)
+    {
+        s.bits += static_cast<uint64_t>(info.m_tbSize) * 8;
+        s.mcsSum += info.m_mcs;
+        ++s.tbs;
+    }
+}
+
+inline void
+SliceAdmissionController::SlotDataStats(uint32_t bwp,
+                                        const SfnSf& /* sfnSf */,
+                                        uint32_t /* scheduledUe */,
+                                        uint32_t /* usedReg */,
+                                        uint32_t /* usedSym */,
+                                        uint32_t availableRb,
+                                        uint32_t availableSym,
+                                        uint16_t /* bwpId */,
+                                        uint16_t /* cellId */)
+{
+    m_bwps[bwp].availableReg += static_cast<uint64_t>(availableRb) * availableSym;
+}
+
+inline void
+SliceAdmissionController::Update()
+{
+    // the RB x symbols of each slice, and those left to it by the other slices of its BWPs
+    std::vector<uint64_t> usedReg(m_slices.size(), 0);
+    std::vector<uint64_t> availableReg(m_slices.size(), 0);
+    for (auto& bwp : m_bwps)
+    {
+        uint64_t used = 0;
+        for (uint64_t reg : bwp.usedReg)
+        {
+            used += reg;
+        }
+        for (uint8_t slice : bwp.slices)
+        {
+            uint64_t others = used - bwp.usedReg[slice];
+            usedReg[slice] += bwp.usedReg[slice];
+            availableReg[slice] += bwp.availableReg - std::min(bwp.availableReg, others);
+        }
+        std::fill(bwp.usedReg.begin(), bwp.usedReg.end(), 0);
+        bwp.availableReg = 0;
+    }
+    for (uint32_t i = 0; i < m_slices.size(); ++i)
+    {
+        Slice& s = m_slices[i];
+        double utilization =
+            availableReg[i] > 0 ? static_cast<double>(usedReg[i]) / availableReg[i] : 0.;
+        if (utilization >= m_minUtilization && s.tbs > 0)
+        {
+            double measured = s.bits / m_period.GetSeconds() / 1e6;
+            double capacity = measured / std::min(utilization, 1.);
+            double mcs = static_cast<double>(s.mcsSum) / s.tbs;
+            double alpha = s.estimated ? m_alpha : 1.;
+            s.capacity = alpha * capacity + (1 - alpha) * s.capacity;
+            s.measured = alpha * measured + (1 - alpha) * s.measured;
+            s.mcs = alpha * mcs + (1 - alpha) * s.mcs;
+            s.estimated = true;
+        }
+        s.bits = s.mcsSum = s.tbs = 0;
+    }
+    m_updateEvent = Simulator::Schedule(m_period, &SliceAdmissionController::Update, this);
+}
+
+inline AdmissionDecision
+SliceAdmissionController::Decide(uint8_t slice, double rate)
+{
+    NS_ABORT_MSG_IF(slice >= m_slices.size(), "Unknown slice " << +slice);
+    Slice& s = m_slices[slice];
+    double load = std::max(s.committed, s.measured);
+    double budget = m_maxLoad * s.capacity;
+    AdmissionDecision decision = ADMISSION_REJECT;
+    if (!s.estimated || load + rate <= budget)
+    {
+        decision = ADMISSION_ACCEPT;
+        s.committed += rate;
+    }
+    else if (m_downgradeFactor > 0 && load + m_downgradeFactor * rate <= budget)
+    {
+        decision = ADMISSION_DOWNGRADE;
+        s.committed += m_downgradeFactor * rate;
+    }
+    ++s.decisions[decision];
+    return decision;
+}
+
+inline double
+SliceAdmissionController::GetBlockingProbability(uint8_t slice) const
+{
+    const Slice& s = m_slices.at(slice);
+    uint32_t arrivals = s.decisions[0] + s.decisions[1] + s.decisions[2];
+    return arrivals > 0 ? static_cast<double>(s.decisions[ADMISSION_REJECT]) / arrivals : 0.;
+}
+
+inline void
+SliceAdmissionController::Print(std::ostream& os) const
+{
+    for (uint32_t i = 0; i < m_slices.size(); ++i)
+    {
+        const Slice& s = m_slices[i];
+        os << "  Slice " << s.name << ": "
+           << s.decisions[0] + s.decisions[1] + s.decisions[2] << " UEs, "
+           << s.decisions[ADMISSION_ACCEPT] << " accepted, " << s.decisions[ADMISSION_DOWNGRADE]
+           << " downgraded, " << s.decisions[ADMISSION_REJECT] << " rejected, blocking probability "
+           << GetBlockingProbability(i) << "\n";
+        os << "    Capacity " << s.capacity << " Mbps at mean MCS " << s.mcs << ", carried "
+           << s.measured << " Mbps, committed " << s.committed << " Mbps\n";
+    }
+}
+
+} // namespace ns3
+
+#endif /* SLICING_ADMISSION_CONTROL_H */
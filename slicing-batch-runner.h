@@ -0,0 +1,113 @@
+#ifndef SLICING_BATCH_RUNNER_H
+#define SLICING_BATCH_RUNNER_H
+
+#include <algorithm>
+#include <atomic>
+#include <cstdlib>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace ns3
+{
+
+/**
+ * Run shell commands on a pool of worker threads.
+ *
+ * The ns-3 simulator is a process-wide singleton, so concurrent simulations
+ * must live in separate processes; each worker thread only waits for its child.
+ *
+ * \param commands The commands to run.
+ * \param jobs The maximum number of commands running at the same time.
+ * \return The exit status of each command, in the order of the commands.
+ */
+inline std::vector<int>
+RunParallel(const std::vector<std::string>& commands, uint32_t jobs)
+{
+    std::vector<int> status(commands.size(), -1);
+    std::atomic<std::size_t> next{0};
+
+    auto worker = [&]() {
+        for (std::size_t i = next++; i < commands.size(); i = next++)
+        {
+            status[i] = std::system(commands[i].c_str());
+        }
+    };
+
+    std::vector<std::thread> workers;
+    for (uint32_t j = 0; j < std::max<uint32_t>(jobs, 1); ++j)
+    {
+        workers.emplace_back(worker);
+    }
+    for (auto& w : workers)
+    {
+        w.join();
+    }
+    return status;
+}
+
+/**
+ * Quote a string for the POSIX shell, e.g. a TDD pattern holding '|'.
+ *
+ * \param arg The argument.
+ * \return The argument in single quotes.
+ */
+inline std::string
+ShellQuote(const std::string& arg)
+{
+    std::string quoted = "'";
+    for (char c : arg)
+    {
+        if (c == '\'')
+        {
+            quoted += "'\\''";
+        }
+        else
+        {
+            quoted += c;
+        }
+    }
+    return quoted + "'";
+}
+
+/**
+ * Read the scenarios of a batch file.
+ *
+ * Every non-empty line that does not start with '#' is one scenario, given as
+ * command-line arguments separated by blanks, e.g. --rngRun=2 --appDuration=500.
+ *
+ * \param filename The batch file.
+ * \param scenarios The arguments of each scenario, appended to the vector.
+ * \return false if the file cannot be opened.
+ */
+inline bool
+ReadBatchFile(const std::string& filename, std::vector<std::vector<std::string>>& scenarios)
+{
+    std::ifstream in(filename.c_str());
+    if (!in.is_open())
+    {
+        return false;
+    }
+    std::string line;
+    while (std::getline(in, line))
+    {
+        std::istringstream iss(line);
+        std::vector<std::string> args;
+        std::string arg;
+        while (iss >> arg)
+        {
+            args.push_back(arg);
+        }
+        if (!args.empty() && args[0][0] != '#')
+        {
+            scenarios.push_back(args);
+        }
+    }
+    return true;
+}
+
+} // namespace ns3
+
+#endif /* SLICING_BATCH_RUNNER_H */
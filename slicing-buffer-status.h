@@ -0,0 +1,170 @@
+#ifndef SLICING_BUFFER_STATUS_H
+#define SLICING_BUFFER_STATUS_H
+
+#include "ns3/core-module.h"
+#include "ns3/nr-module.h"
+
+#include "slicing-ue-registry.h"
+
+#include <unordered_map>
+#include <vector>
+
+namespace ns3
+{
+
+/**
+ * RLC buffer occupancy of each slice, from the buffer status reports.
+ *
+ * The gNB RLC of every DL logical channel reports its transmission,
+ * retransmission and status PDU bytes to the scheduler of its BWP, and every
+ * UE reports the UL bytes of each logical channel group in its BSRs. The
+ * scheduler, see NrMacSchedulerTdmaMiniSlot, forwards the reports here, and
+ * the latest report of each queue is kept. The bytes are thus those the RLC
+ * holds, retransmissions included, and not the PDUs lost on the way. A UL
+ * BSR is quantized to the levels of the BSR table.
+ *
+ * The queues are summed per slice when read, by RNTI through the registry,
+ * so the reports received before the UEs are resolved count as well.
+ */
+class SliceBufferStatus : public Object
+{
+  public:
+    SliceBufferStatus();
+    ~SliceBufferStatus() override;
+
+    /**
+     * Register this type.
+     * \return The TypeId.
+     */
+    static TypeId GetTypeId();
+
+    /**
+     * Set the UEs and their slices.
+     * \param registry The UE registry.
+     */
+    void SetRegistry(Ptr<SliceUeRegistry> registry);
+
+    /**
+     * Record the buffer status of a queue.
+     * \param dir 0 for a DL logical channel, 1 for a UL logical channel group.
+     * \param bwpId The BWP of the report.
+     * \param rnti The RNTI of the UE.
+     * \param lc The LCID in DL, the LCG in UL.
+     * \param bytes The bytes queued.
+     */
+    void Report(uint8_t dir, uint16_t bwpId, uint16_t rnti, uint8_t lc, uint32_t bytes);
+
+    /**
+     * \param dir 0 for DL, 1 for UL.
+     * \param slice The slice index.
+     * \param bwpId The BWP, UINT16_MAX for all.
+     * \return The bytes queued in the RLC of the UEs of the slice.
+     */
+    uint64_t GetBytes(uint8_t dir, uint8_t slice, uint16_t bwpId = UINT16_MAX) const;
+
+    /**
+     * \param dir 0 for DL, 1 for UL.
+     * \param slice The slice index.
+     * \return The queues of the slice holding data.
+     */
+    uint32_t GetQueues(uint8_t dir, uint8_t slice) const;
+
+  protected:
+    void DoDispose() override;
+
+  private:
+    /**
+     * \param bwpId The BWP.
+     * \param rnti The RNTI.
+     * \param lc The LCID or LCG.
+     * \return The key of the queue in m_queues.
+     */
+    static uint64_t QueueKey(uint16_t bwpId, uint16_t rnti, uint8_t lc);
+
+    Ptr<SliceUeRegistry> m_registry;                      //!< UEs and their slices.
+    std::unordered_map<uint64_t, uint32_t> m_queues[2];   //!< Latest bytes of each queue.
+};
+
+inline SliceBufferStatus::SliceBufferStatus()
+{
+}
+
+inline SliceBufferStatus::~SliceBufferStatus()
+{
+}
+
+/* static */
+inline TypeId
+SliceBufferStatus::GetTypeId()
+{
+    static TypeId tid = TypeId("SliceBufferStatus")
+                            .SetParent<Object>()
+                            .SetGroupName("Tutorial")
+                            .AddConstructor<SliceBufferStatus>();
+    return tid;
+}
+
+inline void
+SliceBufferStatus::SetRegistry(Ptr<SliceUeRegistry> registry)
+{
+    m_registry = registry;
+}
+
+/* static */
+inline uint64_t
+SliceBufferStatus::QueueKey(uint16_t bwpId, uint16_t rnti, uint8_t lc)
+{
+    return (static_cast<uint64_t>(bwpId) << 32) | (static_cast<uint64_t>(rnti) << 8) | lc;
+}
+
+inline void
+SliceBufferStatus::Report(uint8_t dir, uint16_t bwpId, uint16_t rnti, uint8_t lc, uint32_t bytes)
+{
+    if (bytes > 0)
+    {
+        m_queues[dir][QueueKey(bwpId, rnti, lc)] = bytes;
+    }
+    else
+    {
+        m_queues[dir].erase(QueueKey(bwpId, rnti, lc));
+    }
+}
+
+inline uint64_t
+SliceBufferStatus::GetBytes(uint8_t dir, uint8_t slice, uint16_t bwpId) const
+{
+    uint64_t bytes = 0;
+    for (const auto& [key, queued] : m_queues[dir])
+    {
+        if ((bwpId == UINT16_MAX || key >> 32 == bwpId) &&
+            m_registry->GetSliceOfRnti((key >> 8) & 0xffff) == slice)
+        {
+            bytes += queued;
+        }
+    }
+    return bytes;
+}
+
+inline uint32_t
+SliceBufferStatus::GetQueues(uint8_t dir, uint8_t slice) const
+{
+    uint32_t queues = 0;
+    for (const auto& [key, queued] : m_queues[dir])
+    {
+        queues += m_registry->GetSliceOfRnti((key >> 8) & 0xffff) == slice ? 1 : 0;
+    }
+    return queues;
+}
+
+inline void
+SliceBufferStatus::DoDispose()
+{
+    m_registry = nullptr;
+    m_queues[0].clear();
+    m_queues[1].clear();
+    Object::DoDispose();
+}
+
+} // namespace ns3
+
+#endif /* SLICING_BUFFER_STATUS_H */
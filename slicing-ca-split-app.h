@@ -0,0 +1,238 @@
+#ifndef SLICING_CA_SPLIT_APP_H
+#define SLICING_CA_SPLIT_APP_H
+
+#include "ns3/applications-module.h"
+#include "ns3/core-module.h"
+#include "ns3/internet-module.h"
+#include "ns3/network-module.h"
+
+#include <vector>
+
+namespace ns3
+{
+
+/**
+ * Frame-based video source that splits its traffic over several legs.
+ *
+ * Each leg is a socket towards a port of the same UE whose packet filter maps
+ * to a bearer on a different component carrier, so the bearers of the slice
+ * are aggregated across CCs. The split policy picks the leg of every packet:
+ * - "bandwidth" and "equal": weighted round robin with the weights given to
+ *   Setup(), e.g. the CC bandwidths, or equal weights;
+ * - "backlog": the leg with the most free transmit buffer, so a TCP leg on an
+ *   idle CC drains faster and takes more traffic. UDP legs never back up, so
+ *   this falls back to the weighted round robin.
+ */
+class CaSplitApp : public Application
+{
+  public:
+    CaSplitApp();
+    ~CaSplitApp() override;
+
+    /**
+     * Register this type.
+     * \return The TypeId.
+     */
+    static TypeId GetTypeId();
+
+    /**
+     * Setup the legs and the traffic.
+     * \param transportProtocol The socket factory, e.g. ns3::TcpSocketFactory.
+     * \param legs The destination address of each leg, the primary CC first.
+     * \param weights The weight of each leg, positive.
+     * \param policy The split policy: bandwidth, equal or backlog.
+     * \param dataRate The data rate of the source in Mbps.
+     * \param fps The frame rate of the source.
+     */
+    void Setup(std::string transportProtocol,
+               std::vector<Address> legs,
+               std::vector<double> weights,
+               std::string policy,
+               double dataRate,
+               uint16_t fps);
+
+    /**
+     * \param leg The leg index.
+     * \return The bytes accepted by the socket of the leg.
+     */
+    uint64_t GetTxBytes(uint32_t leg) const;
+
+    /// \return The bytes that no leg could accept.
+    uint64_t GetDroppedBytes() const;
+
+  private:
+    void StartApplication() override;
+    void StopApplication() override;
+
+    /// Send a frame over the legs and schedule the next one.
+    void SendFrame();
+    /**
+     * Pick the leg of the next packet.
+     * \param size The packet size.
+     * \return The leg index, or the number of legs if no leg can accept the packet.
+     */
+    uint32_t PickLeg(uint32_t size) const;
+
+    std::string m_transportProtocol;   //!< The socket factory.
+    std::vector<Address> m_legs;       //!< Destination of each leg.
+    std::vector<double> m_weights;     //!< Weight of each leg.
+    std::vector<Ptr<Socket>> m_sockets; //!< Socket of each leg.
+    std::vector<uint64_t> m_txBytes;   //!< Bytes accepted by each leg.
+    uint64_t m_droppedBytes;           //!< Bytes no leg could accept.
+    bool m_backlogPolicy;              //!< True for the backlog policy.
+    uint32_t m_packetSize;             //!< Maximum packet size.
+    uint32_t m_frameSize;              //!< Bytes per frame.
+    Time m_frameInterval;              //!< Time between frames.
+    EventId m_sendEvent;               //!< Next frame.
+};
+
+inline CaSplitApp::CaSplitApp()
+    : m_droppedBytes(0),
+      m_backlogPolicy(false),
+      m_packetSize(1400),
+      m_frameSize(0),
+      m_frameInterval(),
+      m_sendEvent()
+{
+}
+
+inline CaSplitApp::~CaSplitApp()
+{
+}
+
+/* static */
+inline TypeId
+CaSplitApp::GetTypeId()
+{
+    static TypeId tid = TypeId("CaSplitApp")
+                            .SetParent<Application>()
+                            .SetGroupName("Tutorial")
+                            .AddConstructor<CaSplitApp>()
+                            .AddAttribute("PacketSize",
+                                          "Maximum size of the packets a frame is cut into",
+                                          UintegerValue(1400),
+                                          MakeUintegerAccessor(&CaSplitApp::m_packetSize),
+                                          MakeUintegerChecker<uint32_t>(1));
+    return tid;
+}
+
+inline void
+CaSplitApp::Setup(std::string transportProtocol,
+                  std::vector<Address> legs,
+                  std::vector<double> weights,
+                  std::string policy,
+                  double dataRate,
+                  uint16_t fps)
+{
+    NS_ABORT_MSG_IF(legs.empty() || legs.size() != weights.size(), "One weight per leg needed");
+    NS_ABORT_MSG_IF(policy != "bandwidth" && policy != "equal" && policy != "backlog",
+                    "Unknown split policy " << policy);
+    for (double weight : weights)
+    {
+        NS_ABORT_MSG_IF(!(weight > 0), "The weight of every leg must be positive, not " << weight);
+    }
+    m_transportProtocol = transportProtocol;
+    m_legs = legs;
+    m_weights = weights;
+    if (policy == "equal")
+    {
+        m_weights.assign(legs.size(), 1.);
+    }
+    m_backlogPolicy = policy == "backlog";
+    m_txBytes.assign(legs.size(), 0);
+    m_frameSize = static_cast<uint32_t>(dataRate * 1e6 / 8 / fps);
+    m_frameInterval = Seconds(1.0 / fps);
+}
+
+inline uint64_t
+CaSplitApp::GetTxBytes(uint32_t leg) const
+{
+    return m_txBytes.at(leg);
+}
+
+inline uint64_t
+CaSplitApp::GetDroppedBytes() const
+{
+    return m_droppedBytes;
+}
+
+inline void
+CaSplitApp::StartApplication()
+{
+    m_sockets.clear();
+    for (const auto& leg : m_legs)
+    {
+        Ptr<Socket> socket =
+            Socket::CreateSocket(GetNode(), TypeId::LookupByName(m_transportProtocol));
+        socket->Bind();
+        socket->Connect(leg);
+        m_sockets.push_back(socket);
+    }
+    SendFrame();
+}
+
+inline void
+CaSplitApp::StopApplication()
+{
+    if (m_sendEvent.IsPending())
+    {
+        Simulator::Cancel(m_sendEvent);
+    }
+
+    for (auto& socket : m_sockets)
+    {
+        socket->Close();
+    }
+    m_sockets.clear();
+}
+
+inline uint32_t
+CaSplitApp::PickLeg(uint32_t size) const
+{
+    uint32_t best = m_sockets.size();
+    for (uint32_t k = 0; k < m_sockets.size(); ++k)
+    {
+        uint32_t available = m_sockets[k]->GetTxAvailable();
+        if (available < size)
+        {
+            continue;
+        }
+        if (best == m_sockets.size())
+        {
+            best = k;
+        }
+        else if (m_backlogPolicy && available != m_sockets[best]->GetTxAvailable())
+        {
+            best = available > m_sockets[best]->GetTxAvailable() ? k : best;
+        }
+        else if (m_txBytes[k] / m_weights[k] < m_txBytes[best] / m_weights[best])
+        {
+            // weighted round robin: the leg furthest behind its share
+            best = k;
+        }
+    }
+    return best;
+}
+
+inline void
+CaSplitApp::SendFrame()
+{
+    uint32_t remaining = m_frameSize;
+    while (remaining > 0)
+    {
+        uint32_t size = std::min(remaining, m_packetSize);
+        uint32_t leg = PickLeg(size);
+        if (leg == m_sockets.size() || m_sockets[leg]->Send(Create<Packet>(size)) < 0)
+        {
+            m_droppedBytes += remaining;
+            break;
+        }
+        m_txBytes[leg] += size;
+        remaining -= size;
+    }
+    m_sendEvent = Simulator::Schedule(m_frameInterval, &CaSplitApp::SendFrame, this);
+}
+
+} // namespace ns3
+
+#endif /* SLICING_CA_SPLIT_APP_H */
@@ -0,0 +1,288 @@
+#ifndef SLICING_CORE_TOPOLOGY_H
+#define SLICING_CORE_TOPOLOGY_H
+
+#include "ns3/core-module.h"
+#include "ns3/internet-module.h"
+#include "ns3/network-module.h"
+#include "ns3/point-to-point-module.h"
+
+#include <ostream>
+#include <string>
+#include <vector>
+
+namespace ns3
+{
+
+/// User-plane anchor of a slice.
+enum SliceAnchor : uint8_t
+{
+    ANCHOR_EDGE = 0, //!< Edge UPF, the server is next to the PGW.
+    ANCHOR_CENTRAL   //!< Central UPF, the server is behind the N9 link.
+};
+
+/**
+ * Core network behind the PGW with a user-plane anchor and a server per slice.
+ *
+ * The PGW of the EPC helper stands for the edge UPF, next to the gNB site.
+ * An edge slice has its application server one N6 link away from it. A
+ * central slice crosses the N9 link to the central UPF first, a router here,
+ * and then its own N6 link to a server in the central data center. Every
+ * link has its own delay and data rate, so the transport latency of each
+ * slice can be set, and moving a slice to the edge shows what MEC placement
+ * gains. The gNB-PGW backhaul is the S1-U link of the EPC helper.
+ */
+class SliceCoreTopology : public Object
+{
+  public:
+    SliceCoreTopology();
+    ~SliceCoreTopology() override;
+
+    /**
+     * Register this type.
+     * \return The TypeId.
+     */
+    static TypeId GetTypeId();
+
+    /**
+     * \param name "edge" or "central".
+     * \return The anchor; aborts on other names.
+     */
+    static SliceAnchor ParseAnchor(const std::string& name);
+
+    /**
+     * Set the anchor of a slice; the slices are edge by default.
+     * \param slice The slice index.
+     * \param anchor The anchor.
+     */
+    void SetAnchor(uint8_t slice, SliceAnchor anchor);
+
+    /**
+     * Create the servers, the central UPF and the links, and set up the routes.
+     * \param pgw The PGW node of the EPC helper.
+     * \param numSlices The number of slices.
+     * \param ueNetwork The network of the UE addresses, e.g. 7.0.0.0.
+     * \param ueMask The mask of the UE network.
+     */
+    void Install(Ptr<Node> pgw, uint8_t numSlices, Ipv4Address ueNetwork, Ipv4Mask ueMask);
+
+    /**
+     * \param slice The slice index.
+     * \return The application server of the slice.
+     */
+    Ptr<Node> GetServer(uint8_t slice) const;
+
+    /**
+     * \param slice The slice index.
+     * \return The address of the application server of the slice.
+     */
+    Ipv4Address GetServerAddress(uint8_t slice) const;
+
+    /// \return The application servers, one per slice.
+    NodeContainer GetServers() const;
+
+    /**
+     * \param slice The slice index.
+     * \return The one-way propagation delay from the PGW to the server of the slice.
+     */
+    Time GetCoreDelay(uint8_t slice) const;
+
+    /**
+     * Print the anchor and the core delay of each slice.
+     * \param os The output stream.
+     * \param sliceNames The names of the slices.
+     */
+    void Print(std::ostream& os, const std::vector<std::string>& sliceNames) const;
+
+  private:
+    /**
+     * Connect two nodes with a point-to-point link on a new /24 network.
+     * \param a The first node.
+     * \param b The second node.
+     * \param rate The data rate.
+     * \param delay The delay.
+     * \return The interfaces of a and b.
+     */
+    Ipv4InterfaceContainer Connect(Ptr<Node> a, Ptr<Node> b, DataRate rate, Time delay);
+
+    Time m_n9Delay;        //!< Delay of the N9 link.
+    DataRate m_n9Rate;     //!< Data rate of the N9 link.
+    Time m_edgeN6Delay;    //!< Delay of the N6 link of an edge server.
+    Time m_centralN6Delay; //!< Delay of the N6 link of a central server.
+    DataRate m_n6Rate;     //!< Data rate of the N6 links.
+    uint16_t m_mtu;        //!< MTU of the links.
+
+    std::vector<SliceAnchor> m_anchors;   //!< Anchor of each slice.
+    NodeContainer m_servers;              //!< Server of each slice.
+    std::vector<Ipv4Address> m_addresses; //!< Address of each server.
+    Ptr<Node> m_centralUpf;               //!< Central UPF, if a slice uses it.
+    Ipv4AddressHelper m_ipv4;             //!< Addresses of the links.
+};
+
+inline SliceCoreTopology::SliceCoreTopology()
+    : m_mtu(2500)
+{
+    m_ipv4.SetBase("1.0.0.0", "255.255.255.0");
+}
+
+inline SliceCoreTopology::~SliceCoreTopology()
+{
+}
+
+/* static */
+inline TypeId
+SliceCoreTopology::GetTypeId()
+{
+    static TypeId tid =
+        TypeId("SliceCoreTopology")
+            .SetParent<Object>()
+            .SetGroupName("Tutorial")
+            .AddConstructor<SliceCoreTopology>()
+            .AddAttribute("N9Delay",
+                          "Delay of the N9 link between the edge and the central UPF",
+                          TimeValue(MilliSeconds(10)),
+                          MakeTimeAccessor(&SliceCoreTopology::m_n9Delay),
+                          MakeTimeChecker())
+            .AddAttribute("N9DataRate",
+                          "Data rate of the N9 link",
+                          DataRateValue(DataRate("10Gb/s")),
+                          MakeDataRateAccessor(&SliceCoreTopology::m_n9Rate),
+                          MakeDataRateChecker())
+            .AddAttribute("EdgeN6Delay",
+                          "Delay of the N6 link between the edge UPF and an edge server",
+                          TimeValue(MicroSeconds(500)),
+                          MakeTimeAccessor(&SliceCoreTopology::m_edgeN6Delay),
+                          MakeTimeChecker())
+            .AddAttribute("CentralN6Delay",
+                          "Delay of the N6 link between the central UPF and a central server",
+                          TimeValue(MilliSeconds(1)),
+                          MakeTimeAccessor(&SliceCoreTopology::m_centralN6Delay),
+                          MakeTimeChecker())
+            .AddAttribute("N6DataRate",
+                          "Data rate of the N6 links",
+                          DataRateValue(DataRate("100Gb/s")),
+                          MakeDataRateAccessor(&SliceCoreTopology::m_n6Rate),
+                          MakeDataRateChecker())
+            .AddAttribute("Mtu",
+                          "MTU of the links",
+                          UintegerValue(2500),
+                          MakeUintegerAccessor(&SliceCoreTopology::m_mtu),
+                          MakeUintegerChecker<uint16_t>());
+    return tid;
+}
+
+/* static */
+inline SliceAnchor
+SliceCoreTopology::ParseAnchor(const std::string& name)
+{
+    NS_ABORT_MSG_IF(name != "edge" && name != "central", "Unknown anchor " << name);
+    return name == "edge" ? ANCHOR_EDGE : ANCHOR_CENTRAL;
+}
+
+inline void
+SliceCoreTopology::SetAnchor(uint8_t slice, SliceAnchor anchor)
+{
+    if (m_anchors.size() <= slice)
+    {
+        m_anchors.resize(slice + 1, ANCHOR_EDGE);
+    }
+    m_anchors[slice] = anchor;
+}
+
+inline Ipv4InterfaceContainer
+SliceCoreTopology::Connect(Ptr<Node> a, Ptr<Node> b, DataRate rate, Time delay)
+{
+    PointToPointHelper p2ph;
+    p2ph.SetDeviceAttribute("DataRate", DataRateValue(rate));
+    p2ph.SetDeviceAttribute("Mtu", UintegerValue(m_mtu));
+    p2ph.SetChannelAttribute("Delay", TimeValue(delay));
+    Ipv4InterfaceContainer ifaces = m_ipv4.Assign(p2ph.Install(a, b));
+    m_ipv4.NewNetwork();
+    return ifaces;
+}
+
+inline void
+SliceCoreTopology::Install(Ptr<Node> pgw, uint8_t numSlices, Ipv4Address ueNetwork, Ipv4Mask ueMask)
+{
+    m_anchors.resize(numSlices, ANCHOR_EDGE);
+    m_servers.Create(numSlices);
+    InternetStackHelper internet;
+    internet.Install(m_servers);
+    Ipv4StaticRoutingHelper routingHelper;
+
+    Ipv4InterfaceContainer n9;
+    for (uint8_t s = 0; s < numSlices; ++s)
+    {
+        if (m_anchors[s] == ANCHOR_CENTRAL && !m_centralUpf)
+        {
+            m_centralUpf = CreateObject<Node>();
+            internet.Install(m_centralUpf);
+            n9 = Connect(pgw, m_centralUpf, m_n9Rate, m_n9Delay);
+            // back to the UEs through the edge UPF
+            routingHelper.GetStaticRouting(m_centralUpf->GetObject<Ipv4>())
+                ->AddNetworkRouteTo(ueNetwork, ueMask, n9.GetAddress(0), n9.Get(1).second);
+        }
+    }
+
+    Ptr<Ipv4StaticRouting> pgwRouting = routingHelper.GetStaticRouting(pgw->GetObject<Ipv4>());
+    for (uint8_t s = 0; s < numSlices; ++s)
+    {
+        Ptr<Node> server = m_servers.Get(s);
+        Ipv4InterfaceContainer n6;
+        if (m_anchors[s] == ANCHOR_EDGE)
+        {
+            n6 = Connect(pgw, server, m_n6Rate, m_edgeN6Delay);
+        }
+        else
+        {
+            n6 = Connect(m_centralUpf, server, m_n6Rate, m_centralN6Delay);
+            // the PGW reaches the central servers over N9
+            pgwRouting->AddNetworkRouteTo(n6.GetAddress(1).CombineMask(Ipv4Mask("255.255.255.0")),
+                                          Ipv4Mask("255.255.255.0"),
+                                          n9.GetAddress(1),
+                                          n9.Get(0).second);
+        }
+        routingHelper.GetStaticRouting(server->GetObject<Ipv4>())
+            ->AddNetworkRouteTo(ueNetwork, ueMask, n6.GetAddress(0), n6.Get(1).second);
+        m_addresses.push_back(n6.GetAddress(1));
+    }
+}
+
+inline Ptr<Node>
+SliceCoreTopology::GetServer(uint8_t slice) const
+{
+    return m_servers.Get(slice);
+}
+
+inline Ipv4Address
+SliceCoreTopology::GetServerAddress(uint8_t slice) const
+{
+    return m_addresses.at(slice);
+}
+
+inline NodeContainer
+SliceCoreTopology::GetServers() const
+{
+    return m_servers;
+}
+
+inline Time
+SliceCoreTopology::GetCoreDelay(uint8_t slice) const
+{
+    return m_anchors.at(slice) == ANCHOR_EDGE ? m_edgeN6Delay : m_n9Delay + m_centralN6Delay;
+}
+
+inline void
+SliceCoreTopology::Print(std::ostream& os, const std::vector<std::string>& sliceNames) const
+{
+    for (uint32_t s = 0; s < m_anchors.size(); ++s)
+    {
+        os << "  Slice " << (s < sliceNames.size() ? sliceNames[s] : std::to_string(s)) << ": "
+           << (m_anchors[s] == ANCHOR_EDGE ? "edge" : "central") << " UPF, server "
+           << m_addresses.at(s) << ", PGW-server delay " << GetCoreDelay(s).GetMicroSeconds() / 1e3
+           << " ms\n";
+    }
+}
+
+} // namespace ns3
+
+#endif /* SLICING_CORE_TOPOLOGY_H */
@@ -0,0 +1,500 @@
+#ifndef SLICING_DROP_COUNTERS_H
+#define SLICING_DROP_COUNTERS_H
+
+#include "ns3/core-module.h"
+#include "ns3/internet-module.h"
+#include "ns3/lte-module.h"
+#include "ns3/network-module.h"
+#include "ns3/nr-module.h"
+
+#include "slicing-ue-registry.h"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <ostream>
+#include <set>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace ns3
+{
+
+/// Causes of a packet loss.
+enum DropCause : uint8_t
+{
+    DROP_RLC_OVERFLOW = 0, //!< RLC TxDrop, the transmission buffer is full.
+    DROP_HARQ_FAILURE,     //!< Transport block still corrupt at the last redundancy version.
+    DROP_PDCP_LOST_TOTAL,  //!< PDCP PDUs sent and never received, whatever the cause.
+    DROP_DEADLINE,         //!< PDCP PDUs received after the slice deadline.
+    DROP_TCP_RTO,          //!< Retransmission timeouts of the TCP senders.
+    DROP_NUM_CAUSES
+};
+
+/**
+ * Per-slice counters of the packet losses, by cause and direction.
+ *
+ * The counters are incremented by trace sinks: the RLC TxDrop of every
+ * bearer, the RxPacketTrace of the PHYs for the HARQ failures, the PDCP
+ * TxPDU/RxPDU for the undelivered and late PDUs, and the congestion state of
+ * the TCP sockets, where each entry in CA_LOSS is a retransmission timeout.
+ * A sink only increments an array entry, so the counters can stay on in
+ * every run. The TCP timeouts are counted on the DL senders only.
+ *
+ * The PDCP PDUs sent and never received are a total, not a cause: they
+ * include the RLC overflows, the PDUs of the HARQ processes that failed and
+ * those still in flight at the end of the run, so Print() shows them apart
+ * from the causes.
+ *
+ * The delays of the PDCP PDUs received also go into a histogram of 50 us
+ * bins per slice and direction: the air-interface latency, from the PDCP of
+ * the sender to the PDCP of the receiver, with RLC queueing and HARQ.
+ *
+ * Mark() remembers the counters at a time, e.g. at each steady-state sample,
+ * and Truncate() then leaves out what was counted before one of the marks.
+ * The highest delay cannot be truncated and stays that of the whole run.
+ */
+class SliceDropCounters : public Object
+{
+  public:
+    SliceDropCounters();
+    ~SliceDropCounters() override;
+
+    /**
+     * Register this type.
+     * \return The TypeId.
+     */
+    static TypeId GetTypeId();
+
+    /**
+     * \param cause The cause.
+     * \return The name of the cause.
+     */
+    static const char* GetCauseName(uint8_t cause);
+
+    /**
+     * Set the UEs and their slices.
+     * \param registry The UE registry.
+     */
+    void SetRegistry(Ptr<SliceUeRegistry> registry);
+
+    /**
+     * Set the delay budget of a slice; later PDCP PDUs count as expired.
+     * \param slice The slice index.
+     * \param deadline The delay budget, zero to disable.
+     */
+    void SetDeadline(uint8_t slice, Time deadline);
+
+    /**
+     * Connect the RLC, PDCP and PHY traces of the registered UEs and of
+     * their gNBs; the UEs must be attached and their bearers set up.
+     */
+    void Connect();
+
+    /**
+     * Connect the congestion state of the TCP sockets connected to a
+     * registered UE; the sockets must exist, so schedule it after the
+     * applications start. The sockets already connected are skipped, so it
+     * can be called again for the applications installed later.
+     */
+    void ConnectTcp();
+
+    /// Remember the counters now.
+    void Mark();
+
+    /**
+     * Keep only what was counted since a mark, and forget the marks.
+     * \param mark The index of the mark, in the order of the Mark() calls.
+     */
+    void Truncate(std::size_t mark);
+
+    /**
+     * \param dir 0 for DL, 1 for UL.
+     * \param slice The slice index.
+     * \param cause The cause.
+     * \return The number of drops.
+     */
+    uint64_t Get(uint8_t dir, uint8_t slice, uint8_t cause) const;
+
+    /**
+     * Print the drops of a slice and direction by cause, then the PDCP PDUs lost in
+     * total, e.g. "RlcOverflow 0, ...; PdcpLostTotal 3".
+     * \param os The output stream.
+     * \param dir 0 for DL, 1 for UL.
+     * \param slice The slice index.
+     */
+    void Print(std::ostream& os, uint8_t dir, uint8_t slice) const;
+
+    /**
+     * Print the PDCP delay of a slice and direction, e.g. "mean 0.4 ms, p50 0.35 ms, ...".
+     * \param os The output stream.
+     * \param dir 0 for DL, 1 for UL.
+     * \param slice The slice index.
+     */
+    void PrintLatency(std::ostream& os, uint8_t dir, uint8_t slice) const;
+
+  private:
+    static constexpr uint32_t NUM_DELAY_BINS = 400;  //!< Delay bins, the last one is open.
+    static constexpr uint64_t DELAY_BIN_NS = 50000;  //!< Width of a delay bin.
+
+    /// Counters of one slice and direction.
+    struct Counters
+    {
+        std::array<uint64_t, DROP_NUM_CAUSES> drops{}; //!< Drops by cause.
+        uint64_t pdcpTx{0};                            //!< PDCP PDUs sent.
+        uint64_t pdcpRx{0};                            //!< PDCP PDUs received.
+        uint64_t pdcpDelaySumNs{0};                    //!< Sum of the PDCP delays.
+        uint64_t pdcpDelayMaxNs{0};                    //!< Highest PDCP delay.
+        std::array<uint32_t, NUM_DELAY_BINS> delayBins{}; //!< Histogram of the PDCP delays.
+    };
+
+    /**
+     * \param dir 0 for DL, 1 for UL.
+     * \param slice The slice index.
+     * \return The counters.
+     */
+    Counters& At(uint8_t dir, uint8_t slice);
+
+    /**
+     * RLC TxDrop trace sink.
+     * \param dir 0 for DL, 1 for UL.
+     * \param slice The slice index.
+     * \param p The dropped packet.
+     */
+    void RlcTxDrop(uint8_t dir, uint8_t slice, Ptr<const Packet> p);
+    /**
+     * PDCP TxPDU trace sink.
+     * \param dir 0 for DL, 1 for UL.
+     * \param slice The slice index.
+     * \param rnti The RNTI.
+     * \param lcid The LCID.
+     * \param size The PDU size.
+     */
+    void PdcpTx(uint8_t dir, uint8_t slice, uint16_t rnti, uint8_t lcid, uint32_t size);
+    /**
+     * PDCP RxPDU trace sink.
+     * \param dir 0 for DL, 1 for UL.
+     * \param slice The slice index.
+     * \param rnti The RNTI.
+     * \param lcid The LCID.
+     * \param size The PDU size.
+     * \param delay The delay in ns.
+     */
+    void PdcpRx(uint8_t dir,
+                uint8_t slice,
+                uint16_t rnti,
+                uint8_t lcid,
+                uint32_t size,
+                uint64_t delay);
+    /**
+     * RxPacketTraceUe/Enb trace sink.
+     * \param dir 0 for DL, 1 for UL.
+     * \param params The reception.
+     */
+    void RxPacket(uint8_t dir, RxPacketTraceParams params);
+    /**
+     * CongState trace sink of a TCP socket.
+     * \param slice The slice index.
+     * \param oldState The previous state.
+     * \param newState The new state.
+     */
+    void CongState(uint8_t slice,
+                   TcpSocketState::TcpCongState_t oldState,
+                   TcpSocketState::TcpCongState_t newState);
+
+    uint8_t m_maxRv;                      //!< Last redundancy version of a HARQ process.
+    Ptr<SliceUeRegistry> m_registry;      //!< UEs and their slices.
+    std::vector<Counters> m_counters[2];  //!< Counters per direction and slice.
+    std::vector<uint64_t> m_deadlineNs;   //!< Delay budget per slice, 0 if none.
+    std::set<Ptr<Socket>> m_tcpSockets;   //!< TCP sockets already connected.
+    std::vector<std::vector<Counters>> m_marks[2]; //!< Counters at each Mark().
+};
+
+inline SliceDropCounters::SliceDropCounters()
+    : m_maxRv(3)
+{
+}
+
+inline SliceDropCounters::~SliceDropCounters()
+{
+}
+
+/* static */
+inline TypeId
+SliceDropCounters::GetTypeId()
+{
+    static TypeId tid =
+        TypeId("SliceDropCounters")
+            .SetParent<Object>()
+            .SetGroupName("Tutorial")
+            .AddConstructor<SliceDropCounters>()
+            .AddAttribute("MaxRv",
+                          "Redundancy version of the last HARQ transmission; a corrupt "
+                          "transport block at this version is a HARQ failure",
+                          UintegerValue(3),
+                          MakeUintegerAccessor(&SliceDropCounters::m_maxRv),
+                          MakeUintegerChecker<uint8_t>());
+    return tid;
+}
+
+/* static */
+inline const char*
+SliceDropCounters::GetCauseName(uint8_t cause)
+{
+    static const char* names[] = {"RlcOverflow",
+                                  "HarqFailure",
+                                  "PdcpLostTotal",
+                                  "DeadlineExpired",
+                                  "TcpRto"};
+    return cause < DROP_NUM_CAUSES ? names[cause] : "Unknown";
+}
+
+inline void
+SliceDropCounters::SetRegistry(Ptr<SliceUeRegistry> registry)
+{
+    m_registry = registry;
+    for (auto& counters : m_counters)
+    {
+        counters.resize(registry->GetNumSlices());
+    }
+    m_deadlineNs.resize(registry->GetNumSlices(), 0);
+}
+
+inline void
+SliceDropCounters::SetDeadline(uint8_t slice, Time deadline)
+{
+    NS_ABORT_MSG_IF(slice >= m_deadlineNs.size(), "Unknown slice " << +slice);
+    m_deadlineNs[slice] = deadline.GetNanoSeconds();
+}
+
+inline SliceDropCounters::Counters&
+SliceDropCounters::At(uint8_t dir, uint8_t slice)
+{
+    return m_counters[dir][slice];
+}
+
+inline void
+SliceDropCounters::Connect()
+{
+    NS_ABORT_MSG_IF(!m_registry, "No UE registry");
+    m_registry->Resolve();
+    std::set<Ptr<NrGnbNetDevice>> gnbs;
+    for (const auto& ue : m_registry->GetUes())
+    {
+        // the bearers of the UE on both sides, so the slice is bound once here
+        std::ostringstream gnbDrb;
+        gnbDrb << "/NodeList/*/DeviceList/*/LteEnbRrc/UeMap/" << ue.rnti
+               << "/DataRadioBearerMap/*/";
+        std::ostringstream ueDrb;
+        ueDrb << "/NodeList/" << ue.dev->GetNode()->GetId()
+              << "/DeviceList/*/LteUeRrc/DataRadioBearerMap/*/";
+        for (uint8_t dir = 0; dir < 2; ++dir)
+        {
+            std::string tx = dir == 0 ? gnbDrb.str() : ueDrb.str();
+            std::string rx = dir == 0 ? ueDrb.str() : gnbDrb.str();
+            Config::ConnectWithoutContext(
+                tx + "LteRlc/TxDrop",
+                MakeCallback(&SliceDropCounters::RlcTxDrop, this).Bind(dir, ue.slice));
+            Config::ConnectWithoutContext(
+                tx + "LtePdcp/TxPDU",
+                MakeCallback(&SliceDropCounters::PdcpTx, this).Bind(dir, ue.slice));
+            Config::ConnectWithoutContext(
+                rx + "LtePdcp/RxPDU",
+                MakeCallback(&SliceDropCounters::PdcpRx, this).Bind(dir, ue.slice));
+        }
+        for (uint32_t bwp = 0; bwp < ue.dev->GetCcMapSize(); ++bwp)
+        {
+            NrHelper::GetUePhy(ue.dev, bwp)->GetSpectrumPhy()->TraceConnectWithoutContext(
+                "RxPacketTraceUe",
+                MakeCallback(&SliceDropCounters::RxPacket, this).Bind(uint8_t(0)));
+        }
+        gnbs.insert(ue.dev->GetTargetEnb());
+    }
+    for (const auto& gnb : gnbs)
+    {
+        for (uint32_t bwp = 0; bwp < gnb->GetCcMapSize(); ++bwp)
+        {
+            NrHelper::GetGnbPhy(gnb, bwp)->GetSpectrumPhy()->TraceConnectWithoutContext(
+                "RxPacketTraceEnb",
+                MakeCallback(&SliceDropCounters::RxPacket, this).Bind(uint8_t(1)));
+        }
+    }
+}
+
+inline void
+SliceDropCounters::ConnectTcp()
+{
+    Config::MatchContainer sockets =
+        Config::LookupMatches("/NodeList/*/$ns3::TcpL4Protocol/SocketList/*");
+    for (auto it = sockets.Begin(); it != sockets.End(); ++it)
+    {
+        Ptr<TcpSocketBase> socket = DynamicCast<TcpSocketBase>(*it);
+        Address peer;
+        if (!socket || m_tcpSockets.count(socket) > 0 || socket->GetPeerName(peer) != 0 ||
+            !InetSocketAddress::IsMatchingType(peer))
+        {
+            continue;
+        }
+        uint8_t slice =
+            m_registry->GetSliceOfAddress(InetSocketAddress::ConvertFrom(peer).GetIpv4());
+        if (slice == UINT8_MAX)
+        {
+            continue;
+        }
+        socket->TraceConnectWithoutContext(
+            "CongState",
+            MakeCallback(&SliceDropCounters::CongState, this).Bind(slice));
+        m_tcpSockets.insert(socket);
+    }
+}
+
+inline void
+SliceDropCounters::Mark()
+{
+    for (uint8_t dir = 0; dir < 2; ++dir)
+    {
+        m_marks[dir].push_back(m_counters[dir]);
+    }
+}
+
+inline void
+SliceDropCounters::Truncate(std::size_t mark)
+{
+    for (uint8_t dir = 0; dir < 2; ++dir)
+    {
+        NS_ABORT_MSG_IF(mark >= m_marks[dir].size(), "Unknown mark " << mark);
+        for (std::size_t slice = 0; slice < m_counters[dir].size(); ++slice)
+        {
+            Counters& c = m_counters[dir][slice];
+            const Counters& earlier = m_marks[dir][mark][slice];
+            for (uint8_t cause = 0; cause < DROP_NUM_CAUSES; ++cause)
+            {
+                c.drops[cause] -= earlier.drops[cause];
+            }
+            c.pdcpTx -= earlier.pdcpTx;
+            c.pdcpRx -= earlier.pdcpRx;
+            c.pdcpDelaySumNs -= earlier.pdcpDelaySumNs;
+            for (uint32_t bin = 0; bin < NUM_DELAY_BINS; ++bin)
+            {
+                c.delayBins[bin] -= earlier.delayBins[bin];
+            }
+        }
+        m_marks[dir].clear();
+    }
+}
+
+inline uint64_t
+SliceDropCounters::Get(uint8_t dir, uint8_t slice, uint8_t cause) const
+{
+    const Counters& c = m_counters[dir].at(slice);
+    if (cause == DROP_PDCP_LOST_TOTAL)
+    {
+        return c.pdcpTx - std::min(c.pdcpTx, c.pdcpRx);
+    }
+    return c.drops.at(cause);
+}
+
+inline void
+SliceDropCounters::Print(std::ostream& os, uint8_t dir, uint8_t slice) const
+{
+    bool first = true;
+    for (uint8_t cause = 0; cause < DROP_NUM_CAUSES; ++cause)
+    {
+        if (cause != DROP_PDCP_LOST_TOTAL)
+        {
+            os << (first ? "" : ", ") << GetCauseName(cause) << " " << Get(dir, slice, cause);
+            first = false;
+        }
+    }
+    os << "; " << GetCauseName(DROP_PDCP_LOST_TOTAL) << " "
+       << Get(dir, slice, DROP_PDCP_LOST_TOTAL);
+}
+
+inline void
+SliceDropCounters::PrintLatency(std::ostream& os, uint8_t dir, uint8_t slice) const
+{
+    const Counters& c = m_counters[dir].at(slice);
+    if (c.pdcpRx == 0)
+    {
+        os << "no PDU";
+        return;
+    }
+    // the upper edge of the bin of a quantile, the highest delay in the open bin
+    auto quantile = [&c](double q) {
+        uint64_t target = std::ceil(q * c.pdcpRx);
+        uint64_t count = 0;
+        for (uint32_t bin = 0; bin < NUM_DELAY_BINS - 1; ++bin)
+        {
+            count += c.delayBins[bin];
+            if (count >= target)
+            {
+                return std::min((bin + 1) * DELAY_BIN_NS, c.pdcpDelayMaxNs) / 1e6;
+            }
+        }
+        return c.pdcpDelayMaxNs / 1e6;
+    };
+    os << "mean " << c.pdcpDelaySumNs / 1e6 / c.pdcpRx << " ms, p50 " << quantile(0.5)
+       << " ms, p99 " << quantile(0.99) << " ms, p99.9 " << quantile(0.999) << " ms, max "
+       << c.pdcpDelayMaxNs / 1e6 << " ms";
+}
+
+inline void
+SliceDropCounters::RlcTxDrop(uint8_t dir, uint8_t slice, Ptr<const Packet> /* p */)
+{
+    ++At(dir, slice).drops[DROP_RLC_OVERFLOW];
+}
+
+inline void
+SliceDropCounters::PdcpTx(uint8_t dir,
+                          uint8_t slice,
+                          uint16_t /* rnti */,
+                          uint8_t /* lcid */,
+                          uint32_t /* size */)
+{
+    ++At(dir, slice).pdcpTx;
+}
+
+inline void
+SliceDropCounters::PdcpRx(uint8_t dir,
+                          uint8_t slice,
+                          uint16_t /* rnti */,
+                          uint8_t /* lcid */,
+                          uint32_t /* size */,
+                          uint64_t delay)
+{
+    Counters& c = At(dir, slice);
+    ++c.pdcpRx;
+    c.pdcpDelaySumNs += delay;
+    c.pdcpDelayMaxNs = std::max(c.pdcpDelayMaxNs, delay);
+    ++c.delayBins[std::min<uint64_t>(delay / DELAY_BIN_NS, NUM_DELAY_BINS - 1)];
+    if (m_deadlineNs[slice] > 0 && delay > m_deadlineNs[slice])
+    {
+        ++c.drops[DROP_DEADLINE];
+    }
+}
+
+inline void
+SliceDropCounters::RxPacket(uint8_t dir, RxPacketTraceParams params)
+{
+    uint8_t slice = m_registry->GetSliceOfRnti(params.m_rnti);
+    if (slice != UINT8_MAX && params.m_corrupt && params.m_rv >= m_maxRv)
+    {
+        ++At(dir, slice).drops[DROP_HARQ_FAILURE];
+    }
+}
+
+inline void
+SliceDropCounters::CongState(uint8_t slice,
+                             TcpSocketState::TcpCongState_t oldState,
+                             TcpSocketState::TcpCongState_t newState)
+{
+    if (newState == TcpSocketState::CA_LOSS && oldState != TcpSocketState::CA_LOSS)
+    {
+        ++At(0, slice).drops[DROP_TCP_RTO];
+    }
+}
+
+} // namespace ns3
+
+#endif /* SLICING_DROP_COUNTERS_H */
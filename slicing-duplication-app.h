@@ -0,0 +1,634 @@
+#ifndef SLICING_DUPLICATION_APP_H
+#define SLICING_DUPLICATION_APP_H
+
+#include "ns3/applications-module.h"
+#include "ns3/core-module.h"
+#include "ns3/internet-module.h"
+#include "ns3/network-module.h"
+#include "ns3/nr-module.h"
+
+#include "slicing-ue-registry.h"
+
+#include <algorithm>
+#include <ostream>
+#include <vector>
+
+namespace ns3
+{
+
+/**
+ * Frame-based source that sends every packet over each of its legs.
+ *
+ * Each leg is a UDP socket towards a port of the same UE whose packet filter
+ * maps to a bearer on a different component carrier, as for CaSplitApp, but
+ * every packet goes over all the legs instead of one: the copies then see
+ * independent channels, schedulers and HARQ processes. Every packet carries a
+ * SeqTsHeader so that DuplicateDiscardSink keeps the first copy.
+ */
+class DuplicatingSource : public Application
+{
+  public:
+    DuplicatingSource();
+    ~DuplicatingSource() override;
+
+    /**
+     * Register this type.
+     * \return The TypeId.
+     */
+    static TypeId GetTypeId();
+
+    /**
+     * Setup the legs and the traffic.
+     * \param legs The destination address of each leg, the primary CC first.
+     * \param dataRate The data rate of the source in Mbps, without the copies.
+     * \param fps The frame rate of the source.
+     */
+    void Setup(std::vector<Address> legs, double dataRate, uint16_t fps);
+
+    /// \return The packets sent, each counted once.
+    uint64_t GetSent() const;
+
+    /**
+     * \param leg The leg index.
+     * \return The bytes accepted by the socket of the leg.
+     */
+    uint64_t GetTxBytes(uint32_t leg) const;
+
+  private:
+    void StartApplication() override;
+    void StopApplication() override;
+
+    /// Send a frame over every leg and schedule the next one.
+    void SendFrame();
+
+    std::vector<Address> m_legs;        //!< Destination of each leg.
+    std::vector<Ptr<Socket>> m_sockets; //!< Socket of each leg.
+    std::vector<uint64_t> m_txBytes;    //!< Bytes accepted by each leg.
+    uint64_t m_sent;                    //!< Packets sent.
+    uint32_t m_packetSize;              //!< Maximum packet size.
+    uint32_t m_frameSize;               //!< Bytes per frame.
+    Time m_frameInterval;               //!< Time between frames.
+    EventId m_sendEvent;                //!< Next frame.
+};
+
+/**
+ * Receiver of a DuplicatingSource that keeps the first copy of each packet.
+ *
+ * It listens on the port of every leg. The first copy of a sequence number
+ * is delivered: its delay from the SeqTsHeader is recorded, and it is on
+ * time within Deadline. The later copies are discarded and only counted, as
+ * their bytes are the air-interface cost of the duplication.
+ */
+class DuplicateDiscardSink : public Application
+{
+  public:
+    DuplicateDiscardSink();
+    ~DuplicateDiscardSink() override;
+
+    /**
+     * Register this type.
+     * \return The TypeId.
+     */
+    static TypeId GetTypeId();
+
+    /**
+     * Setup the ports of the legs.
+     * \param ports The local port of each leg, the primary CC first.
+     */
+    void Setup(std::vector<uint16_t> ports);
+
+    /// \return The delays of the packets delivered.
+    const std::vector<Time>& GetDelays() const;
+    /// \return The packets delivered within Deadline.
+    uint64_t GetOnTime() const;
+    /// \return The copies discarded.
+    uint64_t GetDuplicates() const;
+    /// \return The bytes of the copies discarded.
+    uint64_t GetDuplicateBytes() const;
+
+    /**
+     * \param leg The leg index.
+     * \return The packets whose first copy came over the leg.
+     */
+    uint64_t GetFirst(uint32_t leg) const;
+
+  private:
+    void StartApplication() override;
+    void StopApplication() override;
+
+    /**
+     * Deliver the first copies and discard the others.
+     * \param leg The leg of the socket.
+     * \param socket The socket.
+     */
+    void HandleRead(uint32_t leg, Ptr<Socket> socket);
+
+    Time m_deadline; //!< Delay budget of a packet.
+
+    std::vector<uint16_t> m_ports;      //!< Port of each leg.
+    std::vector<Ptr<Socket>> m_sockets; //!< Socket of each leg.
+    std::vector<bool> m_seen;           //!< True for the sequence numbers delivered.
+    std::vector<Time> m_delays;         //!< Delay of each packet delivered.
+    std::vector<uint64_t> m_first;      //!< First copies of each leg.
+    uint64_t m_onTime;                  //!< Packets within the deadline.
+    uint64_t m_duplicates;              //!< Copies discarded.
+    uint64_t m_duplicateBytes;          //!< Bytes of the copies discarded.
+};
+
+/**
+ * Print the reliability and the overhead of the duplicated flows of a slice.
+ * \param os The output stream.
+ * \param sources The DuplicatingSource applications of the slice.
+ * \param sinks The DuplicateDiscardSink applications of the slice.
+ * \param numLegs The number of legs.
+ * \param deadline The delay budget of a packet.
+ */
+void PrintDuplicationStats(std::ostream& os,
+                           const ApplicationContainer& sources,
+                           const ApplicationContainer& sinks,
+                           uint32_t numLegs,
+                           Time deadline);
+
+/**
+ * Air-interface usage of the legs of a duplicated slice.
+ *
+ * The DL grants of the UEs of the slice are counted on the BWP of each leg as
+ * RB x symbols; the TDMA schedulers give a UE all the RBs of its symbols. The
+ * share of the RB x symbols available on the BWP, from SlotDataStats, is the
+ * spectrum the leg takes from the other slices of that BWP, which the bytes
+ * sent again do not show.
+ */
+class DuplicationAirUsage : public Object
+{
+  public:
+    DuplicationAirUsage();
+    ~DuplicationAirUsage() override;
+
+    /**
+     * Register this type.
+     * \return The TypeId.
+     */
+    static TypeId GetTypeId();
+
+    /**
+     * Set the UEs and the duplicated slice.
+     * \param registry The UE registry.
+     * \param slice The duplicated slice.
+     */
+    void SetRegistry(Ptr<SliceUeRegistry> registry, uint8_t slice);
+
+    /**
+     * Count the grants of the next leg, in the order of the legs.
+     * \param phy The gNB PHY of the BWP of the leg.
+     * \param mac The gNB MAC of the BWP of the leg.
+     */
+    void ConnectLeg(Ptr<NrGnbPhy> phy, Ptr<NrGnbMac> mac);
+
+    /**
+     * Start counting, once the UEs are attached.
+     */
+    void Start();
+
+    /**
+     * Print the RB x symbols used by the slice on the BWP of each leg.
+     * \param os The output stream.
+     */
+    void Print(std::ostream& os) const;
+
+  private:
+    void DoDispose() override;
+
+    /// BWP of a leg and its counters.
+    struct Leg
+    {
+        Ptr<NrGnbPhy> phy;         //!< gNB PHY of the BWP.
+        uint64_t usedReg{0};      //!< RB x symbols granted to the slice since Start().
+        uint64_t availableReg{0}; //!< RB x symbols available on the BWP since Start().
+    };
+
+    /**
+     * DlScheduling trace sink.
+     * \param leg The leg index.
+     * \param info The grant.
+     */
+    void DlScheduling(uint32_t leg, NrSchedulingCallbackInfo info);
+    /**
+     * SlotDataStats trace sink.
+     * \param leg The leg index.
+     */
+    void SlotDataStats(uint32_t leg,
+                       const SfnSf& sfnSf,
+                       uint32_t scheduledUe,
+                       uint32_t usedReg,
+                       uint32_t usedSym,
+                       uint32_t availableRb,
+                       uint32_t availableSym,
+                       uint16_t bwpId,
+                       uint16_t cellId);
+
+    Ptr<SliceUeRegistry> m_registry; //!< UEs and their slices.
+    uint8_t m_slice;                 //!< The duplicated slice.
+    std::vector<Leg> m_legs;         //!< Legs, in order.
+    bool m_started;                  //!< True once Start() is called.
+};
+
+inline DuplicatingSource::DuplicatingSource()
+    : m_sent(0),
+      m_packetSize(1400),
+      m_frameSize(0),
+      m_frameInterval(),
+      m_sendEvent()
+{
+}
+
+inline DuplicatingSource::~DuplicatingSource()
+{
+}
+
+/* static */
+inline TypeId
+DuplicatingSource::GetTypeId()
+{
+    static TypeId tid = TypeId("DuplicatingSource")
+                            .SetParent<Application>()
+                            .SetGroupName("Tutorial")
+                            .AddConstructor<DuplicatingSource>()
+                            .AddAttribute("PacketSize",
+                                          "Maximum size of the packets a frame is cut into",
+                                          UintegerValue(1400),
+                                          MakeUintegerAccessor(&DuplicatingSource::m_packetSize),
+                                          MakeUintegerChecker<uint32_t>(13));
+    return tid;
+}
+
+inline void
+DuplicatingSource::Setup(std::vector<Address> legs, double dataRate, uint16_t fps)
+{
+    NS_ABORT_MSG_IF(legs.empty(), "At least one leg needed");
+    m_legs = legs;
+    m_txBytes.assign(legs.size(), 0);
+    m_frameSize = static_cast<uint32_t>(dataRate * 1e6 / 8 / fps);
+    m_frameInterval = Seconds(1.0 / fps);
+}
+
+inline uint64_t
+DuplicatingSource::GetSent() const
+{
+    return m_sent;
+}
+
+inline uint64_t
+DuplicatingSource::GetTxBytes(uint32_t leg) const
+{
+    return m_txBytes.at(leg);
+}
+
+inline void
+DuplicatingSource::StartApplication()
+{
+    m_sockets.clear();
+    for (const auto& leg : m_legs)
+    {
+        Ptr<Socket> socket = Socket::CreateSocket(GetNode(), UdpSocketFactory::GetTypeId());
+        socket->Bind();
+        socket->Connect(leg);
+        m_sockets.push_back(socket);
+    }
+    SendFrame();
+}
+
+inline void
+DuplicatingSource::StopApplication()
+{
+    if (m_sendEvent.IsPending())
+    {
+        Simulator::Cancel(m_sendEvent);
+    }
+
+    for (auto& socket : m_sockets)
+    {
+        socket->Close();
+    }
+    m_sockets.clear();
+}
+
+inline void
+DuplicatingSource::SendFrame()
+{
+    uint32_t remaining = m_frameSize;
+    while (remaining > 0)
+    {
+        uint32_t size = std::max(std::min(remaining, m_packetSize), 12u);
+        SeqTsHeader header;
+        header.SetSeq(m_sent++);
+        Ptr<Packet> packet = Create<Packet>(size - header.GetSerializedSize());
+        packet->AddHeader(header);
+        for (uint32_t k = 0; k < m_sockets.size(); ++k)
+        {
+            if (m_sockets[k]->Send(packet->Copy()) >= 0)
+            {
+                m_txBytes[k] += size;
+            }
+        }
+        remaining -= std::min(remaining, size);
+    }
+    m_sendEvent = Simulator::Schedule(m_frameInterval, &DuplicatingSource::SendFrame, this);
+}
+
+inline DuplicateDiscardSink::DuplicateDiscardSink()
+    : m_onTime(0),
+      m_duplicates(0),
+      m_duplicateBytes(0)
+{
+}
+
+inline DuplicateDiscardSink::~DuplicateDiscardSink()
+{
+}
+
+/* static */
+inline TypeId
+DuplicateDiscardSink::GetTypeId()
+{
+    static TypeId tid = TypeId("DuplicateDiscardSink")
+                            .SetParent<Application>()
+                            .SetGroupName("Tutorial")
+                            .AddConstructor<DuplicateDiscardSink>()
+                            .AddAttribute("Deadline",
+                                          "Delay budget of a packet",
+                                          TimeValue(MilliSeconds(5)),
+                                          MakeTimeAccessor(&DuplicateDiscardSink::m_deadline),
+                                          MakeTimeChecker());
+    return tid;
+}
+
+inline void
+DuplicateDiscardSink::Setup(std::vector<uint16_t> ports)
+{
+    NS_ABORT_MSG_IF(ports.empty(), "At least one leg needed");
+    m_ports = ports;
+    m_first.assign(ports.size(), 0);
+}
+
+inline const std::vector<Time>&
+DuplicateDiscardSink::GetDelays() const
+{
+    return m_delays;
+}
+
+inline uint64_t
+DuplicateDiscardSink::GetOnTime() const
+{
+    return m_onTime;
+}
+
+inline uint64_t
+DuplicateDiscardSink::GetDuplicates() const
+{
+    return m_duplicates;
+}
+
+inline uint64_t
+DuplicateDiscardSink::GetDuplicateBytes() const
+{
+    return m_duplicateBytes;
+}
+
+inline uint64_t
+DuplicateDiscardSink::GetFirst(uint32_t leg) const
+{
+    return m_first.at(leg);
+}
+
+inline void
+DuplicateDiscardSink::StartApplication()
+{
+    m_sockets.clear();
+    for (uint32_t k = 0; k < m_ports.size(); ++k)
+    {
+        Ptr<Socket> socket = Socket::CreateSocket(GetNode(), UdpSocketFactory::GetTypeId());
+        socket->Bind(InetSocketAddress(Ipv4Address::GetAny(), m_ports[k]));
+        socket->SetRecvCallback(MakeCallback(&DuplicateDiscardSink::HandleRead, this).Bind(k));
+        m_sockets.push_back(socket);
+    }
+}
+
+inline void
+DuplicateDiscardSink::StopApplication()
+{
+    for (auto& socket : m_sockets)
+    {
+        socket->Close();
+        socket->SetRecvCallback(MakeNullCallback<void, Ptr<Socket>>());
+    }
+    m_sockets.clear();
+}
+
+inline void
+DuplicateDiscardSink::HandleRead(uint32_t leg, Ptr<Socket> socket)
+{
+    Ptr<Packet> packet;
+    while ((packet = socket->Recv()))
+    {
+        uint32_t size = packet->GetSize();
+        SeqTsHeader header;
+        packet->RemoveHeader(header);
+        uint32_t seq = header.GetSeq();
+        if (seq < m_seen.size() && m_seen[seq])
+        {
+            ++m_duplicates;
+            m_duplicateBytes += size;
+            continue;
+        }
+        if (seq >= m_seen.size())
+        {
+            m_seen.resize(seq + 1, false);
+        }
+        m_seen[seq] = true;
+        Time delay = Simulator::Now() - header.GetTs();
+        m_delays.push_back(delay);
+        m_onTime += delay <= m_deadline;
+        ++m_first[leg];
+    }
+}
+
+inline void
+PrintDuplicationStats(std::ostream& os,
+                      const ApplicationContainer& sources,
+                      const ApplicationContainer& sinks,
+                      uint32_t numLegs,
+                      Time deadline)
+{
+    uint64_t sent = 0;
+    std::vector<uint64_t> txBytes(numLegs, 0);
+    for (uint32_t i = 0; i < sources.GetN(); ++i)
+    {
+        Ptr<DuplicatingSource> source = DynamicCast<DuplicatingSource>(sources.Get(i));
+        sent += source->GetSent();
+        for (uint32_t k = 0; k < numLegs; ++k)
+        {
+            txBytes[k] += source->GetTxBytes(k);
+        }
+    }
+    std::vector<Time> delays;
+    std::vector<uint64_t> first(numLegs, 0);
+    uint64_t onTime = 0;
+    uint64_t duplicates = 0;
+    uint64_t duplicateBytes = 0;
+    for (uint32_t i = 0; i < sinks.GetN(); ++i)
+    {
+        Ptr<DuplicateDiscardSink> sink = DynamicCast<DuplicateDiscardSink>(sinks.Get(i));
+        delays.insert(delays.end(), sink->GetDelays().begin(), sink->GetDelays().end());
+        onTime += sink->GetOnTime();
+        duplicates += sink->GetDuplicates();
+        duplicateBytes += sink->GetDuplicateBytes();
+        for (uint32_t k = 0; k < numLegs; ++k)
+        {
+            first[k] += sink->GetFirst(k);
+        }
+    }
+    std::sort(delays.begin(), delays.end());
+
+    os << "packets sent " << sent << ", delivered " << delays.size() << ", within "
+       << deadline.GetMicroSeconds() / 1e3 << " ms " << onTime;
+    if (sent > 0)
+    {
+        os << ", reliability " << 100. * onTime / sent << " %";
+    }
+    os << "\n";
+    if (!delays.empty())
+    {
+        auto percentile = [&delays](double p) {
+            return delays[std::min<size_t>(delays.size() - 1, p * delays.size())]
+                       .GetMicroSeconds() /
+                   1e3;
+        };
+        os << "    Delay: p50 " << percentile(0.5) << " ms, p99 " << percentile(0.99)
+           << " ms, p99.9 " << percentile(0.999) << " ms, max "
+           << delays.back().GetMicroSeconds() / 1e3 << " ms\n";
+    }
+    for (uint32_t k = 0; k < numLegs; ++k)
+    {
+        os << "    Leg " << k << ": " << txBytes[k] << " bytes sent, first copy of " << first[k]
+           << " packets\n";
+    }
+    if (numLegs > 1 && txBytes[0] > 0)
+    {
+        uint64_t copies = 0;
+        for (uint32_t k = 1; k < numLegs; ++k)
+        {
+            copies += txBytes[k];
+        }
+        os << "    Overhead: " << 100. * copies / txBytes[0] << " % of the bytes sent again, "
+           << duplicates << " copies (" << duplicateBytes << " bytes) delivered and discarded\n";
+    }
+}
+
+inline DuplicationAirUsage::DuplicationAirUsage()
+    : m_slice(0),
+      m_started(false)
+{
+}
+
+inline DuplicationAirUsage::~DuplicationAirUsage()
+{
+}
+
+/* static */
+inline TypeId
+DuplicationAirUsage::GetTypeId()
+{
+    static TypeId tid = TypeId("DuplicationAirUsage")
+                            .SetParent<Object>()
+                            .SetGroupName("Tutorial")
+                            .AddConstructor<DuplicationAirUsage>();
+    return tid;
+}
+
+inline void
+DuplicationAirUsage::SetRegistry(Ptr<SliceUeRegistry> registry, uint8_t slice)
+{
+    m_registry = registry;
+    m_slice = slice;
+}
+
+inline void
+DuplicationAirUsage::ConnectLeg(Ptr<NrGnbPhy> phy, Ptr<NrGnbMac> mac)
+{
+    uint32_t leg = m_legs.size();
+    m_legs.push_back({phy});
+    phy->TraceConnectWithoutContext(
+        "SlotDataStats",
+        MakeCallback(&DuplicationAirUsage::SlotDataStats, this).Bind(leg));
+    mac->TraceConnectWithoutContext(
+        "DlScheduling",
+        MakeCallback(&DuplicationAirUsage::DlScheduling, this).Bind(leg));
+}
+
+inline void
+DuplicationAirUsage::Start()
+{
+    NS_ABORT_MSG_IF(!m_registry, "No UE registry");
+    m_registry->Resolve();
+    for (auto& leg : m_legs)
+    {
+        leg.usedReg = 0;
+        leg.availableReg = 0;
+    }
+    m_started = true;
+}
+
+inline void
+DuplicationAirUsage::Print(std::ostream& os) const
+{
+    for (uint32_t k = 0; k < m_legs.size(); ++k)
+    {
+        const Leg& leg = m_legs[k];
+        os << "    Leg " << k << " air interface: " << leg.usedReg << " of " << leg.availableReg
+           << " RB x symbols of BWP " << leg.phy->GetBwpId();
+        if (leg.availableReg > 0)
+        {
+            os << ", " << 100. * leg.usedReg / leg.availableReg << " %";
+        }
+        os << "\n";
+    }
+}
+
+inline void
+DuplicationAirUsage::DoDispose()
+{
+    m_legs.clear();
+    m_registry = nullptr;
+    Object::DoDispose();
+}
+
+inline void
+DuplicationAirUsage::DlScheduling(uint32_t leg, NrSchedulingCallbackInfo info)
+{
+    if (m_started && m_registry->GetSliceOfRnti(info.m_rnti) == m_slice)
+    {
+        m_legs[leg].usedReg +=
+            static_cast<uint64_t>(info.m_numSym) * m_legs[leg].phy->GetRbNum();
+    }
+}
+
+inline void
+DuplicationAirUsage::SlotDataStats(uint32_t leg,
+                                   const SfnSf& /* sfnSf */,
+                                   uint32_t /* scheduledUe */,
+                                   uint32_t /* usedReg */,
+                                   uint32_t /* usedSym */,
+                                   uint32_t availableRb,
+                                   uint32_t availableSym,
+                                   uint16_t /* bwpId */,
+                                   uint16_t /* cellId */)
+{
+    if (m_started)
+    {
+        m_legs[leg].availableReg += static_cast<uint64_t>(availableRb) * availableSym;
+    }
+}
+
+} // namespace ns3
+
+#endif /* SLICING_DUPLICATION_APP_H */
@@ -0,0 +1,716 @@
+#ifndef SLICING_EDGE_OFFLOAD_H
+#define SLICING_EDGE_OFFLOAD_H
+
+#include "ns3/applications-module.h"
+#include "ns3/core-module.h"
+#include "ns3/internet-module.h"
+#include "ns3/network-module.h"
+
+#include <algorithm>
+#include <deque>
+#include <map>
+#include <ostream>
+#include <vector>
+
+namespace ns3
+{
+
+/**
+ * Header of the offload packets: a segment of a task, or its result.
+ */
+class OffloadHeader : public Header
+{
+  public:
+    OffloadHeader();
+
+    /**
+     * Register this type.
+     * \return The TypeId.
+     */
+    static TypeId GetTypeId();
+    TypeId GetInstanceTypeId() const override;
+    uint32_t GetSerializedSize() const override;
+    void Serialize(Buffer::Iterator start) const override;
+    uint32_t Deserialize(Buffer::Iterator start) override;
+    void Print(std::ostream& os) const override;
+
+    uint32_t m_taskId;      //!< Task, per client.
+    uint16_t m_segment;     //!< Segment of the task.
+    uint16_t m_numSegments; //!< Segments of the task.
+    uint8_t m_slice;        //!< Slice of the client.
+    uint32_t m_resultSize;  //!< Bytes of the result.
+};
+
+/**
+ * Edge compute server: a pool of workers behind a per-slice priority queue.
+ *
+ * A task arrives as UDP segments; once the last segment is in, the task is
+ * queued. Each of the Workers serves one task at a time for a ServiceTime
+ * drawn from its random variable, then sends the result back to the client.
+ * The queue is served by strict priority, the lowest value first and FIFO
+ * within a priority, without preemption of a task in service. Tasks that
+ * find QueueCapacity tasks waiting are dropped.
+ */
+class EdgeComputeServer : public Application
+{
+  public:
+    /// Counters of a slice.
+    struct SliceStats
+    {
+        uint64_t received = 0; //!< Tasks fully received.
+        uint64_t dropped = 0;  //!< Tasks dropped on a full queue.
+        uint64_t served = 0;   //!< Tasks served.
+        int64_t waitNs = 0;    //!< Sum of the queueing delays of the served tasks.
+        int64_t serviceNs = 0; //!< Sum of the service times of the served tasks.
+    };
+
+    EdgeComputeServer();
+    ~EdgeComputeServer() override;
+
+    /**
+     * Register this type.
+     * \return The TypeId.
+     */
+    static TypeId GetTypeId();
+
+    /**
+     * Set the priority of a slice; slices have priority 0 by default.
+     * \param slice The slice index.
+     * \param priority The priority, 0 is served first.
+     */
+    void SetPriority(uint8_t slice, uint16_t priority);
+
+    /**
+     * Assign a stream to the service time.
+     * \param stream The stream.
+     * \return The number of streams used.
+     */
+    int64_t AssignStreams(int64_t stream);
+
+    /**
+     * \param slice The slice index.
+     * \return The counters of the slice.
+     */
+    SliceStats GetSliceStats(uint8_t slice) const;
+
+    /// \return The time the workers spent serving tasks.
+    Time GetBusyTime() const;
+
+    /// \return The number of workers.
+    uint32_t GetNumWorkers() const;
+
+  private:
+    /// A task in the queue or in service.
+    struct Task
+    {
+        Address from;        //!< Client.
+        uint32_t taskId;     //!< Task, per client.
+        uint8_t slice;       //!< Slice of the client.
+        uint32_t resultSize; //!< Bytes of the result.
+        Time arrival;        //!< End of the reception.
+        Time start;          //!< Start of the service.
+    };
+
+    void StartApplication() override;
+    void StopApplication() override;
+
+    /**
+     * Reassemble the tasks.
+     * \param socket The socket.
+     */
+    void HandleRead(Ptr<Socket> socket);
+
+    /// Start tasks on the idle workers.
+    void Dispatch();
+
+    /**
+     * Send the result of a task and free its worker.
+     * \param task The task.
+     */
+    void Finish(Task task);
+
+    uint16_t m_port;                         //!< Port of the server.
+    uint32_t m_workers;                      //!< Number of workers.
+    uint32_t m_queueCapacity;                //!< Tasks the queue holds.
+    Ptr<RandomVariableStream> m_serviceTime; //!< Service time in seconds.
+
+    Ptr<Socket> m_socket;                          //!< Socket.
+    //! Task being received from each client, and its segments received.
+    std::map<uint64_t, std::pair<uint32_t, uint16_t>> m_partial;
+    std::map<uint16_t, std::deque<Task>> m_queues; //!< Queue of each priority.
+    uint32_t m_queued;                             //!< Tasks in the queues.
+    uint32_t m_busy;                               //!< Workers serving a task.
+    std::vector<uint16_t> m_priority;              //!< Priority of each slice.
+    std::vector<SliceStats> m_stats;               //!< Counters of each slice.
+    Time m_busyTime;                               //!< Sum of the service times.
+};
+
+/**
+ * Closed-loop offload client of a UE.
+ *
+ * Every Period the client has a task, e.g. a sensor frame. It sends the
+ * task as TaskSize bytes in PacketSize segments to the server if fewer
+ * than MaxOutstanding tasks wait for a result, and skips it otherwise, so
+ * the offered load adapts to the round trip. The round trip of a task runs
+ * from its first segment to its result; a result later than Deadline is
+ * late, and a task with no result after Timeout is lost.
+ */
+class OffloadClient : public Application
+{
+  public:
+    OffloadClient();
+    ~OffloadClient() override;
+
+    /**
+     * Register this type.
+     * \return The TypeId.
+     */
+    static TypeId GetTypeId();
+
+    /**
+     * Setup the server and the slice.
+     * \param server The address and port of the server.
+     * \param slice The slice of the UE.
+     */
+    void Setup(Address server, uint8_t slice);
+
+    /// \return The round trips of the completed tasks.
+    const std::vector<Time>& GetRoundTrips() const;
+    /// \return The tasks sent.
+    uint64_t GetSent() const;
+    /// \return The tasks skipped because too many were outstanding.
+    uint64_t GetSkipped() const;
+    /// \return The tasks with no result after Timeout.
+    uint64_t GetLost() const;
+    /// \return The completed tasks later than Deadline.
+    uint64_t GetLate() const;
+
+  private:
+    void StartApplication() override;
+    void StopApplication() override;
+
+    /// Send a task, or skip it, and schedule the next one.
+    void SendTask();
+
+    /**
+     * Collect the results.
+     * \param socket The socket.
+     */
+    void HandleRead(Ptr<Socket> socket);
+
+    uint16_t m_port;           //!< Local port, for the packet filters of the bearer.
+    Time m_period;             //!< Time between tasks.
+    uint32_t m_taskSize;       //!< Bytes of a task.
+    uint32_t m_resultSize;     //!< Bytes of a result.
+    uint32_t m_packetSize;     //!< Bytes of a segment.
+    uint32_t m_maxOutstanding; //!< Tasks waiting for a result.
+    Time m_deadline;           //!< Round-trip deadline.
+    Time m_timeout;            //!< Time after which a task is lost.
+
+    Address m_server;                  //!< Server.
+    uint8_t m_slice;                   //!< Slice of the UE.
+    Ptr<Socket> m_socket;              //!< Socket.
+    EventId m_sendEvent;               //!< Next task.
+    uint32_t m_nextTaskId;             //!< Id of the next task.
+    std::map<uint32_t, Time> m_pending; //!< Send time of the outstanding tasks.
+    std::vector<Time> m_roundTrips;    //!< Round trips of the completed tasks.
+    uint64_t m_sent;                   //!< Tasks sent.
+    uint64_t m_skipped;                //!< Tasks skipped.
+    uint64_t m_lost;                   //!< Tasks lost.
+    uint64_t m_late;                   //!< Tasks late.
+};
+
+/**
+ * Print the offload statistics of the clients of a slice.
+ * \param os The output stream.
+ * \param clients The OffloadClient applications of the slice.
+ * \param stats The server counters of the slice.
+ */
+void PrintOffloadStats(std::ostream& os,
+                       const ApplicationContainer& clients,
+                       const EdgeComputeServer::SliceStats& stats);
+
+inline OffloadHeader::OffloadHeader()
+    : m_taskId(0),
+      m_segment(0),
+      m_numSegments(1),
+      m_slice(0),
+      m_resultSize(0)
+{
+}
+
+/* static */
+inline TypeId
+OffloadHeader::GetTypeId()
+{
+    static TypeId tid = TypeId("OffloadHeader")
+                            .SetParent<Header>()
+                            .SetGroupName("Tutorial")
+                            .AddConstructor<OffloadHeader>();
+    return tid;
+}
+
+inline TypeId
+OffloadHeader::GetInstanceTypeId() const
+{
+    return GetTypeId();
+}
+
+inline uint32_t
+OffloadHeader::GetSerializedSize() const
+{
+    return 13;
+}
+
+inline void
+OffloadHeader::Serialize(Buffer::Iterator start) const
+{
+    start.WriteHtonU32(m_taskId);
+    start.WriteHtonU16(m_segment);
+    start.WriteHtonU16(m_numSegments);
+    start.WriteU8(m_slice);
+    start.WriteHtonU32(m_resultSize);
+}
+
+inline uint32_t
+OffloadHeader::Deserialize(Buffer::Iterator start)
+{
+    m_taskId = start.ReadNtohU32();
+    m_segment = start.ReadNtohU16();
+    m_numSegments = start.ReadNtohU16();
+    m_slice = start.ReadU8();
+    m_resultSize = start.ReadNtohU32();
+    return GetSerializedSize();
+}
+
+inline void
+OffloadHeader::Print(std::ostream& os) const
+{
+    os << "task=" << m_taskId << " segment=" << m_segment << "/" << m_numSegments
+       << " slice=" << +m_slice << " result=" << m_resultSize;
+}
+
+inline EdgeComputeServer::EdgeComputeServer()
+    : m_port(0),
+      m_workers(1),
+      m_queueCapacity(1000),
+      m_queued(0),
+      m_busy(0)
+{
+}
+
+inline EdgeComputeServer::~EdgeComputeServer()
+{
+}
+
+/* static */
+inline TypeId
+EdgeComputeServer::GetTypeId()
+{
+    static TypeId tid =
+        TypeId("EdgeComputeServer")
+            .SetParent<Application>()
+            .SetGroupName("Tutorial")
+            .AddConstructor<EdgeComputeServer>()
+            .AddAttribute("Port",
+                          "Port of the server",
+                          UintegerValue(0),
+                          MakeUintegerAccessor(&EdgeComputeServer::m_port),
+                          MakeUintegerChecker<uint16_t>())
+            .AddAttribute("Workers",
+                          "Number of tasks served in parallel",
+                          UintegerValue(1),
+                          MakeUintegerAccessor(&EdgeComputeServer::m_workers),
+                          MakeUintegerChecker<uint32_t>(1))
+            .AddAttribute("QueueCapacity",
+                          "Number of tasks the queue holds",
+                          UintegerValue(1000),
+                          MakeUintegerAccessor(&EdgeComputeServer::m_queueCapacity),
+                          MakeUintegerChecker<uint32_t>())
+            .AddAttribute("ServiceTime",
+                          "Service time of a task in seconds",
+                          StringValue("ns3::ExponentialRandomVariable[Mean=0.01]"),
+                          MakePointerAccessor(&EdgeComputeServer::m_serviceTime),
+                          MakePointerChecker<RandomVariableStream>());
+    return tid;
+}
+
+inline void
+EdgeComputeServer::SetPriority(uint8_t slice, uint16_t priority)
+{
+    if (m_priority.size() <= slice)
+    {
+        m_priority.resize(slice + 1, 0);
+    }
+    m_priority[slice] = priority;
+}
+
+inline int64_t
+EdgeComputeServer::AssignStreams(int64_t stream)
+{
+    m_serviceTime->SetStream(stream);
+    return 1;
+}
+
+inline EdgeComputeServer::SliceStats
+EdgeComputeServer::GetSliceStats(uint8_t slice) const
+{
+    return slice < m_stats.size() ? m_stats[slice] : SliceStats();
+}
+
+inline Time
+EdgeComputeServer::GetBusyTime() const
+{
+    return m_busyTime;
+}
+
+inline uint32_t
+EdgeComputeServer::GetNumWorkers() const
+{
+    return m_workers;
+}
+
+inline void
+EdgeComputeServer::StartApplication()
+{
+    m_socket = Socket::CreateSocket(GetNode(), UdpSocketFactory::GetTypeId());
+    m_socket->Bind(InetSocketAddress(Ipv4Address::GetAny(), m_port));
+    m_socket->SetRecvCallback(MakeCallback(&EdgeComputeServer::HandleRead, this));
+}
+
+inline void
+EdgeComputeServer::StopApplication()
+{
+    if (m_socket)
+    {
+        m_socket->Close();
+        m_socket->SetRecvCallback(MakeNullCallback<void, Ptr<Socket>>());
+    }
+}
+
+inline void
+EdgeComputeServer::HandleRead(Ptr<Socket> socket)
+{
+    Ptr<Packet> packet;
+    Address from;
+    while ((packet = socket->RecvFrom(from)))
+    {
+        OffloadHeader header;
+        packet->RemoveHeader(header);
+        InetSocketAddress inet = InetSocketAddress::ConvertFrom(from);
+        uint64_t client = (static_cast<uint64_t>(inet.GetIpv4().Get()) << 16) | inet.GetPort();
+        // the segments of a task follow each other: a newer task abandons an incomplete one
+        auto& [taskId, segments] = m_partial[client];
+        if (taskId != header.m_taskId || segments == 0)
+        {
+            taskId = header.m_taskId;
+            segments = 0;
+        }
+        if (++segments < header.m_numSegments)
+        {
+            continue;
+        }
+        segments = 0;
+
+        if (m_stats.size() <= header.m_slice)
+        {
+            m_stats.resize(header.m_slice + 1);
+        }
+        SliceStats& stats = m_stats[header.m_slice];
+        ++stats.received;
+        if (m_queued >= m_queueCapacity)
+        {
+            ++stats.dropped;
+            continue;
+        }
+        uint16_t priority = header.m_slice < m_priority.size() ? m_priority[header.m_slice] : 0;
+        m_queues[priority].push_back(
+            {from, header.m_taskId, header.m_slice, header.m_resultSize, Simulator::Now()});
+        ++m_queued;
+    }
+    Dispatch();
+}
+
+inline void
+EdgeComputeServer::Dispatch()
+{
+    while (m_busy < m_workers && m_queued > 0)
+    {
+        auto it = std::find_if(m_queues.begin(), m_queues.end(), [](const auto& q) {
+            return !q.second.empty();
+        });
+        Task task = it->second.front();
+        it->second.pop_front();
+        --m_queued;
+        ++m_busy;
+        task.start = Simulator::Now();
+        Time service = Seconds(std::max(0., m_serviceTime->GetValue()));
+        Simulator::Schedule(service, &EdgeComputeServer::Finish, this, task);
+    }
+}
+
+inline void
+EdgeComputeServer::Finish(Task task)
+{
+    --m_busy;
+    Time service = Simulator::Now() - task.start;
+    SliceStats& stats = m_stats[task.slice];
+    ++stats.served;
+    stats.waitNs += (task.start - task.arrival).GetNanoSeconds();
+    stats.serviceNs += service.GetNanoSeconds();
+    m_busyTime += service;
+    if (m_socket)
+    {
+        OffloadHeader header;
+        header.m_taskId = task.taskId;
+        header.m_slice = task.slice;
+        header.m_resultSize = task.resultSize;
+        uint32_t size = std::max(task.resultSize, header.GetSerializedSize());
+        Ptr<Packet> packet = Create<Packet>(size - header.GetSerializedSize());
+        packet->AddHeader(header);
+        m_socket->SendTo(packet, 0, task.from);
+    }
+    Dispatch();
+}
+
+inline OffloadClient::OffloadClient()
+    : m_port(0),
+      m_taskSize(60000),
+      m_resultSize(200),
+      m_packetSize(1400),
+      m_maxOutstanding(1),
+      m_slice(0),
+      m_nextTaskId(0),
+      m_sent(0),
+      m_skipped(0),
+      m_lost(0),
+      m_late(0)
+{
+}
+
+inline OffloadClient::~OffloadClient()
+{
+}
+
+/* static */
+inline TypeId
+OffloadClient::GetTypeId()
+{
+    static TypeId tid =
+        TypeId("OffloadClient")
+            .SetParent<Application>()
+            .SetGroupName("Tutorial")
+            .AddConstructor<OffloadClient>()
+            .AddAttribute("Port",
+                          "Local port of the client",
+                          UintegerValue(0),
+                          MakeUintegerAccessor(&OffloadClient::m_port),
+                          MakeUintegerChecker<uint16_t>())
+            .AddAttribute("Period",
+                          "Time between tasks",
+                          TimeValue(MilliSeconds(100)),
+                          MakeTimeAccessor(&OffloadClient::m_period),
+                          MakeTimeChecker())
+            .AddAttribute("TaskSize",
+                          "Bytes sent to the server per task",
+                          UintegerValue(60000),
+                          MakeUintegerAccessor(&OffloadClient::m_taskSize),
+                          MakeUintegerChecker<uint32_t>(1))
+            .AddAttribute("ResultSize",
+                          "Bytes of the result of a task",
+                          UintegerValue(200),
+                          MakeUintegerAccessor(&OffloadClient::m_resultSize),
+                          MakeUintegerChecker<uint32_t>())
+            .AddAttribute("PacketSize",
+                          "Bytes of a segment of a task, header included",
+                          UintegerValue(1400),
+                          MakeUintegerAccessor(&OffloadClient::m_packetSize),
+                          MakeUintegerChecker<uint32_t>(64))
+            .AddAttribute("MaxOutstanding",
+                          "Tasks waiting for a result before new tasks are skipped",
+                          UintegerValue(1),
+                          MakeUintegerAccessor(&OffloadClient::m_maxOutstanding),
+                          MakeUintegerChecker<uint32_t>(1))
+            .AddAttribute("Deadline",
+                          "Round trip after which a result is late",
+                          TimeValue(MilliSeconds(100)),
+                          MakeTimeAccessor(&OffloadClient::m_deadline),
+                          MakeTimeChecker())
+            .AddAttribute("Timeout",
+                          "Time after which a task with no result is lost",
+                          TimeValue(Seconds(1)),
+                          MakeTimeAccessor(&OffloadClient::m_timeout),
+                          MakeTimeChecker());
+    return tid;
+}
+
+inline void
+OffloadClient::Setup(Address server, uint8_t slice)
+{
+    m_server = server;
+    m_slice = slice;
+}
+
+inline const std::vector<Time>&
+OffloadClient::GetRoundTrips() const
+{
+    return m_roundTrips;
+}
+
+inline uint64_t
+OffloadClient::GetSent() const
+{
+    return m_sent;
+}
+
+inline uint64_t
+OffloadClient::GetSkipped() const
+{
+    return m_skipped;
+}
+
+inline uint64_t
+OffloadClient::GetLost() const
+{
+    return m_lost;
+}
+
+inline uint64_t
+OffloadClient::GetLate() const
+{
+    return m_late;
+}
+
+inline void
+OffloadClient::StartApplication()
+{
+    m_socket = Socket::CreateSocket(GetNode(), UdpSocketFactory::GetTypeId());
+    m_socket->Bind(InetSocketAddress(Ipv4Address::GetAny(), m_port));
+    m_socket->Connect(m_server);
+    m_socket->SetRecvCallback(MakeCallback(&OffloadClient::HandleRead, this));
+    SendTask();
+}
+
+inline void
+OffloadClient::StopApplication()
+{
+    if (m_sendEvent.IsPending())
+    {
+        Simulator::Cancel(m_sendEvent);
+    }
+    if (m_socket)
+    {
+        m_socket->Close();
+        m_socket->SetRecvCallback(MakeNullCallback<void, Ptr<Socket>>());
+    }
+}
+
+inline void
+OffloadClient::SendTask()
+{
+    m_sendEvent = Simulator::Schedule(m_period, &OffloadClient::SendTask, this);
+    Time now = Simulator::Now();
+    for (auto it = m_pending.begin(); it != m_pending.end();)
+    {
+        if (now - it->second < m_timeout)
+        {
+            ++it;
+            continue;
+        }
+        ++m_lost;
+        it = m_pending.erase(it);
+    }
+    if (m_pending.size() >= m_maxOutstanding)
+    {
+        ++m_skipped;
+        return;
+    }
+
+    OffloadHeader header;
+    header.m_taskId = m_nextTaskId++;
+    header.m_slice = m_slice;
+    header.m_resultSize = m_resultSize;
+    uint32_t payload = m_packetSize - header.GetSerializedSize();
+    header.m_numSegments = (m_taskSize + payload - 1) / payload;
+    uint32_t remaining = m_taskSize;
+    for (header.m_segment = 0; header.m_segment < header.m_numSegments; ++header.m_segment)
+    {
+        Ptr<Packet> packet = Create<Packet>(std::min(remaining, payload));
+        packet->AddHeader(header);
+        m_socket->Send(packet);
+        remaining -= std::min(remaining, payload);
+    }
+    m_pending[header.m_taskId] = now;
+    ++m_sent;
+}
+
+inline void
+OffloadClient::HandleRead(Ptr<Socket> socket)
+{
+    Ptr<Packet> packet;
+    while ((packet = socket->Recv()))
+    {
+        OffloadHeader header;
+        packet->RemoveHeader(header);
+        auto it = m_pending.find(header.m_taskId);
+        if (it == m_pending.end())
+        {
+            // already counted as lost
+            continue;
+        }
+        Time rtt = Simulator::Now() - it->second;
+        m_pending.erase(it);
+        m_roundTrips.push_back(rtt);
+        m_late += rtt > m_deadline;
+    }
+}
+
+inline void
+PrintOffloadStats(std::ostream& os,
+                  const ApplicationContainer& clients,
+                  const EdgeComputeServer::SliceStats& stats)
+{
+    std::vector<Time> rtts;
+    uint64_t sent = 0;
+    uint64_t skipped = 0;
+    uint64_t lost = 0;
+    uint64_t late = 0;
+    for (uint32_t i = 0; i < clients.GetN(); ++i)
+    {
+        Ptr<OffloadClient> client = DynamicCast<OffloadClient>(clients.Get(i));
+        rtts.insert(rtts.end(), client->GetRoundTrips().begin(), client->GetRoundTrips().end());
+        sent += client->GetSent();
+        skipped += client->GetSkipped();
+        lost += client->GetLost();
+        late += client->GetLate();
+    }
+    std::sort(rtts.begin(), rtts.end());
+    os << "tasks sent " << sent << ", skipped " << skipped << ", completed " << rtts.size()
+       << ", lost " << lost << ", late " << late;
+    if (!rtts.empty())
+    {
+        auto percentile = [&rtts](double p) {
+            return rtts[std::min<size_t>(rtts.size() - 1, p * rtts.size())].GetMicroSeconds() /
+                   1e3;
+        };
+        os << ", on time " << 100. * (rtts.size() - late) / sent << " %\n"
+           << "    Round trip: p50 " << percentile(0.5) << " ms, p95 " << percentile(0.95)
+           << " ms, p99 " << percentile(0.99) << " ms, max " << rtts.back().GetMicroSeconds() / 1e3
+           << " ms\n";
+    }
+    else
+    {
+        os << "\n";
+    }
+    os << "    Server: " << stats.received << " received, " << stats.dropped << " dropped";
+    if (stats.served > 0)
+    {
+        os << ", mean wait " << stats.waitNs / 1e6 / stats.served << " ms, mean service "
+           << stats.serviceNs / 1e6 / stats.served << " ms";
+    }
+    os << "\n";
+}
+
+} // namespace ns3
+
+#endif /* SLICING_EDGE_OFFLOAD_H */
@@ -0,0 +1,484 @@
+#ifndef SLICING_EVENT_LOG_H
+#define SLICING_EVENT_LOG_H
+
+#include "ns3/applications-module.h"
+#include "ns3/core-module.h"
+#include "ns3/lte-module.h"
+#include "ns3/network-module.h"
+#include "ns3/nr-module.h"
+
+#include <cstdio>
+#include <cstring>
+#include <mutex>
+#include <string>
+#include <vector>
+
+/*
+ * Levels of the structured event log. Events above SLICING_EVENT_LOG_LEVEL
+ * are removed at compile time, arguments included. The default keeps every
+ * level in builds with NS-3 logging (debug, default) and none in optimized
+ * builds; define SLICING_EVENT_LOG_LEVEL to override it.
+ */
+#define SLICING_EVENT_ERROR 1
+#define SLICING_EVENT_WARN 2
+#define SLICING_EVENT_INFO 3
+#define SLICING_EVENT_DEBUG 4
+
+#ifndef SLICING_EVENT_LOG_LEVEL
+#ifdef NS3_LOG_ENABLE
+#define SLICING_EVENT_LOG_LEVEL SLICING_EVENT_DEBUG
+#else
+#define SLICING_EVENT_LOG_LEVEL 0
+#endif
+#endif
+
+/**
+ * Log an event if its level is compiled in and the log is open.
+ * \param level The level, e.g. SLICING_EVENT_INFO.
+ * \param event The event id, a SliceEventId.
+ * \param node The node id.
+ * \param slice The slice index, UINT8_MAX if unknown.
+ * \param f0 First integer field.
+ * \param f1 Second integer field.
+ * \param f2 Floating-point field.
+ */
+#define SLICING_EVENT(level, event, node, slice, f0, f1, f2)                                      \
+    do                                                                                             \
+    {                                                                                              \
+        if constexpr ((level) <= SLICING_EVENT_LOG_LEVEL)                                          \
+        {                                                                                          \
+            if (ns3::SliceEventLog::IsEnabled())                                                   \
+            {                                                                                      \
+                ns3::SliceEventLog::Write(level, event, node, slice, f0, f1, f2);                  \
+            }                                                                                      \
+        }                                                                                          \
+    } while (false)
+
+namespace ns3
+{
+
+/// Events of the structured log; the meaning of the fields is given per event.
+enum SliceEventId : uint16_t
+{
+    EVENT_APP_TX = 1, //!< Application sends a packet: f0 packet uid, f1 size.
+    EVENT_APP_RX,     //!< Application receives a packet: f0 packet uid, f1 size.
+    EVENT_PDCP_DL_TX, //!< gNB PDCP sends a PDU: f0 rnti | lcid << 16, f1 size.
+    EVENT_PDCP_DL_RX, //!< UE PDCP receives a PDU: f0 rnti | lcid << 16, f1 size, f2 delay in ms.
+    EVENT_PDCP_UL_TX, //!< UE PDCP sends a PDU: f0 rnti | lcid << 16, f1 size.
+    EVENT_PDCP_UL_RX, //!< gNB PDCP receives a PDU: f0 rnti | lcid << 16, f1 size, f2 delay in ms.
+};
+
+/**
+ * \param event The event id.
+ * \return The name of the event.
+ */
+inline const char*
+SliceEventName(uint16_t event)
+{
+    static const char* names[] = {"Unknown",
+                                  "AppTx",
+                                  "AppRx",
+                                  "PdcpDlTx",
+                                  "PdcpDlRx",
+                                  "PdcpUlTx",
+                                  "PdcpUlRx"};
+    return event <= EVENT_PDCP_UL_RX ? names[event] : names[0];
+}
+
+/// A binary event record.
+struct EventRecord
+{
+    int64_t timeNs;  //!< Simulation time.
+    uint32_t node;   //!< Node id.
+    uint16_t event;  //!< SliceEventId.
+    uint8_t slice;   //!< Slice index, UINT8_MAX if unknown.
+    uint8_t level;   //!< Level of the event.
+    uint64_t f0;     //!< First integer field.
+    uint64_t f1;     //!< Second integer field.
+    double f2;       //!< Floating-point field.
+};
+
+static_assert(sizeof(EventRecord) == 40, "EventRecord must stay packed");
+
+/// Header of an event log file.
+struct EventLogHeader
+{
+    char magic[8];       //!< "NREVLOG".
+    uint32_t version;    //!< Format version.
+    uint32_t recordSize; //!< sizeof(EventRecord).
+};
+
+/// Magic of an event log file.
+static const char g_eventLogMagic[8] = {'N', 'R', 'E', 'V', 'L', 'O', 'G', '\0'};
+
+/**
+ * Structured, binary event log.
+ *
+ * Each thread appends EventRecords to its own buffer, which is written to
+ * the shared file under a lock only when it is full, so logging an event is
+ * a bounds check and a copy. log-decode-network-slicing.cc prints the file
+ * as text. The Connect functions hook the application and PDCP traces of a
+ * scenario; they do nothing if the log is not open or the INFO and DEBUG
+ * levels are compiled out.
+ */
+class SliceEventLog
+{
+  public:
+    /// Records per thread buffer.
+    static constexpr uint32_t BUFFER_RECORDS = 16384;
+
+    /**
+     * Open the log file.
+     * \param filename The file.
+     * \return false if the file cannot be opened.
+     */
+    static bool Open(const std::string& filename)
+    {
+        std::lock_guard<std::mutex> lock(Mutex());
+        State& s = GetState();
+        s.file = std::fopen(filename.c_str(), "wb");
+        if (!s.file)
+        {
+            return false;
+        }
+        EventLogHeader header;
+        std::memcpy(header.magic, g_eventLogMagic, sizeof(header.magic));
+        header.version = 1;
+        header.recordSize = sizeof(EventRecord);
+        std::fwrite(&header, sizeof(header), 1, s.file);
+        s.sliceOfRnti.assign(UINT16_MAX + 1, UINT8_MAX);
+        s.nodeOfRnti.assign(UINT16_MAX + 1, UINT32_MAX);
+        s.enabled = true;
+        return true;
+    }
+
+    /// Flush the buffer of the calling thread and close the file.
+    static void Close()
+    {
+        if (!IsEnabled())
+        {
+            return;
+        }
+        FlushThread();
+        std::lock_guard<std::mutex> lock(Mutex());
+        State& s = GetState();
+        s.enabled = false;
+        std::fclose(s.file);
+        s.file = nullptr;
+        s.ues.clear();
+    }
+
+    /**
+     * Close the log if open and forget the UEs and RNTIs of the scenario,
+     * so the next scenario starts from a clean state.
+     */
+    static void Reset()
+    {
+        Close();
+        std::lock_guard<std::mutex> lock(Mutex());
+        State& s = GetState();
+        s.sliceOfRnti.clear();
+        s.nodeOfRnti.clear();
+        s.ues.clear();
+        GetThreadBuffer().used = 0;
+    }
+
+    /// \return true if the log is open.
+    static bool IsEnabled()
+    {
+        return GetState().enabled;
+    }
+
+    /**
+     * Append a record to the buffer of the calling thread.
+     * \param level The level.
+     * \param event The event id.
+     * \param node The node id.
+     * \param slice The slice index.
+     * \param f0 First integer field.
+     * \param f1 Second integer field.
+     * \param f2 Floating-point field.
+     */
+    static void Write(uint8_t level,
+                      uint16_t event,
+                      uint32_t node,
+                      uint8_t slice,
+                      uint64_t f0,
+                      uint64_t f1,
+                      double f2)
+    {
+        ThreadBuffer& b = GetThreadBuffer();
+        EventRecord& r = b.records[b.used++];
+        r.timeNs = Simulator::Now().GetNanoSeconds();
+        r.node = node;
+        r.event = event;
+        r.slice = slice;
+        r.level = level;
+        r.f0 = f0;
+        r.f1 = f1;
+        r.f2 = f2;
+        if (b.used == BUFFER_RECORDS)
+        {
+            FlushThread();
+        }
+    }
+
+    /**
+     * Log the packets sent and received by applications of a slice.
+     * \param apps The applications; UdpClient, TrafficGenerator, PacketSink and
+     * UdpServer are hooked.
+     * \param slice The slice index.
+     */
+    static void ConnectApps(const ApplicationContainer& apps, uint8_t slice)
+    {
+        if constexpr (SLICING_EVENT_INFO <= SLICING_EVENT_LOG_LEVEL)
+        {
+            if (!IsEnabled())
+            {
+                return;
+            }
+            for (uint32_t i = 0; i < apps.GetN(); ++i)
+            {
+                Ptr<Application> app = apps.Get(i);
+                uint32_t node = app->GetNode()->GetId();
+                if (DynamicCast<UdpClient>(app) || DynamicCast<TrafficGenerator>(app))
+                {
+                    app->TraceConnectWithoutContext(
+                        "Tx",
+                        MakeCallback(&SliceEventLog::AppTx).Bind(node, slice));
+                }
+                else if (DynamicCast<PacketSink>(app))
+                {
+                    app->TraceConnectWithoutContext(
+                        "Rx",
+                        MakeCallback(&SliceEventLog::AppRxFrom).Bind(node, slice));
+                }
+                else if (DynamicCast<UdpServer>(app))
+                {
+                    app->TraceConnectWithoutContext(
+                        "Rx",
+                        MakeCallback(&SliceEventLog::AppRx).Bind(node, slice));
+                }
+            }
+        }
+    }
+
+    /**
+     * Log the applications of the nodes of a slice.
+     * \param nodes The nodes.
+     * \param slice The slice index.
+     */
+    static void ConnectNodes(const NodeContainer& nodes, uint8_t slice)
+    {
+        ApplicationContainer apps;
+        for (uint32_t i = 0; i < nodes.GetN(); ++i)
+        {
+            for (uint32_t a = 0; a < nodes.Get(i)->GetNApplications(); ++a)
+            {
+                apps.Add(nodes.Get(i)->GetApplication(a));
+            }
+        }
+        ConnectApps(apps, slice);
+    }
+
+    /**
+     * Assign UEs to a slice, for the PDCP events.
+     * \param slice The slice index.
+     * \param ueDevices The UE devices.
+     */
+    static void AddUes(uint8_t slice, const NetDeviceContainer& ueDevices)
+    {
+        if (!IsEnabled())
+        {
+            return;
+        }
+        for (uint32_t i = 0; i < ueDevices.GetN(); ++i)
+        {
+            GetState().ues.emplace_back(slice, ueDevices.Get(i));
+        }
+    }
+
+    /**
+     * Log the PDCP PDUs of the UEs added with AddUes(); the UEs must be
+     * attached and their bearers set up.
+     */
+    static void ConnectPdcp()
+    {
+        if constexpr (SLICING_EVENT_DEBUG <= SLICING_EVENT_LOG_LEVEL)
+        {
+            if (!IsEnabled())
+            {
+                return;
+            }
+            State& s = GetState();
+            for (const auto& [slice, dev] : s.ues)
+            {
+                Ptr<NrUeNetDevice> ue = DynamicCast<NrUeNetDevice>(dev);
+                NS_ABORT_MSG_IF(!ue, "Not a UE device");
+                uint16_t rnti = ue->GetRrc()->GetRnti();
+                s.sliceOfRnti[rnti] = slice;
+                s.nodeOfRnti[rnti] = ue->GetNode()->GetId();
+            }
+            std::string gnbPdcp =
+                "/NodeList/*/DeviceList/*/LteEnbRrc/UeMap/*/DataRadioBearerMap/*/LtePdcp/";
+            std::string uePdcp = "/NodeList/*/DeviceList/*/LteUeRrc/DataRadioBearerMap/*/LtePdcp/";
+            Config::ConnectWithoutContext(
+                gnbPdcp + "TxPDU",
+                MakeCallback(&SliceEventLog::PdcpTx).Bind(uint16_t(EVENT_PDCP_DL_TX)));
+            Config::ConnectWithoutContext(
+                uePdcp + "RxPDU",
+                MakeCallback(&SliceEventLog::PdcpRx).Bind(uint16_t(EVENT_PDCP_DL_RX)));
+            Config::ConnectWithoutContext(
+                uePdcp + "TxPDU",
+                MakeCallback(&SliceEventLog::PdcpTx).Bind(uint16_t(EVENT_PDCP_UL_TX)));
+            Config::ConnectWithoutContext(
+                gnbPdcp + "RxPDU",
+                MakeCallback(&SliceEventLog::PdcpRx).Bind(uint16_t(EVENT_PDCP_UL_RX)));
+        }
+    }
+
+  private:
+    /// Process-wide state of the log.
+    struct State
+    {
+        bool enabled{false};                 //!< True while the file is open.
+        std::FILE* file{nullptr};            //!< Log file.
+        std::vector<uint8_t> sliceOfRnti;    //!< Slice of each RNTI.
+        std::vector<uint32_t> nodeOfRnti;    //!< UE node of each RNTI.
+        std::vector<std::pair<uint8_t, Ptr<NetDevice>>> ues; //!< UEs and their slice.
+    };
+
+    /// Records of one thread, written when full or at exit.
+    struct ThreadBuffer
+    {
+        std::vector<EventRecord> records = std::vector<EventRecord>(BUFFER_RECORDS); //!< Records.
+        uint32_t used{0}; //!< Records in use.
+
+        ~ThreadBuffer()
+        {
+            FlushBuffer(*this);
+        }
+    };
+
+    /// \return The state.
+    static State& GetState()
+    {
+        static State state;
+        return state;
+    }
+
+    /// \return The lock of the file.
+    static std::mutex& Mutex()
+    {
+        static std::mutex mutex;
+        return mutex;
+    }
+
+    /// \return The buffer of the calling thread.
+    static ThreadBuffer& GetThreadBuffer()
+    {
+        thread_local ThreadBuffer buffer;
+        return buffer;
+    }
+
+    /// Write the buffer of the calling thread.
+    static void FlushThread()
+    {
+        FlushBuffer(GetThreadBuffer());
+    }
+
+    /**
+     * Write a thread buffer.
+     * \param b The buffer.
+     */
+    static void FlushBuffer(ThreadBuffer& b)
+    {
+        std::lock_guard<std::mutex> lock(Mutex());
+        State& s = GetState();
+        if (s.file && b.used > 0)
+        {
+            std::fwrite(b.records.data(), sizeof(EventRecord), b.used, s.file);
+        }
+        b.used = 0;
+    }
+
+    /**
+     * Tx trace sink of an application.
+     * \param node The node id.
+     * \param slice The slice index.
+     * \param p The packet.
+     */
+    static void AppTx(uint32_t node, uint8_t slice, Ptr<const Packet> p)
+    {
+        SLICING_EVENT(SLICING_EVENT_INFO, EVENT_APP_TX, node, slice, p->GetUid(), p->GetSize(), 0.);
+    }
+
+    /**
+     * Rx trace sink of an application.
+     * \param node The node id.
+     * \param slice The slice index.
+     * \param p The packet.
+     */
+    static void AppRx(uint32_t node, uint8_t slice, Ptr<const Packet> p)
+    {
+        SLICING_EVENT(SLICING_EVENT_INFO, EVENT_APP_RX, node, slice, p->GetUid(), p->GetSize(), 0.);
+    }
+
+    /**
+     * Rx trace sink of a PacketSink.
+     * \param node The node id.
+     * \param slice The slice index.
+     * \param p The packet.
+     * \param from The sender.
+     */
+    static void AppRxFrom(uint32_t node,
+                          uint8_t slice,
+                          Ptr<const Packet> p,
+                          const Address& /* from */)
+    {
+        AppRx(node, slice, p);
+    }
+
+    /**
+     * TxPDU trace sink of PDCP.
+     * \param event The event id.
+     * \param rnti The RNTI.
+     * \param lcid The LCID.
+     * \param size The PDU size.
+     */
+    static void PdcpTx(uint16_t event, uint16_t rnti, uint8_t lcid, uint32_t size)
+    {
+        const State& s = GetState();
+        SLICING_EVENT(SLICING_EVENT_DEBUG,
+                      event,
+                      s.nodeOfRnti[rnti],
+                      s.sliceOfRnti[rnti],
+                      rnti | static_cast<uint64_t>(lcid) << 16,
+                      size,
+                      0.);
+    }
+
+    /**
+     * RxPDU trace sink of PDCP.
+     * \param event The event id.
+     * \param rnti The RNTI.
+     * \param lcid The LCID.
+     * \param size The PDU size.
+     * \param delay The delay in ns.
+     */
+    static void PdcpRx(uint16_t event, uint16_t rnti, uint8_t lcid, uint32_t size, uint64_t delay)
+    {
+        const State& s = GetState();
+        SLICING_EVENT(SLICING_EVENT_DEBUG,
+                      event,
+                      s.nodeOfRnti[rnti],
+                      s.sliceOfRnti[rnti],
+                      rnti | static_cast<uint64_t>(lcid) << 16,
+                      size,
+                      delay / 1e6);
+    }
+};
+
+} // namespace ns3
+
+#endif /* SLICING_EVENT_LOG_H */
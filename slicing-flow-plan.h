@@ -0,0 +1,212 @@
+#ifndef SLICING_FLOW_PLAN_H
+#define SLICING_FLOW_PLAN_H
+
+#include "ns3/core-module.h"
+#include "ns3/nr-module.h"
+
+#include <algorithm>
+#include <vector>
+
+namespace ns3
+{
+
+/// First ephemeral port: the planned ports stay below it, clear of the TCP ACK flows.
+const uint32_t FIRST_EPHEMERAL_PORT = 49152;
+
+/**
+ * Port plan of the flows of every slice, indexed by port range.
+ *
+ * Every UE of a slice has the same M flows. Flow f uses QCI qcis[f % Q] and the
+ * flows sharing a QCI get consecutive ports:
+ *
+ *     port(f) = basePort + (f % Q) * ceil(M / Q) + f / Q
+ *
+ * so one packet filter per QCI covers all of them, whatever M is. A UE then
+ * carries Q bearers of one filter each, and the classification of a packet by
+ * the EPC TFT classifier costs O(Q) instead of O(M). Lookup() maps a port back
+ * to its slice and flow with a binary search over the slices and arithmetic
+ * within the slice.
+ */
+class FlowPortPlan
+{
+  public:
+    /**
+     * \param numFlows The number of flows per UE.
+     * \param numQcis The number of QCIs given to AddSlice().
+     * \return The number of ports AddSlice() reserves, ceil(M / Q) * Q with Q = min(QCIs, M).
+     */
+    static uint32_t GetSpan(uint16_t numFlows, std::size_t numQcis);
+
+    /**
+     * Add a slice; slices must not overlap nor reach FIRST_EPHEMERAL_PORT.
+     * \param basePort The first port of the slice.
+     * \param numFlows The number of flows per UE.
+     * \param qcis The QCIs of the flows, at most numFlows of them are used.
+     * \return The index of the slice.
+     */
+    uint8_t AddSlice(uint16_t basePort, uint16_t numFlows, std::vector<EpsBearer::Qci> qcis);
+
+    /**
+     * \param slice The slice index.
+     * \return The number of flows per UE of the slice.
+     */
+    uint16_t GetNumFlows(uint8_t slice) const;
+
+    /**
+     * \param slice The slice index.
+     * \return The number of QCIs, i.e. of bearers per UE, of the slice.
+     */
+    uint8_t GetNumQcis(uint8_t slice) const;
+
+    /**
+     * \param slice The slice index.
+     * \param q The QCI index.
+     * \return The QCI.
+     */
+    EpsBearer::Qci GetQci(uint8_t slice, uint8_t q) const;
+
+    /**
+     * \param slice The slice index.
+     * \param flow The flow index.
+     * \return The port of the flow.
+     */
+    uint16_t GetPort(uint8_t slice, uint16_t flow) const;
+
+    /**
+     * Create the DL TFT of each QCI of a slice, one port-range filter each.
+     * \param slice The slice index.
+     * \return The TFTs, indexed by QCI index.
+     */
+    std::vector<Ptr<EpcTft>> CreateTfts(uint8_t slice) const;
+
+    /**
+     * Find the slice and the flow of a port.
+     * \param port The port.
+     * \param slice The slice index, set if found.
+     * \param flow The flow index, set if found.
+     * \return false if the port is outside the plan.
+     */
+    bool Lookup(uint16_t port, uint8_t& slice, uint16_t& flow) const;
+
+  private:
+    /// Ports of one slice.
+    struct SlicePlan
+    {
+        uint16_t basePort;                 //!< First port.
+        uint16_t numFlows;                 //!< Flows per UE.
+        uint16_t block;                    //!< Ports per QCI.
+        std::vector<EpsBearer::Qci> qcis;  //!< QCI of each block.
+        uint8_t index;                     //!< Index returned by AddSlice().
+    };
+
+    std::vector<SlicePlan> m_slices; //!< Slices, by index.
+    std::vector<SlicePlan> m_sorted; //!< Slices, by base port.
+};
+
+/* static */
+inline uint32_t
+FlowPortPlan::GetSpan(uint16_t numFlows, std::size_t numQcis)
+{
+    uint32_t q = std::min<std::size_t>(numQcis, numFlows);
+    return q > 0 ? (numFlows + q - 1) / q * q : 0;
+}
+
+inline uint8_t
+FlowPortPlan::AddSlice(uint16_t basePort, uint16_t numFlows, std::vector<EpsBearer::Qci> qcis)
+{
+    NS_ABORT_MSG_IF(numFlows == 0 || qcis.empty(), "A slice needs at least one flow and QCI");
+    SlicePlan plan;
+    plan.basePort = basePort;
+    plan.numFlows = numFlows;
+    plan.qcis.assign(qcis.begin(), qcis.begin() + std::min<std::size_t>(qcis.size(), numFlows));
+    plan.block = (numFlows + plan.qcis.size() - 1) / plan.qcis.size();
+    plan.index = m_slices.size();
+    NS_ABORT_MSG_IF(basePort + plan.block * plan.qcis.size() > FIRST_EPHEMERAL_PORT,
+                    "Port plan reaches the ephemeral ports");
+    for (const auto& other : m_slices)
+    {
+        NS_ABORT_MSG_IF(basePort < other.basePort + other.block * other.qcis.size() &&
+                            other.basePort < basePort + plan.block * plan.qcis.size(),
+                        "Overlapping port ranges of slices");
+    }
+    m_slices.push_back(plan);
+
+    m_sorted.push_back(plan);
+    std::sort(m_sorted.begin(), m_sorted.end(), [](const SlicePlan& a, const SlicePlan& b) {
+        return a.basePort < b.basePort;
+    });
+    return plan.index;
+}
+
+inline uint16_t
+FlowPortPlan::GetNumFlows(uint8_t slice) const
+{
+    return m_slices.at(slice).numFlows;
+}
+
+inline uint8_t
+FlowPortPlan::GetNumQcis(uint8_t slice) const
+{
+    return m_slices.at(slice).qcis.size();
+}
+
+inline EpsBearer::Qci
+FlowPortPlan::GetQci(uint8_t slice, uint8_t q) const
+{
+    return m_slices.at(slice).qcis.at(q);
+}
+
+inline uint16_t
+FlowPortPlan::GetPort(uint8_t slice, uint16_t flow) const
+{
+    const SlicePlan& plan = m_slices.at(slice);
+    uint16_t q = flow % plan.qcis.size();
+    return plan.basePort + q * plan.block + flow / plan.qcis.size();
+}
+
+inline std::vector<Ptr<EpcTft>>
+FlowPortPlan::CreateTfts(uint8_t slice) const
+{
+    const SlicePlan& plan = m_slices.at(slice);
+    std::vector<Ptr<EpcTft>> tfts;
+    for (uint16_t q = 0; q < plan.qcis.size(); ++q)
+    {
+        // flows f = q, q + Q, q + 2Q, ... below numFlows
+        uint16_t count = (plan.numFlows - q + plan.qcis.size() - 1) / plan.qcis.size();
+        Ptr<EpcTft> tft = Create<EpcTft>();
+        EpcTft::PacketFilter dlpf;
+        dlpf.localPortStart = plan.basePort + q * plan.block;
+        dlpf.localPortEnd = dlpf.localPortStart + count - 1;
+        tft->Add(dlpf);
+        tfts.push_back(tft);
+    }
+    return tfts;
+}
+
+inline bool
+FlowPortPlan::Lookup(uint16_t port, uint8_t& slice, uint16_t& flow) const
+{
+    auto it = std::upper_bound(m_sorted.begin(),
+                               m_sorted.end(),
+                               port,
+                               [](uint16_t p, const SlicePlan& plan) { return p < plan.basePort; });
+    if (it == m_sorted.begin())
+    {
+        return false;
+    }
+    const SlicePlan& plan = *(--it);
+    uint32_t offset = port - plan.basePort;
+    uint32_t q = offset / plan.block;
+    uint32_t f = (offset % plan.block) * plan.qcis.size() + q;
+    if (q >= plan.qcis.size() || f >= plan.numFlows)
+    {
+        return false;
+    }
+    slice = plan.index;
+    flow = f;
+    return true;
+}
+
+} // namespace ns3
+
+#endif /* SLICING_FLOW_PLAN_H */
@@ -0,0 +1,390 @@
+#ifndef SLICING_HARQ_STATS_H
+#define SLICING_HARQ_STATS_H
+
+#include "ns3/core-module.h"
+#include "ns3/network-module.h"
+#include "ns3/nr-module.h"
+
+#include "slicing-ue-registry.h"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <ostream>
+#include <set>
+#include <unordered_map>
+#include <vector>
+
+namespace ns3
+{
+
+/**
+ * Per-UE and per-slice statistics of the link adaptation and of the HARQ.
+ *
+ * The RxPacketTrace of the PHYs gives the MCS distribution, the SINR and the
+ * first-transmission BLER of the transport blocks; the DL/UL scheduling
+ * traces of the gNB MACs follow each HARQ process, from the first
+ * transmission of a transport block to its last retransmission. The latency
+ * added by the HARQ is the time between these two grants, so a block decoded
+ * at the first transmission adds none. Everything is aggregated in memory
+ * and printed with the results; no per-slot record is written.
+ */
+class SliceHarqStats : public Object
+{
+  public:
+    /// Number of MCS indices.
+    static constexpr uint32_t NUM_MCS = 32;
+    /// Number of retransmission counts in the histogram, the last one is "or more".
+    static constexpr uint32_t NUM_RETX = 4;
+
+    /// Statistics of one UE, or of a slice, in one direction.
+    struct LinkStats
+    {
+        std::array<uint64_t, NUM_MCS> mcs{}; //!< First transmissions per MCS.
+        uint64_t firstTx{0};                 //!< First transmissions received.
+        uint64_t firstTxErrors{0};           //!< First transmissions corrupt.
+        uint64_t retx{0};                    //!< Retransmissions received.
+        uint64_t retxErrors{0};              //!< Retransmissions corrupt.
+        double sinrDbSum{0};                 //!< Sum of the SINR of the first transmissions.
+        uint64_t sinrSamples{0};             //!< First transmissions with a positive SINR.
+        std::array<uint64_t, NUM_RETX> retxPerTb{}; //!< Transport blocks per retransmission count.
+        uint64_t harqDelaySumNs{0};          //!< Sum of the latency added by the HARQ.
+        uint64_t harqDelayMaxNs{0};          //!< Highest latency added by the HARQ.
+
+        /**
+         * Add the statistics of another UE.
+         * \param other The statistics to add.
+         * \return This.
+         */
+        LinkStats& operator+=(const LinkStats& other);
+    };
+
+    SliceHarqStats();
+    ~SliceHarqStats() override;
+
+    /**
+     * Register this type.
+     * \return The TypeId.
+     */
+    static TypeId GetTypeId();
+
+    /**
+     * Set the UEs and their slices.
+     * \param registry The UE registry.
+     */
+    void SetRegistry(Ptr<SliceUeRegistry> registry);
+
+    /**
+     * Connect the PHY traces of the registered UEs and the PHY and MAC
+     * traces of their gNBs; the UEs must be attached.
+     */
+    void Connect();
+
+    /**
+     * Account the HARQ processes still open, e.g. at the end of the run.
+     */
+    void Finish();
+
+    /**
+     * \param dir 0 for DL, 1 for UL.
+     * \param ue The index of the UE in the registry.
+     * \return The statistics of the UE.
+     */
+    const LinkStats& GetUe(uint8_t dir, uint32_t ue) const;
+
+    /**
+     * \param dir 0 for DL, 1 for UL.
+     * \param slice The slice index.
+     * \return The statistics of all the UEs of the slice.
+     */
+    LinkStats GetSlice(uint8_t dir, uint8_t slice) const;
+
+    /**
+     * Print statistics, e.g. "TBs 5120, first-tx BLER 0.08, retx BLER 0.01, ...".
+     * \param os The output stream.
+     * \param stats The statistics.
+     */
+    static void Print(std::ostream& os, const LinkStats& stats);
+
+  private:
+    /// A HARQ process of a UE, from the first transmission of its transport block.
+    struct Process
+    {
+        int64_t firstNs; //!< Grant of the first transmission.
+        int64_t lastNs;  //!< Grant of the last retransmission.
+        uint32_t retx;   //!< Retransmissions so far.
+    };
+
+    /**
+     * Account a HARQ process whose transport block is done.
+     * \param dir 0 for DL, 1 for UL.
+     * \param ue The index of the UE.
+     * \param process The process.
+     */
+    void Close(uint8_t dir, uint32_t ue, const Process& process);
+
+    /**
+     * RxPacketTraceUe/Enb trace sink.
+     * \param dir 0 for DL, 1 for UL.
+     * \param params The reception.
+     */
+    void RxPacket(uint8_t dir, RxPacketTraceParams params);
+    /**
+     * DlScheduling/UlScheduling trace sink.
+     * \param dir 0 for DL, 1 for UL.
+     * \param info The grant.
+     */
+    void Scheduling(uint8_t dir, NrSchedulingCallbackInfo info);
+
+    /**
+     * \param rnti The RNTI of the UE.
+     * \param bwpId The BWP of the grant; each BWP of a UE has its own HARQ entity.
+     * \param harqId The HARQ process id.
+     * \return The key of the process in m_processes.
+     */
+    static uint64_t ProcessKey(uint16_t rnti, uint16_t bwpId, uint8_t harqId);
+
+    Ptr<SliceUeRegistry> m_registry;   //!< UEs and their slices.
+    std::vector<LinkStats> m_stats[2]; //!< Statistics per direction and UE.
+    /// Open processes by RNTI, BWP and id, see ProcessKey.
+    std::unordered_map<uint64_t, Process> m_processes[2];
+};
+
+inline SliceHarqStats::LinkStats&
+SliceHarqStats::LinkStats::operator+=(const LinkStats& other)
+{
+    for (uint32_t i = 0; i < NUM_MCS; ++i)
+    {
+        mcs[i] += other.mcs[i];
+    }
+    for (uint32_t i = 0; i < NUM_RETX; ++i)
+    {
+        retxPerTb[i] += other.retxPerTb[i];
+    }
+    firstTx += other.firstTx;
+    firstTxErrors += other.firstTxErrors;
+    retx += other.retx;
+    retxErrors += other.retxErrors;
+    sinrDbSum += other.sinrDbSum;
+    sinrSamples += other.sinrSamples;
+    harqDelaySumNs += other.harqDelaySumNs;
+    harqDelayMaxNs = std::max(harqDelayMaxNs, other.harqDelayMaxNs);
+    return *this;
+}
+
+inline SliceHarqStats::SliceHarqStats()
+{
+}
+
+inline SliceHarqStats::~SliceHarqStats()
+{
+}
+
+/* static */
+inline TypeId
+SliceHarqStats::GetTypeId()
+{
+    static TypeId tid = TypeId("SliceHarqStats")
+                            .SetParent<Object>()
+                            .SetGroupName("Tutorial")
+                            .AddConstructor<SliceHarqStats>();
+    return tid;
+}
+
+inline void
+SliceHarqStats::SetRegistry(Ptr<SliceUeRegistry> registry)
+{
+    m_registry = registry;
+    for (auto& stats : m_stats)
+    {
+        stats.assign(registry->GetUes().size(), LinkStats());
+    }
+}
+
+inline void
+SliceHarqStats::Connect()
+{
+    NS_ABORT_MSG_IF(!m_registry, "No UE registry");
+    m_registry->Resolve();
+    std::set<Ptr<NrGnbNetDevice>> gnbs;
+    for (const auto& ue : m_registry->GetUes())
+    {
+        for (uint32_t bwp = 0; bwp < ue.dev->GetCcMapSize(); ++bwp)
+        {
+            NrHelper::GetUePhy(ue.dev, bwp)->GetSpectrumPhy()->TraceConnectWithoutContext(
+                "RxPacketTraceUe",
+                MakeCallback(&SliceHarqStats::RxPacket, this).Bind(uint8_t(0)));
+        }
+        gnbs.insert(ue.dev->GetTargetEnb());
+    }
+    for (const auto& gnb : gnbs)
+    {
+        for (uint32_t bwp = 0; bwp < gnb->GetCcMapSize(); ++bwp)
+        {
+            NrHelper::GetGnbPhy(gnb, bwp)->GetSpectrumPhy()->TraceConnectWithoutContext(
+                "RxPacketTraceEnb",
+                MakeCallback(&SliceHarqStats::RxPacket, this).Bind(uint8_t(1)));
+            Ptr<NrGnbMac> mac = NrHelper::GetGnbMac(gnb, bwp);
+            mac->TraceConnectWithoutContext(
+                "DlScheduling",
+                MakeCallback(&SliceHarqStats::Scheduling, this).Bind(uint8_t(0)));
+            mac->TraceConnectWithoutContext(
+                "UlScheduling",
+                MakeCallback(&SliceHarqStats::Scheduling, this).Bind(uint8_t(1)));
+        }
+    }
+}
+
+inline void
+SliceHarqStats::Finish()
+{
+    for (uint8_t dir = 0; dir < 2; ++dir)
+    {
+        for (const auto& p : m_processes[dir])
+        {
+            uint32_t ue = m_registry->GetUeOfRnti(p.first >> 32);
+            Close(dir, ue, p.second);
+        }
+        m_processes[dir].clear();
+    }
+}
+
+inline const SliceHarqStats::LinkStats&
+SliceHarqStats::GetUe(uint8_t dir, uint32_t ue) const
+{
+    return m_stats[dir].at(ue);
+}
+
+inline SliceHarqStats::LinkStats
+SliceHarqStats::GetSlice(uint8_t dir, uint8_t slice) const
+{
+    LinkStats sum;
+    const auto& ues = m_registry->GetUes();
+    for (uint32_t i = 0; i < ues.size(); ++i)
+    {
+        if (ues[i].slice == slice)
+        {
+            sum += m_stats[dir][i];
+        }
+    }
+    return sum;
+}
+
+/* static */
+inline void
+SliceHarqStats::Print(std::ostream& os, const LinkStats& stats)
+{
+    uint64_t tbs = 0;
+    for (uint32_t i = 0; i < NUM_RETX; ++i)
+    {
+        tbs += stats.retxPerTb[i];
+    }
+    os << "TBs " << stats.firstTx << ", first-tx BLER "
+       << (stats.firstTx > 0 ? double(stats.firstTxErrors) / stats.firstTx : 0)
+       << ", retx BLER " << (stats.retx > 0 ? double(stats.retxErrors) / stats.retx : 0)
+       << ", mean SINR " << (stats.sinrSamples > 0 ? stats.sinrDbSum / stats.sinrSamples : 0)
+       << " dB"
+       << ", retx/TB " << (stats.firstTx > 0 ? double(stats.retx) / stats.firstTx : 0)
+       << ", HARQ delay mean " << (tbs > 0 ? stats.harqDelaySumNs / 1e6 / tbs : 0) << " ms max "
+       << stats.harqDelayMaxNs / 1e6 << " ms, TBs by retx {";
+    for (uint32_t i = 0; i < NUM_RETX; ++i)
+    {
+        os << (i == 0 ? "" : ", ") << i << (i + 1 == NUM_RETX ? "+" : "") << ":"
+           << stats.retxPerTb[i];
+    }
+    os << "}, MCS {";
+    bool first = true;
+    for (uint32_t i = 0; i < NUM_MCS; ++i)
+    {
+        if (stats.mcs[i] > 0)
+        {
+            os << (first ? "" : ", ") << i << ":" << stats.mcs[i];
+            first = false;
+        }
+    }
+    os << "}";
+}
+
+inline void
+SliceHarqStats::Close(uint8_t dir, uint32_t ue, const Process& process)
+{
+    if (ue == UINT32_MAX)
+    {
+        return;
+    }
+    LinkStats& stats = m_stats[dir][ue];
+    uint64_t delay = process.lastNs - process.firstNs;
+    ++stats.retxPerTb[std::min<uint32_t>(process.retx, NUM_RETX - 1)];
+    stats.harqDelaySumNs += delay;
+    stats.harqDelayMaxNs = std::max(stats.harqDelayMaxNs, delay);
+}
+
+inline void
+SliceHarqStats::RxPacket(uint8_t dir, RxPacketTraceParams params)
+{
+    uint32_t ue = m_registry->GetUeOfRnti(params.m_rnti);
+    if (ue == UINT32_MAX)
+    {
+        return;
+    }
+    LinkStats& stats = m_stats[dir][ue];
+    if (params.m_rv == 0)
+    {
+        ++stats.firstTx;
+        stats.firstTxErrors += params.m_corrupt ? 1 : 0;
+        ++stats.mcs[std::min<uint32_t>(params.m_mcs, NUM_MCS - 1)];
+        // a zero SINR has no dB value; the block still counts for the BLER
+        if (params.m_sinr > 0)
+        {
+            stats.sinrDbSum += 10 * std::log10(params.m_sinr);
+            ++stats.sinrSamples;
+        }
+    }
+    else
+    {
+        ++stats.retx;
+        stats.retxErrors += params.m_corrupt ? 1 : 0;
+    }
+}
+
+/* static */
+inline uint64_t
+SliceHarqStats::ProcessKey(uint16_t rnti, uint16_t bwpId, uint8_t harqId)
+{
+    return (static_cast<uint64_t>(rnti) << 32) | (static_cast<uint64_t>(bwpId) << 8) | harqId;
+}
+
+inline void
+SliceHarqStats::Scheduling(uint8_t dir, NrSchedulingCallbackInfo info)
+{
+    uint32_t ue = m_registry->GetUeOfRnti(info.m_rnti);
+    if (ue == UINT32_MAX)
+    {
+        return;
+    }
+    int64_t now = Simulator::Now().GetNanoSeconds();
+    uint64_t key = ProcessKey(info.m_rnti, info.m_bwpId, info.m_harqId);
+    auto it = m_processes[dir].find(key);
+    if (info.m_rv == 0)
+    {
+        // a new transport block: the previous one of the process is done
+        if (it != m_processes[dir].end())
+        {
+            Close(dir, ue, it->second);
+            it->second = {now, now, 0};
+        }
+        else
+        {
+            m_processes[dir][key] = {now, now, 0};
+        }
+    }
+    else if (it != m_processes[dir].end())
+    {
+        it->second.lastNs = now;
+        ++it->second.retx;
+    }
+}
+
+} // namespace ns3
+
+#endif /* SLICING_HARQ_STATS_H */
@@ -0,0 +1,519 @@
+#ifndef SLICING_KPI_SAMPLER_H
+#define SLICING_KPI_SAMPLER_H
+
+#include "ns3/core-module.h"
+#include "ns3/lte-module.h"
+#include "ns3/network-module.h"
+#include "ns3/nr-module.h"
+
+#include "slicing-buffer-status.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+namespace ns3
+{
+
+/// KPIs of one slice and direction over one sampling interval.
+struct KpiSample
+{
+    int64_t timeNs;        //!< End of the interval.
+    uint8_t slice;         //!< Slice index.
+    uint8_t direction;     //!< 0 for DL, 1 for UL.
+    uint32_t rxPackets;    //!< PDCP PDUs received in the interval.
+    double throughputMbps; //!< PDCP throughput over the interval.
+    uint64_t queueBytes;   //!< RLC bytes queued at the end of the interval.
+    double p50DelayMs;     //!< Median PDCP delay over the interval.
+    double p99DelayMs;     //!< p99 PDCP delay over the interval.
+    double rbUsage;        //!< Fraction of the RB x symbols of the slice BWPs it used, DL only.
+};
+
+/**
+ * Periodic sampler of the per-slice KPIs.
+ *
+ * Every Interval, the PDCP throughput, the bytes queued in the RLC, the
+ * median and p99 PDCP delay and the RB usage of each slice and direction
+ * are stored in a ring buffer of Capacity samples. The counters,
+ * the delay histograms and the ring are allocated by Open(), and the trace
+ * sinks only index fixed arrays, so sampling allocates nothing but the
+ * simulator event. With Incremental, a full ring is written to the CSV file
+ * and reused; otherwise it keeps the latest samples until Stop().
+ *
+ * The RB usage of a slice is the RB x symbols of its DL grants over those
+ * available on the BWPs it uses, which may carry other slices too. A grant
+ * spans all the RBs of its symbols, as with the TDMA schedulers.
+ *
+ * The RLC queue of a slice is the sum of the latest buffer status reports of
+ * its queues, see SliceBufferStatus: the DL transmission and retransmission
+ * buffers of the gNB and the UL BSRs of the UEs. The PDUs lost on the way are
+ * not in it. Without a buffer status, the queue is reported as 0.
+ *
+ * The slice of a PDCP PDU or a grant is looked up by RNTI, which assumes a
+ * single cell.
+ */
+class SliceKpiSampler : public Object
+{
+  public:
+    SliceKpiSampler();
+    ~SliceKpiSampler() override;
+
+    /**
+     * Register this type.
+     * \return The TypeId.
+     */
+    static TypeId GetTypeId();
+
+    /**
+     * Open the CSV file and allocate the counters and the ring buffer.
+     * \param filename The CSV file.
+     * \param sliceNames The names of the slices.
+     * \return false if the file cannot be opened.
+     */
+    bool Open(const std::string& filename, const std::vector<std::string>& sliceNames);
+
+    /**
+     * Assign UEs to a slice.
+     * \param slice The slice index.
+     * \param ueDevices The UE devices.
+     */
+    void AddUes(uint8_t slice, const NetDeviceContainer& ueDevices);
+
+    /**
+     * Measure the RB usage of the slices a BWP carries.
+     * \param phy The gNB PHY of the BWP.
+     * \param mac The gNB MAC of the BWP.
+     * \param slices The slices whose bearers map to the BWP.
+     */
+    void ConnectBwp(Ptr<NrGnbPhy> phy, Ptr<NrGnbMac> mac, const std::vector<uint8_t>& slices);
+
+    /**
+     * Read the RLC queues of the slices from the buffer status reports.
+     * \param bufferStatus The buffer status fed by the schedulers.
+     */
+    void SetBufferStatus(Ptr<SliceBufferStatus> bufferStatus);
+
+    /**
+     * Connect the PDCP traces and start sampling; the UEs must be attached
+     * and their bearers set up.
+     */
+    void Start();
+
+    /**
+     * Stop sampling, write the buffered samples and close the file.
+     */
+    void Stop();
+
+    /// \return The number of samples taken.
+    uint64_t GetNumSamples() const;
+
+  protected:
+    void DoDispose() override;
+
+  private:
+    /// Counters of one slice and direction.
+    struct Counters
+    {
+        uint64_t intervalRxBytes{0};  //!< PDCP bytes received in the interval.
+        uint32_t intervalRxPackets{0}; //!< PDCP PDUs received in the interval.
+        std::vector<uint32_t> delayBins; //!< Delay histogram of the interval.
+    };
+
+    /// Record the samples of the interval and schedule the next one.
+    void Sample();
+    /**
+     * Append a sample to the ring buffer.
+     * \param s The sample.
+     */
+    void Store(const KpiSample& s);
+    /// Write the buffered samples, oldest first.
+    void Flush();
+    /**
+     * \param bins The delay histogram.
+     * \param total The number of delays in the histogram.
+     * \param q The quantile.
+     * \return The upper edge of the bin holding the quantile, in ms.
+     */
+    double Quantile(const std::vector<uint32_t>& bins, uint32_t total, double q) const;
+
+    /**
+     * PDCP RxPDU trace sink.
+     * \param dir 0 for DL, 1 for UL.
+     * \param rnti The RNTI.
+     * \param lcid The LCID.
+     * \param size The PDU size.
+     * \param delay The delay in ns.
+     */
+    void PdcpRx(uint8_t dir, uint16_t rnti, uint8_t lcid, uint32_t size, uint64_t delay);
+    /**
+     * DlScheduling trace sink.
+     * \param bwp The index of the BWP in m_bwps.
+     * \param info The grant.
+     */
+    void DlScheduling(uint32_t bwp, NrSchedulingCallbackInfo info);
+    /**
+     * SlotDataStats trace sink.
+     * \param bwp The index of the BWP in m_bwps.
+     * \param sfnSf The slot.
+     * \param scheduledUe The number of scheduled UEs.
+     * \param usedReg The used RB x symbols.
+     * \param usedSym The used symbols.
+     * \param availableRb The available RBs.
+     * \param availableSym The available symbols.
+     * \param bwpId The BWP id.
+     * \param cellId The cell id.
+     */
+    void SlotDataStats(uint32_t bwp,
+                       const SfnSf& sfnSf,
+                       uint32_t scheduledUe,
+                       uint32_t usedReg,
+                       uint32_t usedSym,
+                       uint32_t availableRb,
+                       uint32_t availableSym,
+                       uint16_t bwpId,
+                       uint16_t cellId);
+
+    Time m_interval;          //!< Sampling interval.
+    uint32_t m_capacity;      //!< Samples in the ring buffer.
+    bool m_incremental;       //!< Write the ring whenever it is full.
+    double m_delayBinWidth;   //!< Width of the delay bins in ms.
+    uint32_t m_numDelayBins;  //!< Number of delay bins, the last one is open.
+
+    std::vector<std::string> m_sliceNames;          //!< Slice names.
+    std::vector<std::pair<uint8_t, Ptr<NetDevice>>> m_ues; //!< UE devices and their slice.
+    std::vector<uint8_t> m_sliceOfRnti;             //!< Slice of each RNTI, UINT8_MAX if none.
+    std::vector<Counters> m_counters;               //!< Counters, at dir * slices + slice.
+    std::vector<uint64_t> m_usedReg;                //!< Used RB x symbols per slice.
+    std::vector<uint64_t> m_availableReg;           //!< Available RB x symbols per slice.
+    std::vector<std::pair<Ptr<NrGnbPhy>, std::vector<uint8_t>>> m_bwps; //!< BWPs and their slices.
+    Ptr<SliceBufferStatus> m_bufferStatus;          //!< RLC queues, if set.
+
+    std::vector<KpiSample> m_ring; //!< Ring buffer of samples.
+    uint32_t m_head;               //!< Index of the oldest sample.
+    uint32_t m_count;              //!< Samples in the ring.
+    uint64_t m_numSamples;         //!< Samples taken.
+    uint64_t m_overwritten;        //!< Samples lost to a full ring.
+    EventId m_sampleEvent;         //!< Next sample.
+    std::FILE* m_file;             //!< CSV file.
+};
+
+inline SliceKpiSampler::SliceKpiSampler()
+    : m_interval(MilliSeconds(10)),
+      m_capacity(4096),
+      m_incremental(true),
+      m_delayBinWidth(0.1),
+      m_numDelayBins(2000),
+      m_head(0),
+      m_count(0),
+      m_numSamples(0),
+      m_overwritten(0),
+      m_file(nullptr)
+{
+}
+
+inline SliceKpiSampler::~SliceKpiSampler()
+{
+    if (m_file)
+    {
+        std::fclose(m_file);
+    }
+}
+
+/* static */
+inline TypeId
+SliceKpiSampler::GetTypeId()
+{
+    static TypeId tid =
+        TypeId("SliceKpiSampler")
+            .SetParent<Object>()
+            .SetGroupName("Tutorial")
+            .AddConstructor<SliceKpiSampler>()
+            .AddAttribute("Interval",
+                          "Sampling interval",
+                          TimeValue(MilliSeconds(10)),
+                          MakeTimeAccessor(&SliceKpiSampler::m_interval),
+                          MakeTimeChecker(NanoSeconds(1)))
+            .AddAttribute("Capacity",
+                          "Number of samples in the ring buffer",
+                          UintegerValue(4096),
+                          MakeUintegerAccessor(&SliceKpiSampler::m_capacity),
+                          MakeUintegerChecker<uint32_t>(1))
+            .AddAttribute("Incremental",
+                          "Write the ring buffer whenever it is full; otherwise keep the "
+                          "latest samples and write them at the end",
+                          BooleanValue(true),
+                          MakeBooleanAccessor(&SliceKpiSampler::m_incremental),
+                          MakeBooleanChecker())
+            .AddAttribute("DelayBinWidth",
+                          "Width of the delay histogram bins in ms",
+                          DoubleValue(0.1),
+                          MakeDoubleAccessor(&SliceKpiSampler::m_delayBinWidth),
+                          MakeDoubleChecker<double>(0))
+            .AddAttribute("NumDelayBins",
+                          "Number of delay histogram bins; longer delays fall in the last one",
+                          UintegerValue(2000),
+                          MakeUintegerAccessor(&SliceKpiSampler::m_numDelayBins),
+                          MakeUintegerChecker<uint32_t>(1));
+    return tid;
+}
+
+inline void
+SliceKpiSampler::DoDispose()
+{
+    Stop();
+    m_ues.clear();
+    m_bwps.clear();
+    m_bufferStatus = nullptr;
+    Object::DoDispose();
+}
+
+inline bool
+SliceKpiSampler::Open(const std::string& filename, const std::vector<std::string>& sliceNames)
+{
+    m_file = std::fopen(filename.c_str(), "w");
+    if (!m_file)
+    {
+        return false;
+    }
+    std::fprintf(m_file,
+                 "timeMs,slice,direction,throughputMbps,queueBytes,rxPackets,p50DelayMs,"
+                 "p99DelayMs,rbUsage\n");
+    m_sliceNames = sliceNames;
+    m_sliceOfRnti.assign(UINT16_MAX + 1, UINT8_MAX);
+    m_counters.assign(2 * sliceNames.size(), Counters());
+    for (auto& c : m_counters)
+    {
+        c.delayBins.assign(m_numDelayBins, 0);
+    }
+    m_usedReg.assign(sliceNames.size(), 0);
+    m_availableReg.assign(sliceNames.size(), 0);
+    m_ring.resize(m_capacity);
+    m_head = 0;
+    m_count = 0;
+    return true;
+}
+
+inline void
+SliceKpiSampler::AddUes(uint8_t slice, const NetDeviceContainer& ueDevices)
+{
+    NS_ABORT_MSG_IF(slice >= m_sliceNames.size(), "Unknown slice " << +slice);
+    for (uint32_t i = 0; i < ueDevices.GetN(); ++i)
+    {
+        m_ues.emplace_back(slice, ueDevices.Get(i));
+    }
+}
+
+inline void
+SliceKpiSampler::ConnectBwp(Ptr<NrGnbPhy> phy,
+                            Ptr<NrGnbMac> mac,
+                            const std::vector<uint8_t>& slices)
+{
+    for (uint8_t slice : slices)
+    {
+        NS_ABORT_MSG_IF(slice >= m_sliceNames.size(), "Unknown slice " << +slice);
+    }
+    uint32_t bwp = m_bwps.size();
+    m_bwps.emplace_back(phy, slices);
+    phy->TraceConnectWithoutContext(
+        "SlotDataStats",
+        MakeCallback(&SliceKpiSampler::SlotDataStats, this).Bind(bwp));
+    mac->TraceConnectWithoutContext(
+        "DlScheduling",
+        MakeCallback(&SliceKpiSampler::DlScheduling, this).Bind(bwp));
+}
+
+inline void
+SliceKpiSampler::SetBufferStatus(Ptr<SliceBufferStatus> bufferStatus)
+{
+    m_bufferStatus = bufferStatus;
+}
+
+inline void
+SliceKpiSampler::Start()
+{
+    for (const auto& [slice, dev] : m_ues)
+    {
+        Ptr<NrUeNetDevice> ue = DynamicCast<NrUeNetDevice>(dev);
+        NS_ABORT_MSG_IF(!ue, "Not a UE device");
+        m_sliceOfRnti[ue->GetRrc()->GetRnti()] = slice;
+    }
+    std::string gnbPdcp = "/NodeList/*/DeviceList/*/LteEnbRrc/UeMap/*/DataRadioBearerMap/*/LtePdcp/";
+    std::string uePdcp = "/NodeList/*/DeviceList/*/LteUeRrc/DataRadioBearerMap/*/LtePdcp/";
+    Config::ConnectWithoutContext(uePdcp + "RxPDU",
+                                  MakeCallback(&SliceKpiSampler::PdcpRx, this).Bind(uint8_t(0)));
+    Config::ConnectWithoutContext(gnbPdcp + "RxPDU",
+                                  MakeCallback(&SliceKpiSampler::PdcpRx, this).Bind(uint8_t(1)));
+    std::fill(m_usedReg.begin(), m_usedReg.end(), 0);
+    std::fill(m_availableReg.begin(), m_availableReg.end(), 0);
+    m_sampleEvent = Simulator::Schedule(m_interval, &SliceKpiSampler::Sample, this);
+}
+
+inline void
+SliceKpiSampler::Stop()
+{
+    Simulator::Cancel(m_sampleEvent);
+    if (m_file)
+    {
+        Flush();
+        if (m_overwritten > 0)
+        {
+            std::fprintf(m_file, "# %llu older samples overwritten\n",
+                         static_cast<unsigned long long>(m_overwritten));
+        }
+        std::fclose(m_file);
+        m_file = nullptr;
+    }
+}
+
+inline uint64_t
+SliceKpiSampler::GetNumSamples() const
+{
+    return m_numSamples;
+}
+
+inline void
+SliceKpiSampler::PdcpRx(uint8_t dir,
+                        uint16_t rnti,
+                        uint8_t /* lcid */,
+                        uint32_t size,
+                        uint64_t delay)
+{
+    uint8_t slice = m_sliceOfRnti[rnti];
+    if (slice == UINT8_MAX)
+    {
+        return;
+    }
+    Counters& c = m_counters[dir * m_sliceNames.size() + slice];
+    c.intervalRxBytes += size;
+    ++c.intervalRxPackets;
+    double delayMs = delay / 1e6;
+    uint32_t bin = std::min<uint32_t>(delayMs / m_delayBinWidth, m_numDelayBins - 1);
+    ++c.delayBins[bin];
+}
+
+inline void
+SliceKpiSampler::DlScheduling(uint32_t bwp, NrSchedulingCallbackInfo info)
+{
+    uint8_t slice = m_sliceOfRnti[info.m_rnti];
+    if (slice != UINT8_MAX)
+    {
+        m_usedReg[slice] += static_cast<uint64_t>(info.m_numSym) * m_bwps[bwp].first->GetRbNum();
+    }
+}
+
+inline void
+SliceKpiSampler::SlotDataStats(uint32_t bwp,
+                               const SfnSf& /* sfnSf */,
+                               uint32_t /* scheduledUe */,
+                               uint32_t /* usedReg */,
+                               uint32_t /* usedSym */,
+                               uint32_t availableRb,
+                               uint32_t availableSym,
+                               uint16_t /* bwpId */,
+                               uint16_t /* cellId */)
+{
+    for (uint8_t slice : m_bwps[bwp].second)
+    {
+        m_availableReg[slice] += static_cast<uint64_t>(availableRb) * availableSym;
+    }
+}
+
+inline double
+SliceKpiSampler::Quantile(const std::vector<uint32_t>& bins, uint32_t total, double q) const
+{
+    if (total == 0)
+    {
+        return 0.;
+    }
+    uint64_t target = std::ceil(q * total);
+    uint64_t seen = 0;
+    for (uint32_t b = 0; b < bins.size(); ++b)
+    {
+        seen += bins[b];
+        if (seen >= target)
+        {
+            return (b + 1) * m_delayBinWidth;
+        }
+    }
+    return bins.size() * m_delayBinWidth;
+}
+
+inline void
+SliceKpiSampler::Sample()
+{
+    uint32_t numSlices = m_sliceNames.size();
+    for (uint32_t k = 0; k < m_counters.size(); ++k)
+    {
+        Counters& c = m_counters[k];
+        KpiSample s;
+        s.timeNs = Simulator::Now().GetNanoSeconds();
+        s.slice = k % numSlices;
+        s.direction = k / numSlices;
+        s.rxPackets = c.intervalRxPackets;
+        s.throughputMbps = c.intervalRxBytes * 8.0 / m_interval.GetSeconds() / 1000 / 1000;
+        s.queueBytes = m_bufferStatus ? m_bufferStatus->GetBytes(s.direction, s.slice) : 0;
+        s.p50DelayMs = Quantile(c.delayBins, c.intervalRxPackets, 0.5);
+        s.p99DelayMs = Quantile(c.delayBins, c.intervalRxPackets, 0.99);
+        s.rbUsage = s.direction == 0 && m_availableReg[s.slice] > 0
+                        ? static_cast<double>(m_usedReg[s.slice]) / m_availableReg[s.slice]
+                        : 0.;
+        Store(s);
+
+        c.intervalRxBytes = 0;
+        c.intervalRxPackets = 0;
+        std::fill(c.delayBins.begin(), c.delayBins.end(), 0);
+    }
+    std::fill(m_usedReg.begin(), m_usedReg.end(), 0);
+    std::fill(m_availableReg.begin(), m_availableReg.end(), 0);
+    m_sampleEvent = Simulator::Schedule(m_interval, &SliceKpiSampler::Sample, this);
+}
+
+inline void
+SliceKpiSampler::Store(const KpiSample& s)
+{
+    ++m_numSamples;
+    if (m_count == m_capacity)
+    {
+        if (m_incremental)
+        {
+            Flush();
+        }
+        else
+        {
+            // keep the latest samples
+            m_head = (m_head + 1) % m_capacity;
+            --m_count;
+            ++m_overwritten;
+        }
+    }
+    m_ring[(m_head + m_count) % m_capacity] = s;
+    ++m_count;
+}
+
+inline void
+SliceKpiSampler::Flush()
+{
+    for (uint32_t i = 0; i < m_count; ++i)
+    {
+        const KpiSample& s = m_ring[(m_head + i) % m_capacity];
+        std::fprintf(m_file,
+                     "%.3f,%s,%s,%.6f,%llu,%u,%.3f,%.3f,%.4f\n",
+                     s.timeNs / 1e6,
+                     m_sliceNames[s.slice].c_str(),
+                     s.direction == 0 ? "DL" : "UL",
+                     s.throughputMbps,
+                     static_cast<unsigned long long>(s.queueBytes),
+                     s.rxPackets,
+                     s.p50DelayMs,
+                     s.p99DelayMs,
+                     s.rbUsage);
+    }
+    m_head = 0;
+    m_count = 0;
+}
+
+} // namespace ns3
+
+#endif /* SLICING_KPI_SAMPLER_H */
@@ -0,0 +1,125 @@
+#ifndef SLICING_KPI_H
+#define SLICING_KPI_H
+
+#include <cstdint>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace ns3
+{
+
+/**
+ * Per-slice, per-direction key performance indicators of one run.
+ *
+ * The scenario writes them with WriteKpiFile() when --kpiFile is given, so that
+ * drivers such as the TDD/numerology optimizer can read the outcome of a run
+ * without parsing the human-readable results file.
+ */
+struct SliceKpi
+{
+    std::string slice;        //!< Slice name, e.g. VR.
+    std::string direction;    //!< DL or UL.
+    double throughputMbps{0}; //!< Received throughput over the application duration.
+    double meanDelayMs{0};    //!< Mean one-way delay.
+    double p99DelayMs{0};     //!< 99th percentile of the one-way delay.
+    uint64_t lostPackets{0};  //!< Packets declared lost by the flow monitor.
+};
+
+/**
+ * Write the KPIs of a run, one line per slice and direction.
+ *
+ * \param filename The output file.
+ * \param kpis The KPIs to write.
+ * \return false if the file cannot be opened.
+ */
+inline bool
+WriteKpiFile(const std::string& filename, const std::vector<SliceKpi>& kpis)
+{
+    std::ofstream out(filename.c_str(), std::ofstream::out | std::ofstream::trunc);
+    if (!out.is_open())
+    {
+        return false;
+    }
+    out << "# slice dir throughputMbps meanDelayMs p99DelayMs lostPackets\n";
+    for (const auto& k : kpis)
+    {
+        out << k.slice << " " << k.direction << " " << k.throughputMbps << " " << k.meanDelayMs
+            << " " << k.p99DelayMs << " " << k.lostPackets << "\n";
+    }
+    return true;
+}
+
+/**
+ * Read the KPIs written by WriteKpiFile().
+ *
+ * \param filename The input file.
+ * \param kpis The KPIs read, appended to the vector.
+ * \return false if the file cannot be opened or holds no KPI.
+ */
+inline bool
+ReadKpiFile(const std::string& filename, std::vector<SliceKpi>& kpis)
+{
+    std::ifstream in(filename.c_str());
+    if (!in.is_open())
+    {
+        return false;
+    }
+    std::size_t before = kpis.size();
+    std::string line;
+    while (std::getline(in, line))
+    {
+        if (line.empty() || line[0] == '#')
+        {
+            continue;
+        }
+        std::istringstream iss(line);
+        SliceKpi k;
+        if (iss >> k.slice >> k.direction >> k.throughputMbps >> k.meanDelayMs >> k.p99DelayMs >>
+            k.lostPackets)
+        {
+            kpis.push_back(k);
+        }
+    }
+    return kpis.size() > before;
+}
+
+/**
+ * Percentile of a histogram with fixed-width bins starting at zero.
+ *
+ * The upper edge of the bin holding the percentile is returned, so the result
+ * is conservative by at most one bin width.
+ *
+ * \param bins The bin counts.
+ * \param binWidth The width of a bin.
+ * \param q The percentile, in (0, 1].
+ * \return The percentile, or 0 for an empty histogram.
+ */
+inline double
+HistogramPercentile(const std::vector<uint64_t>& bins, double binWidth, double q)
+{
+    uint64_t total = 0;
+    for (auto c : bins)
+    {
+        total += c;
+    }
+    if (total == 0)
+    {
+        return 0.;
+    }
+    uint64_t cumulative = 0;
+    for (std::size_t b = 0; b < bins.size(); ++b)
+    {
+        cumulative += bins[b];
+        if (cumulative >= q * total)
+        {
+            return (b + 1) * binWidth;
+        }
+    }
+    return bins.size() * binWidth;
+}
+
+} // namespace ns3
+
+#endif /* SLICING_KPI_H */
@@ -0,0 +1,560 @@
+#ifndef SLICING_MEMORY_ACCOUNTING_H
+#define SLICING_MEMORY_ACCOUNTING_H
+
+#include "ns3/core-module.h"
+
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <new>
+#include <ostream>
+#include <string>
+#include <vector>
+
+namespace ns3
+{
+
+/// Phases of a scenario, the heap allocations are attributed to the current one.
+enum MemoryPhase : uint8_t
+{
+    MEMORY_PHASE_OTHER = 0,    //!< Before and after the scenario.
+    MEMORY_PHASE_TOPOLOGY,     //!< Nodes, devices, channel, beams, IP stack.
+    MEMORY_PHASE_APPLICATIONS, //!< Applications and bearers.
+    MEMORY_PHASE_MONITORING,   //!< Flow monitor, traces and statistics.
+    MEMORY_PHASE_RUN,          //!< Simulator::Run: packets, events, queues, lazy channel state.
+    MEMORY_NUM_PHASES
+};
+
+/// Heap allocations, live bytes per phase and in total, shared by the operator new hooks.
+inline std::atomic<int64_t> g_memoryLiveBytes[MEMORY_NUM_PHASES];
+/// Live heap allocations.
+inline std::atomic<int64_t> g_memoryLiveAllocations;
+/// Live heap bytes, all phases.
+inline std::atomic<int64_t> g_memoryTotalBytes;
+/// Highest live heap bytes so far.
+inline std::atomic<int64_t> g_memoryPeakBytes;
+/// Phase of the new allocations.
+inline std::atomic<uint8_t> g_memoryPhase;
+/// Generation of the counters, bumped by MemoryAccounting::Reset().
+inline std::atomic<uint8_t> g_memoryGeneration;
+
+/**
+ * Heap accounting by phase.
+ *
+ * When a program is built with SLICING_MEMORY_ACCOUNTING defined, the
+ * translation unit that includes this header replaces the global operator
+ * new and delete: every allocation carries a 16-byte header with its size
+ * and the phase it was made in, so the live bytes of each phase and the
+ * peak of the heap are known exactly, for the ns-3 libraries too. Without
+ * the macro nothing is replaced and only the RSS is available. Include the
+ * header with the macro in one translation unit of the program only.
+ */
+class MemoryAccounting
+{
+  public:
+    /// \return True if the operator new hooks are built in.
+    static constexpr bool IsHooked()
+    {
+#ifdef SLICING_MEMORY_ACCOUNTING
+        return true;
+#else
+        return false;
+#endif
+    }
+
+    /**
+     * Attribute the next allocations to a phase.
+     * \param phase The phase.
+     */
+    static void SetPhase(uint8_t phase)
+    {
+        g_memoryPhase.store(phase, std::memory_order_relaxed);
+    }
+
+    /**
+     * Start the counters of a new scenario from zero. The allocations made
+     * before are no longer counted, nor their release.
+     */
+    static void Reset()
+    {
+        g_memoryGeneration.fetch_add(1, std::memory_order_relaxed);
+        for (auto& bytes : g_memoryLiveBytes)
+        {
+            bytes.store(0, std::memory_order_relaxed);
+        }
+        g_memoryLiveAllocations.store(0, std::memory_order_relaxed);
+        g_memoryTotalBytes.store(0, std::memory_order_relaxed);
+        g_memoryPeakBytes.store(0, std::memory_order_relaxed);
+        g_memoryPhase.store(MEMORY_PHASE_OTHER, std::memory_order_relaxed);
+    }
+
+    /**
+     * \param phase The phase.
+     * \return The name of the phase.
+     */
+    static const char* GetPhaseName(uint8_t phase)
+    {
+        static const char* names[] = {"Other", "Topology", "Applications", "Monitoring", "Run"};
+        return phase < MEMORY_NUM_PHASES ? names[phase] : "Unknown";
+    }
+
+    /**
+     * \param phase The phase.
+     * \return The live heap bytes allocated during the phase.
+     */
+    static int64_t GetLiveBytes(uint8_t phase)
+    {
+        return g_memoryLiveBytes[phase].load(std::memory_order_relaxed);
+    }
+
+    /// \return The live heap bytes.
+    static int64_t GetLiveBytes()
+    {
+        return g_memoryTotalBytes.load(std::memory_order_relaxed);
+    }
+
+    /// \return The live heap allocations.
+    static int64_t GetLiveAllocations()
+    {
+        return g_memoryLiveAllocations.load(std::memory_order_relaxed);
+    }
+
+    /// \return The highest live heap bytes so far.
+    static int64_t GetPeakBytes()
+    {
+        return g_memoryPeakBytes.load(std::memory_order_relaxed);
+    }
+
+    /// \return The resident set size of the process, 0 if unknown.
+    static uint64_t GetRssBytes()
+    {
+        return ReadStatus("VmRSS:");
+    }
+
+    /// \return The peak resident set size of the process, 0 if unknown.
+    static uint64_t GetPeakRssBytes()
+    {
+        return ReadStatus("VmHWM:");
+    }
+
+    /**
+     * Allocate and account heap memory; the hook of operator new.
+     * \param size The size.
+     * \return The memory, nullptr if exhausted.
+     */
+    static void* Allocate(std::size_t size)
+    {
+        void* raw = std::malloc(size + sizeof(Header));
+        if (!raw)
+        {
+            return nullptr;
+        }
+        Header* h = static_cast<Header*>(raw);
+        h->size = size;
+        h->phase = g_memoryPhase.load(std::memory_order_relaxed);
+        h->generation = g_memoryGeneration.load(std::memory_order_relaxed);
+        g_memoryLiveBytes[h->phase].fetch_add(size, std::memory_order_relaxed);
+        g_memoryLiveAllocations.fetch_add(1, std::memory_order_relaxed);
+        int64_t total = g_memoryTotalBytes.fetch_add(size, std::memory_order_relaxed) + size;
+        int64_t peak = g_memoryPeakBytes.load(std::memory_order_relaxed);
+        while (total > peak &&
+               !g_memoryPeakBytes.compare_exchange_weak(peak, total, std::memory_order_relaxed))
+        {
+        }
+        return h + 1;
+    }
+
+    /**
+     * Free memory returned by Allocate(); the hook of operator delete.
+     * \param p The memory, or nullptr.
+     */
+    static void Free(void* p)
+    {
+        if (!p)
+        {
+            return;
+        }
+        Header* h = static_cast<Header*>(p) - 1;
+        if (h->generation != g_memoryGeneration.load(std::memory_order_relaxed))
+        {
+            std::free(h);
+            return;
+        }
+        g_memoryLiveBytes[h->phase].fetch_sub(h->size, std::memory_order_relaxed);
+        g_memoryLiveAllocations.fetch_sub(1, std::memory_order_relaxed);
+        g_memoryTotalBytes.fetch_sub(h->size, std::memory_order_relaxed);
+        std::free(h);
+    }
+
+  private:
+    /// Header of an allocation, 16 bytes to keep the alignment of malloc.
+    struct alignas(16) Header
+    {
+        uint64_t size;      //!< Requested size.
+        uint8_t phase;      //!< Phase of the allocation.
+        uint8_t generation; //!< Generation of the counters at the allocation.
+    };
+
+    /**
+     * Read a size from /proc/self/status.
+     * \param key The key, e.g. "VmRSS:".
+     * \return The size in bytes, 0 if not found.
+     */
+    static uint64_t ReadStatus(const char* key)
+    {
+        std::FILE* f = std::fopen("/proc/self/status", "r");
+        if (!f)
+        {
+            return 0;
+        }
+        char line[256];
+        unsigned long long kb = 0;
+        while (std::fgets(line, sizeof(line), f))
+        {
+            if (std::strncmp(line, key, std::strlen(key)) == 0)
+            {
+                std::sscanf(line + std::strlen(key), "%llu", &kb);
+                break;
+            }
+        }
+        std::fclose(f);
+        return kb * 1024;
+    }
+};
+
+/// Memory held by a category of objects.
+struct MemoryUsage
+{
+    uint64_t count{0}; //!< Number of objects.
+    uint64_t bytes{0}; //!< Bytes, 0 if unknown.
+};
+
+/**
+ * Periodic census of the memory held by each category of objects.
+ *
+ * Each category has a probe that returns the objects and bytes it holds,
+ * one entry per slice or a single entry for all of them, e.g. the RLC SDUs
+ * of each slice or the trace buffers. Every Interval, the RSS, the live heap
+ * of each phase and the result of every probe are written to a CSV file,
+ * one row per category and slice. Report() gives the census at the sample
+ * with the highest RSS, so the categories to shrink first stand out.
+ */
+class MemoryCensus : public Object
+{
+  public:
+    /// Returns the usage of a category, per slice or a single entry.
+    using Probe = std::function<std::vector<MemoryUsage>()>;
+
+    MemoryCensus();
+    ~MemoryCensus() override;
+
+    /**
+     * Register this type.
+     * \return The TypeId.
+     */
+    static TypeId GetTypeId();
+
+    /**
+     * Open the CSV file.
+     * \param filename The CSV file.
+     * \param sliceNames The names of the slices.
+     * \return false if the file cannot be opened.
+     */
+    bool Open(const std::string& filename, const std::vector<std::string>& sliceNames);
+
+    /**
+     * Add a category.
+     * \param name The name of the category.
+     * \param probe The probe, called on the simulation thread.
+     */
+    void AddProbe(const std::string& name, Probe probe);
+
+    /// Take a sample now and every Interval.
+    void Start();
+
+    /// Take a last sample and close the file.
+    void Stop();
+
+    /**
+     * Print the peak RSS, the heap by phase and the census at the peak.
+     * \param os The output stream.
+     */
+    void Report(std::ostream& os) const;
+
+  protected:
+    void DoDispose() override;
+
+  private:
+    /// A census of every category.
+    struct Census
+    {
+        double timeS{0};                            //!< Simulated time.
+        uint64_t rssBytes{0};                       //!< RSS of the process.
+        std::vector<std::vector<MemoryUsage>> usage; //!< Usage per category.
+    };
+
+    /// Take a sample and schedule the next one.
+    void Tick();
+    /// Take a sample.
+    void Sample();
+    /**
+     * \param entries The number of entries of a probe.
+     * \param i The entry.
+     * \return The slice label of the entry.
+     */
+    const char* GetSliceName(std::size_t entries, std::size_t i) const;
+
+    Time m_interval; //!< Time between two samples.
+
+    std::vector<std::string> m_sliceNames; //!< Names of the slices.
+    std::vector<std::string> m_names;      //!< Names of the categories.
+    std::vector<Probe> m_probes;           //!< Probes of the categories.
+    std::FILE* m_file;                     //!< CSV file.
+    EventId m_event;                       //!< Next sample.
+    Census m_last;                         //!< Last sample.
+    Census m_peak;                         //!< Sample with the highest RSS.
+};
+
+inline MemoryCensus::MemoryCensus()
+    : m_file(nullptr)
+{
+}
+
+inline MemoryCensus::~MemoryCensus()
+{
+    if (m_file)
+    {
+        std::fclose(m_file);
+    }
+}
+
+/* static */
+inline TypeId
+MemoryCensus::GetTypeId()
+{
+    static TypeId tid = TypeId("MemoryCensus")
+                            .SetParent<Object>()
+                            .SetGroupName("Tutorial")
+                            .AddConstructor<MemoryCensus>()
+                            .AddAttribute("Interval",
+                                          "Time between two samples",
+                                          TimeValue(MilliSeconds(100)),
+                                          MakeTimeAccessor(&MemoryCensus::m_interval),
+                                          MakeTimeChecker());
+    return tid;
+}
+
+inline void
+MemoryCensus::DoDispose()
+{
+    m_event.Cancel();
+    m_probes.clear();
+    Object::DoDispose();
+}
+
+inline bool
+MemoryCensus::Open(const std::string& filename, const std::vector<std::string>& sliceNames)
+{
+    m_file = std::fopen(filename.c_str(), "w");
+    if (!m_file)
+    {
+        return false;
+    }
+    m_sliceNames = sliceNames;
+    std::fprintf(m_file, "time_s,category,slice,count,bytes\n");
+    return true;
+}
+
+inline void
+MemoryCensus::AddProbe(const std::string& name, Probe probe)
+{
+    m_names.push_back(name);
+    m_probes.push_back(probe);
+}
+
+inline void
+MemoryCensus::Start()
+{
+    Tick();
+}
+
+inline void
+MemoryCensus::Stop()
+{
+    m_event.Cancel();
+    if (m_file)
+    {
+        Sample();
+        std::fclose(m_file);
+        m_file = nullptr;
+    }
+}
+
+inline void
+MemoryCensus::Tick()
+{
+    Sample();
+    m_event = Simulator::Schedule(m_interval, &MemoryCensus::Tick, this);
+}
+
+inline const char*
+MemoryCensus::GetSliceName(std::size_t entries, std::size_t i) const
+{
+    return entries == m_sliceNames.size() ? m_sliceNames[i].c_str() : "all";
+}
+
+inline void
+MemoryCensus::Sample()
+{
+    m_last.timeS = Simulator::Now().GetSeconds();
+    m_last.rssBytes = MemoryAccounting::GetRssBytes();
+    m_last.usage.resize(m_probes.size());
+    for (std::size_t c = 0; c < m_probes.size(); ++c)
+    {
+        m_last.usage[c] = m_probes[c]();
+    }
+    if (m_file)
+    {
+        std::fprintf(m_file,
+                     "%.6f,Rss,all,1,%llu\n",
+                     m_last.timeS,
+                     static_cast<unsigned long long>(m_last.rssBytes));
+        for (uint8_t phase = 0; MemoryAccounting::IsHooked() && phase < MEMORY_NUM_PHASES; ++phase)
+        {
+            std::fprintf(m_file,
+                         "%.6f,Heap%s,all,,%lld\n",
+                         m_last.timeS,
+                         MemoryAccounting::GetPhaseName(phase),
+                         static_cast<long long>(MemoryAccounting::GetLiveBytes(phase)));
+        }
+        for (std::size_t c = 0; c < m_probes.size(); ++c)
+        {
+            const auto& entries = m_last.usage[c];
+            for (std::size_t i = 0; i < entries.size(); ++i)
+            {
+                std::fprintf(m_file,
+                             "%.6f,%s,%s,%llu,%llu\n",
+                             m_last.timeS,
+                             m_names[c].c_str(),
+                             GetSliceName(entries.size(), i),
+                             static_cast<unsigned long long>(entries[i].count),
+                             static_cast<unsigned long long>(entries[i].bytes));
+            }
+        }
+    }
+    if (m_last.rssBytes >= m_peak.rssBytes)
+    {
+        m_peak = m_last;
+    }
+}
+
+inline void
+MemoryCensus::Report(std::ostream& os) const
+{
+    os << "  Peak RSS " << MemoryAccounting::GetPeakRssBytes() / 1e6 << " MB, highest sampled "
+       << m_peak.rssBytes / 1e6 << " MB at " << m_peak.timeS << " s\n";
+    if (MemoryAccounting::IsHooked())
+    {
+        os << "  Heap peak " << MemoryAccounting::GetPeakBytes() / 1e6 << " MB, live "
+           << MemoryAccounting::GetLiveBytes() / 1e6 << " MB in "
+           << MemoryAccounting::GetLiveAllocations() << " allocations:";
+        for (uint8_t phase = 0; phase < MEMORY_NUM_PHASES; ++phase)
+        {
+            os << (phase == 0 ? " " : ", ") << MemoryAccounting::GetPhaseName(phase) << " "
+               << MemoryAccounting::GetLiveBytes(phase) / 1e6 << " MB";
+        }
+        os << "\n";
+    }
+    os << "  At the sampled peak:\n";
+    for (std::size_t c = 0; c < m_peak.usage.size(); ++c)
+    {
+        const auto& entries = m_peak.usage[c];
+        os << "  " << m_names[c] << ":";
+        for (std::size_t i = 0; i < entries.size(); ++i)
+        {
+            os << (i == 0 ? " " : ", ") << GetSliceName(entries.size(), i) << " "
+               << entries[i].count << " (" << entries[i].bytes / 1e3 << " kB)";
+        }
+        os << "\n";
+    }
+}
+
+} // namespace ns3
+
+#ifdef SLICING_MEMORY_ACCOUNTING
+
+void*
+operator new(std::size_t size)
+{
+    void* p = ns3::MemoryAccounting::Allocate(size);
+    if (!p)
+    {
+        throw std::bad_alloc();
+    }
+    return p;
+}
+
+void*
+operator new[](std::size_t size)
+{
+    void* p = ns3::MemoryAccounting::Allocate(size);
+    if (!p)
+    {
+        throw std::bad_alloc();
+    }
+    return p;
+}
+
+void*
+operator new(std::size_t size, const std::nothrow_t&) noexcept
+{
+    return ns3::MemoryAccounting::Allocate(size);
+}
+
+void*
+operator new[](std::size_t size, const std::nothrow_t&) noexcept
+{
+    return ns3::MemoryAccounting::Allocate(size);
+}
+
+void
+operator delete(void* p) noexcept
+{
+    ns3::MemoryAccounting::Free(p);
+}
+
+void
+operator delete[](void* p) noexcept
+{
+    ns3::MemoryAccounting::Free(p);
+}
+
+void
+operator delete(void* p, std::size_t) noexcept
+{
+    ns3::MemoryAccounting::Free(p);
+}
+
+void
+operator delete[](void* p, std::size_t) noexcept
+{
+    ns3::MemoryAccounting::Free(p);
+}
+
+void
+operator delete(void* p, const std::nothrow_t&) noexcept
+{
+    ns3::MemoryAccounting::Free(p);
+}
+
+void
+operator delete[](void* p, const std::nothrow_t&) noexcept
+{
+    ns3::MemoryAccounting::Free(p);
+}
+
+#endif /* SLICING_MEMORY_ACCOUNTING */
+
+#endif /* SLICING_MEMORY_ACCOUNTING_H */
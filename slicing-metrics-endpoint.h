@@ -0,0 +1,413 @@
+#ifndef SLICING_METRICS_ENDPOINT_H
+#define SLICING_METRICS_ENDPOINT_H
+
+#include "ns3/core-module.h"
+
+#include "slicing-steady-state.h"
+
+#include <arpa/inet.h>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <functional>
+#include <netinet/in.h>
+#include <poll.h>
+#include <sstream>
+#include <string>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <thread>
+#include <unistd.h>
+#include <utility>
+#include <vector>
+
+namespace ns3
+{
+
+/**
+ * Live metrics of a running simulation in the Prometheus text format.
+ *
+ * A server thread answers every HTTP request on a local TCP port, or on a
+ * Unix socket, with the latest snapshot: the simulated time, the number of
+ * events and the events per wall-clock second, the resident memory and the
+ * cumulative flow monitor counters of each slice. The simulation thread
+ * publishes a snapshot every Period of simulated time, from a timer event;
+ * the snapshot only reads the state, so the results of the run are the same
+ * with or without the endpoint. The counters of the slices are scalars, the
+ * source need not fill the delay histograms. The snapshots go through a
+ * triple buffer: neither thread waits for the other.
+ */
+class MetricsEndpoint : public Object
+{
+  public:
+    /// Returns the cumulative counters of each slice and direction, histograms not needed.
+    using SliceSource = std::function<std::vector<SliceCounters>()>;
+
+    MetricsEndpoint();
+    ~MetricsEndpoint() override;
+
+    /**
+     * Register this type.
+     * \return The TypeId.
+     */
+    static TypeId GetTypeId();
+
+    /**
+     * Set the source of the per-slice counters.
+     * \param labels The "slice" and "direction" labels of each entry, e.g. {"VR", "DL"}.
+     * \param source The source, called on the simulation thread.
+     */
+    void SetSliceSource(const std::vector<std::pair<std::string, std::string>>& labels,
+                        SliceSource source);
+
+    /**
+     * Listen on Port, or on SocketPath if set, start the server thread and
+     * publish a snapshot every Period.
+     * \return false if the socket cannot be opened.
+     */
+    bool Start();
+
+    /**
+     * Stop the snapshots and the server thread, and close the socket.
+     */
+    void Stop();
+
+  protected:
+    void DoDispose() override;
+
+  private:
+    /// The metrics published by the simulation thread.
+    struct Snapshot
+    {
+        double simTimeS{0};                 //!< Simulated time.
+        uint64_t events{0};                 //!< Events executed.
+        double eventsPerS{0};               //!< Events per wall-clock second.
+        double wallS{0};                    //!< Wall-clock time since Start().
+        std::vector<SliceCounters> slices;  //!< Counters of each slice and direction.
+    };
+
+    /// Publish a snapshot and schedule the next one.
+    void Tick();
+    /// Fill the back buffer and swap it with the middle one.
+    void Publish();
+    /// Accept and answer the requests until Stop().
+    void ServerLoop();
+    /**
+     * Format the latest snapshot.
+     * \return The Prometheus text.
+     */
+    std::string Format();
+
+    uint16_t m_port;          //!< TCP port on the loopback interface.
+    std::string m_socketPath; //!< Unix socket, instead of the TCP port.
+    Time m_period;            //!< Simulated time between two snapshots.
+
+    std::vector<std::pair<std::string, std::string>> m_labels; //!< Labels of the slices.
+    SliceSource m_source;                                     //!< Source of the slice counters.
+
+    std::array<Snapshot, 3> m_snapshots; //!< Triple buffer.
+    std::atomic<uint8_t> m_middle;       //!< Middle buffer, bit 2 set if not read yet.
+    uint8_t m_back;                      //!< Buffer written by the simulation thread.
+    uint8_t m_front;                     //!< Buffer read by the server thread.
+
+    std::chrono::steady_clock::time_point m_startWall; //!< Wall-clock time of Start().
+    std::chrono::steady_clock::time_point m_lastWall;  //!< Wall-clock time of the last snapshot.
+    uint64_t m_lastEvents;   //!< Events at the last snapshot.
+    EventId m_tickEvent;     //!< Next snapshot.
+
+    int m_fd;                     //!< Listening socket.
+    std::atomic<bool> m_stopping; //!< Set by Stop().
+    std::thread m_server;         //!< Server thread.
+};
+
+inline MetricsEndpoint::MetricsEndpoint()
+    : m_port(9464),
+      m_middle(1),
+      m_back(0),
+      m_front(2),
+      m_lastEvents(0),
+      m_fd(-1),
+      m_stopping(false)
+{
+}
+
+inline MetricsEndpoint::~MetricsEndpoint()
+{
+    Stop();
+}
+
+/* static */
+inline TypeId
+MetricsEndpoint::GetTypeId()
+{
+    static TypeId tid =
+        TypeId("MetricsEndpoint")
+            .SetParent<Object>()
+            .SetGroupName("Tutorial")
+            .AddConstructor<MetricsEndpoint>()
+            .AddAttribute("Port",
+                          "TCP port on 127.0.0.1",
+                          UintegerValue(9464),
+                          MakeUintegerAccessor(&MetricsEndpoint::m_port),
+                          MakeUintegerChecker<uint16_t>(1))
+            .AddAttribute("SocketPath",
+                          "Unix socket to listen on instead of the TCP port, if not empty",
+                          StringValue(""),
+                          MakeStringAccessor(&MetricsEndpoint::m_socketPath),
+                          MakeStringChecker())
+            .AddAttribute("Period",
+                          "Simulated time between two snapshots",
+                          TimeValue(Seconds(1)),
+                          MakeTimeAccessor(&MetricsEndpoint::m_period),
+                          MakeTimeChecker());
+    return tid;
+}
+
+inline void
+MetricsEndpoint::DoDispose()
+{
+    Stop();
+    m_source = nullptr;
+    Object::DoDispose();
+}
+
+inline void
+MetricsEndpoint::SetSliceSource(const std::vector<std::pair<std::string, std::string>>& labels,
+                                SliceSource source)
+{
+    m_labels = labels;
+    m_source = source;
+}
+
+inline bool
+MetricsEndpoint::Start()
+{
+    if (m_socketPath.empty())
+    {
+        m_fd = socket(AF_INET, SOCK_STREAM, 0);
+        int on = 1;
+        setsockopt(m_fd, SOL_SOCKET, SO_REUSEADDR, &on, sizeof(on));
+        sockaddr_in addr;
+        std::memset(&addr, 0, sizeof(addr));
+        addr.sin_family = AF_INET;
+        addr.sin_port = htons(m_port);
+        addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        if (m_fd < 0 || bind(m_fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) != 0)
+        {
+            Stop();
+            return false;
+        }
+    }
+    else
+    {
+        m_fd = socket(AF_UNIX, SOCK_STREAM, 0);
+        sockaddr_un addr;
+        std::memset(&addr, 0, sizeof(addr));
+        addr.sun_family = AF_UNIX;
+        std::strncpy(addr.sun_path, m_socketPath.c_str(), sizeof(addr.sun_path) - 1);
+        unlink(m_socketPath.c_str());
+        if (m_fd < 0 || bind(m_fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) != 0)
+        {
+            Stop();
+            return false;
+        }
+    }
+    if (listen(m_fd, 4) != 0)
+    {
+        Stop();
+        return false;
+    }
+    m_startWall = std::chrono::steady_clock::now();
+    m_lastWall = m_startWall;
+    m_lastEvents = Simulator::GetEventCount();
+    Publish();
+    m_stopping = false;
+    m_server = std::thread(&MetricsEndpoint::ServerLoop, this);
+    m_tickEvent = Simulator::Schedule(m_period, &MetricsEndpoint::Tick, this);
+    return true;
+}
+
+inline void
+MetricsEndpoint::Stop()
+{
+    Simulator::Cancel(m_tickEvent);
+    if (m_server.joinable())
+    {
+        m_stopping.store(true, std::memory_order_release);
+        m_server.join();
+    }
+    if (m_fd >= 0)
+    {
+        close(m_fd);
+        m_fd = -1;
+        if (!m_socketPath.empty())
+        {
+            unlink(m_socketPath.c_str());
+        }
+    }
+}
+
+inline void
+MetricsEndpoint::Tick()
+{
+    Publish();
+    m_tickEvent = Simulator::Schedule(m_period, &MetricsEndpoint::Tick, this);
+}
+
+inline void
+MetricsEndpoint::Publish()
+{
+    auto now = std::chrono::steady_clock::now();
+    uint64_t events = Simulator::GetEventCount();
+    double elapsed = std::chrono::duration<double>(now - m_lastWall).count();
+
+    Snapshot& s = m_snapshots[m_back];
+    s.simTimeS = Simulator::Now().GetSeconds();
+    s.events = events;
+    if (elapsed > 0)
+    {
+        s.eventsPerS = (events - m_lastEvents) / elapsed;
+    }
+    s.wallS = std::chrono::duration<double>(now - m_startWall).count();
+    if (m_source)
+    {
+        s.slices = m_source();
+    }
+    m_lastWall = now;
+    m_lastEvents = events;
+    m_back = m_middle.exchange(m_back | 4, std::memory_order_acq_rel) & 3;
+}
+
+inline std::string
+MetricsEndpoint::Format()
+{
+    if (m_middle.load(std::memory_order_acquire) & 4)
+    {
+        m_front = m_middle.exchange(m_front, std::memory_order_acq_rel) & 3;
+    }
+    const Snapshot& s = m_snapshots[m_front];
+
+    // the resident set of the whole process, read here to spare the simulation thread
+    uint64_t rssBytes = 0;
+    if (std::FILE* f = std::fopen("/proc/self/statm", "r"))
+    {
+        unsigned long long size = 0;
+        unsigned long long resident = 0;
+        if (std::fscanf(f, "%llu %llu", &size, &resident) == 2)
+        {
+            rssBytes = resident * sysconf(_SC_PAGESIZE);
+        }
+        std::fclose(f);
+    }
+
+    std::ostringstream os;
+    os << "# HELP nrslicing_sim_time_seconds Simulated time.\n"
+       << "# TYPE nrslicing_sim_time_seconds gauge\n"
+       << "nrslicing_sim_time_seconds " << s.simTimeS << "\n"
+       << "# HELP nrslicing_events_total Events executed by the simulator.\n"
+       << "# TYPE nrslicing_events_total counter\n"
+       << "nrslicing_events_total " << s.events << "\n"
+       << "# HELP nrslicing_events_per_second Events per wall-clock second.\n"
+       << "# TYPE nrslicing_events_per_second gauge\n"
+       << "nrslicing_events_per_second " << s.eventsPerS << "\n"
+       << "# HELP nrslicing_wall_seconds Wall-clock time since the start of the run.\n"
+       << "# TYPE nrslicing_wall_seconds gauge\n"
+       << "nrslicing_wall_seconds " << s.wallS << "\n"
+       << "# HELP nrslicing_resident_memory_bytes Resident set size of the process.\n"
+       << "# TYPE nrslicing_resident_memory_bytes gauge\n"
+       << "nrslicing_resident_memory_bytes " << rssBytes << "\n";
+
+    struct
+    {
+        const char* name;
+        const char* help;
+        const char* type;
+    } families[] = {
+        {"nrslicing_slice_rx_bytes_total", "Bytes received by the flows of a slice.", "counter"},
+        {"nrslicing_slice_rx_packets_total",
+         "Packets received by the flows of a slice.",
+         "counter"},
+        {"nrslicing_slice_lost_packets_total",
+         "Packets of a slice declared lost by the flow monitor.",
+         "counter"},
+        {"nrslicing_slice_mean_delay_seconds",
+         "Mean delay of the packets of a slice since the start.",
+         "gauge"},
+    };
+    for (uint32_t m = 0; m < 4; ++m)
+    {
+        os << "# HELP " << families[m].name << " " << families[m].help << "\n"
+           << "# TYPE " << families[m].name << " " << families[m].type << "\n";
+        for (uint32_t i = 0; i < s.slices.size() && i < m_labels.size(); ++i)
+        {
+            const SliceCounters& c = s.slices[i];
+            os << families[m].name << "{slice=\"" << m_labels[i].first << "\",direction=\""
+               << m_labels[i].second << "\"} ";
+            switch (m)
+            {
+            case 0:
+                os << c.rxBytes;
+                break;
+            case 1:
+                os << c.rxPackets;
+                break;
+            case 2:
+                os << c.lostPackets;
+                break;
+            default:
+                os << (c.rxPackets > 0 ? c.delaySum / c.rxPackets : 0);
+            }
+            os << "\n";
+        }
+    }
+    return os.str();
+}
+
+inline void
+MetricsEndpoint::ServerLoop()
+{
+    while (!m_stopping.load(std::memory_order_acquire))
+    {
+        pollfd p = {m_fd, POLLIN, 0};
+        if (poll(&p, 1, 200) <= 0)
+        {
+            continue;
+        }
+        int client = accept(m_fd, nullptr, nullptr);
+        if (client < 0)
+        {
+            continue;
+        }
+        // any request gets the metrics; the request itself is not parsed
+        char request[1024];
+        pollfd c = {client, POLLIN, 0};
+        if (poll(&c, 1, 1000) > 0)
+        {
+            recv(client, request, sizeof(request), 0);
+        }
+        std::string body = Format();
+        std::ostringstream response;
+        response << "HTTP/1.0 200 OK\r\n"
+                 << "Content-Type: text/plain; version=0.0.4\r\n"
+                 << "Content-Length: " << body.size() << "\r\n"
+                 << "Connection: close\r\n\r\n"
+                 << body;
+        std::string r = response.str();
+        for (std::size_t sent = 0; sent < r.size();)
+        {
+            ssize_t n = send(client, r.data() + sent, r.size() - sent, MSG_NOSIGNAL);
+            if (n <= 0)
+            {
+                break;
+            }
+            sent += n;
+        }
+        close(client);
+    }
+}
+
+} // namespace ns3
+
+#endif /* SLICING_METRICS_ENDPOINT_H */
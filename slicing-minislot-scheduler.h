@@ -0,0 +1,258 @@
+#ifndef SLICING_MINISLOT_SCHEDULER_H
+#define SLICING_MINISLOT_SCHEDULER_H
+
+#include "ns3/core-module.h"
+#include "ns3/nr-mac-scheduler-tdma-rr.h"
+#include "ns3/nr-module.h"
+
+#include "slicing-buffer-status.h"
+#include "slicing-ue-registry.h"
+
+#include <functional>
+
+namespace ns3
+{
+
+/**
+ * TDMA round-robin scheduler with mini-slots on one BWP and a priority slice.
+ *
+ * The TDMA schedulers hand out the symbols of a slot one at a time to the
+ * UE that comes first in the order of the scheduler. On the BWP MiniSlotBwp,
+ * a UE whose allocation is not yet a whole number of MiniSlotSymbols symbols
+ * (2, 4 or 7, the mini-slot lengths of NR) comes first, so every UE gets
+ * contiguous mini-slots and the round robin moves between mini-slots rather
+ * than single symbols. A UE with little data thus takes one short
+ * mini-slot and leaves the rest of the slot to the others. The other BWPs,
+ * or all of them with MiniSlotSymbols 0, are scheduled as by
+ * NrMacSchedulerTdmaRR.
+ *
+ * With a PrioritySlice, the UEs of that slice, found by RNTI in the
+ * Registry, come before all the others whenever they have data: on a BWP
+ * shared with other slices they take the symbols they need and the others
+ * share the rest, so urgent data never waits behind a long allocation of
+ * another slice scheduled after it arrived.
+ *
+ * The scheduler still runs once per slot: a mini-slot is a short allocation
+ * within the slot, not a scheduling occasion of its own. The processing
+ * delays of the BWP (N0/N1/N2 of the gNB PHY) set how soon new data and its
+ * HARQ feedback follow.
+ *
+ * With a BufferStatus, the DL RLC buffer reports and the UL BSRs the
+ * scheduler receives are also forwarded there, so the RLC queues of each
+ * slice can be read without touching the RLC.
+ */
+class NrMacSchedulerTdmaMiniSlot : public NrMacSchedulerTdmaRR
+{
+  public:
+    NrMacSchedulerTdmaMiniSlot();
+    ~NrMacSchedulerTdmaMiniSlot() override;
+
+    /**
+     * Register this type.
+     * \return The TypeId.
+     */
+    static TypeId GetTypeId();
+
+    /**
+     * Forward the DL RLC buffer status to the BufferStatus, then schedule as before.
+     * \param params The buffer status of a logical channel.
+     */
+    void DoSchedDlRlcBufferReq(
+        const NrMacSchedSapProvider::SchedDlRlcBufferReqParameters& params) override;
+
+    /**
+     * Forward the UL BSRs to the BufferStatus, then schedule as before.
+     * \param params The MAC control elements received.
+     */
+    void DoSchedUlMacCtrlInfoReq(
+        const NrMacSchedSapProvider::SchedUlMacCtrlInfoReqParameters& params) override;
+
+  protected:
+    /// \return The order of the UEs in DL, see Order().
+    std::function<bool(const NrMacSchedulerNs3::UePtrAndBufferReq& lhs,
+                       const NrMacSchedulerNs3::UePtrAndBufferReq& rhs)>
+    GetUeCompareDlFn() const override;
+
+    /// \return The order of the UEs in UL, see Order().
+    std::function<bool(const NrMacSchedulerNs3::UePtrAndBufferReq& lhs,
+                       const NrMacSchedulerNs3::UePtrAndBufferReq& rhs)>
+    GetUeCompareUlFn() const override;
+
+  private:
+    /// \return True if this scheduler allocates mini-slots.
+    bool IsMiniSlotBwp() const;
+
+    /**
+     * Order the UEs: the priority slice first, then the open mini-slots, then round robin.
+     * \param roundRobin The order of the round robin.
+     * \param dl True for DL, false for UL.
+     * \return The order.
+     */
+    std::function<bool(const NrMacSchedulerNs3::UePtrAndBufferReq& lhs,
+                       const NrMacSchedulerNs3::UePtrAndBufferReq& rhs)>
+    Order(std::function<bool(const NrMacSchedulerNs3::UePtrAndBufferReq& lhs,
+                             const NrMacSchedulerNs3::UePtrAndBufferReq& rhs)> roundRobin,
+          bool dl) const;
+
+    uint8_t m_miniSlotSymbols;       //!< Symbols of a mini-slot, 0 for slot-based scheduling.
+    uint16_t m_miniSlotBwp;          //!< BWP with mini-slots, UINT16_MAX for all.
+    uint8_t m_prioritySlice;         //!< Slice served first, UINT8_MAX for none.
+    Ptr<SliceUeRegistry> m_registry; //!< UEs and their slices.
+    Ptr<SliceBufferStatus> m_bufferStatus; //!< Receiver of the buffer status, if any.
+};
+
+inline NrMacSchedulerTdmaMiniSlot::NrMacSchedulerTdmaMiniSlot()
+    : m_miniSlotSymbols(0),
+      m_miniSlotBwp(UINT16_MAX),
+      m_prioritySlice(UINT8_MAX)
+{
+}
+
+inline NrMacSchedulerTdmaMiniSlot::~NrMacSchedulerTdmaMiniSlot()
+{
+}
+
+/* static */
+inline TypeId
+NrMacSchedulerTdmaMiniSlot::GetTypeId()
+{
+    static TypeId tid =
+        TypeId("NrMacSchedulerTdmaMiniSlot")
+            .SetParent<NrMacSchedulerTdmaRR>()
+            .SetGroupName("Tutorial")
+            .AddConstructor<NrMacSchedulerTdmaMiniSlot>()
+            .AddAttribute("MiniSlotSymbols",
+                          "Symbols of a mini-slot (2, 4 or 7), 0 for slot-based scheduling",
+                          UintegerValue(0),
+                          MakeUintegerAccessor(&NrMacSchedulerTdmaMiniSlot::m_miniSlotSymbols),
+                          MakeUintegerChecker<uint8_t>(0, 7))
+            .AddAttribute("MiniSlotBwp",
+                          "BWP scheduled in mini-slots, 65535 for all",
+                          UintegerValue(UINT16_MAX),
+                          MakeUintegerAccessor(&NrMacSchedulerTdmaMiniSlot::m_miniSlotBwp),
+                          MakeUintegerChecker<uint16_t>())
+            .AddAttribute("PrioritySlice",
+                          "Slice whose UEs are served before all the others, 255 for none",
+                          UintegerValue(UINT8_MAX),
+                          MakeUintegerAccessor(&NrMacSchedulerTdmaMiniSlot::m_prioritySlice),
+                          MakeUintegerChecker<uint8_t>())
+            .AddAttribute("Registry",
+                          "Slice of each UE, for the PrioritySlice",
+                          PointerValue(),
+                          MakePointerAccessor(&NrMacSchedulerTdmaMiniSlot::m_registry),
+                          MakePointerChecker<SliceUeRegistry>())
+            .AddAttribute("BufferStatus",
+                          "Receiver of the DL RLC buffer status and UL BSRs, if any",
+                          PointerValue(),
+                          MakePointerAccessor(&NrMacSchedulerTdmaMiniSlot::m_bufferStatus),
+                          MakePointerChecker<SliceBufferStatus>());
+    return tid;
+}
+
+inline void
+NrMacSchedulerTdmaMiniSlot::DoSchedDlRlcBufferReq(
+    const NrMacSchedSapProvider::SchedDlRlcBufferReqParameters& params)
+{
+    if (m_bufferStatus)
+    {
+        m_bufferStatus->Report(0,
+                               GetBwpId(),
+                               params.m_rnti,
+                               params.m_logicalChannelIdentity,
+                               params.m_rlcTransmissionQueueSize +
+                                   params.m_rlcRetransmissionQueueSize +
+                                   params.m_rlcStatusPduSize);
+    }
+    NrMacSchedulerTdmaRR::DoSchedDlRlcBufferReq(params);
+}
+
+inline void
+NrMacSchedulerTdmaMiniSlot::DoSchedUlMacCtrlInfoReq(
+    const NrMacSchedSapProvider::SchedUlMacCtrlInfoReqParameters& params)
+{
+    if (m_bufferStatus)
+    {
+        for (const auto& element : params.m_macCeList)
+        {
+            if (element.m_macCeType != MacCeElement::BSR)
+            {
+                continue;
+            }
+            const auto& levels = element.m_macCeValue.m_bufferStatus;
+            for (uint8_t lcg = 0; lcg < levels.size(); ++lcg)
+            {
+                m_bufferStatus->Report(1,
+                                       GetBwpId(),
+                                       element.m_rnti,
+                                       lcg,
+                                       NrMacShortBsrCe::FromLevelToBytes(levels[lcg]));
+            }
+        }
+    }
+    NrMacSchedulerTdmaRR::DoSchedUlMacCtrlInfoReq(params);
+}
+
+inline bool
+NrMacSchedulerTdmaMiniSlot::IsMiniSlotBwp() const
+{
+    return m_miniSlotSymbols > 0 && (m_miniSlotBwp == UINT16_MAX || m_miniSlotBwp == GetBwpId());
+}
+
+inline std::function<bool(const NrMacSchedulerNs3::UePtrAndBufferReq& lhs,
+                          const NrMacSchedulerNs3::UePtrAndBufferReq& rhs)>
+NrMacSchedulerTdmaMiniSlot::GetUeCompareDlFn() const
+{
+    return Order(NrMacSchedulerTdmaRR::GetUeCompareDlFn(), true);
+}
+
+inline std::function<bool(const NrMacSchedulerNs3::UePtrAndBufferReq& lhs,
+                          const NrMacSchedulerNs3::UePtrAndBufferReq& rhs)>
+NrMacSchedulerTdmaMiniSlot::GetUeCompareUlFn() const
+{
+    return Order(NrMacSchedulerTdmaRR::GetUeCompareUlFn(), false);
+}
+
+inline std::function<bool(const NrMacSchedulerNs3::UePtrAndBufferReq& lhs,
+                          const NrMacSchedulerNs3::UePtrAndBufferReq& rhs)>
+NrMacSchedulerTdmaMiniSlot::Order(
+    std::function<bool(const NrMacSchedulerNs3::UePtrAndBufferReq& lhs,
+                       const NrMacSchedulerNs3::UePtrAndBufferReq& rhs)> roundRobin,
+    bool dl) const
+{
+    uint8_t length = IsMiniSlotBwp() ? m_miniSlotSymbols : 0;
+    Ptr<SliceUeRegistry> registry = m_prioritySlice != UINT8_MAX ? m_registry : nullptr;
+    if (length == 0 && !registry)
+    {
+        return roundRobin;
+    }
+    uint8_t prioritySlice = m_prioritySlice;
+    return [roundRobin, length, registry, prioritySlice, dl](
+               const NrMacSchedulerNs3::UePtrAndBufferReq& lhs,
+               const NrMacSchedulerNs3::UePtrAndBufferReq& rhs) {
+        if (registry)
+        {
+            bool lhsUrgent = registry->GetSliceOfRnti(lhs.first->m_rnti) == prioritySlice;
+            bool rhsUrgent = registry->GetSliceOfRnti(rhs.first->m_rnti) == prioritySlice;
+            if (lhsUrgent != rhsUrgent)
+            {
+                return lhsUrgent;
+            }
+        }
+        if (length > 0)
+        {
+            uint32_t lhsSym = dl ? lhs.first->m_dlSym : lhs.first->m_ulSym;
+            uint32_t rhsSym = dl ? rhs.first->m_dlSym : rhs.first->m_ulSym;
+            bool lhsOpen = lhsSym % length != 0;
+            bool rhsOpen = rhsSym % length != 0;
+            if (lhsOpen != rhsOpen)
+            {
+                return lhsOpen;
+            }
+        }
+        return roundRobin(lhs, rhs);
+    };
+}
+
+} // namespace ns3
+
+#endif /* SLICING_MINISLOT_SCHEDULER_H */
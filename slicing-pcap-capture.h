@@ -0,0 +1,304 @@
+#ifndef SLICING_PCAP_CAPTURE_H
+#define SLICING_PCAP_CAPTURE_H
+
+#include "ns3/core-module.h"
+#include "ns3/network-module.h"
+
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <fstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace ns3
+{
+
+/**
+ * Asynchronous PCAP capture of the packets of a trace, e.g. the drops.
+ *
+ * Capture() copies the first SnapLen bytes of a packet into a slot of a
+ * single-producer, single-consumer ring and returns; it never blocks nor
+ * touches the file. A background thread drains the ring into the PCAP file.
+ * When the ring is full the packet is counted and not captured, so a slow
+ * disk never stalls the simulation. SamplingPeriod keeps one of N packets,
+ * and Budget stops the capture after that many packets. Capture() must be
+ * called from a single thread, the simulation thread.
+ */
+class AsyncPcapCapture : public Object
+{
+  public:
+    AsyncPcapCapture();
+    ~AsyncPcapCapture() override;
+
+    /**
+     * Register this type.
+     * \return The TypeId.
+     */
+    static TypeId GetTypeId();
+
+    /**
+     * Open the PCAP file, allocate the ring and start the writer thread.
+     * \param filename The PCAP file.
+     * \param dataLinkType The PCAP data link type, e.g. PcapHelper::DLT_PPP.
+     * \return false if the file cannot be opened.
+     */
+    bool Open(const std::string& filename, uint32_t dataLinkType);
+
+    /**
+     * Capture a packet; the signature of most packet trace sources.
+     * \param p The packet.
+     */
+    void Capture(Ptr<const Packet> p);
+
+    /**
+     * Drain the ring, stop the writer thread and close the file.
+     */
+    void Close();
+
+    /// \return The number of packets seen by Capture().
+    uint64_t GetNumSeen() const;
+    /// \return The number of packets written or queued.
+    uint64_t GetNumCaptured() const;
+    /// \return The number of packets lost to a full ring.
+    uint64_t GetNumRingDrops() const;
+    /// \return The number of packets not captured because the budget was spent.
+    uint64_t GetNumOverBudget() const;
+
+  protected:
+    void DoDispose() override;
+
+  private:
+    /// Header of a captured packet.
+    struct Slot
+    {
+        int64_t timeNs;      //!< Capture time.
+        uint32_t origLen;    //!< Packet size.
+        uint32_t capLen;     //!< Captured bytes.
+    };
+
+    /// Write the ring to the file until Close().
+    void WriterLoop();
+    /**
+     * Write the slots between the consumer and the producer index.
+     * \return The number of slots written.
+     */
+    uint64_t Drain();
+
+    uint32_t m_snapLen;        //!< Captured bytes per packet.
+    uint32_t m_ringSize;       //!< Slots in the ring.
+    uint64_t m_budget;         //!< Maximum packets captured, 0 for no limit.
+    uint32_t m_samplingPeriod; //!< Capture one of N packets.
+
+    std::vector<Slot> m_slots;   //!< Slot headers.
+    std::vector<uint8_t> m_data; //!< Slot data, m_snapLen bytes per slot.
+    std::atomic<uint64_t> m_head; //!< Next slot written by the producer.
+    std::atomic<uint64_t> m_tail; //!< Next slot read by the consumer.
+    uint64_t m_cachedTail;        //!< Producer copy of m_tail.
+
+    uint64_t m_seen;          //!< Packets seen.
+    uint64_t m_captured;      //!< Packets queued.
+    uint64_t m_ringDrops;     //!< Packets lost to a full ring.
+    uint64_t m_overBudget;    //!< Packets over the budget.
+
+    std::atomic<bool> m_closing; //!< Set by Close().
+    std::thread m_writer;        //!< Writer thread.
+    std::ofstream m_file;        //!< PCAP file.
+};
+
+inline AsyncPcapCapture::AsyncPcapCapture()
+    : m_snapLen(96),
+      m_ringSize(4096),
+      m_budget(0),
+      m_samplingPeriod(1),
+      m_head(0),
+      m_tail(0),
+      m_cachedTail(0),
+      m_seen(0),
+      m_captured(0),
+      m_ringDrops(0),
+      m_overBudget(0),
+      m_closing(false)
+{
+}
+
+inline AsyncPcapCapture::~AsyncPcapCapture()
+{
+    Close();
+}
+
+/* static */
+inline TypeId
+AsyncPcapCapture::GetTypeId()
+{
+    static TypeId tid =
+        TypeId("AsyncPcapCapture")
+            .SetParent<Object>()
+            .SetGroupName("Tutorial")
+            .AddConstructor<AsyncPcapCapture>()
+            .AddAttribute("SnapLen",
+                          "Number of bytes captured per packet",
+                          UintegerValue(96),
+                          MakeUintegerAccessor(&AsyncPcapCapture::m_snapLen),
+                          MakeUintegerChecker<uint32_t>(1, 65535))
+            .AddAttribute("RingSize",
+                          "Number of packets the ring holds before captures are lost",
+                          UintegerValue(4096),
+                          MakeUintegerAccessor(&AsyncPcapCapture::m_ringSize),
+                          MakeUintegerChecker<uint32_t>(1))
+            .AddAttribute("Budget",
+                          "Maximum number of packets captured, 0 for no limit",
+                          UintegerValue(0),
+                          MakeUintegerAccessor(&AsyncPcapCapture::m_budget),
+                          MakeUintegerChecker<uint64_t>())
+            .AddAttribute("SamplingPeriod",
+                          "Capture one of N packets",
+                          UintegerValue(1),
+                          MakeUintegerAccessor(&AsyncPcapCapture::m_samplingPeriod),
+                          MakeUintegerChecker<uint32_t>(1));
+    return tid;
+}
+
+inline void
+AsyncPcapCapture::DoDispose()
+{
+    Close();
+    Object::DoDispose();
+}
+
+inline bool
+AsyncPcapCapture::Open(const std::string& filename, uint32_t dataLinkType)
+{
+    m_file.open(filename.c_str(), std::ofstream::out | std::ofstream::binary);
+    if (!m_file.is_open())
+    {
+        return false;
+    }
+    // classic PCAP global header, microsecond timestamps
+    uint32_t magic = 0xa1b2c3d4;
+    uint16_t versionMajor = 2;
+    uint16_t versionMinor = 4;
+    int32_t thisZone = 0;
+    uint32_t sigFigs = 0;
+    m_file.write(reinterpret_cast<const char*>(&magic), 4);
+    m_file.write(reinterpret_cast<const char*>(&versionMajor), 2);
+    m_file.write(reinterpret_cast<const char*>(&versionMinor), 2);
+    m_file.write(reinterpret_cast<const char*>(&thisZone), 4);
+    m_file.write(reinterpret_cast<const char*>(&sigFigs), 4);
+    m_file.write(reinterpret_cast<const char*>(&m_snapLen), 4);
+    m_file.write(reinterpret_cast<const char*>(&dataLinkType), 4);
+
+    m_slots.resize(m_ringSize);
+    m_data.resize(static_cast<std::size_t>(m_ringSize) * m_snapLen);
+    m_head = 0;
+    m_tail = 0;
+    m_cachedTail = 0;
+    m_closing = false;
+    m_writer = std::thread(&AsyncPcapCapture::WriterLoop, this);
+    return true;
+}
+
+inline void
+AsyncPcapCapture::Capture(Ptr<const Packet> p)
+{
+    if (m_seen++ % m_samplingPeriod != 0 || !m_writer.joinable())
+    {
+        return;
+    }
+    if (m_budget > 0 && m_captured >= m_budget)
+    {
+        ++m_overBudget;
+        return;
+    }
+    uint64_t head = m_head.load(std::memory_order_relaxed);
+    if (head - m_cachedTail == m_ringSize)
+    {
+        m_cachedTail = m_tail.load(std::memory_order_acquire);
+        if (head - m_cachedTail == m_ringSize)
+        {
+            ++m_ringDrops;
+            return;
+        }
+    }
+    uint64_t index = head % m_ringSize;
+    Slot& slot = m_slots[index];
+    slot.timeNs = Simulator::Now().GetNanoSeconds();
+    slot.origLen = p->GetSize();
+    slot.capLen = p->CopyData(&m_data[index * m_snapLen], m_snapLen);
+    m_head.store(head + 1, std::memory_order_release);
+    ++m_captured;
+}
+
+inline uint64_t
+AsyncPcapCapture::Drain()
+{
+    uint64_t tail = m_tail.load(std::memory_order_relaxed);
+    uint64_t head = m_head.load(std::memory_order_acquire);
+    for (uint64_t i = tail; i < head; ++i)
+    {
+        uint64_t index = i % m_ringSize;
+        const Slot& slot = m_slots[index];
+        uint32_t record[4] = {static_cast<uint32_t>(slot.timeNs / 1000000000),
+                              static_cast<uint32_t>(slot.timeNs % 1000000000 / 1000),
+                              slot.capLen,
+                              slot.origLen};
+        m_file.write(reinterpret_cast<const char*>(record), sizeof(record));
+        m_file.write(reinterpret_cast<const char*>(&m_data[index * m_snapLen]), slot.capLen);
+    }
+    m_tail.store(head, std::memory_order_release);
+    return head - tail;
+}
+
+inline void
+AsyncPcapCapture::WriterLoop()
+{
+    while (!m_closing.load(std::memory_order_acquire))
+    {
+        if (Drain() == 0)
+        {
+            std::this_thread::sleep_for(std::chrono::microseconds(500));
+        }
+    }
+    Drain();
+}
+
+inline void
+AsyncPcapCapture::Close()
+{
+    if (!m_writer.joinable())
+    {
+        return;
+    }
+    m_closing.store(true, std::memory_order_release);
+    m_writer.join();
+    m_file.close();
+}
+
+inline uint64_t
+AsyncPcapCapture::GetNumSeen() const
+{
+    return m_seen;
+}
+
+inline uint64_t
+AsyncPcapCapture::GetNumCaptured() const
+{
+    return m_captured;
+}
+
+inline uint64_t
+AsyncPcapCapture::GetNumRingDrops() const
+{
+    return m_ringDrops;
+}
+
+inline uint64_t
+AsyncPcapCapture::GetNumOverBudget() const
+{
+    return m_overBudget;
+}
+
+} // namespace ns3
+
+#endif /* SLICING_PCAP_CAPTURE_H */
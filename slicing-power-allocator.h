@@ -0,0 +1,431 @@
+#ifndef SLICING_POWER_ALLOCATOR_H
+#define SLICING_POWER_ALLOCATOR_H
+
+#include "ns3/core-module.h"
+#include "ns3/nr-module.h"
+
+#include "slicing-ue-registry.h"
+
+#include <cmath>
+#include <ostream>
+#include <string>
+#include <vector>
+
+namespace ns3
+{
+
+/**
+ * Slice-aware split of the gNB transmit power across bandwidth parts.
+ *
+ * A BWP carries the slices whose bearers map to it, one or more; it takes
+ * the SLA weight the caller derives from them. The allocator measures the RB utilization and
+ * the bits of new transmissions of each BWP, and every UpdatePeriod assigns
+ * the TotalTxPower in proportion to bandwidth x SLA weight x demand, where the
+ * demand is the smoothed RB utilization. Each BWP keeps at least MinShare of
+ * its bandwidth-proportional power. When Adaptive is false the initial
+ * bandwidth-proportional split is kept and only the efficiency is measured.
+ *
+ * The efficiency is also reported per slice. The grants are attributed to the
+ * slices by RNTI, through the registry, and each period the energy of a BWP is
+ * shared among its slices by the RB x symbols of their grants, retransmissions
+ * included. The energy of a BWP in a period without grants is counted as idle.
+ */
+class SlicePowerAllocator : public Object
+{
+  public:
+    SlicePowerAllocator();
+    ~SlicePowerAllocator() override;
+
+    /**
+     * Register this type.
+     * \return The TypeId.
+     */
+    static TypeId GetTypeId();
+
+    /**
+     * Set the slices, before the BWPs are added.
+     * \param names The name of each slice.
+     */
+    void SetSlices(const std::vector<std::string>& names);
+
+    /**
+     * Set the UEs and their slices.
+     * \param registry The UE registry.
+     */
+    void SetRegistry(Ptr<SliceUeRegistry> registry);
+
+    /**
+     * Add a bandwidth part.
+     *
+     * \param name The names of the slices carried by the BWP.
+     * \param phy The gNB PHY of the BWP.
+     * \param mac The gNB MAC of the BWP.
+     * \param bandwidth The bandwidth of the BWP in Hz.
+     * \param slaWeight The SLA weight of the BWP.
+     */
+    void AddBwp(std::string name,
+                Ptr<NrGnbPhy> phy,
+                Ptr<NrGnbMac> mac,
+                double bandwidth,
+                double slaWeight);
+
+    /**
+     * Apply the bandwidth-proportional split and start the periodic updates.
+     */
+    void Start();
+
+    /**
+     * Account the energy spent up to now and stop the updates and the measurements.
+     */
+    void Stop();
+
+    /**
+     * Print the power and the power efficiency of each BWP and of each slice.
+     * \param os The output stream.
+     */
+    void Report(std::ostream& os) const;
+
+  private:
+    /// Measurements and power of one BWP.
+    struct BwpState
+    {
+        std::string name;       //!< Names of the slices.
+        Ptr<NrGnbPhy> phy;      //!< gNB PHY of the BWP.
+        uint16_t bwpId;         //!< BWP id reported by the traces.
+        double bandwidth;       //!< Bandwidth in Hz.
+        double slaWeight;       //!< SLA weight of the BWP.
+        uint64_t usedReg{0};    //!< RB x symbols used in the current period.
+        uint64_t availReg{0};   //!< RB x symbols available in the current period.
+        double demand{0};       //!< Smoothed RB utilization.
+        double txPowerDbm{0};   //!< Current transmit power.
+        double energyJ{0};      //!< Energy spent so far.
+        uint64_t txBits{0};     //!< Bits of new transmissions so far.
+        std::vector<uint64_t> sliceReg; //!< RB x symbols granted to each slice since the last accounting.
+    };
+
+    /// Re-optimize the split and schedule the next update.
+    void Update();
+    /// Account the energy spent since the last update.
+    void AccountEnergy();
+    /**
+     * Set the power of every BWP.
+     * \param shares The share of TotalTxPower of each BWP.
+     */
+    void ApplyShares(const std::vector<double>& shares);
+
+    /**
+     * SlotDataStats trace sink of the gNB PHY.
+     * \param sfnSf The slot.
+     * \param scheduledUe The number of scheduled UEs.
+     * \param usedReg The used RB x symbols.
+     * \param usedSym The used symbols.
+     * \param availableRb The available RBs.
+     * \param availableSym The available symbols.
+     * \param bwpId The BWP id.
+     * \param cellId The cell id.
+     */
+    void SlotDataStats(const SfnSf& sfnSf,
+                       uint32_t scheduledUe,
+                       uint32_t usedReg,
+                       uint32_t usedSym,
+                       uint32_t availableRb,
+                       uint32_t availableSym,
+                       uint16_t bwpId,
+                       uint16_t cellId);
+
+    /**
+     * DlScheduling trace sink of the gNB MAC.
+     * \param info The scheduling decision.
+     */
+    void DlScheduling(NrSchedulingCallbackInfo info);
+
+    std::vector<BwpState> m_bwps; //!< The bandwidth parts.
+    std::vector<std::string> m_sliceNames; //!< Name of each slice.
+    std::vector<uint64_t> m_sliceBits;     //!< Bits of new transmissions of each slice so far.
+    std::vector<double> m_sliceEnergyJ;    //!< Energy attributed to each slice so far.
+    double m_idleEnergyJ{0};               //!< Energy of the BWPs in periods without grants.
+    Ptr<SliceUeRegistry> m_registry;       //!< UEs and their slices.
+    double m_totalTxPower;        //!< Total transmit power in dBm.
+    Time m_updatePeriod;          //!< Period of the re-optimization.
+    double m_minShare;            //!< Minimum fraction of the bandwidth-proportional power.
+    double m_smoothing;           //!< Weight of the newest utilization sample.
+    bool m_adaptive;              //!< True to re-optimize, false to only measure.
+    bool m_running;               //!< True between Start() and Stop().
+    Time m_lastUpdate;            //!< Time of the last energy accounting.
+    EventId m_updateEvent;        //!< Next update.
+};
+
+inline SlicePowerAllocator::SlicePowerAllocator()
+    : m_totalTxPower(41),
+      m_updatePeriod(MilliSeconds(100)),
+      m_minShare(0.2),
+      m_smoothing(0.5),
+      m_adaptive(true),
+      m_running(false),
+      m_lastUpdate(),
+      m_updateEvent()
+{
+}
+
+inline SlicePowerAllocator::~SlicePowerAllocator()
+{
+}
+
+/* static */
+inline TypeId
+SlicePowerAllocator::GetTypeId()
+{
+    static TypeId tid =
+        TypeId("SlicePowerAllocator")
+            .SetParent<Object>()
+            .SetGroupName("Tutorial")
+            .AddConstructor<SlicePowerAllocator>()
+            .AddAttribute("TotalTxPower",
+                          "Total gNB transmit power in dBm, split across the BWPs",
+                          DoubleValue(41),
+                          MakeDoubleAccessor(&SlicePowerAllocator::m_totalTxPower),
+                          MakeDoubleChecker<double>())
+            .AddAttribute("UpdatePeriod",
+                          "Period of the re-optimization of the split",
+                          TimeValue(MilliSeconds(100)),
+                          MakeTimeAccessor(&SlicePowerAllocator::m_updatePeriod),
+                          MakeTimeChecker())
+            .AddAttribute("MinShare",
+                          "Minimum fraction of its bandwidth-proportional power kept by a BWP",
+                          DoubleValue(0.2),
+                          MakeDoubleAccessor(&SlicePowerAllocator::m_minShare),
+                          MakeDoubleChecker<double>(0, 1))
+            .AddAttribute("Smoothing",
+                          "Weight of the newest RB utilization sample in the demand estimate",
+                          DoubleValue(0.5),
+                          MakeDoubleAccessor(&SlicePowerAllocator::m_smoothing),
+                          MakeDoubleChecker<double>(0, 1))
+            .AddAttribute("Adaptive",
+                          "Re-optimize the split; if false, keep it proportional to bandwidth",
+                          BooleanValue(true),
+                          MakeBooleanAccessor(&SlicePowerAllocator::m_adaptive),
+                          MakeBooleanChecker());
+    return tid;
+}
+
+inline void
+SlicePowerAllocator::SetSlices(const std::vector<std::string>& names)
+{
+    m_sliceNames = names;
+    m_sliceBits.assign(names.size(), 0);
+    m_sliceEnergyJ.assign(names.size(), 0);
+}
+
+inline void
+SlicePowerAllocator::SetRegistry(Ptr<SliceUeRegistry> registry)
+{
+    m_registry = registry;
+}
+
+inline void
+SlicePowerAllocator::AddBwp(std::string name,
+                            Ptr<NrGnbPhy> phy,
+                            Ptr<NrGnbMac> mac,
+                            double bandwidth,
+                            double slaWeight)
+{
+    BwpState bwp;
+    bwp.name = name;
+    bwp.phy = phy;
+    bwp.bwpId = phy->GetBwpId();
+    bwp.bandwidth = bandwidth;
+    bwp.slaWeight = slaWeight;
+    bwp.sliceReg.assign(m_sliceNames.size(), 0);
+    m_bwps.push_back(bwp);
+
+    phy->TraceConnectWithoutContext("SlotDataStats",
+                                    MakeCallback(&SlicePowerAllocator::SlotDataStats, this));
+    mac->TraceConnectWithoutContext("DlScheduling",
+                                    MakeCallback(&SlicePowerAllocator::DlScheduling, this));
+}
+
+inline void
+SlicePowerAllocator::Start()
+{
+    double totalBandwidth = 0;
+    for (const auto& bwp : m_bwps)
+    {
+        totalBandwidth += bwp.bandwidth;
+    }
+    std::vector<double> shares;
+    for (const auto& bwp : m_bwps)
+    {
+        shares.push_back(bwp.bandwidth / totalBandwidth);
+    }
+    ApplyShares(shares);
+    m_running = true;
+    m_lastUpdate = Simulator::Now();
+    m_updateEvent = Simulator::Schedule(m_updatePeriod, &SlicePowerAllocator::Update, this);
+}
+
+inline void
+SlicePowerAllocator::Stop()
+{
+    AccountEnergy();
+    m_running = false;
+    Simulator::Cancel(m_updateEvent);
+}
+
+inline void
+SlicePowerAllocator::AccountEnergy()
+{
+    double dt = (Simulator::Now() - m_lastUpdate).GetSeconds();
+    for (auto& bwp : m_bwps)
+    {
+        double energyJ = std::pow(10, (bwp.txPowerDbm - 30) / 10) * dt;
+        bwp.energyJ += energyJ;
+
+        uint64_t grantedReg = 0;
+        for (uint64_t reg : bwp.sliceReg)
+        {
+            grantedReg += reg;
+        }
+        if (grantedReg == 0)
+        {
+            m_idleEnergyJ += energyJ;
+            continue;
+        }
+        for (std::size_t s = 0; s < bwp.sliceReg.size(); ++s)
+        {
+            m_sliceEnergyJ[s] += energyJ * bwp.sliceReg[s] / grantedReg;
+            bwp.sliceReg[s] = 0;
+        }
+    }
+    m_lastUpdate = Simulator::Now();
+}
+
+inline void
+SlicePowerAllocator::ApplyShares(const std::vector<double>& shares)
+{
+    double x = std::pow(10, m_totalTxPower / 10);
+    for (std::size_t i = 0; i < m_bwps.size(); ++i)
+    {
+        m_bwps[i].txPowerDbm = 10 * std::log10(shares[i] * x);
+        m_bwps[i].phy->SetAttribute("TxPower", DoubleValue(m_bwps[i].txPowerDbm));
+    }
+}
+
+inline void
+SlicePowerAllocator::Update()
+{
+    AccountEnergy();
+
+    double totalBandwidth = 0;
+    for (auto& bwp : m_bwps)
+    {
+        double utilization = bwp.availReg > 0 ? bwp.usedReg / static_cast<double>(bwp.availReg) : 0;
+        bwp.demand = m_smoothing * utilization + (1 - m_smoothing) * bwp.demand;
+        bwp.usedReg = 0;
+        bwp.availReg = 0;
+        totalBandwidth += bwp.bandwidth;
+    }
+
+    if (m_adaptive)
+    {
+        // an idle BWP still weighs a little, so it is not starved when traffic resumes
+        std::vector<double> scores;
+        double totalScore = 0;
+        for (const auto& bwp : m_bwps)
+        {
+            scores.push_back(bwp.bandwidth * bwp.slaWeight * std::max(bwp.demand, 0.05));
+            totalScore += scores.back();
+        }
+        std::vector<double> shares;
+        for (std::size_t i = 0; i < m_bwps.size(); ++i)
+        {
+            shares.push_back(m_minShare * m_bwps[i].bandwidth / totalBandwidth +
+                             (1 - m_minShare) * scores[i] / totalScore);
+        }
+        ApplyShares(shares);
+    }
+
+    m_updateEvent = Simulator::Schedule(m_updatePeriod, &SlicePowerAllocator::Update, this);
+}
+
+inline void
+SlicePowerAllocator::SlotDataStats(const SfnSf& sfnSf,
+                                   uint32_t scheduledUe,
+                                   uint32_t usedReg,
+                                   uint32_t usedSym,
+                                   uint32_t availableRb,
+                                   uint32_t availableSym,
+                                   uint16_t bwpId,
+                                   uint16_t cellId)
+{
+    if (!m_running)
+    {
+        return;
+    }
+    for (auto& bwp : m_bwps)
+    {
+        if (bwp.bwpId == bwpId)
+        {
+            bwp.usedReg += usedReg;
+            bwp.availReg += static_cast<uint64_t>(availableRb) * availableSym;
+            return;
+        }
+    }
+}
+
+inline void
+SlicePowerAllocator::DlScheduling(NrSchedulingCallbackInfo info)
+{
+    if (!m_running)
+    {
+        return;
+    }
+    uint8_t slice = m_registry ? m_registry->GetSliceOfRnti(info.m_rnti) : UINT8_MAX;
+    bool inSlice = slice < m_sliceNames.size();
+    for (auto& bwp : m_bwps)
+    {
+        if (bwp.bwpId != info.m_bwpId)
+        {
+            continue;
+        }
+        // a retransmission takes its share of the energy but carries no new bits
+        if (inSlice)
+        {
+            bwp.sliceReg[slice] += static_cast<uint64_t>(info.m_numSym) * bwp.phy->GetRbNum();
+        }
+        if (info.m_rv == 0)
+        {
+            bwp.txBits += info.m_tbSize * 8;
+            if (inSlice)
+            {
+                m_sliceBits[slice] += info.m_tbSize * 8;
+            }
+        }
+        return;
+    }
+}
+
+inline void
+SlicePowerAllocator::Report(std::ostream& os) const
+{
+    for (const auto& bwp : m_bwps)
+    {
+        os << "  BWP " << bwp.bwpId << " (" << bwp.name << ") power: " << bwp.txPowerDbm << " dBm (last),";
+        os << " Energy " << bwp.energyJ << " J,";
+        os << " Efficiency " << (bwp.energyJ > 0 ? bwp.txBits / bwp.energyJ : 0.) << " bits/J\n";
+    }
+    if (m_sliceNames.empty())
+    {
+        return;
+    }
+    for (std::size_t s = 0; s < m_sliceNames.size(); ++s)
+    {
+        os << "  Slice " << m_sliceNames[s] << ": Energy " << m_sliceEnergyJ[s] << " J,";
+        os << " Efficiency " << (m_sliceEnergyJ[s] > 0 ? m_sliceBits[s] / m_sliceEnergyJ[s] : 0.)
+           << " bits/J\n";
+    }
+    os << "  Idle energy " << m_idleEnergyJ << " J\n";
+}
+
+} // namespace ns3
+
+#endif /* SLICING_POWER_ALLOCATOR_H */
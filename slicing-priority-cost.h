@@ -0,0 +1,247 @@
+#ifndef SLICING_PRIORITY_COST_H
+#define SLICING_PRIORITY_COST_H
+
+#include "ns3/core-module.h"
+#include "ns3/nr-module.h"
+
+#include "slicing-buffer-status.h"
+#include "slicing-ue-registry.h"
+
+#include <ostream>
+#include <string>
+#include <vector>
+
+namespace ns3
+{
+
+/**
+ * Cost to the other slices of serving a priority slice first on a shared BWP.
+ *
+ * With a PrioritySlice, NrMacSchedulerTdmaMiniSlot gives the UEs of that
+ * slice the symbols they need before the others. Every DL grant of the
+ * priority slice on the BWP is counted, in RB x symbols, against each other
+ * slice that had DL data in its RLC queues on the BWP when the grant was
+ * made, as the buffer status reports give them: these are the resources the
+ * other slice waited for. The grants are attributed to the slices by RNTI,
+ * and a grant spans all the RBs of its symbols, as with the TDMA schedulers.
+ */
+class SlicePriorityCost : public Object
+{
+  public:
+    SlicePriorityCost();
+    ~SlicePriorityCost() override;
+
+    /**
+     * Register this type.
+     * \return The TypeId.
+     */
+    static TypeId GetTypeId();
+
+    /**
+     * Set the slices.
+     * \param names The name of each slice.
+     * \param prioritySlice The slice served first.
+     */
+    void SetSlices(const std::vector<std::string>& names, uint8_t prioritySlice);
+
+    /**
+     * Set the UEs and their slices.
+     * \param registry The UE registry.
+     */
+    void SetRegistry(Ptr<SliceUeRegistry> registry);
+
+    /**
+     * Set the RLC queues of the slices.
+     * \param bufferStatus The buffer status of the schedulers.
+     */
+    void SetBufferStatus(Ptr<SliceBufferStatus> bufferStatus);
+
+    /**
+     * Measure a shared BWP.
+     * \param phy The gNB PHY of the BWP.
+     * \param mac The gNB MAC of the BWP.
+     */
+    void ConnectBwp(Ptr<NrGnbPhy> phy, Ptr<NrGnbMac> mac);
+
+    /// Start the measurement.
+    void Start();
+
+    /// Stop the measurement.
+    void Stop();
+
+    /**
+     * Print the RB x symbols of the priority slice and what each other slice waited for.
+     * \param os The output stream.
+     */
+    void Print(std::ostream& os) const;
+
+  protected:
+    void DoDispose() override;
+
+  private:
+    /**
+     * SlotDataStats trace sink of the gNB PHY.
+     * \param sfnSf The slot.
+     * \param scheduledUe The number of scheduled UEs.
+     * \param usedReg The used RB x symbols.
+     * \param usedSym The used symbols.
+     * \param availableRb The available RBs.
+     * \param availableSym The available symbols.
+     * \param bwpId The BWP id.
+     * \param cellId The cell id.
+     */
+    void SlotDataStats(const SfnSf& sfnSf,
+                       uint32_t scheduledUe,
+                       uint32_t usedReg,
+                       uint32_t usedSym,
+                       uint32_t availableRb,
+                       uint32_t availableSym,
+                       uint16_t bwpId,
+                       uint16_t cellId);
+
+    /**
+     * DlScheduling trace sink of the gNB MAC.
+     * \param info The scheduling decision.
+     */
+    void DlScheduling(NrSchedulingCallbackInfo info);
+
+    std::vector<std::string> m_sliceNames;   //!< Name of each slice.
+    uint8_t m_prioritySlice;                 //!< Slice served first.
+    Ptr<SliceUeRegistry> m_registry;         //!< UEs and their slices.
+    Ptr<SliceBufferStatus> m_bufferStatus;   //!< RLC queues of the slices.
+    Ptr<NrGnbPhy> m_phy;                     //!< gNB PHY of the shared BWP.
+    bool m_running;                          //!< True between Start() and Stop().
+    uint64_t m_availableReg;                 //!< Available RB x symbols of the BWP.
+    uint64_t m_priorityReg;                  //!< RB x symbols granted to the priority slice.
+    std::vector<uint64_t> m_waitedReg;       //!< Of those, the ones each slice waited for.
+};
+
+inline SlicePriorityCost::SlicePriorityCost()
+    : m_prioritySlice(UINT8_MAX),
+      m_running(false),
+      m_availableReg(0),
+      m_priorityReg(0)
+{
+}
+
+inline SlicePriorityCost::~SlicePriorityCost()
+{
+}
+
+/* static */
+inline TypeId
+SlicePriorityCost::GetTypeId()
+{
+    static TypeId tid = TypeId("SlicePriorityCost")
+                            .SetParent<Object>()
+                            .SetGroupName("Tutorial")
+                            .AddConstructor<SlicePriorityCost>();
+    return tid;
+}
+
+inline void
+SlicePriorityCost::SetSlices(const std::vector<std::string>& names, uint8_t prioritySlice)
+{
+    NS_ABORT_MSG_IF(prioritySlice >= names.size(), "Unknown slice " << +prioritySlice);
+    m_sliceNames = names;
+    m_prioritySlice = prioritySlice;
+    m_waitedReg.assign(names.size(), 0);
+}
+
+inline void
+SlicePriorityCost::SetRegistry(Ptr<SliceUeRegistry> registry)
+{
+    m_registry = registry;
+}
+
+inline void
+SlicePriorityCost::SetBufferStatus(Ptr<SliceBufferStatus> bufferStatus)
+{
+    m_bufferStatus = bufferStatus;
+}
+
+inline void
+SlicePriorityCost::ConnectBwp(Ptr<NrGnbPhy> phy, Ptr<NrGnbMac> mac)
+{
+    m_phy = phy;
+    phy->TraceConnectWithoutContext("SlotDataStats",
+                                    MakeCallback(&SlicePriorityCost::SlotDataStats, this));
+    mac->TraceConnectWithoutContext("DlScheduling",
+                                    MakeCallback(&SlicePriorityCost::DlScheduling, this));
+}
+
+inline void
+SlicePriorityCost::Start()
+{
+    m_running = true;
+}
+
+inline void
+SlicePriorityCost::Stop()
+{
+    m_running = false;
+}
+
+inline void
+SlicePriorityCost::SlotDataStats(const SfnSf& /* sfnSf */,
+                                 uint32_t /* scheduledUe */,
+                                 uint32_t /* usedReg */,
+                                 uint32_t /* usedSym */,
+                                 uint32_t availableRb,
+                                 uint32_t availableSym,
+                                 uint16_t /* bwpId */,
+                                 uint16_t /* cellId */)
+{
+    if (m_running)
+    {
+        m_availableReg += static_cast<uint64_t>(availableRb) * availableSym;
+    }
+}
+
+inline void
+SlicePriorityCost::DlScheduling(NrSchedulingCallbackInfo info)
+{
+    if (!m_running || m_registry->GetSliceOfRnti(info.m_rnti) != m_prioritySlice)
+    {
+        return;
+    }
+    uint64_t reg = static_cast<uint64_t>(info.m_numSym) * m_phy->GetRbNum();
+    m_priorityReg += reg;
+    for (uint8_t s = 0; s < m_sliceNames.size(); ++s)
+    {
+        if (s != m_prioritySlice && m_bufferStatus->GetBytes(0, s, info.m_bwpId) > 0)
+        {
+            m_waitedReg[s] += reg;
+        }
+    }
+}
+
+inline void
+SlicePriorityCost::Print(std::ostream& os) const
+{
+    double available = m_availableReg > 0 ? static_cast<double>(m_availableReg) : 1.;
+    os << "  Slice " << m_sliceNames[m_prioritySlice] << ": " << m_priorityReg
+       << " RB x symbols (" << 100. * m_priorityReg / available << " % of the BWP)\n";
+    for (uint8_t s = 0; s < m_sliceNames.size(); ++s)
+    {
+        if (s == m_prioritySlice)
+        {
+            continue;
+        }
+        os << "  Slice " << m_sliceNames[s] << ": waited for " << m_waitedReg[s]
+           << " RB x symbols (" << 100. * m_waitedReg[s] / available << " % of the BWP)\n";
+    }
+}
+
+inline void
+SlicePriorityCost::DoDispose()
+{
+    m_registry = nullptr;
+    m_bufferStatus = nullptr;
+    m_phy = nullptr;
+    Object::DoDispose();
+}
+
+} // namespace ns3
+
+#endif /* SLICING_PRIORITY_COST_H */
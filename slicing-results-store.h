@@ -0,0 +1,418 @@
+#ifndef SLICING_RESULTS_STORE_H
+#define SLICING_RESULTS_STORE_H
+
+#include "ns3/core-module.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace ns3
+{
+
+/*
+ * Columnar binary store of simulation results.
+ *
+ * The store is a directory holding one directory per table: runs, slices and
+ * flows. A table stores each column in its own file, <table>/<column>.col, as
+ * a plain array of fixed-width little-endian values, so a reader can mmap a
+ * column and scan it without parsing. Every row carries the configuration
+ * hash and the RNG run of its simulation. Writers append whole blocks of rows
+ * under an exclusive flock on <table>/.lock, so concurrent runs can share a
+ * store. A block is written whole or not at all: a failed write truncates the
+ * columns back to their previous length, and a block left over by a writer
+ * that died is cut before the next one, so the columns stay aligned; a reader
+ * takes the shortest column as the row count. configs.txt maps each
+ * configuration hash, once, to the parameters it was computed from.
+ */
+
+/// Type of a column.
+enum ColumnType : uint8_t
+{
+    COL_U8,
+    COL_U16,
+    COL_U32,
+    COL_U64,
+    COL_F64
+};
+
+/**
+ * \param type The column type.
+ * \return The width of a value in bytes.
+ */
+inline uint32_t
+ColumnWidth(ColumnType type)
+{
+    static const uint32_t widths[] = {1, 2, 4, 8, 8};
+    return widths[type];
+}
+
+/// Name and type of a column.
+struct ColumnSpec
+{
+    const char* name; //!< Column name, also the file name.
+    ColumnType type;  //!< Value type.
+};
+
+/// Columns of the runs table, one row per simulation.
+static const std::vector<ColumnSpec> g_runColumns = {{"configHash", COL_U64},
+                                                     {"rngRun", COL_U32},
+                                                     {"appDurationMs", COL_U32},
+                                                     {"numUes", COL_U32},
+                                                     {"numFlows", COL_U32},
+                                                     {"wallClockS", COL_F64},
+                                                     {"meanFlowThroughputMbps", COL_F64},
+                                                     {"meanFlowDelayMs", COL_F64}};
+
+/// Columns of the slices table, one row per slice and direction.
+static const std::vector<ColumnSpec> g_sliceColumns = {{"configHash", COL_U64},
+                                                       {"rngRun", COL_U32},
+                                                       {"slice", COL_U8},
+                                                       {"direction", COL_U8},
+                                                       {"throughputMbps", COL_F64},
+                                                       {"meanDelayMs", COL_F64},
+                                                       {"p99DelayMs", COL_F64},
+                                                       {"rxPackets", COL_U64},
+                                                       {"lostPackets", COL_U64}};
+
+/// Columns of the flows table, one row per flow monitor flow; slice and direction are
+/// 255 for a flow of no slice.
+static const std::vector<ColumnSpec> g_flowColumns = {{"configHash", COL_U64},
+                                                      {"rngRun", COL_U32},
+                                                      {"flowId", COL_U32},
+                                                      {"slice", COL_U8},
+                                                      {"direction", COL_U8},
+                                                      {"protocol", COL_U8},
+                                                      {"sourcePort", COL_U16},
+                                                      {"destinationPort", COL_U16},
+                                                      {"txPackets", COL_U64},
+                                                      {"rxPackets", COL_U64},
+                                                      {"txBytes", COL_U64},
+                                                      {"rxBytes", COL_U64},
+                                                      {"lostPackets", COL_U64},
+                                                      {"throughputMbps", COL_F64},
+                                                      {"meanDelayMs", COL_F64},
+                                                      {"meanJitterMs", COL_F64}};
+
+/**
+ * Rows of one table, buffered column by column before they are appended.
+ */
+class ColumnBlock
+{
+  public:
+    /**
+     * \param schema The columns of the table.
+     */
+    explicit ColumnBlock(const std::vector<ColumnSpec>& schema)
+        : m_schema(schema),
+          m_data(schema.size())
+    {
+    }
+
+    /**
+     * Append a value to a column; the value is converted to the column type.
+     * \param name The column name.
+     * \param value The value.
+     */
+    template <typename T>
+    void Put(const char* name, T value)
+    {
+        for (std::size_t c = 0; c < m_schema.size(); ++c)
+        {
+            if (std::strcmp(m_schema[c].name, name) != 0)
+            {
+                continue;
+            }
+            switch (m_schema[c].type)
+            {
+            case COL_U8:
+                Append(c, static_cast<uint8_t>(value));
+                return;
+            case COL_U16:
+                Append(c, static_cast<uint16_t>(value));
+                return;
+            case COL_U32:
+                Append(c, static_cast<uint32_t>(value));
+                return;
+            case COL_U64:
+                Append(c, static_cast<uint64_t>(value));
+                return;
+            case COL_F64:
+                Append(c, static_cast<double>(value));
+                return;
+            }
+        }
+        NS_ABORT_MSG("Unknown column " << name);
+    }
+
+    /**
+     * \return The number of complete rows, or -1 if the columns differ in length.
+     */
+    int64_t GetNumRows() const
+    {
+        int64_t rows = -1;
+        for (std::size_t c = 0; c < m_schema.size(); ++c)
+        {
+            int64_t n = m_data[c].size() / ColumnWidth(m_schema[c].type);
+            if (rows >= 0 && n != rows)
+            {
+                return -1;
+            }
+            rows = n;
+        }
+        return rows;
+    }
+
+    /**
+     * Append the rows to a table of a store.
+     * \param store The store directory.
+     * \param table The table name.
+     * \return false if the rows are incomplete or the table cannot be written.
+     */
+    bool AppendTo(const std::string& store, const std::string& table) const
+    {
+        if (GetNumRows() < 0)
+        {
+            return false;
+        }
+        std::string dir = store + "/" + table;
+        std::error_code ec;
+        std::filesystem::create_directories(dir, ec);
+        int lock = open((dir + "/.lock").c_str(), O_RDWR | O_CREAT, 0644);
+        if (lock < 0 || flock(lock, LOCK_EX) != 0)
+        {
+            if (lock >= 0)
+            {
+                close(lock);
+            }
+            return false;
+        }
+        // the complete rows already in the table: a block a dead writer left half
+        // written is cut, so that this one starts aligned on every column
+        std::vector<std::string> paths;
+        uintmax_t rows = UINTMAX_MAX;
+        for (const auto& col : m_schema)
+        {
+            paths.push_back(dir + "/" + col.name + ".col");
+            std::error_code sizeEc;
+            uintmax_t size = std::filesystem::file_size(paths.back(), sizeEc);
+            rows = std::min<uintmax_t>(rows, sizeEc ? 0 : size / ColumnWidth(col.type));
+        }
+        auto truncateTo = [&](uintmax_t numRows) {
+            bool done = true;
+            for (std::size_t c = 0; c < m_schema.size(); ++c)
+            {
+                if (std::filesystem::exists(paths[c]) &&
+                    truncate(paths[c].c_str(), numRows * ColumnWidth(m_schema[c].type)) != 0)
+                {
+                    done = false;
+                }
+            }
+            return done;
+        };
+        bool ok = truncateTo(rows);
+        if (ok && !std::filesystem::exists(dir + "/schema.txt"))
+        {
+            std::ofstream schema(dir + "/schema.txt");
+            for (const auto& col : m_schema)
+            {
+                schema << col.name << " " << +col.type << "\n";
+            }
+        }
+        for (std::size_t c = 0; c < m_schema.size() && ok; ++c)
+        {
+            int fd = open(paths[c].c_str(), O_WRONLY | O_APPEND | O_CREAT, 0644);
+            ok = fd >= 0 && write(fd, m_data[c].data(), m_data[c].size()) ==
+                                static_cast<ssize_t>(m_data[c].size());
+            if (fd >= 0)
+            {
+                close(fd);
+            }
+        }
+        if (!ok)
+        {
+            // roll back the columns already written
+            truncateTo(rows);
+        }
+        flock(lock, LOCK_UN);
+        close(lock);
+        return ok;
+    }
+
+  private:
+    /**
+     * Append the bytes of a value to a column.
+     * \param c The column index.
+     * \param value The value.
+     */
+    template <typename V>
+    void Append(std::size_t c, V value)
+    {
+        const char* bytes = reinterpret_cast<const char*>(&value);
+        m_data[c].insert(m_data[c].end(), bytes, bytes + sizeof(V));
+    }
+
+    std::vector<ColumnSpec> m_schema;    //!< Columns of the table.
+    std::vector<std::vector<char>> m_data; //!< Bytes of each column.
+};
+
+/**
+ * Record the parameters of a configuration hash in <store>/configs.txt,
+ * unless the hash is there already, e.g. from another replication.
+ * \param store The store directory.
+ * \param hash The configuration hash.
+ * \param canonical The canonical parameters, see RunConfig::GetCanonical().
+ * \return false if the file cannot be written.
+ */
+inline bool
+AppendConfig(const std::string& store, uint64_t hash, const std::string& canonical)
+{
+    std::error_code ec;
+    std::filesystem::create_directories(store, ec);
+    char key[17];
+    std::snprintf(key, sizeof(key), "%016llx", static_cast<unsigned long long>(hash));
+    std::string line = std::string(key) + " " + canonical + "\n";
+    std::string path = store + "/configs.txt";
+    int fd = open(path.c_str(), O_WRONLY | O_APPEND | O_CREAT, 0644);
+    if (fd < 0)
+    {
+        return false;
+    }
+    flock(fd, LOCK_EX);
+    bool known = false;
+    std::ifstream in(path);
+    std::string existing;
+    while (!known && std::getline(in, existing))
+    {
+        known = existing.compare(0, sizeof(key), std::string(key) + " ") == 0;
+    }
+    bool ok = known || write(fd, line.data(), line.size()) == static_cast<ssize_t>(line.size());
+    flock(fd, LOCK_UN);
+    close(fd);
+    return ok;
+}
+
+/**
+ * Read-only, memory-mapped view of a table of a store.
+ */
+class ColumnReader
+{
+  public:
+    ColumnReader()
+        : m_numRows(0)
+    {
+    }
+
+    ~ColumnReader()
+    {
+        for (auto& col : m_columns)
+        {
+            if (col.data)
+            {
+                munmap(col.data, col.size);
+            }
+        }
+    }
+
+    ColumnReader(const ColumnReader&) = delete;
+    ColumnReader& operator=(const ColumnReader&) = delete;
+
+    /**
+     * Map the columns of a table.
+     * \param store The store directory.
+     * \param table The table name.
+     * \param schema The expected columns.
+     * \return false if a column is missing.
+     */
+    bool Open(const std::string& store,
+              const std::string& table,
+              const std::vector<ColumnSpec>& schema)
+    {
+        m_numRows = UINT64_MAX;
+        for (const auto& spec : schema)
+        {
+            Mapped col;
+            col.spec = spec;
+            std::string path = store + "/" + table + "/" + spec.name + ".col";
+            int fd = open(path.c_str(), O_RDONLY);
+            struct stat st;
+            if (fd < 0 || fstat(fd, &st) != 0)
+            {
+                if (fd >= 0)
+                {
+                    close(fd);
+                }
+                return false;
+            }
+            col.size = st.st_size;
+            if (col.size > 0)
+            {
+                col.data = mmap(nullptr, col.size, PROT_READ, MAP_SHARED, fd, 0);
+                if (col.data == MAP_FAILED)
+                {
+                    col.data = nullptr;
+                    close(fd);
+                    return false;
+                }
+            }
+            close(fd);
+            m_numRows = std::min<uint64_t>(m_numRows, col.size / ColumnWidth(spec.type));
+            m_columns.push_back(col);
+        }
+        if (m_columns.empty())
+        {
+            m_numRows = 0;
+        }
+        return true;
+    }
+
+    /// \return The number of complete rows.
+    uint64_t GetNumRows() const
+    {
+        return m_numRows;
+    }
+
+    /**
+     * \param name The column name.
+     * \return The values of the column, or nullptr if the type does not match.
+     */
+    template <typename T>
+    const T* Get(const char* name) const
+    {
+        for (const auto& col : m_columns)
+        {
+            if (std::strcmp(col.spec.name, name) == 0 && ColumnWidth(col.spec.type) == sizeof(T))
+            {
+                return static_cast<const T*>(col.data);
+            }
+        }
+        return nullptr;
+    }
+
+  private:
+    /// A mapped column file.
+    struct Mapped
+    {
+        ColumnSpec spec;       //!< The column.
+        void* data{nullptr};   //!< The mapped values.
+        std::size_t size{0};   //!< The mapped size in bytes.
+    };
+
+    std::vector<Mapped> m_columns; //!< The mapped columns.
+    uint64_t m_numRows;            //!< Rows present in every column.
+};
+
+} // namespace ns3
+
+#endif /* SLICING_RESULTS_STORE_H */
@@ -0,0 +1,95 @@
+#ifndef SLICING_RUN_CONFIG_H
+#define SLICING_RUN_CONFIG_H
+
+#include "ns3/core-module.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <functional>
+#include <iomanip>
+#include <sstream>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace ns3
+{
+
+/**
+ * The parameters that define a scenario, registered on a CommandLine.
+ *
+ * Parameters added through AddValue() are both command-line options and part
+ * of the configuration; options that only name outputs or select diagnostics,
+ * and the RNG run, are added to the CommandLine directly so that they do not
+ * change the configuration hash.
+ */
+class RunConfig
+{
+  public:
+    /**
+     * \param cmd The command line the parameters are registered on.
+     */
+    explicit RunConfig(CommandLine& cmd)
+        : m_cmd(cmd)
+    {
+    }
+
+    /**
+     * Register a parameter.
+     * \param name The option name.
+     * \param help The help text.
+     * \param value The variable holding the value.
+     */
+    template <typename T>
+    void AddValue(const std::string& name, const std::string& help, T& value)
+    {
+        m_cmd.AddValue(name, help, value);
+        m_params.emplace_back(name, [&value]() {
+            std::ostringstream oss;
+            oss << std::setprecision(17) << value;
+            return oss.str();
+        });
+    }
+
+    /**
+     * \return The current values as name=value pairs sorted by name and separated by ';'.
+     */
+    std::string GetCanonical() const
+    {
+        std::vector<std::pair<std::string, std::string>> values;
+        for (const auto& p : m_params)
+        {
+            values.emplace_back(p.first, p.second());
+        }
+        std::sort(values.begin(), values.end());
+        std::ostringstream oss;
+        for (const auto& v : values)
+        {
+            oss << v.first << "=" << v.second << ";";
+        }
+        return oss.str();
+    }
+
+    /**
+     * \return The 64-bit FNV-1a hash of GetCanonical().
+     */
+    uint64_t GetHash() const
+    {
+        uint64_t hash = 14695981039346656037ULL;
+        for (char c : GetCanonical())
+        {
+            hash ^= static_cast<uint8_t>(c);
+            hash *= 1099511628211ULL;
+        }
+        return hash;
+    }
+
+  private:
+    CommandLine& m_cmd; //!< The command line.
+    /// Name and current value of each parameter.
+    std::vector<std::pair<std::string, std::function<std::string()>>> m_params;
+};
+
+} // namespace ns3
+
+#endif /* SLICING_RUN_CONFIG_H */
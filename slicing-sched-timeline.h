@@ -0,0 +1,324 @@
+#ifndef SLICING_SCHED_TIMELINE_H
+#define SLICING_SCHED_TIMELINE_H
+
+#include "ns3/core-module.h"
+#include "ns3/network-module.h"
+#include "ns3/nr-module.h"
+
+#include "slicing-ue-registry.h"
+
+#include <cmath>
+#include <cstdio>
+#include <set>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace ns3
+{
+
+/**
+ * Timeline of the scheduler decisions, written as Chrome trace events.
+ *
+ * The DL and UL grants of the gNB MACs that fall in [Start, Stop) are
+ * stored as fixed-size records in a buffer of Capacity records, allocated
+ * once; grants past a full buffer are only counted. Write() produces a
+ * trace-event JSON file for chrome://tracing or Perfetto, with one track
+ * per BWP and direction and one row per UE, so the slots each UE and slice
+ * gets are visible at a glance.
+ *
+ * The grant times are those of the scheduled symbols, derived from the
+ * SFN/slot of the grant. The MAC traces do not give the RBs of a grant;
+ * the TDMA schedulers give a UE the whole BWP, so the RBs of the BWP are
+ * reported instead.
+ */
+class SchedulerTimeline : public Object
+{
+  public:
+    SchedulerTimeline();
+    ~SchedulerTimeline() override;
+
+    /**
+     * Register this type.
+     * \return The TypeId.
+     */
+    static TypeId GetTypeId();
+
+    /**
+     * Set the UEs and their slices, and the names of the slices.
+     * \param registry The UE registry, resolved by the time of Write().
+     * \param sliceNames The names of the slices.
+     */
+    void SetRegistry(Ptr<SliceUeRegistry> registry, const std::vector<std::string>& sliceNames);
+
+    /**
+     * Allocate the buffer and connect the DL/UL scheduling traces of the
+     * BWPs of the gNBs.
+     * \param gnbDevices The gNB devices.
+     */
+    void ConnectGnbs(const NetDeviceContainer& gnbDevices);
+
+    /**
+     * Write the recorded grants as trace-event JSON.
+     * \param filename The JSON file.
+     * \return false if the file cannot be opened.
+     */
+    bool Write(const std::string& filename) const;
+
+    /// \return The number of grants recorded.
+    uint64_t GetNumRecorded() const;
+    /// \return The number of grants in the window lost to a full buffer.
+    uint64_t GetNumDropped() const;
+    /// \return The bytes of the grant buffer.
+    uint64_t GetBufferBytes() const;
+
+  private:
+    /// A grant, 24 bytes.
+    struct Grant
+    {
+        int64_t startNs;  //!< Start of the first scheduled symbol.
+        uint32_t tbSize;  //!< Transport block size in bytes.
+        uint16_t rnti;    //!< RNTI.
+        uint16_t bwp;     //!< Index of the BWP in m_bwps.
+        uint8_t dir;      //!< 0 for DL, 1 for UL.
+        uint8_t symStart; //!< First symbol.
+        uint8_t numSym;   //!< Number of symbols.
+        uint8_t mcs;      //!< MCS.
+        uint8_t rv;       //!< Redundancy version.
+        uint8_t harqId;   //!< HARQ process.
+    };
+
+    /// Timing of a BWP.
+    struct Bwp
+    {
+        uint16_t cellId;          //!< Cell.
+        uint16_t bwpId;           //!< BWP id.
+        uint32_t slotsPerSubframe; //!< Slots per 1 ms subframe.
+        int64_t slotNs;           //!< Slot duration.
+        int64_t symbolNs;         //!< Symbol duration.
+        uint32_t rbs;             //!< RBs of the BWP.
+    };
+
+    /**
+     * DlScheduling/UlScheduling trace sink.
+     * \param dir 0 for DL, 1 for UL.
+     * \param bwp The index of the BWP in m_bwps.
+     * \param info The grant.
+     */
+    void Scheduling(uint8_t dir, uint16_t bwp, NrSchedulingCallbackInfo info);
+
+    Time m_start;        //!< Start of the window.
+    Time m_stop;         //!< End of the window.
+    uint32_t m_capacity; //!< Buffer size in grants.
+
+    std::vector<Grant> m_grants;          //!< Recorded grants.
+    std::vector<Bwp> m_bwps;              //!< Connected BWPs.
+    uint64_t m_dropped;                   //!< Grants lost to a full buffer.
+    Ptr<SliceUeRegistry> m_registry;      //!< UEs and their slices.
+    std::vector<std::string> m_sliceNames; //!< Names of the slices.
+};
+
+inline SchedulerTimeline::SchedulerTimeline()
+    : m_capacity(1 << 20),
+      m_dropped(0)
+{
+}
+
+inline SchedulerTimeline::~SchedulerTimeline()
+{
+}
+
+/* static */
+inline TypeId
+SchedulerTimeline::GetTypeId()
+{
+    static TypeId tid =
+        TypeId("SchedulerTimeline")
+            .SetParent<Object>()
+            .SetGroupName("Tutorial")
+            .AddConstructor<SchedulerTimeline>()
+            .AddAttribute("Start",
+                          "Start of the recorded window",
+                          TimeValue(Seconds(0)),
+                          MakeTimeAccessor(&SchedulerTimeline::m_start),
+                          MakeTimeChecker())
+            .AddAttribute("Stop",
+                          "End of the recorded window",
+                          TimeValue(Seconds(1)),
+                          MakeTimeAccessor(&SchedulerTimeline::m_stop),
+                          MakeTimeChecker())
+            .AddAttribute("Capacity",
+                          "Number of grants the buffer holds",
+                          UintegerValue(1 << 20),
+                          MakeUintegerAccessor(&SchedulerTimeline::m_capacity),
+                          MakeUintegerChecker<uint32_t>(1));
+    return tid;
+}
+
+inline void
+SchedulerTimeline::SetRegistry(Ptr<SliceUeRegistry> registry,
+                               const std::vector<std::string>& sliceNames)
+{
+    m_registry = registry;
+    m_sliceNames = sliceNames;
+}
+
+inline void
+SchedulerTimeline::ConnectGnbs(const NetDeviceContainer& gnbDevices)
+{
+    m_grants.reserve(m_capacity);
+    for (uint32_t i = 0; i < gnbDevices.GetN(); ++i)
+    {
+        Ptr<NrGnbNetDevice> gnb = DynamicCast<NrGnbNetDevice>(gnbDevices.Get(i));
+        NS_ABORT_MSG_IF(!gnb, "Not a gNB device");
+        for (uint32_t bwp = 0; bwp < gnb->GetCcMapSize(); ++bwp)
+        {
+            Ptr<NrGnbPhy> phy = NrHelper::GetGnbPhy(gnb, bwp);
+            Bwp b;
+            b.cellId = gnb->GetCellId();
+            b.bwpId = bwp;
+            b.slotsPerSubframe = 1 << phy->GetNumerology();
+            b.slotNs = phy->GetSlotPeriod().GetNanoSeconds();
+            b.symbolNs = phy->GetSymbolPeriod().GetNanoSeconds();
+            b.rbs = phy->GetRbNum();
+            uint16_t index = m_bwps.size();
+            m_bwps.push_back(b);
+            Ptr<NrGnbMac> mac = NrHelper::GetGnbMac(gnb, bwp);
+            mac->TraceConnectWithoutContext(
+                "DlScheduling",
+                MakeCallback(&SchedulerTimeline::Scheduling, this).Bind(uint8_t(0), index));
+            mac->TraceConnectWithoutContext(
+                "UlScheduling",
+                MakeCallback(&SchedulerTimeline::Scheduling, this).Bind(uint8_t(1), index));
+        }
+    }
+}
+
+inline void
+SchedulerTimeline::Scheduling(uint8_t dir, uint16_t bwp, NrSchedulingCallbackInfo info)
+{
+    Time now = Simulator::Now();
+    if (now < m_start || now >= m_stop)
+    {
+        return;
+    }
+    if (m_grants.size() == m_capacity)
+    {
+        ++m_dropped;
+        return;
+    }
+    // the SFN wraps every 1024 frames: take the slot closest to now
+    const Bwp& b = m_bwps[bwp];
+    const int64_t wrapNs = 1024 * 10 * 1000000LL;
+    int64_t slotNs = ((static_cast<int64_t>(info.m_frameNum) * 10 + info.m_subframeNum) *
+                          b.slotsPerSubframe +
+                      info.m_slotNum) *
+                     b.slotNs;
+    slotNs += std::llround(static_cast<double>(now.GetNanoSeconds() - slotNs) / wrapNs) * wrapNs;
+
+    Grant g;
+    g.startNs = slotNs + info.m_symStart * b.symbolNs;
+    g.tbSize = info.m_tbSize;
+    g.rnti = info.m_rnti;
+    g.bwp = bwp;
+    g.dir = dir;
+    g.symStart = info.m_symStart;
+    g.numSym = info.m_numSym;
+    g.mcs = info.m_mcs;
+    g.rv = info.m_rv;
+    g.harqId = info.m_harqId;
+    m_grants.push_back(g);
+}
+
+inline bool
+SchedulerTimeline::Write(const std::string& filename) const
+{
+    std::FILE* f = std::fopen(filename.c_str(), "w");
+    if (!f)
+    {
+        return false;
+    }
+    // one process per BWP and direction, one thread per UE
+    std::fprintf(f, "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[\n");
+    for (uint32_t i = 0; i < m_bwps.size(); ++i)
+    {
+        for (uint8_t dir = 0; dir < 2; ++dir)
+        {
+            std::fprintf(f,
+                         "{\"ph\":\"M\",\"name\":\"process_name\",\"pid\":%u,\"tid\":0,"
+                         "\"args\":{\"name\":\"Cell %u BWP %u %s\"}},\n",
+                         i * 2 + dir,
+                         m_bwps[i].cellId,
+                         m_bwps[i].bwpId,
+                         dir == 0 ? "DL" : "UL");
+        }
+    }
+    std::set<std::pair<uint32_t, uint16_t>> threads;
+    for (const auto& g : m_grants)
+    {
+        uint32_t pid = g.bwp * 2 + g.dir;
+        uint8_t slice = m_registry ? m_registry->GetSliceOfRnti(g.rnti) : UINT8_MAX;
+        const char* sliceName =
+            slice < m_sliceNames.size() ? m_sliceNames[slice].c_str() : "unknown";
+        if (threads.insert({pid, g.rnti}).second)
+        {
+            std::fprintf(f,
+                         "{\"ph\":\"M\",\"name\":\"thread_name\",\"pid\":%u,\"tid\":%u,"
+                         "\"args\":{\"name\":\"UE %u (%s)\"}},\n",
+                         pid,
+                         g.rnti,
+                         g.rnti,
+                         sliceName);
+        }
+        // timestamps in microseconds
+        std::fprintf(f,
+                     "{\"ph\":\"X\",\"name\":\"%s%s\",\"cat\":\"%s\",\"pid\":%u,\"tid\":%u,"
+                     "\"ts\":%.3f,\"dur\":%.3f,\"args\":{\"slice\":\"%s\",\"rbs\":%u,"
+                     "\"symStart\":%u,\"numSym\":%u,\"mcs\":%u,\"tbSize\":%u,\"rv\":%u,"
+                     "\"harqId\":%u}},\n",
+                     sliceName,
+                     g.rv > 0 ? " retx" : "",
+                     sliceName,
+                     pid,
+                     g.rnti,
+                     g.startNs / 1e3,
+                     g.numSym * m_bwps[g.bwp].symbolNs / 1e3,
+                     sliceName,
+                     m_bwps[g.bwp].rbs,
+                     g.symStart,
+                     g.numSym,
+                     g.mcs,
+                     g.tbSize,
+                     g.rv,
+                     g.harqId);
+    }
+    // a last metadata event, so that every event above can end with a comma
+    std::fprintf(f,
+                 "{\"ph\":\"M\",\"name\":\"trace_dropped\",\"pid\":0,\"tid\":0,"
+                 "\"args\":{\"grants\":%llu}}\n]}\n",
+                 static_cast<unsigned long long>(m_dropped));
+    std::fclose(f);
+    return true;
+}
+
+inline uint64_t
+SchedulerTimeline::GetNumRecorded() const
+{
+    return m_grants.size();
+}
+
+inline uint64_t
+SchedulerTimeline::GetNumDropped() const
+{
+    return m_dropped;
+}
+
+inline uint64_t
+SchedulerTimeline::GetBufferBytes() const
+{
+    return m_grants.capacity() * sizeof(Grant);
+}
+
+} // namespace ns3
+
+#endif /* SLICING_SCHED_TIMELINE_H */
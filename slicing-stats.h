@@ -0,0 +1,150 @@
+#ifndef SLICING_STATS_H
+#define SLICING_STATS_H
+
+#include <cmath>
+#include <cstdint>
+#include <limits>
+
+namespace ns3
+{
+
+/**
+ * Quantile of the standard normal distribution.
+ *
+ * Rational approximation of P. J. Acklam, relative error below 1.2e-9.
+ *
+ * \param p The probability, in (0, 1).
+ * \return The quantile.
+ */
+inline double
+NormalQuantile(double p)
+{
+    static const double a[] = {-3.969683028665376e+01,
+                               2.209460984245205e+02,
+                               -2.759285104469687e+02,
+                               1.383577518672690e+02,
+                               -3.066479806614716e+01,
+                               2.506628277459239e+00};
+    static const double b[] = {-5.447609879822406e+01,
+                               1.615858368580409e+02,
+                               -1.556989798598866e+02,
+                               6.680131188771972e+01,
+                               -1.328068155288572e+01};
+    static const double c[] = {-7.784894002430293e-03,
+                               -3.223964580411365e-01,
+                               -2.400758277161838e+00,
+                               -2.549732539343734e+00,
+                               4.374664141464968e+00,
+                               2.938163982698783e+00};
+    static const double d[] = {7.784695709041462e-03,
+                               3.224671290700398e-01,
+                               2.445134137142996e+00,
+                               3.754408661907416e+00};
+    const double low = 0.02425;
+    if (p < low)
+    {
+        double q = std::sqrt(-2 * std::log(p));
+        return (((((c[0] * q + c[1]) * q + c[2]) * q + c[3]) * q + c[4]) * q + c[5]) /
+               ((((d[0] * q + d[1]) * q + d[2]) * q + d[3]) * q + 1);
+    }
+    if (p > 1 - low)
+    {
+        return -NormalQuantile(1 - p);
+    }
+    double q = p - 0.5;
+    double r = q * q;
+    return (((((a[0] * r + a[1]) * r + a[2]) * r + a[3]) * r + a[4]) * r + a[5]) * q /
+           (((((b[0] * r + b[1]) * r + b[2]) * r + b[3]) * r + b[4]) * r + 1);
+}
+
+/**
+ * Quantile of the Student t distribution.
+ *
+ * Exact for 1 and 2 degrees of freedom, Cornish-Fisher expansion around the
+ * normal quantile otherwise; the error is below 0.5% from 3 degrees of freedom.
+ *
+ * \param p The probability, in (0, 1).
+ * \param dof The degrees of freedom, at least 1.
+ * \return The quantile.
+ */
+inline double
+StudentTQuantile(double p, uint32_t dof)
+{
+    if (dof == 1)
+    {
+        return std::tan(M_PI * (p - 0.5));
+    }
+    if (dof == 2)
+    {
+        return (2 * p - 1) / std::sqrt(2 * p * (1 - p));
+    }
+    double z = NormalQuantile(p);
+    double n = dof;
+    double z2 = z * z;
+    double g1 = (z2 + 1) * z / 4;
+    double g2 = ((5 * z2 + 16) * z2 + 3) * z / 96;
+    double g3 = (((3 * z2 + 19) * z2 + 17) * z2 - 15) * z / 384;
+    double g4 = ((((79 * z2 + 776) * z2 + 1482) * z2 - 1920) * z2 - 945) * z / 92160;
+    return z + g1 / n + g2 / (n * n) + g3 / (n * n * n) + g4 / (n * n * n * n);
+}
+
+/**
+ * Running mean and variance of a sample (Welford).
+ */
+class RunningStats
+{
+  public:
+    /**
+     * Add a value to the sample.
+     * \param x The value.
+     */
+    void Add(double x)
+    {
+        ++m_n;
+        double delta = x - m_mean;
+        m_mean += delta / m_n;
+        m_m2 += delta * (x - m_mean);
+    }
+
+    /// \return The sample size.
+    uint32_t GetCount() const
+    {
+        return m_n;
+    }
+
+    /// \return The sample mean.
+    double GetMean() const
+    {
+        return m_mean;
+    }
+
+    /// \return The unbiased sample variance, 0 below two values.
+    double GetVariance() const
+    {
+        return m_n > 1 ? m_m2 / (m_n - 1) : 0.;
+    }
+
+    /**
+     * Half-width of the two-sided confidence interval of the mean.
+     * \param confidence The confidence level, e.g. 0.95.
+     * \return The half-width, infinite below two values.
+     */
+    double GetHalfWidth(double confidence) const
+    {
+        if (m_n < 2)
+        {
+            return std::numeric_limits<double>::infinity();
+        }
+        return StudentTQuantile(1 - (1 - confidence) / 2, m_n - 1) *
+               std::sqrt(GetVariance() / m_n);
+    }
+
+  private:
+    uint32_t m_n{0};   //!< Sample size.
+    double m_mean{0};  //!< Sample mean.
+    double m_m2{0};    //!< Sum of the squared deviations from the mean.
+};
+
+} // namespace ns3
+
+#endif /* SLICING_STATS_H */
@@ -0,0 +1,325 @@
+#ifndef SLICING_STEADY_STATE_H
+#define SLICING_STEADY_STATE_H
+
+#include "ns3/core-module.h"
+
+#include "slicing-stats.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <string>
+#include <vector>
+
+namespace ns3
+{
+
+/**
+ * Cumulative flow monitor counters of one slice and direction.
+ */
+struct SliceCounters
+{
+    uint64_t rxBytes{0};              //!< Received bytes.
+    uint64_t rxPackets{0};            //!< Received packets.
+    uint64_t lostPackets{0};          //!< Packets declared lost.
+    double delaySum{0};               //!< Sum of the delays in seconds.
+    std::vector<uint64_t> delayBins;  //!< Delay histogram.
+
+    /**
+     * Subtract earlier counters, e.g. those at the end of the warm-up.
+     * \param earlier The earlier counters.
+     * \return The counters accumulated since.
+     */
+    SliceCounters Since(const SliceCounters& earlier) const
+    {
+        SliceCounters d;
+        d.rxBytes = rxBytes - earlier.rxBytes;
+        d.rxPackets = rxPackets - earlier.rxPackets;
+        d.lostPackets = lostPackets - std::min(lostPackets, earlier.lostPackets);
+        d.delaySum = delaySum - earlier.delaySum;
+        d.delayBins = delayBins;
+        for (std::size_t b = 0; b < std::min(d.delayBins.size(), earlier.delayBins.size()); ++b)
+        {
+            d.delayBins[b] -= earlier.delayBins[b];
+        }
+        return d;
+    }
+};
+
+/**
+ * Cumulative flow monitor counters of one flow, without the histograms.
+ */
+struct FlowCounters
+{
+    uint64_t txBytes{0};     //!< Transmitted bytes.
+    uint64_t txPackets{0};   //!< Transmitted packets.
+    uint64_t rxBytes{0};     //!< Received bytes.
+    uint64_t rxPackets{0};   //!< Received packets.
+    uint64_t lostPackets{0}; //!< Packets declared lost.
+    double delaySum{0};      //!< Sum of the delays in seconds.
+    double jitterSum{0};     //!< Sum of the jitters in seconds.
+
+    /**
+     * Subtract earlier counters, e.g. those at the end of the warm-up.
+     * \param earlier The earlier counters.
+     * \return The counters accumulated since.
+     */
+    FlowCounters Since(const FlowCounters& earlier) const
+    {
+        FlowCounters d;
+        d.txBytes = txBytes - earlier.txBytes;
+        d.txPackets = txPackets - earlier.txPackets;
+        d.rxBytes = rxBytes - earlier.rxBytes;
+        d.rxPackets = rxPackets - earlier.rxPackets;
+        d.lostPackets = lostPackets - std::min(lostPackets, earlier.lostPackets);
+        d.delaySum = delaySum - earlier.delaySum;
+        d.jitterSum = jitterSum - earlier.jitterSum;
+        return d;
+    }
+};
+
+/**
+ * Online steady-state detector based on MSER-5.
+ *
+ * Each series, e.g. the throughput or the mean delay of a slice per sampling
+ * interval, is grouped in batches of BatchSize samples. The truncation point
+ * d minimizes the MSER statistic of the batch means Z(d+1..k),
+ * sum (Z_i - mean)^2 / (k - d)^2; a series is steady once d lies in the first
+ * half of its batches. The detector has converged when every series is steady
+ * and the batch-means confidence interval of its retained part is narrower
+ * than Tolerance relative to its mean.
+ */
+class SteadyStateDetector : public Object
+{
+  public:
+    SteadyStateDetector();
+    ~SteadyStateDetector() override;
+
+    /**
+     * Register this type.
+     * \return The TypeId.
+     */
+    static TypeId GetTypeId();
+
+    /**
+     * Add a series.
+     * \param name The name of the series.
+     * \return The index of the series.
+     */
+    uint32_t AddSeries(std::string name);
+
+    /**
+     * Add a sample to a series.
+     * \param series The series index.
+     * \param end The end of the sampling interval.
+     * \param value The value over the interval.
+     */
+    void AddSample(uint32_t series, Time end, double value);
+
+    /**
+     * \return true if every series with samples is steady and precise enough.
+     */
+    bool IsConverged() const;
+
+    /**
+     * \return The end of the warm-up, the latest truncation point of the
+     * series, or zero if no sample is discarded.
+     */
+    Time GetWarmupEnd() const;
+
+    /**
+     * Print the truncation point and the state of each series.
+     * \param os The output stream.
+     */
+    void Report(std::ostream& os) const;
+
+  private:
+    /// Samples of one series.
+    struct Series
+    {
+        std::string name;          //!< Name of the series.
+        std::vector<Time> ends;    //!< End of each sampling interval.
+        std::vector<double> values; //!< Value of each sampling interval.
+    };
+
+    /**
+     * Find the MSER truncation point of a series.
+     * \param s The series.
+     * \param truncation The number of discarded batches.
+     * \param halfWidth The relative half-width of the retained batch means.
+     * \return true if the series is steady, i.e. truncated in its first half.
+     */
+    bool Truncate(const Series& s, uint32_t& truncation, double& halfWidth) const;
+
+    std::vector<Series> m_series; //!< The series.
+    uint32_t m_batchSize;         //!< Samples per batch.
+    uint32_t m_minBatches;        //!< Batches retained before convergence.
+    double m_tolerance;           //!< Target relative half-width.
+    double m_confidence;          //!< Confidence level of the half-width.
+};
+
+inline SteadyStateDetector::SteadyStateDetector()
+    : m_batchSize(5),
+      m_minBatches(10),
+      m_tolerance(0.05),
+      m_confidence(0.95)
+{
+}
+
+inline SteadyStateDetector::~SteadyStateDetector()
+{
+}
+
+/* static */
+inline TypeId
+SteadyStateDetector::GetTypeId()
+{
+    static TypeId tid =
+        TypeId("SteadyStateDetector")
+            .SetParent<Object>()
+            .SetGroupName("Tutorial")
+            .AddConstructor<SteadyStateDetector>()
+            .AddAttribute("BatchSize",
+                          "Number of samples per batch, 5 for MSER-5",
+                          UintegerValue(5),
+                          MakeUintegerAccessor(&SteadyStateDetector::m_batchSize),
+                          MakeUintegerChecker<uint32_t>(1))
+            .AddAttribute("MinBatches",
+                          "Number of retained batches needed before convergence",
+                          UintegerValue(10),
+                          MakeUintegerAccessor(&SteadyStateDetector::m_minBatches),
+                          MakeUintegerChecker<uint32_t>(2))
+            .AddAttribute("Tolerance",
+                          "Target half-width of the batch-means confidence interval, relative "
+                          "to the mean",
+                          DoubleValue(0.05),
+                          MakeDoubleAccessor(&SteadyStateDetector::m_tolerance),
+                          MakeDoubleChecker<double>(0))
+            .AddAttribute("Confidence",
+                          "Confidence level of the batch-means interval",
+                          DoubleValue(0.95),
+                          MakeDoubleAccessor(&SteadyStateDetector::m_confidence),
+                          MakeDoubleChecker<double>(0, 1));
+    return tid;
+}
+
+inline uint32_t
+SteadyStateDetector::AddSeries(std::string name)
+{
+    Series s;
+    s.name = name;
+    m_series.push_back(s);
+    return m_series.size() - 1;
+}
+
+inline void
+SteadyStateDetector::AddSample(uint32_t series, Time end, double value)
+{
+    m_series.at(series).ends.push_back(end);
+    m_series.at(series).values.push_back(value);
+}
+
+inline bool
+SteadyStateDetector::Truncate(const Series& s, uint32_t& truncation, double& halfWidth) const
+{
+    truncation = 0;
+    halfWidth = std::numeric_limits<double>::infinity();
+    std::size_t k = s.values.size() / m_batchSize;
+    if (k < 2)
+    {
+        return false;
+    }
+    std::vector<double> z(k, 0.);
+    for (std::size_t i = 0; i < k * m_batchSize; ++i)
+    {
+        z[i / m_batchSize] += s.values[i] / m_batchSize;
+    }
+
+    // suffix sums give the mean and the squared deviations of Z(d+1..k) in O(k)
+    double best = std::numeric_limits<double>::infinity();
+    double sum = 0;
+    double sumSq = 0;
+    for (std::size_t d = k; d-- > 0;)
+    {
+        sum += z[d];
+        sumSq += z[d] * z[d];
+        double m = k - d;
+        if (m < 2)
+        {
+            continue;
+        }
+        double mser = (sumSq - sum * sum / m) / (m * m);
+        if (mser <= best)
+        {
+            best = mser;
+            truncation = d;
+        }
+    }
+
+    RunningStats retained;
+    for (std::size_t i = truncation; i < k; ++i)
+    {
+        retained.Add(z[i]);
+    }
+    double mean = std::abs(retained.GetMean());
+    double hw = retained.GetHalfWidth(m_confidence);
+    halfWidth = mean > 0 ? hw / mean : (hw > 0 ? std::numeric_limits<double>::infinity() : 0.);
+    return truncation <= k / 2;
+}
+
+inline bool
+SteadyStateDetector::IsConverged() const
+{
+    bool any = false;
+    for (const auto& s : m_series)
+    {
+        if (s.values.empty())
+        {
+            continue;
+        }
+        any = true;
+        uint32_t truncation;
+        double halfWidth;
+        if (!Truncate(s, truncation, halfWidth) ||
+            s.values.size() / m_batchSize - truncation < m_minBatches || halfWidth > m_tolerance)
+        {
+            return false;
+        }
+    }
+    return any;
+}
+
+inline Time
+SteadyStateDetector::GetWarmupEnd() const
+{
+    Time end;
+    for (const auto& s : m_series)
+    {
+        uint32_t truncation;
+        double halfWidth;
+        Truncate(s, truncation, halfWidth);
+        if (truncation > 0)
+        {
+            end = std::max(end, s.ends[truncation * m_batchSize - 1]);
+        }
+    }
+    return end;
+}
+
+inline void
+SteadyStateDetector::Report(std::ostream& os) const
+{
+    for (const auto& s : m_series)
+    {
+        uint32_t truncation;
+        double halfWidth;
+        bool steady = Truncate(s, truncation, halfWidth);
+        os << "  " << s.name << ": " << s.values.size() << " samples, warm-up "
+           << truncation * m_batchSize << " samples, "
+           << (steady ? "steady" : "not steady") << ", relative half-width " << halfWidth << "\n";
+    }
+}
+
+} // namespace ns3
+
+#endif /* SLICING_STEADY_STATE_H */
@@ -0,0 +1,205 @@
+#ifndef SLICING_STREAM_REGISTRY_H
+#define SLICING_STREAM_REGISTRY_H
+
+#include "ns3/core-module.h"
+
+#include <functional>
+#include <map>
+#include <ostream>
+#include <tuple>
+#include <utility>
+
+namespace ns3
+{
+
+/// Entities that own random variables.
+enum RngEntity : uint8_t
+{
+    RNG_ENTITY_GNB = 0, //!< A gNB device.
+    RNG_ENTITY_UE,      //!< A UE, its device and its position.
+    RNG_ENTITY_APP,     //!< A traffic generator.
+    RNG_ENTITY_SERVER,  //!< An application server.
+    RNG_NUM_ENTITIES
+};
+
+/// What the random variables of an entity are used for.
+enum RngPurpose : uint8_t
+{
+    RNG_PURPOSE_DEVICE = 0, //!< PHY, MAC, scheduler and channel of a device.
+    RNG_PURPOSE_POSITION,   //!< Initial positions.
+    RNG_PURPOSE_TRAFFIC,    //!< Packet sizes and times of a traffic generator, UE arrivals.
+    RNG_PURPOSE_SERVICE,    //!< Service times of a server.
+    RNG_NUM_PURPOSES
+};
+
+/**
+ * Stable allocation of the RNG streams.
+ *
+ * Every (entity, slice, index, purpose) key owns a fixed block of
+ * StreamsPerKey streams, at a position computed from the key alone. The
+ * streams of the third UE of a slice are thus the same whatever the number
+ * of UEs or slices, unlike a running counter that shifts every later stream
+ * when an entity is added. Sweep points that share entities then share their
+ * random numbers (common random numbers), and their differences have less
+ * variance. Assigning a key twice, or more streams than its block holds,
+ * is an error.
+ */
+class RngStreamRegistry : public Object
+{
+  public:
+    /**
+     * Assigns the streams of an entity from a first stream.
+     * \return The number of streams used.
+     */
+    using Assigner = std::function<int64_t(int64_t)>;
+
+    RngStreamRegistry();
+    ~RngStreamRegistry() override;
+
+    /**
+     * Register this type.
+     * \return The TypeId.
+     */
+    static TypeId GetTypeId();
+
+    /**
+     * \param entity The entity, e.g. RNG_ENTITY_UE.
+     * \param slice The slice index, 0 for entities outside the slices.
+     * \param index The index of the entity within its slice.
+     * \param purpose The purpose, e.g. RNG_PURPOSE_DEVICE.
+     * \return The first stream of the block of the key.
+     */
+    int64_t GetStream(uint8_t entity, uint32_t slice, uint32_t index, uint8_t purpose) const;
+
+    /**
+     * Assign the streams of the block of a key.
+     * \param entity The entity.
+     * \param slice The slice index.
+     * \param index The index of the entity within its slice.
+     * \param purpose The purpose.
+     * \param assign Assigns the streams, e.g. a call to AssignStreams().
+     * \return The number of streams used.
+     */
+    int64_t Assign(uint8_t entity,
+                   uint32_t slice,
+                   uint32_t index,
+                   uint8_t purpose,
+                   const Assigner& assign);
+
+    /**
+     * Print the number of keys and streams assigned per entity and purpose.
+     * \param os The output stream.
+     */
+    void Print(std::ostream& os) const;
+
+  private:
+    /// (entity, slice, index, purpose)
+    using Key = std::tuple<uint8_t, uint32_t, uint32_t, uint8_t>;
+
+    int64_t m_offset;         //!< First stream of the registry.
+    uint32_t m_streamsPerKey; //!< Streams in the block of a key.
+    uint32_t m_maxSlices;     //!< Slices per entity.
+    uint32_t m_maxIndex;      //!< Entities per slice.
+
+    std::map<Key, int64_t> m_assigned; //!< Streams used by each key assigned.
+};
+
+inline RngStreamRegistry::RngStreamRegistry()
+    : m_offset(1),
+      m_streamsPerKey(64),
+      m_maxSlices(8),
+      m_maxIndex(4096)
+{
+}
+
+inline RngStreamRegistry::~RngStreamRegistry()
+{
+}
+
+/* static */
+inline TypeId
+RngStreamRegistry::GetTypeId()
+{
+    static TypeId tid =
+        TypeId("RngStreamRegistry")
+            .SetParent<Object>()
+            .SetGroupName("Tutorial")
+            .AddConstructor<RngStreamRegistry>()
+            .AddAttribute("Offset",
+                          "First stream of the registry",
+                          IntegerValue(1),
+                          MakeIntegerAccessor(&RngStreamRegistry::m_offset),
+                          MakeIntegerChecker<int64_t>(0))
+            .AddAttribute("StreamsPerKey",
+                          "Streams reserved for each (entity, slice, index, purpose) key",
+                          UintegerValue(64),
+                          MakeUintegerAccessor(&RngStreamRegistry::m_streamsPerKey),
+                          MakeUintegerChecker<uint32_t>(1))
+            .AddAttribute("MaxSlices",
+                          "Highest number of slices; changing it moves every stream",
+                          UintegerValue(8),
+                          MakeUintegerAccessor(&RngStreamRegistry::m_maxSlices),
+                          MakeUintegerChecker<uint32_t>(1))
+            .AddAttribute("MaxIndex",
+                          "Highest number of entities per slice; changing it moves every stream",
+                          UintegerValue(4096),
+                          MakeUintegerAccessor(&RngStreamRegistry::m_maxIndex),
+                          MakeUintegerChecker<uint32_t>(1));
+    return tid;
+}
+
+inline int64_t
+RngStreamRegistry::GetStream(uint8_t entity, uint32_t slice, uint32_t index, uint8_t purpose) const
+{
+    NS_ABORT_MSG_IF(entity >= RNG_NUM_ENTITIES || purpose >= RNG_NUM_PURPOSES,
+                    "Unknown entity " << +entity << " or purpose " << +purpose);
+    NS_ABORT_MSG_IF(slice >= m_maxSlices, "Slice " << slice << " over MaxSlices");
+    NS_ABORT_MSG_IF(index >= m_maxIndex, "Index " << index << " over MaxIndex");
+    int64_t block = ((static_cast<int64_t>(entity) * RNG_NUM_PURPOSES + purpose) * m_maxSlices +
+                     slice) *
+                        m_maxIndex +
+                    index;
+    return m_offset + block * m_streamsPerKey;
+}
+
+inline int64_t
+RngStreamRegistry::Assign(uint8_t entity,
+                          uint32_t slice,
+                          uint32_t index,
+                          uint8_t purpose,
+                          const Assigner& assign)
+{
+    Key key(entity, slice, index, purpose);
+    NS_ABORT_MSG_IF(m_assigned.count(key) > 0,
+                    "Streams of entity " << +entity << " slice " << slice << " index " << index
+                                         << " purpose " << +purpose << " assigned twice");
+    int64_t used = assign(GetStream(entity, slice, index, purpose));
+    NS_ABORT_MSG_IF(used > m_streamsPerKey,
+                    "Entity " << +entity << " needs " << used
+                              << " streams, raise RngStreamRegistry::StreamsPerKey");
+    m_assigned[key] = used;
+    return used;
+}
+
+inline void
+RngStreamRegistry::Print(std::ostream& os) const
+{
+    static const char* entities[] = {"gNB", "UE", "App", "Server"};
+    static const char* purposes[] = {"device", "position", "traffic", "service"};
+    std::map<std::pair<uint8_t, uint8_t>, std::pair<uint32_t, int64_t>> totals;
+    for (const auto& [key, used] : m_assigned)
+    {
+        auto& t = totals[{std::get<0>(key), std::get<3>(key)}];
+        ++t.first;
+        t.second += used;
+    }
+    for (const auto& [k, t] : totals)
+    {
+        os << "  " << entities[k.first] << " " << purposes[k.second] << ": " << t.first
+           << " keys, " << t.second << " streams\n";
+    }
+}
+
+} // namespace ns3
+
+#endif /* SLICING_STREAM_REGISTRY_H */
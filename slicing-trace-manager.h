@@ -0,0 +1,789 @@
+#ifndef SLICING_TRACE_MANAGER_H
+#define SLICING_TRACE_MANAGER_H
+
+#include "ns3/core-module.h"
+#include "ns3/lte-module.h"
+#include "ns3/network-module.h"
+#include "ns3/nr-module.h"
+
+#include <algorithm>
+#include <condition_variable>
+#include <cstdio>
+#include <cstring>
+#include <deque>
+#include <fstream>
+#include <map>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace ns3
+{
+
+/// Type of a binary trace record.
+enum TraceRecordType : uint8_t
+{
+    TRACE_RX_PACKET_DL = 0, //!< RxPacketTraceUe of a UE PHY.
+    TRACE_RX_PACKET_UL,     //!< RxPacketTraceEnb of a gNB PHY.
+    TRACE_DL_SCHED,         //!< DlScheduling of a gNB MAC.
+    TRACE_UL_SCHED,         //!< UlScheduling of a gNB MAC.
+    TRACE_SLOT_STATS,       //!< SlotDataStats of a gNB PHY.
+    TRACE_RLC_DL_TX,        //!< TxPDU of a gNB RLC.
+    TRACE_RLC_DL_RX,        //!< RxPDU of a UE RLC.
+    TRACE_RLC_UL_TX,        //!< TxPDU of a UE RLC.
+    TRACE_RLC_UL_RX,        //!< RxPDU of a gNB RLC.
+    TRACE_PDCP_DL_TX,       //!< TxPDU of a gNB PDCP.
+    TRACE_PDCP_DL_RX,       //!< RxPDU of a UE PDCP.
+    TRACE_PDCP_UL_TX,       //!< TxPDU of a UE PDCP.
+    TRACE_PDCP_UL_RX,       //!< RxPDU of a gNB PDCP.
+    TRACE_NUM_TYPES
+};
+
+/**
+ * Fixed-size binary trace record.
+ *
+ * The meaning of the generic fields depends on the type:
+ * - RX_PACKET: size = TB size, rbs = assigned RBs, sinr is linear;
+ * - DL/UL_SCHED: size = TB size;
+ * - SLOT_STATS: size = used REGs, numSym = used symbols, rbs = available RBs,
+ *   aux0 = available symbols, aux1 = scheduled UEs;
+ * - RLC/PDCP: size = PDU size, aux0 = LCID, aux1 = delay in us (RX only).
+ * With per-slot aggregation, count records of the same slot, cell, BWP and RNTI
+ * are merged: size, rbs, numSym and corrupt are summed, sinr and tbler averaged.
+ */
+struct TraceRecord
+{
+    uint64_t timeNs;  //!< Simulation time of the (first) event.
+    uint8_t type;     //!< TraceRecordType.
+    uint8_t mcs;      //!< MCS.
+    uint8_t rv;       //!< Redundancy version.
+    uint8_t rank;     //!< Rank.
+    uint16_t cellId;  //!< Cell id.
+    uint16_t rnti;    //!< RNTI.
+    uint16_t bwpId;   //!< BWP id.
+    uint16_t frame;   //!< Frame number, modulo 2^16.
+    uint8_t subframe; //!< Subframe number.
+    uint8_t slot;     //!< Slot number.
+    uint8_t symStart; //!< First symbol.
+    uint8_t numSym;   //!< Number of symbols.
+    uint32_t size;    //!< Bytes, see the type.
+    uint32_t rbs;     //!< RBs, see the type.
+    uint32_t aux0;    //!< See the type.
+    uint32_t aux1;    //!< See the type.
+    float sinr;       //!< SINR.
+    float tbler;      //!< TB error rate.
+    uint8_t corrupt;  //!< Corrupted TBs.
+    uint8_t cqi;      //!< CQI.
+    uint8_t ndi;      //!< New data indicator.
+    uint8_t harqId;   //!< HARQ process.
+    uint32_t count;   //!< Number of events merged in the record.
+};
+
+static_assert(sizeof(TraceRecord) == 56, "The trace file format relies on the record size");
+
+/// Header of a binary trace file.
+struct TraceFileHeader
+{
+    char magic[8];          //!< "NRTRACE".
+    uint32_t version;       //!< Format version.
+    uint32_t recordSize;    //!< sizeof(TraceRecord).
+    uint32_t families;      //!< Mask of the enabled families.
+    uint32_t samplingPeriod; //!< One of samplingPeriod records kept per type.
+    uint32_t aggregated;    //!< 1 if the records are aggregated per slot.
+    uint32_t reserved;      //!< Zero.
+};
+
+/// Magic of a binary trace file.
+static const char g_traceMagic[8] = "NRTRACE";
+
+/**
+ * Selective, buffered binary sink for the NR traces.
+ *
+ * Only the families listed in the Families attribute are connected:
+ * rxPacket (PHY RxPacketTrace), dlSched and ulSched (MAC scheduling),
+ * slotStats (PHY SlotDataStats), rlc and pdcp (PDU tx/rx). Every event is a
+ * TraceRecord appended to a large in-memory buffer; full buffers are written
+ * by a background thread, so the simulation never formats text nor waits for
+ * the disk unless all BufferCount buffers are full. SamplingPeriod keeps one
+ * of N records of each type, and AggregatePerSlot merges the PHY and MAC
+ * records of the same UE and slot. trace-export-network-slicing.cc turns the
+ * file into the text files of NrHelper::EnableTraces().
+ */
+class SliceTraceManager : public Object
+{
+  public:
+    /// Trace families.
+    enum Family : uint32_t
+    {
+        RX_PACKET = 1 << 0,
+        DL_SCHED = 1 << 1,
+        UL_SCHED = 1 << 2,
+        SLOT_STATS = 1 << 3,
+        RLC = 1 << 4,
+        PDCP = 1 << 5,
+    };
+
+    SliceTraceManager();
+    ~SliceTraceManager() override;
+
+    /**
+     * Register this type.
+     * \return The TypeId.
+     */
+    static TypeId GetTypeId();
+
+    /**
+     * Parse a comma-separated list of families.
+     * \param families The list, e.g. rxPacket,dlSched; "all" enables every family.
+     * \return The mask of the families.
+     */
+    static uint32_t ParseFamilies(const std::string& families);
+
+    /**
+     * Open the trace file and start the writer thread.
+     * \param filename The trace file.
+     * \return false if the file cannot be opened.
+     */
+    bool Open(const std::string& filename);
+
+    /**
+     * Connect the PHY and MAC traces of the gNBs.
+     * \param gnbDevices The gNB devices.
+     */
+    void ConnectGnbs(const NetDeviceContainer& gnbDevices);
+
+    /**
+     * Connect the PHY traces of the UEs.
+     * \param ueDevices The UE devices.
+     */
+    void ConnectUes(const NetDeviceContainer& ueDevices);
+
+    /**
+     * Connect the RLC and PDCP traces; the bearers must exist, so schedule it
+     * after they are set up.
+     */
+    void ConnectBearers();
+
+    /**
+     * Flush the pending records, stop the writer thread and close the file.
+     */
+    void Close();
+
+    /// \return The number of records written or queued.
+    uint64_t GetNumRecords() const;
+    /// \return The bytes of the record buffers allocated so far.
+    uint64_t GetBufferBytes() const;
+
+  protected:
+    void DoDispose() override;
+
+  private:
+    /**
+     * Sample, aggregate and queue a record.
+     * \param r The record.
+     */
+    void Push(const TraceRecord& r);
+    /**
+     * Queue a record.
+     * \param r The record.
+     */
+    void Append(const TraceRecord& r);
+    /// Hand the active buffer to the writer thread.
+    void Flush();
+    /// Write the full buffers until Close().
+    void WriterLoop();
+
+    /**
+     * RxPacketTraceUe/Enb trace sink.
+     * \param type The record type.
+     * \param params The reception.
+     */
+    void RxPacketTrace(uint8_t type, RxPacketTraceParams params);
+    /**
+     * DlScheduling/UlScheduling trace sink.
+     * \param type The record type.
+     * \param cellId The cell id.
+     * \param info The scheduling decision.
+     */
+    void Scheduling(uint8_t type, uint16_t cellId, NrSchedulingCallbackInfo info);
+    /**
+     * SlotDataStats trace sink.
+     * \param sfnSf The slot.
+     * \param scheduledUe The number of scheduled UEs.
+     * \param usedReg The used RB x symbols.
+     * \param usedSym The used symbols.
+     * \param availableRb The available RBs.
+     * \param availableSym The available symbols.
+     * \param bwpId The BWP id.
+     * \param cellId The cell id.
+     */
+    void SlotDataStats(const SfnSf& sfnSf,
+                       uint32_t scheduledUe,
+                       uint32_t usedReg,
+                       uint32_t usedSym,
+                       uint32_t availableRb,
+                       uint32_t availableSym,
+                       uint16_t bwpId,
+                       uint16_t cellId);
+    /**
+     * TxPDU trace sink of RLC and PDCP.
+     * \param type The record type.
+     * \param context The trace context.
+     * \param rnti The RNTI.
+     * \param lcid The LCID.
+     * \param size The PDU size.
+     */
+    void TxPdu(uint8_t type, std::string context, uint16_t rnti, uint8_t lcid, uint32_t size);
+    /**
+     * RxPDU trace sink of RLC and PDCP.
+     * \param type The record type.
+     * \param context The trace context.
+     * \param rnti The RNTI.
+     * \param lcid The LCID.
+     * \param size The PDU size.
+     * \param delay The delay in ns.
+     */
+    void RxPdu(uint8_t type,
+               std::string context,
+               uint16_t rnti,
+               uint8_t lcid,
+               uint32_t size,
+               uint64_t delay);
+    /**
+     * \param context A trace context starting with /NodeList/n/DeviceList/d.
+     * \return The cell id of the device, or 0.
+     */
+    static uint16_t CellIdOfContext(const std::string& context);
+
+    std::string m_familyList;   //!< Families attribute.
+    uint32_t m_families;        //!< Mask of the enabled families.
+    uint32_t m_bufferSize;      //!< Records per buffer.
+    uint32_t m_bufferCount;     //!< Maximum number of buffers.
+    uint32_t m_samplingPeriod;  //!< Keep one of N records per type.
+    bool m_aggregate;           //!< Merge the records of a UE and slot.
+
+    std::vector<uint32_t> m_sampleCounters; //!< Records seen per type.
+    /// Records of the current slot, per (type, cell, BWP).
+    std::map<uint64_t, std::vector<TraceRecord>> m_pending;
+    uint64_t m_numRecords;                  //!< Records written or queued.
+
+    std::vector<TraceRecord> m_active;              //!< Buffer filled by the simulation.
+    std::deque<std::vector<TraceRecord>> m_full;    //!< Buffers waiting for the writer.
+    std::vector<std::vector<TraceRecord>> m_free;   //!< Buffers written by the writer.
+    uint32_t m_allocated;                           //!< Buffers allocated so far.
+    std::mutex m_mutex;                             //!< Protects the buffer queues.
+    std::condition_variable m_cv;                   //!< Signals the buffer queues.
+    bool m_closing;                                 //!< True once Close() is called.
+    std::thread m_writer;                           //!< Writer thread.
+    std::ofstream m_file;                           //!< Trace file.
+};
+
+inline SliceTraceManager::SliceTraceManager()
+    : m_families(0),
+      m_bufferSize(1 << 16),
+      m_bufferCount(4),
+      m_samplingPeriod(1),
+      m_aggregate(false),
+      m_sampleCounters(TRACE_NUM_TYPES, 0),
+      m_numRecords(0),
+      m_allocated(0),
+      m_closing(false)
+{
+}
+
+inline SliceTraceManager::~SliceTraceManager()
+{
+    Close();
+}
+
+/* static */
+inline TypeId
+SliceTraceManager::GetTypeId()
+{
+    static TypeId tid =
+        TypeId("SliceTraceManager")
+            .SetParent<Object>()
+            .SetGroupName("Tutorial")
+            .AddConstructor<SliceTraceManager>()
+            .AddAttribute("Families",
+                          "Comma-separated trace families: rxPacket, dlSched, ulSched, "
+                          "slotStats, rlc, pdcp, or all",
+                          StringValue("rxPacket,dlSched,ulSched,slotStats"),
+                          MakeStringAccessor(&SliceTraceManager::m_familyList),
+                          MakeStringChecker())
+            .AddAttribute("BufferSize",
+                          "Number of records per buffer",
+                          UintegerValue(1 << 16),
+                          MakeUintegerAccessor(&SliceTraceManager::m_bufferSize),
+                          MakeUintegerChecker<uint32_t>(1))
+            .AddAttribute("BufferCount",
+                          "Maximum number of buffers; the simulation waits for the writer "
+                          "when all are full",
+                          UintegerValue(4),
+                          MakeUintegerAccessor(&SliceTraceManager::m_bufferCount),
+                          MakeUintegerChecker<uint32_t>(2))
+            .AddAttribute("SamplingPeriod",
+                          "Keep one of N records of each type",
+                          UintegerValue(1),
+                          MakeUintegerAccessor(&SliceTraceManager::m_samplingPeriod),
+                          MakeUintegerChecker<uint32_t>(1))
+            .AddAttribute("AggregatePerSlot",
+                          "Merge the PHY and MAC records of the same UE and slot",
+                          BooleanValue(false),
+                          MakeBooleanAccessor(&SliceTraceManager::m_aggregate),
+                          MakeBooleanChecker());
+    return tid;
+}
+
+/* static */
+inline uint32_t
+SliceTraceManager::ParseFamilies(const std::string& families)
+{
+    static const std::map<std::string, uint32_t> names = {{"rxPacket", RX_PACKET},
+                                                          {"dlSched", DL_SCHED},
+                                                          {"ulSched", UL_SCHED},
+                                                          {"slotStats", SLOT_STATS},
+                                                          {"rlc", RLC},
+                                                          {"pdcp", PDCP}};
+    uint32_t mask = 0;
+    std::istringstream iss(families);
+    std::string name;
+    while (std::getline(iss, name, ','))
+    {
+        if (name.empty())
+        {
+            continue;
+        }
+        if (name == "all")
+        {
+            mask |= RX_PACKET | DL_SCHED | UL_SCHED | SLOT_STATS | RLC | PDCP;
+            continue;
+        }
+        auto it = names.find(name);
+        NS_ABORT_MSG_IF(it == names.end(), "Unknown trace family " << name);
+        mask |= it->second;
+    }
+    return mask;
+}
+
+inline bool
+SliceTraceManager::Open(const std::string& filename)
+{
+    m_families = ParseFamilies(m_familyList);
+    m_file.open(filename.c_str(), std::ofstream::out | std::ofstream::trunc | std::ofstream::binary);
+    if (!m_file.is_open())
+    {
+        return false;
+    }
+    TraceFileHeader header;
+    std::memset(&header, 0, sizeof(header));
+    std::memcpy(header.magic, g_traceMagic, sizeof(header.magic));
+    header.version = 1;
+    header.recordSize = sizeof(TraceRecord);
+    header.families = m_families;
+    header.samplingPeriod = m_samplingPeriod;
+    header.aggregated = m_aggregate ? 1 : 0;
+    m_file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+
+    m_active.reserve(m_bufferSize);
+    m_allocated = 1;
+    m_closing = false;
+    m_writer = std::thread(&SliceTraceManager::WriterLoop, this);
+    return true;
+}
+
+inline void
+SliceTraceManager::ConnectGnbs(const NetDeviceContainer& gnbDevices)
+{
+    for (uint32_t i = 0; i < gnbDevices.GetN(); ++i)
+    {
+        Ptr<NrGnbNetDevice> gnb = DynamicCast<NrGnbNetDevice>(gnbDevices.Get(i));
+        NS_ABORT_MSG_IF(!gnb, "Not a gNB device");
+        for (uint32_t bwp = 0; bwp < gnb->GetCcMapSize(); ++bwp)
+        {
+            Ptr<NrGnbPhy> phy = NrHelper::GetGnbPhy(gnb, bwp);
+            Ptr<NrGnbMac> mac = NrHelper::GetGnbMac(gnb, bwp);
+            if (m_families & RX_PACKET)
+            {
+                phy->GetSpectrumPhy()->TraceConnectWithoutContext(
+                    "RxPacketTraceEnb",
+                    MakeCallback(&SliceTraceManager::RxPacketTrace, this)
+                        .Bind(static_cast<uint8_t>(TRACE_RX_PACKET_UL)));
+            }
+            if (m_families & SLOT_STATS)
+            {
+                phy->TraceConnectWithoutContext(
+                    "SlotDataStats",
+                    MakeCallback(&SliceTraceManager::SlotDataStats, this));
+            }
+            if (m_families & DL_SCHED)
+            {
+                mac->TraceConnectWithoutContext(
+                    "DlScheduling",
+                    MakeCallback(&SliceTraceManager::Scheduling, this)
+                        .Bind(static_cast<uint8_t>(TRACE_DL_SCHED), gnb->GetCellId()));
+            }
+            if (m_families & UL_SCHED)
+            {
+                mac->TraceConnectWithoutContext(
+                    "UlScheduling",
+                    MakeCallback(&SliceTraceManager::Scheduling, this)
+                        .Bind(static_cast<uint8_t>(TRACE_UL_SCHED), gnb->GetCellId()));
+            }
+        }
+    }
+}
+
+inline void
+SliceTraceManager::ConnectUes(const NetDeviceContainer& ueDevices)
+{
+    if (!(m_families & RX_PACKET))
+    {
+        return;
+    }
+    for (uint32_t i = 0; i < ueDevices.GetN(); ++i)
+    {
+        Ptr<NrUeNetDevice> ue = DynamicCast<NrUeNetDevice>(ueDevices.Get(i));
+        NS_ABORT_MSG_IF(!ue, "Not a UE device");
+        for (uint32_t bwp = 0; bwp < ue->GetCcMapSize(); ++bwp)
+        {
+            NrHelper::GetUePhy(ue, bwp)->GetSpectrumPhy()->TraceConnectWithoutContext(
+                "RxPacketTraceUe",
+                MakeCallback(&SliceTraceManager::RxPacketTrace, this)
+                    .Bind(static_cast<uint8_t>(TRACE_RX_PACKET_DL)));
+        }
+    }
+}
+
+inline void
+SliceTraceManager::ConnectBearers()
+{
+    std::string gnbDrb = "/NodeList/*/DeviceList/*/LteEnbRrc/UeMap/*/DataRadioBearerMap/*/";
+    std::string ueDrb = "/NodeList/*/DeviceList/*/LteUeRrc/DataRadioBearerMap/*/";
+    struct Layer
+    {
+        uint32_t family;
+        std::string name;
+        uint8_t dlTx, dlRx, ulTx, ulRx;
+    };
+    const Layer layers[] = {
+        {RLC, "LteRlc", TRACE_RLC_DL_TX, TRACE_RLC_DL_RX, TRACE_RLC_UL_TX, TRACE_RLC_UL_RX},
+        {PDCP, "LtePdcp", TRACE_PDCP_DL_TX, TRACE_PDCP_DL_RX, TRACE_PDCP_UL_TX, TRACE_PDCP_UL_RX}};
+    for (const auto& l : layers)
+    {
+        if (!(m_families & l.family))
+        {
+            continue;
+        }
+        Config::Connect(gnbDrb + l.name + "/TxPDU",
+                        MakeCallback(&SliceTraceManager::TxPdu, this).Bind(l.dlTx));
+        Config::Connect(gnbDrb + l.name + "/RxPDU",
+                        MakeCallback(&SliceTraceManager::RxPdu, this).Bind(l.ulRx));
+        Config::Connect(ueDrb + l.name + "/TxPDU",
+                        MakeCallback(&SliceTraceManager::TxPdu, this).Bind(l.ulTx));
+        Config::Connect(ueDrb + l.name + "/RxPDU",
+                        MakeCallback(&SliceTraceManager::RxPdu, this).Bind(l.dlRx));
+    }
+}
+
+inline void
+SliceTraceManager::Close()
+{
+    if (!m_writer.joinable())
+    {
+        return;
+    }
+    for (auto& group : m_pending)
+    {
+        for (const auto& r : group.second)
+        {
+            Append(r);
+        }
+    }
+    m_pending.clear();
+    Flush();
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_closing = true;
+    }
+    m_cv.notify_all();
+    m_writer.join();
+    m_file.close();
+    m_full.clear();
+    m_free.clear();
+    m_active = std::vector<TraceRecord>();
+}
+
+inline uint64_t
+SliceTraceManager::GetNumRecords() const
+{
+    return m_numRecords;
+}
+
+inline uint64_t
+SliceTraceManager::GetBufferBytes() const
+{
+    return static_cast<uint64_t>(m_allocated) * m_bufferSize * sizeof(TraceRecord);
+}
+
+inline void
+SliceTraceManager::DoDispose()
+{
+    Close();
+    Object::DoDispose();
+}
+
+inline void
+SliceTraceManager::Push(const TraceRecord& r)
+{
+    if (!m_writer.joinable() || m_sampleCounters[r.type]++ % m_samplingPeriod != 0)
+    {
+        return;
+    }
+    bool perSlot = r.type <= TRACE_UL_SCHED;
+    if (!m_aggregate || !perSlot)
+    {
+        Append(r);
+        return;
+    }
+
+    // a record of a new slot closes the slot of its (type, cell, BWP)
+    uint64_t key = (static_cast<uint64_t>(r.type) << 32) | (static_cast<uint64_t>(r.cellId) << 16) |
+                   r.bwpId;
+    std::vector<TraceRecord>& group = m_pending[key];
+    if (!group.empty() && (group[0].frame != r.frame || group[0].subframe != r.subframe ||
+                           group[0].slot != r.slot))
+    {
+        for (const auto& p : group)
+        {
+            Append(p);
+        }
+        group.clear();
+    }
+    for (auto& p : group)
+    {
+        if (p.rnti == r.rnti)
+        {
+            uint32_t n = p.count + r.count;
+            p.sinr = (p.sinr * p.count + r.sinr * r.count) / n;
+            p.tbler = (p.tbler * p.count + r.tbler * r.count) / n;
+            p.size += r.size;
+            p.rbs += r.rbs;
+            p.numSym = static_cast<uint8_t>(std::min(255, p.numSym + r.numSym));
+            p.corrupt = static_cast<uint8_t>(std::min(255, p.corrupt + r.corrupt));
+            p.mcs = r.mcs;
+            p.rv = r.rv;
+            p.count = n;
+            return;
+        }
+    }
+    group.push_back(r);
+}
+
+inline void
+SliceTraceManager::Append(const TraceRecord& r)
+{
+    m_active.push_back(r);
+    ++m_numRecords;
+    if (m_active.size() >= m_bufferSize)
+    {
+        Flush();
+    }
+}
+
+inline void
+SliceTraceManager::Flush()
+{
+    if (m_active.empty())
+    {
+        return;
+    }
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_full.push_back(std::move(m_active));
+    m_cv.notify_all();
+    if (m_free.empty() && m_allocated < m_bufferCount)
+    {
+        ++m_allocated;
+        m_active = std::vector<TraceRecord>();
+    }
+    else
+    {
+        // all the buffers are in use: wait for the writer
+        m_cv.wait(lock, [this]() { return !m_free.empty(); });
+        m_active = std::move(m_free.back());
+        m_free.pop_back();
+    }
+    m_active.clear();
+    m_active.reserve(m_bufferSize);
+}
+
+inline void
+SliceTraceManager::WriterLoop()
+{
+    std::unique_lock<std::mutex> lock(m_mutex);
+    while (true)
+    {
+        m_cv.wait(lock, [this]() { return m_closing || !m_full.empty(); });
+        if (m_full.empty())
+        {
+            return;
+        }
+        std::vector<TraceRecord> buffer = std::move(m_full.front());
+        m_full.pop_front();
+        lock.unlock();
+        m_file.write(reinterpret_cast<const char*>(buffer.data()),
+                     buffer.size() * sizeof(TraceRecord));
+        buffer.clear();
+        lock.lock();
+        m_free.push_back(std::move(buffer));
+        m_cv.notify_all();
+    }
+}
+
+inline void
+SliceTraceManager::RxPacketTrace(uint8_t type, RxPacketTraceParams params)
+{
+    TraceRecord r;
+    std::memset(&r, 0, sizeof(r));
+    r.timeNs = Simulator::Now().GetNanoSeconds();
+    r.type = type;
+    r.mcs = params.m_mcs;
+    r.rv = params.m_rv;
+    r.rank = params.m_rank;
+    r.cellId = params.m_cellId;
+    r.rnti = params.m_rnti;
+    r.bwpId = params.m_bwpId;
+    r.frame = static_cast<uint16_t>(params.m_frameNum);
+    r.subframe = params.m_subframeNum;
+    r.slot = params.m_slotNum;
+    r.symStart = params.m_symStart;
+    r.numSym = params.m_numSym;
+    r.size = params.m_tbSize;
+    r.rbs = params.m_rbAssignedNum;
+    r.sinr = static_cast<float>(params.m_sinr);
+    r.tbler = static_cast<float>(params.m_tbler);
+    r.corrupt = params.m_corrupt ? 1 : 0;
+    r.cqi = params.m_cqi;
+    r.count = 1;
+    Push(r);
+}
+
+inline void
+SliceTraceManager::Scheduling(uint8_t type, uint16_t cellId, NrSchedulingCallbackInfo info)
+{
+    TraceRecord r;
+    std::memset(&r, 0, sizeof(r));
+    r.timeNs = Simulator::Now().GetNanoSeconds();
+    r.type = type;
+    r.mcs = info.m_mcs;
+    r.rv = info.m_rv;
+    r.cellId = cellId;
+    r.rnti = info.m_rnti;
+    r.bwpId = info.m_bwpId;
+    r.frame = static_cast<uint16_t>(info.m_frameNum);
+    r.subframe = info.m_subframeNum;
+    r.slot = info.m_slotNum;
+    r.symStart = info.m_symStart;
+    r.numSym = info.m_numSym;
+    r.size = info.m_tbSize;
+    r.ndi = info.m_ndi;
+    r.harqId = info.m_harqId;
+    r.count = 1;
+    Push(r);
+}
+
+inline void
+SliceTraceManager::SlotDataStats(const SfnSf& sfnSf,
+                                 uint32_t scheduledUe,
+                                 uint32_t usedReg,
+                                 uint32_t usedSym,
+                                 uint32_t availableRb,
+                                 uint32_t availableSym,
+                                 uint16_t bwpId,
+                                 uint16_t cellId)
+{
+    TraceRecord r;
+    std::memset(&r, 0, sizeof(r));
+    r.timeNs = Simulator::Now().GetNanoSeconds();
+    r.type = TRACE_SLOT_STATS;
+    r.cellId = cellId;
+    r.bwpId = bwpId;
+    r.frame = static_cast<uint16_t>(sfnSf.GetFrame());
+    r.subframe = sfnSf.GetSubframe();
+    r.slot = sfnSf.GetSlot();
+    r.numSym = static_cast<uint8_t>(usedSym);
+    r.size = usedReg;
+    r.rbs = availableRb;
+    r.aux0 = availableSym;
+    r.aux1 = scheduledUe;
+    r.count = 1;
+    Push(r);
+}
+
+inline void
+SliceTraceManager::TxPdu(uint8_t type,
+                         std::string context,
+                         uint16_t rnti,
+                         uint8_t lcid,
+                         uint32_t size)
+{
+    TraceRecord r;
+    std::memset(&r, 0, sizeof(r));
+    r.timeNs = Simulator::Now().GetNanoSeconds();
+    r.type = type;
+    r.cellId = CellIdOfContext(context);
+    r.rnti = rnti;
+    r.size = size;
+    r.aux0 = lcid;
+    r.count = 1;
+    Push(r);
+}
+
+inline void
+SliceTraceManager::RxPdu(uint8_t type,
+                         std::string context,
+                         uint16_t rnti,
+                         uint8_t lcid,
+                         uint32_t size,
+                         uint64_t delay)
+{
+    TraceRecord r;
+    std::memset(&r, 0, sizeof(r));
+    r.timeNs = Simulator::Now().GetNanoSeconds();
+    r.type = type;
+    r.cellId = CellIdOfContext(context);
+    r.rnti = rnti;
+    r.size = size;
+    r.aux0 = lcid;
+    r.aux1 = static_cast<uint32_t>(delay / 1000);
+    r.count = 1;
+    Push(r);
+}
+
+/* static */
+inline uint16_t
+SliceTraceManager::CellIdOfContext(const std::string& context)
+{
+    uint32_t node;
+    uint32_t device;
+    if (std::sscanf(context.c_str(), "/NodeList/%u/DeviceList/%u", &node, &device) != 2)
+    {
+        return 0;
+    }
+    Ptr<NetDevice> dev = NodeList::GetNode(node)->GetDevice(device);
+    if (Ptr<NrGnbNetDevice> gnb = DynamicCast<NrGnbNetDevice>(dev))
+    {
+        return gnb->GetCellId();
+    }
+    if (Ptr<NrUeNetDevice> ue = DynamicCast<NrUeNetDevice>(dev))
+    {
+        return ue->GetCellId();
+    }
+    return 0;
+}
+
+} // namespace ns3
+
+#endif /* SLICING_TRACE_MANAGER_H */
@@ -0,0 +1,140 @@
+#ifndef SLICING_UE_REGISTRY_H
+#define SLICING_UE_REGISTRY_H
+
+#include "ns3/core-module.h"
+#include "ns3/internet-module.h"
+#include "ns3/network-module.h"
+#include "ns3/nr-module.h"
+
+#include <algorithm>
+#include <map>
+#include <vector>
+
+namespace ns3
+{
+
+/**
+ * Slice of each UE, by device, RNTI and IPv4 address.
+ *
+ * The UEs are added with their slice when they are installed; Resolve()
+ * reads their RNTIs once they are attached. Lookups by RNTI index a flat
+ * array, so trace sinks can use them on every packet. RNTIs are unique
+ * within a cell only, so the registry assumes a single cell.
+ */
+class SliceUeRegistry : public Object
+{
+  public:
+    /// A registered UE.
+    struct Ue
+    {
+        uint8_t slice;            //!< Slice index.
+        Ptr<NrUeNetDevice> dev;   //!< UE device.
+        Ipv4Address address;      //!< UE address.
+        uint16_t rnti;            //!< RNTI, 0 until resolved.
+    };
+
+    SliceUeRegistry()
+        : m_numSlices(0),
+          m_ueOfRnti(UINT16_MAX + 1, UINT32_MAX)
+    {
+    }
+
+    /**
+     * Register this type.
+     * \return The TypeId.
+     */
+    static TypeId GetTypeId()
+    {
+        static TypeId tid = TypeId("SliceUeRegistry")
+                                .SetParent<Object>()
+                                .SetGroupName("Tutorial")
+                                .AddConstructor<SliceUeRegistry>();
+        return tid;
+    }
+
+    /**
+     * Add the UEs of a slice.
+     * \param slice The slice index.
+     * \param ueDevices The UE devices.
+     * \param ueIpIface The interfaces of the UEs, in the same order.
+     */
+    void AddUes(uint8_t slice,
+                const NetDeviceContainer& ueDevices,
+                const Ipv4InterfaceContainer& ueIpIface)
+    {
+        NS_ABORT_MSG_IF(slice == UINT8_MAX, "Invalid slice");
+        for (uint32_t i = 0; i < ueDevices.GetN(); ++i)
+        {
+            Ue ue;
+            ue.slice = slice;
+            ue.dev = DynamicCast<NrUeNetDevice>(ueDevices.Get(i));
+            NS_ABORT_MSG_IF(!ue.dev, "Not a UE device");
+            ue.address = ueIpIface.GetAddress(i, 0);
+            ue.rnti = 0;
+            m_sliceOfAddress[ue.address] = slice;
+            m_ues.push_back(ue);
+        }
+        m_numSlices = std::max<uint32_t>(m_numSlices, slice + 1);
+    }
+
+    /// Read the RNTIs of the UEs; call it once they are attached.
+    void Resolve()
+    {
+        for (uint32_t i = 0; i < m_ues.size(); ++i)
+        {
+            m_ues[i].rnti = m_ues[i].dev->GetRrc()->GetRnti();
+            m_ueOfRnti[m_ues[i].rnti] = i;
+        }
+    }
+
+    /// \return The number of slices, one more than the highest slice index.
+    uint32_t GetNumSlices() const
+    {
+        return m_numSlices;
+    }
+
+    /// \return The registered UEs.
+    const std::vector<Ue>& GetUes() const
+    {
+        return m_ues;
+    }
+
+    /**
+     * \param rnti The RNTI.
+     * \return The slice of the UE, UINT8_MAX if unknown.
+     */
+    uint8_t GetSliceOfRnti(uint16_t rnti) const
+    {
+        uint32_t ue = m_ueOfRnti[rnti];
+        return ue == UINT32_MAX ? UINT8_MAX : m_ues[ue].slice;
+    }
+
+    /**
+     * \param rnti The RNTI.
+     * \return The index of the UE in GetUes(), UINT32_MAX if unknown.
+     */
+    uint32_t GetUeOfRnti(uint16_t rnti) const
+    {
+        return m_ueOfRnti[rnti];
+    }
+
+    /**
+     * \param address The IPv4 address.
+     * \return The slice of the UE, UINT8_MAX if unknown.
+     */
+    uint8_t GetSliceOfAddress(Ipv4Address address) const
+    {
+        auto it = m_sliceOfAddress.find(address);
+        return it == m_sliceOfAddress.end() ? UINT8_MAX : it->second;
+    }
+
+  private:
+    uint32_t m_numSlices;                           //!< Number of slices.
+    std::vector<Ue> m_ues;                          //!< Registered UEs.
+    std::vector<uint32_t> m_ueOfRnti;               //!< UE index of each RNTI.
+    std::map<Ipv4Address, uint8_t> m_sliceOfAddress; //!< Slice of each UE address.
+};
+
+} // namespace ns3
+
+#endif /* SLICING_UE_REGISTRY_H */
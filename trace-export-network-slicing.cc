@@ -0,0 +1,181 @@
+#include "ns3/core-module.h"
+
+#include "slicing-trace-manager.h"
+
+#include <cmath>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <vector>
+
+/**
+ * Export a binary trace file written by SliceTraceManager to the text files of
+ * NrHelper::EnableTraces(): RxPacketTrace.txt, NrDlMacStats.txt,
+ * NrUlMacStats.txt, the RLC and PDCP PDU statistics, and SlotStats.txt for
+ * the slot statistics, which the nr module only stores in a database.
+ *
+ * The MAC records carry no IMSI, so the IMSI column holds 0. For aggregated
+ * traces, a numEvents column is appended to the PHY and MAC files.
+ *
+ * Example:
+ * ./ns3 run "trace-export-network-slicing --traceFile=results.nrtrace --outputDir=traces"
+ */
+
+using namespace ns3;
+
+NS_LOG_COMPONENT_DEFINE("SlicingTraceExport");
+
+int
+main(int argc, char* argv[])
+{
+    std::string traceFile = "";
+    std::string outputDir = "./";
+    uint32_t chunk = 1 << 16;
+
+    CommandLine cmd(__FILE__);
+
+    cmd.AddValue("traceFile", "binary trace file written by sim-network-slicing", traceFile);
+    cmd.AddValue("outputDir", "directory where to store the text traces", outputDir);
+    cmd.AddValue("chunk", "number of records read at once", chunk);
+
+    cmd.Parse(argc, argv);
+
+    std::ifstream in(traceFile.c_str(), std::ifstream::in | std::ifstream::binary);
+    if (!in.is_open())
+    {
+        std::cerr << "Can't open file " << traceFile << std::endl;
+        return 1;
+    }
+    TraceFileHeader header;
+    if (!in.read(reinterpret_cast<char*>(&header), sizeof(header)) ||
+        std::memcmp(header.magic, g_traceMagic, sizeof(header.magic)) != 0)
+    {
+        std::cerr << traceFile << " is not a trace file" << std::endl;
+        return 1;
+    }
+    if (header.version != 1 || header.recordSize != sizeof(TraceRecord))
+    {
+        std::cerr << "Unsupported trace format version " << header.version << std::endl;
+        return 1;
+    }
+    bool aggregated = header.aggregated != 0;
+
+    // one output per record type, opened on first use
+    const char* names[TRACE_NUM_TYPES] = {"RxPacketTrace.txt",
+                                          "RxPacketTrace.txt",
+                                          "NrDlMacStats.txt",
+                                          "NrUlMacStats.txt",
+                                          "SlotStats.txt",
+                                          "NrDlTxRlcStats.txt",
+                                          "NrDlRxRlcStats.txt",
+                                          "NrUlTxRlcStats.txt",
+                                          "NrUlRxRlcStats.txt",
+                                          "NrDlTxPdcpStats.txt",
+                                          "NrDlRxPdcpStats.txt",
+                                          "NrUlTxPdcpStats.txt",
+                                          "NrUlRxPdcpStats.txt"};
+    std::map<std::string, std::unique_ptr<std::ofstream>> files;
+    auto open = [&](uint8_t type) -> std::ofstream& {
+        auto& file = files[names[type]];
+        if (file)
+        {
+            return *file;
+        }
+        file = std::make_unique<std::ofstream>(outputDir + "/" + names[type]);
+        std::ofstream& out = *file;
+        std::string extra = aggregated ? "\tnumEvents" : "";
+        if (type <= TRACE_RX_PACKET_UL)
+        {
+            out << "Time\tdirection\tframe\tsubF\tslot\t1stSym\tnSymbol\tcellId\tbwpId\trnti"
+                   "\ttbSize\tmcs\trank\trv\tSINR(dB)\tCQI\tcorrupt\tTBler"
+                << extra << "\n";
+        }
+        else if (type <= TRACE_UL_SCHED)
+        {
+            out << "% time(s)\tcellId\tbwpId\tIMSI\tRNTI\tframe\tsframe\tslot\tsymStart\tnumSym"
+                   "\tharqId\tndi\trv\tmcs\ttbSize"
+                << extra << "\n";
+        }
+        else if (type == TRACE_SLOT_STATS)
+        {
+            out << "% time(s)\tframe\tsframe\tslot\tbwpId\tcellId\tscheduledUe\tusedReg\tusedSym"
+                   "\tavailableRb\tavailableSym\n";
+        }
+        else if ((type - TRACE_RLC_DL_TX) % 2 == 0)
+        {
+            out << "% time(s)\tcellId\trnti\tlcid\tpacketSize\n";
+        }
+        else
+        {
+            out << "% time(s)\tcellId\trnti\tlcid\tpacketSize\tdelay(s)\n";
+        }
+        return out;
+    };
+
+    uint64_t numRecords = 0;
+    std::vector<TraceRecord> records(chunk);
+    while (in)
+    {
+        in.read(reinterpret_cast<char*>(records.data()), chunk * sizeof(TraceRecord));
+        std::size_t n = in.gcount() / sizeof(TraceRecord);
+        for (std::size_t i = 0; i < n; ++i)
+        {
+            const TraceRecord& r = records[i];
+            if (r.type >= TRACE_NUM_TYPES)
+            {
+                std::cerr << "Corrupted record " << numRecords + i << std::endl;
+                return 1;
+            }
+            std::ofstream& out = open(r.type);
+            double t = r.timeNs / 1e9;
+            if (r.type <= TRACE_RX_PACKET_UL)
+            {
+                out << t << "\t" << (r.type == TRACE_RX_PACKET_DL ? "DL" : "UL") << "\t"
+                    << r.frame << "\t" << +r.subframe << "\t" << +r.slot << "\t" << +r.symStart
+                    << "\t" << +r.numSym << "\t" << r.cellId << "\t" << r.bwpId << "\t" << r.rnti
+                    << "\t" << r.size << "\t" << +r.mcs << "\t" << +r.rank << "\t" << +r.rv
+                    << "\t" << 10 * std::log10(r.sinr) << "\t" << +r.cqi << "\t" << +r.corrupt
+                    << "\t" << r.tbler;
+            }
+            else if (r.type <= TRACE_UL_SCHED)
+            {
+                out << t << "\t" << r.cellId << "\t" << r.bwpId << "\t" << 0 << "\t" << r.rnti
+                    << "\t" << r.frame << "\t" << +r.subframe << "\t" << +r.slot << "\t"
+                    << +r.symStart << "\t" << +r.numSym << "\t" << +r.harqId << "\t" << +r.ndi
+                    << "\t" << +r.rv << "\t" << +r.mcs << "\t" << r.size;
+            }
+            else if (r.type == TRACE_SLOT_STATS)
+            {
+                out << t << "\t" << r.frame << "\t" << +r.subframe << "\t" << +r.slot << "\t"
+                    << r.bwpId << "\t" << r.cellId << "\t" << r.aux1 << "\t" << r.size << "\t"
+                    << +r.numSym << "\t" << r.rbs << "\t" << r.aux0;
+            }
+            else
+            {
+                out << t << "\t" << r.cellId << "\t" << r.rnti << "\t" << r.aux0 << "\t"
+                    << r.size;
+                if ((r.type - TRACE_RLC_DL_TX) % 2 == 1)
+                {
+                    out << "\t" << r.aux1 / 1e6;
+                }
+            }
+            if (aggregated && r.type <= TRACE_UL_SCHED)
+            {
+                out << "\t" << r.count;
+            }
+            out << "\n";
+        }
+        numRecords += n;
+    }
+
+    std::cout << "Exported " << numRecords << " records to " << files.size() << " files in "
+              << outputDir << std::endl;
+    if (header.samplingPeriod > 1)
+    {
+        std::cout << "Note: one of " << header.samplingPeriod << " records was kept per type"
+                  << std::endl;
+    }
+    return 0;
+}